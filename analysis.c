@@ -0,0 +1,382 @@
+#include "analysis.h"
+
+#include "board.h"
+#include "moves.h"
+#include "options.h"
+#include "sfInterface.h"
+#include "trace.h"
+#include "diag.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+#define ANALYSIS_MAGIC       0x41414350   // "PCAA"
+#define ANALYSIS_PROBES      8            // slots looked at for a position before one is given up
+#define ANALYSIS_LOCK_FILE   ANALYSIS_FILE ".lock"
+#define ANALYSIS_FIFTY_PLY   80           // past this the engine's answer depends on the history
+
+// The file is this followed by count entries
+typedef struct analysisHeader_s
+{
+   uint32_t magic;
+   uint32_t count;
+}analysisHeader_t;
+
+static analysisEntry_t table[ANALYSIS_MAX_ENTRIES];
+static bool_t loaded = FALSE;
+static bool_t dirty  = FALSE;
+
+static bool_t repeated( const game_t *g );
+static bool_t searchedEnough( const analysisEntry_t *e, const game_t *g );
+static analysisEntry_t *findSlot( U64 hash, uint8_t toMove, bool_t add );
+static bool_t mergeEntry( analysisEntry_t *into, const analysisEntry_t *from );
+static void   readFile( void );
+static int    compareHits( const void *a, const void *b );
+
+bool_t ANALYSIS_answer( const game_t *g, searchSummary_t *found )
+{
+   move_t list[MAX_LIST_SIZE], best, ponder = {0, 0, PIECE_NONE};
+   board_t b = g->brd;
+   analysisEntry_t *e;
+   int i, n;
+
+   if(!ANALYSIS_usable(g) || repeated(g) || g->brd.halfMoves > ANALYSIS_FIFTY_PLY)
+      return FALSE;
+
+   if( (e = findSlot(g->brd.hash, g->brd.toMove, FALSE)) == NULL)
+      return FALSE;
+
+   e->hits++;
+   dirty = TRUE;
+
+   if(!searchedEnough(e, g))
+      return FALSE;
+
+   best = SF_unpackMove(e->best);
+   n = findMoves(&b, list);
+
+   for(i=0;i<n;i++)
+   {
+      if(list[i].from == best.from && list[i].to == best.to &&
+         (list[i].promote == best.promote || best.promote < KNIGHT || best.promote > QUEEN))
+         break;
+   }
+
+   // Another position with the same hash
+   if(i >= n)
+   {
+      DLOG(DIAG_WARN, "Cached move for %s isn't legal\n", e->fen);
+      return FALSE;
+   }
+
+   if(e->ponder != 0)
+      ponder = SF_unpackMove(e->ponder);
+
+   DPRINT("Move from the analysis cache:  depth %d, %llu nodes, %u hits\n", e->depth,
+          (unsigned long long)e->nodes, e->hits);
+
+   SF_postResult(list[i], ponder);
+
+   found->best      = list[i];
+   found->ponder    = ponder;
+   found->hasPonder = (e->ponder != 0) ? TRUE : FALSE;
+   found->depth     = e->depth;
+   found->score     = e->score;
+   found->mate      = e->mate;
+   found->nodes     = e->nodes;
+
+   return TRUE;
+}
+
+void ANALYSIS_learn( const game_t *g, move_t played )
+{
+   searchSummary_t s;
+
+   if(!ANALYSIS_usable(g) || !SF_lastSearch(&s))
+      return;
+
+   if(s.best.from != played.from || s.best.to != played.to)
+      return;
+
+   ANALYSIS_keep(&g->brd, &s);
+}
+
+void ANALYSIS_keep( const board_t *b, const searchSummary_t *s )
+{
+   analysisEntry_t found, *e;
+
+   if(TRACE_isReplaying() || s->depth <= 0)
+      return;
+
+   memset(&found, 0x00, sizeof(found));
+
+   found.hash     = b->hash;
+   found.toMove   = b->toMove;
+   found.depth    = (s->depth > 255) ? 255 : s->depth;
+   found.mate     = s->mate;
+   found.score    = s->score;
+   found.best     = SF_packMove(s->best);
+   found.ponder   = s->hasPonder ? SF_packMove(s->ponder) : 0;
+   found.nodes    = s->nodes;
+   found.hits     = 1;
+   found.searched = time(NULL);
+
+   snprintf(found.fen, sizeof(found.fen), "%s", getFEN(b));
+
+   if( (e = findSlot(found.hash, found.toMove, TRUE)) != NULL && mergeEntry(e, &found))
+      dirty = TRUE;
+}
+
+void ANALYSIS_save( void )
+{
+   analysisHeader_t h = { ANALYSIS_MAGIC, 0 };
+   char temp[sizeof(ANALYSIS_FILE) + 24];
+   FILE *fp;
+   int i, lockFd, dirFd;
+
+   if(!dirty)
+      return;
+
+   // The board and piChessAnalyze both save:  one at a time, so neither loses what the other added
+   if( (lockFd = open(ANALYSIS_LOCK_FILE, O_RDWR | O_CREAT, 0644)) < 0 || flock(lockFd, LOCK_EX) != 0)
+   {
+      DLOG(DIAG_ERROR, "Unable to lock %s\n", ANALYSIS_LOCK_FILE);
+
+      if(lockFd >= 0)
+         close(lockFd);
+      return;
+   }
+
+   // What's been saved since it was loaded (piChessAnalyze) goes in too
+   readFile();
+
+   for(i=0;i<ANALYSIS_MAX_ENTRIES;i++)
+   {
+      if(table[i].depth != 0)
+         h.count++;
+   }
+
+   snprintf(temp, sizeof(temp), "%s.%d.tmp", ANALYSIS_FILE, (int)getpid());
+
+   if( (fp = fopen(temp, "w")) == NULL)
+   {
+      DLOG(DIAG_ERROR, "Unable to open %s\n", temp);
+      close(lockFd);
+      return;
+   }
+
+   fwrite(&h, sizeof(h), 1, fp);
+
+   for(i=0;i<ANALYSIS_MAX_ENTRIES;i++)
+   {
+      if(table[i].depth != 0)
+         fwrite(&table[i], sizeof(analysisEntry_t), 1, fp);
+   }
+
+   if(fflush(fp) | fsync(fileno(fp)) | ferror(fp) | fclose(fp) || rename(temp, ANALYSIS_FILE) != 0)
+   {
+      DLOG(DIAG_ERROR, "Unable to replace %s\n", ANALYSIS_FILE);
+      remove(temp);
+      close(lockFd);
+      return;
+   }
+
+   // Make the rename itself stick
+   if( (dirFd = open(CHESS_DIR, O_RDONLY)) >= 0)
+   {
+      fsync(dirFd);
+      close(dirFd);
+   }
+
+   close(lockFd);
+
+   DPRINT("Saved %u positions to %s\n", h.count, ANALYSIS_FILE);
+
+   dirty = FALSE;
+}
+
+int ANALYSIS_mostReached( analysisEntry_t *list, int max, int depth )
+{
+   analysisEntry_t **found;
+   int i, n = 0;
+
+   if(!loaded)
+   {
+      loaded = TRUE;
+      readFile();
+   }
+
+   if( (found = malloc(ANALYSIS_MAX_ENTRIES * sizeof(analysisEntry_t *))) == NULL)
+      return 0;
+
+   for(i=0;i<ANALYSIS_MAX_ENTRIES;i++)
+   {
+      if(table[i].depth != 0 && table[i].depth < depth)
+         found[n++] = &table[i];
+   }
+
+   qsort(found, n, sizeof(analysisEntry_t *), compareHits);
+
+   if(n > max)
+      n = max;
+
+   for(i=0;i<n;i++)
+      list[i] = *found[i];
+
+   free(found);
+
+   return n;
+}
+
+bool_t ANALYSIS_usable( const game_t *g )
+{
+   return (!TRACE_isReplaying() && !g->chess960 &&
+           getOption(OPT_ENGINE_STRENGTH) == MAX_STRENGTH &&
+           getOption(OPT_ENGINE_REPEATABLE) == FALSE) ? TRUE : FALSE;
+}
+
+// The position has come up before in the game
+static bool_t repeated( const game_t *g )
+{
+   int i;
+
+   for(i=0;i<g->playedMoves;i++)
+   {
+      if(g->posHistory[i].posHash == g->brd.hash)
+         return TRUE;
+   }
+
+   return FALSE;
+}
+
+// The entry was searched at least as far as the search about to start would go:  as deep, or as
+//   many nodes as the engine would get through in the time it would be given
+static bool_t searchedEnough( const analysisEntry_t *e, const game_t *g )
+{
+   uint64_t budgetMs;
+
+   if(getOption(OPT_TIME_CONTROL) == TIME_NONE)
+   {
+      switch(getOption(OPT_COMPUTER_STRATEGY))
+      {
+         case STRAT_FIXED_DEPTH:
+            return (e->depth >= getOption(OPT_SEARCH_DEPTH)) ? TRUE : FALSE;
+
+         case STRAT_FIXED_TIME:
+            budgetMs = options.game.timeControl.compStrategySetting.timeInMs;
+            break;
+
+         // Searches until the button:  nothing short of that will do
+         default:
+            return FALSE;
+      }
+   }
+   else if(g->brd.toMove == WHITE)
+      budgetMs = (uint64_t)g->wtime * 100 / NPS_BUDGET_MOVES + g->wIncrement * 100;
+   else
+      budgetMs = (uint64_t)g->btime * 100 / NPS_BUDGET_MOVES + g->bIncrement * 100;
+
+   return (e->nodes >= budgetMs * SF_engineNps() / 1000) ? TRUE : FALSE;
+}
+
+// The position's entry.  Failing that, with add, a slot for it:  an empty one, or the one of those
+//   it could go in that has come up least.
+static analysisEntry_t *findSlot( U64 hash, uint8_t toMove, bool_t add )
+{
+   analysisEntry_t *victim = NULL;
+   int i;
+
+   if(!loaded)
+   {
+      loaded = TRUE;
+      readFile();
+   }
+
+   for(i=0;i<ANALYSIS_PROBES;i++)
+   {
+      analysisEntry_t *e = &table[(hash + toMove + i) & (ANALYSIS_MAX_ENTRIES - 1)];
+
+      if(e->depth != 0 && e->hash == hash && e->toMove == toMove)
+         return e;
+
+      if(victim == NULL || (victim->depth != 0 && (e->depth == 0 || e->hits < victim->hits)))
+         victim = e;
+   }
+
+   return add ? victim : NULL;
+}
+
+// Put from into its slot, unless that already has the same position searched further.  TRUE if
+//   the slot has changed.
+static bool_t mergeEntry( analysisEntry_t *into, const analysisEntry_t *from )
+{
+   uint32_t hits;
+
+   if(into->depth == 0 || into->hash != from->hash || into->toMove != from->toMove)
+   {
+      *into = *from;
+      return TRUE;
+   }
+
+   hits = (into->hits > from->hits) ? into->hits : from->hits;
+
+   if(from->depth > into->depth || (from->depth == into->depth && from->nodes > into->nodes))
+   {
+      *into = *from;
+      into->hits = hits;
+      return TRUE;
+   }
+
+   if(into->hits != hits)
+   {
+      into->hits = hits;
+      return TRUE;
+   }
+
+   return FALSE;
+}
+
+// Merge the file into the table
+static void readFile( void )
+{
+   analysisHeader_t h;
+   analysisEntry_t e, *slot;
+   uint32_t i;
+   FILE *fp;
+
+   if( (fp = fopen(ANALYSIS_FILE, "r")) == NULL)
+      return;
+
+   if(fread(&h, sizeof(h), 1, fp) != 1 || h.magic != ANALYSIS_MAGIC)
+   {
+      DLOG(DIAG_WARN, "%s isn't an analysis file, ignored\n", ANALYSIS_FILE);
+      fclose(fp);
+      return;
+   }
+
+   for(i=0;i<h.count && fread(&e, sizeof(e), 1, fp) == 1;i++)
+   {
+      if(e.depth == 0)
+         continue;
+
+      e.fen[ANALYSIS_FEN_MAX - 1] = '\0';
+
+      if( (slot = findSlot(e.hash, e.toMove, TRUE)) != NULL)
+         mergeEntry(slot, &e);
+   }
+
+   fclose(fp);
+}
+
+static int compareHits( const void *a, const void *b )
+{
+   const analysisEntry_t *x = *(const analysisEntry_t * const *)a;
+   const analysisEntry_t *y = *(const analysisEntry_t * const *)b;
+
+   return (x->hits < y->hits) ? 1 : (x->hits > y->hits) ? -1 : 0;
+}
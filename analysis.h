@@ -0,0 +1,73 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+// Analysis cache
+//
+// What the engine found for the positions the computer has had to move from, kept between games
+//   in ANALYSIS_FILE:  for each position (its Polyglot hash and side to move, with its FEN so it
+//   can be searched again) the best move and the reply expected, the score, the depth and nodes
+//   searched, and how many computer turns it has come up on.
+//
+// When the computer is to move from a position whose entry covers at least what the search about
+//   to start would (the depth asked for, or the nodes the time allows at the engine's measured
+//   speed), its move is played instead of searching again.  It goes through the engine's result
+//   file like any other answer (SF_postResult()), so it is traced and replayed the same way, and
+//   arrives as soon as the poll task sees it.
+//
+// Only full strength searches go in or come out:  a capped level has its own (weaker) move to find
+//   and a repeatable search has to be searched to be repeated.  Nor is it used replaying, for
+//   Chess960, or for a position that has come up before in the game (the engine knows the
+//   repetitions, the cache doesn't).
+//
+// piChessAnalyze (analyzeTool.c) deepens the entries that come up most, off the board, e.g. from
+//   cron overnight.  It and the board both merge with the file when they save, keeping the deeper
+//   analysis of each position;  a lock file keeps two saves from overlapping.
+
+#include "types.h"
+#include "engine.h"
+#include "sfInterface.h"
+
+#define ANALYSIS_FILE         CHESS_DIR "/analysis.dat"
+#define ANALYSIS_MAX_ENTRIES  16384     // a power of 2
+#define ANALYSIS_FEN_MAX      100
+
+typedef struct analysisEntry_s
+{
+   U64      hash;
+   uint8_t  toMove;
+   uint8_t  depth;         // 0 for an empty slot
+   uint8_t  mate;          // score is moves to mate (negative if mated), not centipawns
+   uint8_t  reserved;
+   int16_t  score;         // for the side to move
+   uint16_t best;          // packed as the engine channel has them (SF_packMove())
+   uint16_t ponder;        // 0 if there wasn't one
+   uint32_t hits;          // computer turns it has come up on
+   uint32_t searched;      // time() of the search
+   uint64_t nodes;
+   char     fen[ANALYSIS_FEN_MAX];
+}analysisEntry_t;
+
+// The computer is about to search for its move in the game.  If the cache has an answer good
+//   enough, post it, fill in found as the search would have and return TRUE.
+bool_t ANALYSIS_answer( const game_t *g, searchSummary_t *found );
+
+// The engine has answered the search for a move in the game's position with played:  keep what it
+//   found
+void   ANALYSIS_learn( const game_t *g, move_t played );
+
+// Keep a full strength search of the position (a standard chess one) found some other way:  the
+//   background analysis' (idle.h)
+void   ANALYSIS_keep( const board_t *b, const searchSummary_t *s );
+
+// Whether a search for a move in the game is one the cache is for:  full strength and not
+//   repeatable, not replaying, not Chess960
+bool_t ANALYSIS_usable( const game_t *g );
+
+// Write the cache out if it has changed, merged with what's in the file now
+void   ANALYSIS_save( void );
+
+// Up to max of the entries searched less deep than depth, those that come up most first.  Returns
+//   how many.
+int    ANALYSIS_mostReached( analysisEntry_t *list, int max, int depth );
+
+#endif
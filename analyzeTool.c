@@ -0,0 +1,212 @@
+// Analysis cache deepening (piChessAnalyze)
+//
+// Searches the positions in the analysis cache (analysis.h) that the computer comes up against
+//   most again, deeper than they were, so more of its moves there can be played straight from the
+//   cache.  Meant for when the board is idle, e.g. from cron overnight:
+//
+//    piChessAnalyze [-n positions] [-d depth] [-m minutes] [-t threads]
+//
+//       -n   most positions to search (default 200)
+//       -d   depth to search them to;  only those searched less deep are taken (default 22)
+//       -m   stop starting searches after this many minutes (default:  no limit)
+//       -t   engine threads (default:  as the board picks them, one per core)
+//
+// The cache is saved after each position, merged with the file as it is then, so it can be
+//   stopped at any time and a game played meanwhile loses nothing.  Like engineBench it runs in a
+//   new directory under /tmp and the engine neither loads nor saves the board's hash table.
+
+#include "analysis.h"
+#include "sfInterface.h"
+#include "hsmDefs.h"
+#include "event.h"
+#include "options.h"
+#include "board.h"
+#include "moves.h"
+#include "util.h"
+#include "diag.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <semaphore.h>
+
+#define DEFAULT_POSITIONS   200
+#define DEFAULT_DEPTH       22
+#define REPLY_TIMEOUT_MS    3600000
+
+static game_t analyzeGame;
+
+static void   usage( const char *name );
+static bool_t analyze( const analysisEntry_t *e, int depth );
+static bool_t waitForReply( uint32_t timeoutMs );
+
+int main( int argc, char *argv[] )
+{
+   char dir[] = "/tmp/piChessAnalyze.XXXXXX";
+   analysisEntry_t *list;
+   long threads = ENGINE_AUTO;
+   int opt, i, n, positions = DEFAULT_POSITIONS, depth = DEFAULT_DEPTH, done = 0;
+   time_t deadline = 0;
+
+   while( (opt = getopt(argc, argv, "n:d:m:t:")) != -1)
+   {
+      switch(opt)
+      {
+         case 'n':
+            if( (positions = atoi(optarg)) < 1)
+               usage(argv[0]);
+            break;
+
+         case 'd':
+            if( (depth = atoi(optarg)) < 1 || depth > 255)
+               usage(argv[0]);
+            break;
+
+         case 'm':
+            if(atoi(optarg) < 1)
+               usage(argv[0]);
+            deadline = time(NULL) + atoi(optarg) * 60;
+            break;
+
+         case 't':
+            threads = atol(optarg);
+            break;
+
+         default:
+            usage(argv[0]);
+      }
+   }
+
+   if(mkdtemp(dir) == NULL || chdir(dir) != 0)
+   {
+      fprintf(stderr, "Unable to create work directory\n");
+      exit(-1);
+   }
+
+   // Engine messages only if something goes wrong
+   DIAG_init();
+   DIAG_setLevel(NULL, DIAG_WARN);
+
+   initEvent();
+   loadOptions();
+
+   setOption(OPT_ENGINE_THREADS, threads);
+   setOption(OPT_ENGINE_STRENGTH, MAX_STRENGTH);
+   setOption(OPT_ENGINE_REPEATABLE, FALSE);
+   SF_setHashFile("<empty>");
+
+   list = malloc(positions * sizeof(analysisEntry_t));
+
+   if( (n = ANALYSIS_mostReached(list, positions, depth)) == 0)
+   {
+      printf("No positions in %s searched less than depth %d\n", ANALYSIS_FILE, depth);
+      free(list);
+      return 0;
+   }
+
+   printf("Searching %d positions to depth %d, %d threads\n\n", n, depth, SF_threadCount());
+
+   SF_initEngine();
+
+   for(i=0;i<n && (deadline == 0 || time(NULL) < deadline);i++)
+   {
+      printf("%6u hits  depth %3d  %s\n", list[i].hits, list[i].depth, list[i].fen);
+      fflush(stdout);
+
+      if(analyze(&list[i], depth))
+         done++;
+
+      ANALYSIS_save();
+   }
+
+   SF_closeEngine();
+
+   printf("\n%d of %d positions searched\n", done, n);
+
+   free(list);
+   DIAG_flush();
+
+   return 0;
+}
+
+static void usage( const char *name )
+{
+   fprintf(stderr, "usage: %s [-n positions] [-d depth] [-m minutes] [-t threads]\n", name);
+   exit(-1);
+}
+
+// Search one position and keep what the engine finds
+static bool_t analyze( const analysisEntry_t *e, int depth )
+{
+   char line[40] = "";
+   move_t best;
+   FILE *fp;
+
+   free(analyzeGame.startPos);
+   memset(&analyzeGame, 0, sizeof(analyzeGame));
+
+   if(setBoard(&analyzeGame.brd, e->fen) != FEN_OK || analyzeGame.brd.hash != e->hash)
+   {
+      fprintf(stderr, "Bad FEN in cache, skipped\n");
+      return FALSE;
+   }
+
+   analyzeGame.startPos = strdup(e->fen);
+   analyzeGame.posHistory[0].posHash = analyzeGame.brd.hash;
+
+   SF_setGame(&analyzeGame);
+   SF_findMoveFixedDepth(depth);
+
+   if(!waitForReply(REPLY_TIMEOUT_MS))
+   {
+      fprintf(stderr, "No reply from the engine\n");
+      SF_stop();
+      return FALSE;
+   }
+
+   if( (fp = fopen(OUTPUT_FILE, "r")) != NULL)
+   {
+      if(fgets(line, sizeof(line), fp) == NULL)
+         line[0] = '\0';
+      fclose(fp);
+      remove(OUTPUT_FILE);
+   }
+
+   if(strncmp(line, "bestmove", 8))
+   {
+      fprintf(stderr, "Unexpected engine result [%s]\n", line);
+      return FALSE;
+   }
+
+   best = convertCoordMove(&line[9]);
+   ANALYSIS_learn(&analyzeGame, best);
+
+   return TRUE;
+}
+
+// Wait for sfInterface to post the engine's answer, as the state machine would get it
+static bool_t waitForReply( uint32_t timeoutMs )
+{
+   struct timespec deadline;
+   event_t *ev;
+
+   clock_gettime(CLOCK_REALTIME, &deadline);
+   deadline.tv_sec  += timeoutMs / 1000 + (deadline.tv_nsec + (timeoutMs % 1000) * 1000000L) / 1000000000L;
+   deadline.tv_nsec  = (deadline.tv_nsec + (timeoutMs % 1000) * 1000000L) % 1000000000L;
+
+   while(1)
+   {
+      if(sem_timedwait(getQueueSem(EVQ_EVENT_MANAGER), &deadline) != 0)
+      {
+         if(errno == EINTR)
+            continue;
+         return FALSE;
+      }
+
+      if( (ev = getEvent(EVQ_EVENT_MANAGER)) != NULL && ev->ev == EV_PROCESS_COMPUTER_MOVE)
+         return TRUE;
+   }
+}
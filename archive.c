@@ -0,0 +1,1035 @@
+#include "archive.h"
+
+#include "board.h"
+#include "moves.h"
+#include "diag.h"
+#include "options.h"
+#include "pgn.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define ARCHIVE_GAME_MAGIC       0x41474350   // "PCGA"
+#define ARCHIVE_INDEX_MAGIC      0x49474350   // "PCGI"
+
+#define ARCHIVE_INDEX_TEMP_FILE  ARCHIVE_INDEX_FILE ".tmp"
+
+#define ARCHIVE_WHITE_COMPUTER   0x01
+#define ARCHIVE_BLACK_COMPUTER   0x02
+
+#define ARCHIVE_CHESS960         0x01
+#define ARCHIVE_IMPORTED         0x02         // read from a PGN file, not played on the board
+#define ARCHIVE_NAMES            0x04         // players' names follow the FEN
+
+#define ARCHIVE_SCAN_CHUNK       256          // index entries read at a time scanning the tail
+#define ARCHIVE_MERGE_RUN        65536        // index entries sorted in memory at a time
+#define ARCHIVE_MERGE_BUF        64           // entries read at a time from each run being merged
+
+// Start of each game in the games file.  Followed by fenLength characters of FEN, the names (a
+//   length byte and the characters, white then black) if flags has ARCHIVE_NAMES, plies packed
+//   moves (uint16_t) and, unless timing is TIME_NONE, both clocks after each of them (uint32_t[2]).
+typedef struct archiveGame_s
+{
+   uint32_t magic;          // ARCHIVE_GAME_MAGIC
+   uint32_t date;           // time() the game was saved;  imported, YYYYMMDD (0 for a part not known)
+   uint16_t plies;
+   uint8_t  result;         // archiveResult_t
+   uint8_t  reason;         // endReason_t
+   uint8_t  players;        // ARCHIVE_WHITE_COMPUTER, ARCHIVE_BLACK_COMPUTER
+   uint8_t  timing;         // timingType_t
+   uint8_t  fenLength;      // 0 for the standard start
+   uint8_t  flags;          // ARCHIVE_CHESS960, ARCHIVE_IMPORTED, ARCHIVE_NAMES
+   periodTimingSettings_t timeSettings[3];   // as options.game.timeControl had them
+   uint32_t clocks[2];      // at the start, 0.1 seconds
+}archiveGame_t;
+
+typedef struct archiveIndexHeader_s
+{
+   uint32_t magic;          // ARCHIVE_INDEX_MAGIC
+   uint32_t count;          // entries in the index
+   uint32_t sorted;         // of those, how many at the start are in order
+   uint32_t covered;        // bytes of the games file indexed
+}archiveIndexHeader_t;
+
+typedef struct archiveEntry_s
+{
+   U64      hash;
+   uint32_t game;           // offset in the games file
+   uint16_t next;           // packed move played from the position, 0 if the game ended there
+   uint16_t ply    : 12;
+   uint16_t result : 4;     // archiveResult_t
+}archiveEntry_t;
+
+// A game read back from the games file, or being written to it
+typedef struct archivedGame_s
+{
+   archiveGame_t hdr;
+   char          fen[256];
+   char          white[256];
+   char          black[256];
+   uint16_t      moves[MAX_MOVES_IN_GAME];
+   uint32_t      clocks[MAX_MOVES_IN_GAME][2];
+}archivedGame_t;
+
+// The moves played from a position, for ARCHIVE_positionStats()
+typedef struct nextMoves_s
+{
+   archiveStats_t *stats;
+   int             count;
+   uint16_t        move[MAX_LIST_SIZE];
+   int             times[MAX_LIST_SIZE];
+}nextMoves_t;
+
+// Matches collected for ARCHIVE_lookup()
+typedef struct matchList_s
+{
+   archiveMatch_t *matches;
+   int             max;
+   int             total;
+}matchList_t;
+
+// A sorted stretch of the index, being merged
+typedef struct mergeRun_s
+{
+   uint32_t       next;     // next entry to read into buf
+   uint32_t       end;
+   int            count;    // entries in buf
+   int            pos;      // next of those to merge
+   archiveEntry_t buf[ARCHIVE_MERGE_BUF];
+}mergeRun_t;
+
+typedef void (*matchFunc_t)( const archiveEntry_t *e, void *ctx );
+
+static bool_t saved = FALSE;
+
+// One game at a time is read or indexed
+static archivedGame_t archived;
+static archiveEntry_t gameEntries[MAX_MOVES_IN_GAME];
+
+static archiveResult_t gameResult( const board_t *b, endReason_t reason );
+static uint16_t packMove( move_t m );
+static move_t unpackMove( uint16_t packed );
+static bool_t writeRecord( FILE *fp, archivedGame_t *g );
+static int readGame( FILE *fp, archivedGame_t *g );
+static bool_t readName( FILE *fp, char *name );
+static off_t entryPos( uint32_t i );
+static int indexGame( const archivedGame_t *g, uint32_t offset, archiveEntry_t *entries );
+static archiveErr_t syncIndex( void );
+static archiveErr_t mergeIndex( void );
+static bool_t fillRun( FILE *idx, mergeRun_t *run );
+static int findPosition( U64 hash, matchFunc_t found, void *ctx );
+static int compareEntries( const void *a, const void *b );
+static void writeGamePGN( FILE *out, const archivedGame_t *g );
+static void timeControlText( char *text, int size, const periodTimingSettings_t *p, int periods );
+static uint32_t parseDate( const char *date );
+static void dateText( char *text, uint32_t date );
+static void addMatch( const archiveEntry_t *e, void *ctx );
+static void addStats( const archiveEntry_t *e, void *ctx );
+
+void ARCHIVE_newGame( void )
+{
+   saved = FALSE;
+}
+
+archiveErr_t ARCHIVE_saveGame( const game_t *g, endReason_t reason )
+{
+   archiveGame_t *hdr = &archived.hdr;
+   archiveErr_t err;
+   board_t start = g->brd;
+   board_t standard;
+   FILE *fp;
+   int i;
+
+   if(saved || g->playedMoves == 0)
+      return ARCHIVE_NO_ERROR;
+
+   saved = TRUE;
+
+   // Any damaged game at the end of the file goes before this one is added after it
+   if( (err = syncIndex()) != ARCHIVE_NO_ERROR)
+      return err;
+
+   for(i=g->playedMoves-1;i>=0;i--)
+      unmove(&start, g->posHistory[i].revMove);
+
+   memset(hdr, 0x00, sizeof(*hdr));
+
+   hdr->date    = (uint32_t)time(NULL);
+   hdr->plies   = g->playedMoves;
+   hdr->result  = gameResult(&g->brd, reason);
+   hdr->reason  = reason;
+   hdr->players = (getOption(OPT_WHITE_PLAYER) == PLAYER_COMPUTER ? ARCHIVE_WHITE_COMPUTER : 0) |
+                  (getOption(OPT_BLACK_PLAYER) == PLAYER_COMPUTER ? ARCHIVE_BLACK_COMPUTER : 0);
+   hdr->timing  = getOption(OPT_TIME_CONTROL);
+   hdr->flags   = g->chess960 ? ARCHIVE_CHESS960 : 0;
+   hdr->clocks[WHITE] = g->posHistory[0].clocks[WHITE];
+   hdr->clocks[BLACK] = g->posHistory[0].clocks[BLACK];
+
+   memcpy(hdr->timeSettings, options.game.timeControl.timeSettings, sizeof(hdr->timeSettings));
+
+   setBoard(&standard, NULL);
+
+   if(start.hash != standard.hash || start.moveNumber != 1 || start.halfMoves != 0)
+      strcpy(archived.fen, getFEN(&start));
+   else
+      archived.fen[0] = '\0';
+
+   archived.white[0] = archived.black[0] = '\0';
+
+   for(i=0;i<g->playedMoves;i++)
+   {
+      archived.moves[i] = packMove(g->posHistory[i].move);
+      archived.clocks[i][WHITE] = g->posHistory[i + 1].clocks[WHITE];
+      archived.clocks[i][BLACK] = g->posHistory[i + 1].clocks[BLACK];
+   }
+
+   if( (fp = fopen(ARCHIVE_FILE, "ab")) == NULL)
+   {
+      DLOG(DIAG_ERROR, "Unable to open %s\n", ARCHIVE_FILE);
+      return ARCHIVE_FILE_ERROR;
+   }
+
+   // Appending, but where that is has to be known to tell whether there's room
+   fseeko(fp, 0, SEEK_END);
+
+   if(!writeRecord(fp, &archived))
+   {
+      DLOG(DIAG_ERROR, "%s is full\n", ARCHIVE_FILE);
+      fclose(fp);
+      return ARCHIVE_FULL;
+   }
+
+   if(ferror(fp) | fclose(fp))
+   {
+      DLOG(DIAG_ERROR, "Unable to write %s\n", ARCHIVE_FILE);
+      return ARCHIVE_FILE_ERROR;
+   }
+
+   DPRINT("Game archived (%d plies, result %d)\n", hdr->plies, hdr->result);
+
+   return syncIndex();
+}
+
+int ARCHIVE_lookup( U64 hash, archiveMatch_t *matches, int max )
+{
+   matchList_t found = { matches, max, 0 };
+
+   if(findPosition(hash, addMatch, &found) < 0)
+      return -1;
+
+   return found.total;
+}
+
+archiveErr_t ARCHIVE_positionStats( U64 hash, archiveStats_t *stats )
+{
+   nextMoves_t next;
+
+   memset(stats, 0x00, sizeof(*stats));
+
+   next.stats = stats;
+   next.count = 0;
+
+   if(findPosition(hash, addStats, &next) < 0)
+      return ARCHIVE_FILE_ERROR;
+
+   return ARCHIVE_NO_ERROR;
+}
+
+archiveErr_t ARCHIVE_writePGN( FILE *out )
+{
+   FILE *fp;
+   int r;
+
+   if( (fp = fopen(ARCHIVE_FILE, "rb")) == NULL)
+      return ARCHIVE_FILE_ERROR;
+
+   while( (r = readGame(fp, &archived)) > 0)
+      writeGamePGN(out, &archived);
+
+   fclose(fp);
+
+   return (r < 0) ? ARCHIVE_BAD_RECORD : ARCHIVE_NO_ERROR;
+}
+
+archiveErr_t ARCHIVE_importPGN( FILE *in, archiveImport_t *report )
+{
+   static pgnGame_t pg;
+   archiveGame_t *hdr = &archived.hdr;
+   pgnReader_t reader;
+   archiveErr_t err;
+   bool_t full = FALSE, partial;
+   FILE *fp;
+   int i;
+
+   memset(report, 0x00, sizeof(*report));
+
+   if( (err = syncIndex()) != ARCHIVE_NO_ERROR)
+      return err;
+
+   if( (fp = fopen(ARCHIVE_FILE, "ab")) == NULL)
+   {
+      DLOG(DIAG_ERROR, "Unable to open %s\n", ARCHIVE_FILE);
+      return ARCHIVE_FILE_ERROR;
+   }
+
+   // Appending, but where that is has to be known to tell whether there's room
+   fseeko(fp, 0, SEEK_END);
+
+   PGN_initReader(&reader, in);
+
+   // Everything goes on the end of the games file first, then is indexed in one go
+   while(PGN_readGame(&reader, &pg) == PGN_OK)
+   {
+      if(pg.plies == 0)
+      {
+         report->skipped++;
+         continue;
+      }
+
+      partial = (pg.badPly >= 0 || pg.truncated) ? TRUE : FALSE;
+
+      memset(hdr, 0x00, sizeof(*hdr));
+
+      hdr->date   = parseDate(pg.date);
+      hdr->plies  = pg.plies;
+      hdr->result = !strcmp(pg.result, "1-0")     ? RESULT_WHITE_WINS :
+                    !strcmp(pg.result, "0-1")     ? RESULT_BLACK_WINS :
+                    !strcmp(pg.result, "1/2-1/2") ? RESULT_DRAW : RESULT_UNFINISHED;
+      hdr->reason = GAME_END_ABORT;
+      hdr->timing = TIME_NONE;
+      hdr->flags  = ARCHIVE_IMPORTED;
+
+      strcpy(archived.fen, pg.fen);
+      strcpy(archived.white, pg.white);
+      strcpy(archived.black, pg.black);
+
+      for(i=0;i<pg.plies;i++)
+         archived.moves[i] = packMove(pg.moves[i]);
+
+      if(!writeRecord(fp, &archived))
+      {
+         DLOG(DIAG_ERROR, "%s is full\n", ARCHIVE_FILE);
+         full = TRUE;
+         break;
+      }
+
+      report->games++;
+
+      if(partial)
+         report->partial++;
+   }
+
+   if(ferror(fp) | fclose(fp))
+   {
+      DLOG(DIAG_ERROR, "Unable to write %s\n", ARCHIVE_FILE);
+      return ARCHIVE_FILE_ERROR;
+   }
+
+   DPRINT("Imported %ld games (%ld partly, %ld skipped)\n", report->games, report->partial,
+          report->skipped);
+
+   if( (err = syncIndex()) != ARCHIVE_NO_ERROR)
+      return err;
+
+   return full ? ARCHIVE_FULL : ARCHIVE_NO_ERROR;
+}
+
+archiveErr_t ARCHIVE_rebuildIndex( void )
+{
+   remove(ARCHIVE_INDEX_FILE);
+
+   return syncIndex();
+}
+
+static archiveResult_t gameResult( const board_t *b, endReason_t reason )
+{
+   // The side to move at the end is the one mated or out of time
+   archiveResult_t moverLoses = (b->toMove == WHITE) ? RESULT_BLACK_WINS : RESULT_WHITE_WINS;
+
+   switch(reason)
+   {
+      case GAME_END_CHECKMATE:
+      case GAME_END_TIME_EXPIRED:
+         return moverLoses;
+
+      case GAME_END_TB_WHITE_WINS:
+         return RESULT_WHITE_WINS;
+
+      case GAME_END_TB_BLACK_WINS:
+         return RESULT_BLACK_WINS;
+
+      case GAME_END_ABORT:
+         return RESULT_UNFINISHED;
+
+      default:
+         return RESULT_DRAW;
+   }
+}
+
+// Same layout as the engine channel's moves (SF_setBoard())
+static uint16_t packMove( move_t m )
+{
+   return m.from | m.to << 6 | ((m.promote >= KNIGHT && m.promote <= QUEEN) ? m.promote << 12 : 0);
+}
+
+static move_t unpackMove( uint16_t packed )
+{
+   move_t m;
+
+   m.from    = packed & 0x3F;
+   m.to      = (packed >> 6) & 0x3F;
+   m.promote = (packed >> 12) ? (packed >> 12) & 0x07 : PIECE_NONE;
+
+   return m;
+}
+
+// Write a game at the file position (the end of the games file).  FALSE, with nothing written, if
+//   it would take the file past ARCHIVE_MAX_SIZE.
+static bool_t writeRecord( FILE *fp, archivedGame_t *g )
+{
+   off_t size;
+   uint8_t len;
+
+   g->hdr.magic     = ARCHIVE_GAME_MAGIC;
+   g->hdr.fenLength = strlen(g->fen);
+
+   if(g->white[0] != '\0' || g->black[0] != '\0')
+      g->hdr.flags |= ARCHIVE_NAMES;
+
+   size = sizeof(g->hdr) + g->hdr.fenLength + g->hdr.plies * sizeof(g->moves[0]);
+
+   if(g->hdr.flags & ARCHIVE_NAMES)
+      size += 2 + strlen(g->white) + strlen(g->black);
+
+   if(g->hdr.timing != TIME_NONE)
+      size += g->hdr.plies * sizeof(g->clocks[0]);
+
+   if(ftello(fp) + size > ARCHIVE_MAX_SIZE)
+      return FALSE;
+
+   fwrite(&g->hdr, sizeof(g->hdr), 1, fp);
+   fwrite(g->fen, 1, g->hdr.fenLength, fp);
+
+   if(g->hdr.flags & ARCHIVE_NAMES)
+   {
+      len = strlen(g->white);
+      fwrite(&len, 1, 1, fp);
+      fwrite(g->white, 1, len, fp);
+
+      len = strlen(g->black);
+      fwrite(&len, 1, 1, fp);
+      fwrite(g->black, 1, len, fp);
+   }
+
+   fwrite(g->moves, sizeof(g->moves[0]), g->hdr.plies, fp);
+
+   if(g->hdr.timing != TIME_NONE)
+      fwrite(g->clocks, sizeof(g->clocks[0]), g->hdr.plies, fp);
+
+   return TRUE;
+}
+
+// Read the game at the file position.  1 if one was read, 0 at the end of the file, -1 if what's
+//   there isn't a whole game.
+static int readGame( FILE *fp, archivedGame_t *g )
+{
+   size_t n = fread(&g->hdr, 1, sizeof(g->hdr), fp);
+
+   if(n == 0 && feof(fp))
+      return 0;
+
+   if(n != sizeof(g->hdr) || g->hdr.magic != ARCHIVE_GAME_MAGIC || g->hdr.plies >= MAX_MOVES_IN_GAME)
+      return -1;
+
+   if(fread(g->fen, 1, g->hdr.fenLength, fp) != g->hdr.fenLength)
+      return -1;
+
+   g->fen[g->hdr.fenLength] = '\0';
+   g->white[0] = g->black[0] = '\0';
+
+   if((g->hdr.flags & ARCHIVE_NAMES) && (!readName(fp, g->white) || !readName(fp, g->black)))
+      return -1;
+
+   if(fread(g->moves, sizeof(g->moves[0]), g->hdr.plies, fp) != g->hdr.plies)
+      return -1;
+
+   if(g->hdr.timing != TIME_NONE)
+   {
+      if(fread(g->clocks, sizeof(g->clocks[0]), g->hdr.plies, fp) != g->hdr.plies)
+         return -1;
+   }
+   else
+   {
+      memset(g->clocks, 0x00, g->hdr.plies * sizeof(g->clocks[0]));
+   }
+
+   return 1;
+}
+
+static bool_t readName( FILE *fp, char *name )
+{
+   uint8_t len;
+
+   if(fread(&len, 1, 1, fp) != 1 || fread(name, 1, len, fp) != len)
+      return FALSE;
+
+   name[len] = '\0';
+
+   return TRUE;
+}
+
+// Where index entry i is in the index file
+static off_t entryPos( uint32_t i )
+{
+   return sizeof(archiveIndexHeader_t) + (off_t)i * sizeof(archiveEntry_t);
+}
+
+// Index entries for the positions in a game, the first time each is reached.  Returns how many.
+static int indexGame( const archivedGame_t *g, uint32_t offset, archiveEntry_t *entries )
+{
+   board_t b;
+   int ply, i, count = 0;
+
+   if(setBoard(&b, g->hdr.fenLength ? g->fen : NULL) != FEN_OK)
+      return 0;
+
+   for(ply=0;ply<=g->hdr.plies;ply++)
+   {
+      for(i=0;i<count && entries[i].hash != b.hash;i++);
+
+      if(i == count)
+      {
+         entries[count].hash   = b.hash;
+         entries[count].game   = offset;
+         entries[count].ply    = ply;
+         entries[count].next   = (ply < g->hdr.plies) ? g->moves[ply] : 0;
+         entries[count].result = g->hdr.result;
+         count++;
+      }
+
+      if(ply < g->hdr.plies)
+         move(&b, unpackMove(g->moves[ply]));
+   }
+
+   return count;
+}
+
+// Index whatever the index doesn't cover of the games file yet (all of it if there's no index, or
+//   it's damaged).  A game cut short at the end of the file is dropped;  one past ARCHIVE_MAX_SIZE
+//   (in a file grown some other way) is left out of the index.
+static archiveErr_t syncIndex( void )
+{
+   archiveIndexHeader_t ih;
+   struct stat st;
+   FILE *idx, *games;
+   off_t offset;
+   int r, n;
+
+   if(stat(ARCHIVE_FILE, &st) != 0)
+      st.st_size = 0;
+
+   if( (idx = fopen(ARCHIVE_INDEX_FILE, "r+b")) == NULL ||
+       fread(&ih, sizeof(ih), 1, idx) != 1 || ih.magic != ARCHIVE_INDEX_MAGIC ||
+       ih.sorted > ih.count || ih.covered > st.st_size)
+   {
+      if(idx != NULL)
+      {
+         DLOG(DIAG_WARN, "Rebuilding %s\n", ARCHIVE_INDEX_FILE);
+         fclose(idx);
+      }
+
+      if( (idx = fopen(ARCHIVE_INDEX_FILE, "w+b")) == NULL)
+      {
+         DLOG(DIAG_ERROR, "Unable to create %s\n", ARCHIVE_INDEX_FILE);
+         return ARCHIVE_FILE_ERROR;
+      }
+
+      memset(&ih, 0x00, sizeof(ih));
+      ih.magic = ARCHIVE_INDEX_MAGIC;
+
+      fwrite(&ih, sizeof(ih), 1, idx);
+   }
+
+   if(ih.covered == st.st_size)
+   {
+      fclose(idx);
+      return ARCHIVE_NO_ERROR;
+   }
+
+   if( (games = fopen(ARCHIVE_FILE, "rb")) == NULL)
+   {
+      fclose(idx);
+      return ARCHIVE_FILE_ERROR;
+   }
+
+   fseeko(games, ih.covered, SEEK_SET);
+
+   // Entries go after the ones the header counts (anything beyond those is left from a save cut short)
+   fseeko(idx, entryPos(ih.count), SEEK_SET);
+
+   while(1)
+   {
+      offset = ftello(games);
+
+      if( (r = readGame(games, &archived)) <= 0)
+         break;
+
+      if(ftello(games) > ARCHIVE_MAX_SIZE)
+      {
+         DLOG(DIAG_WARN, "%s is too big to index past %lld\n", ARCHIVE_FILE, (long long)offset);
+         break;
+      }
+
+      n = indexGame(&archived, (uint32_t)offset, gameEntries);
+
+      fwrite(gameEntries, sizeof(gameEntries[0]), n, idx);
+      ih.count += n;
+   }
+
+   fclose(games);
+
+   if(r < 0)
+   {
+      DLOG(DIAG_WARN, "Dropping the damaged game at %lld in %s\n", (long long)offset, ARCHIVE_FILE);
+
+      if(truncate(ARCHIVE_FILE, offset) != 0)
+         DLOG(DIAG_ERROR, "Unable to truncate %s\n", ARCHIVE_FILE);
+   }
+
+   ih.covered = (uint32_t)offset;
+
+   // The entries are written before the header that counts them
+   fflush(idx);
+   fseeko(idx, 0, SEEK_SET);
+   fwrite(&ih, sizeof(ih), 1, idx);
+
+   if(ferror(idx) | fclose(idx))
+   {
+      DLOG(DIAG_ERROR, "Unable to write %s\n", ARCHIVE_INDEX_FILE);
+      return ARCHIVE_FILE_ERROR;
+   }
+
+   if(ih.count - ih.sorted > ARCHIVE_INDEX_TAIL_MAX)
+      return mergeIndex();
+
+   return ARCHIVE_NO_ERROR;
+}
+
+// Sort the unsorted entries at the end of the index into the rest.  The tail is sorted in place a
+//   run of ARCHIVE_MERGE_RUN entries at a time, then the sorted part and the runs are merged into a
+//   new file that replaces the index, so the memory needed doesn't grow with the archive and the old
+//   index stands if this is cut short.  (A run sorted in place still has each position's entries in
+//   the order the games were played, so a scan of the tail finds them as before.)
+static archiveErr_t mergeIndex( void )
+{
+   archiveIndexHeader_t ih;
+   archiveEntry_t *chunk;
+   mergeRun_t *runs;
+   FILE *idx, *out;
+   uint32_t start, n;
+   int runCount = 0, i, best;
+
+   if( (idx = fopen(ARCHIVE_INDEX_FILE, "r+b")) == NULL || fread(&ih, sizeof(ih), 1, idx) != 1)
+   {
+      if(idx != NULL) fclose(idx);
+      return ARCHIVE_FILE_ERROR;
+   }
+
+   chunk = malloc(ARCHIVE_MERGE_RUN * sizeof(archiveEntry_t));
+   runs  = malloc((2 + (ih.count - ih.sorted) / ARCHIVE_MERGE_RUN) * sizeof(mergeRun_t));
+
+   if(chunk == NULL || runs == NULL)
+   {
+      free(chunk);
+      free(runs);
+      fclose(idx);
+      return ARCHIVE_NO_MEM;
+   }
+
+   if(ih.sorted > 0)
+   {
+      runs[runCount].next = 0;
+      runs[runCount++].end = ih.sorted;
+   }
+
+   for(start=ih.sorted;start<ih.count;start+=n)
+   {
+      n = ih.count - start;
+
+      if(n > ARCHIVE_MERGE_RUN)
+         n = ARCHIVE_MERGE_RUN;
+
+      fseeko(idx, entryPos(start), SEEK_SET);
+
+      if(fread(chunk, sizeof(archiveEntry_t), n, idx) != n)
+         break;
+
+      qsort(chunk, n, sizeof(archiveEntry_t), compareEntries);
+
+      fseeko(idx, entryPos(start), SEEK_SET);
+      fwrite(chunk, sizeof(archiveEntry_t), n, idx);
+
+      runs[runCount].next = start;
+      runs[runCount++].end = start + n;
+   }
+
+   free(chunk);
+
+   if(start < ih.count || fflush(idx) != 0 || (out = fopen(ARCHIVE_INDEX_TEMP_FILE, "wb")) == NULL)
+   {
+      free(runs);
+      fclose(idx);
+      return ARCHIVE_FILE_ERROR;
+   }
+
+   for(i=0;i<runCount;i++)
+      runs[i].count = runs[i].pos = 0;
+
+   ih.sorted = ih.count;
+   fwrite(&ih, sizeof(ih), 1, out);
+
+   while(1)
+   {
+      best = -1;
+
+      for(i=0;i<runCount;i++)
+      {
+         if(fillRun(idx, &runs[i]) &&
+            (best < 0 || compareEntries(&runs[i].buf[runs[i].pos], &runs[best].buf[runs[best].pos]) < 0))
+            best = i;
+      }
+
+      if(best < 0)
+         break;
+
+      fwrite(&runs[best].buf[runs[best].pos++], sizeof(archiveEntry_t), 1, out);
+   }
+
+   free(runs);
+   fclose(idx);
+
+   if(ferror(out) | fclose(out) || rename(ARCHIVE_INDEX_TEMP_FILE, ARCHIVE_INDEX_FILE) != 0)
+   {
+      DLOG(DIAG_ERROR, "Unable to replace %s\n", ARCHIVE_INDEX_FILE);
+      return ARCHIVE_FILE_ERROR;
+   }
+
+   DPRINT("Merged %d runs into %s (%d entries)\n", runCount, ARCHIVE_INDEX_FILE, ih.count);
+
+   return ARCHIVE_NO_ERROR;
+}
+
+// Make sure a run being merged has an entry buffered.  FALSE once it's used up.
+static bool_t fillRun( FILE *idx, mergeRun_t *run )
+{
+   uint32_t n;
+
+   if(run->pos < run->count)
+      return TRUE;
+
+   if(run->next >= run->end)
+      return FALSE;
+
+   n = run->end - run->next;
+
+   if(n > ARCHIVE_MERGE_BUF)
+      n = ARCHIVE_MERGE_BUF;
+
+   fseeko(idx, entryPos(run->next), SEEK_SET);
+
+   if(fread(run->buf, sizeof(archiveEntry_t), n, idx) != n)
+   {
+      run->next = run->end;
+      return FALSE;
+   }
+
+   run->next += n;
+   run->count = n;
+   run->pos   = 0;
+
+   return TRUE;
+}
+
+// Pass each index entry for the position to found, in the order the games were played:  a binary
+//   search of the sorted entries, then a scan of the rest.  Returns the number found, -1 on error.
+static int findPosition( U64 hash, matchFunc_t found, void *ctx )
+{
+   archiveIndexHeader_t ih;
+   archiveEntry_t chunk[ARCHIVE_SCAN_CHUNK];
+   uint32_t lo, hi, mid, i, n;
+   FILE *idx;
+   int total = 0;
+
+   if(syncIndex() != ARCHIVE_NO_ERROR)
+      return -1;
+
+   if( (idx = fopen(ARCHIVE_INDEX_FILE, "rb")) == NULL || fread(&ih, sizeof(ih), 1, idx) != 1)
+   {
+      if(idx != NULL) fclose(idx);
+      return -1;
+   }
+
+   lo = 0;
+   hi = ih.sorted;
+
+   while(lo < hi)
+   {
+      mid = lo + (hi - lo) / 2;
+
+      fseeko(idx, entryPos(mid), SEEK_SET);
+
+      if(fread(chunk, sizeof(archiveEntry_t), 1, idx) != 1)
+         break;
+
+      if(chunk[0].hash < hash)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   fseeko(idx, entryPos(lo), SEEK_SET);
+
+   for(i=lo;i<ih.sorted && fread(chunk, sizeof(archiveEntry_t), 1, idx) == 1 && chunk[0].hash == hash;i++)
+   {
+      found(&chunk[0], ctx);
+      total++;
+   }
+
+   fseeko(idx, entryPos(ih.sorted), SEEK_SET);
+
+   for(i=ih.sorted;i<ih.count;i+=n)
+   {
+      n = ih.count - i;
+
+      if(n > ARCHIVE_SCAN_CHUNK)
+         n = ARCHIVE_SCAN_CHUNK;
+
+      if(fread(chunk, sizeof(archiveEntry_t), n, idx) != n)
+         break;
+
+      for(mid=0;mid<n;mid++)
+      {
+         if(chunk[mid].hash == hash)
+         {
+            found(&chunk[mid], ctx);
+            total++;
+         }
+      }
+   }
+
+   fclose(idx);
+
+   return total;
+}
+
+// Index order:  by hash, then as the games were played
+static int compareEntries( const void *a, const void *b )
+{
+   const archiveEntry_t *x = a, *y = b;
+
+   if(x->hash != y->hash) return (x->hash < y->hash) ? -1 : 1;
+   if(x->game != y->game) return (x->game < y->game) ? -1 : 1;
+
+   return (int)x->ply - (int)y->ply;
+}
+
+static void addMatch( const archiveEntry_t *e, void *ctx )
+{
+   matchList_t *found = ctx;
+   archiveMatch_t *m;
+
+   if(found->total < found->max)
+   {
+      m = &found->matches[found->total];
+
+      m->game    = e->game;
+      m->ply     = e->ply;
+      m->result  = e->result;
+      m->hasNext = (e->next != 0) ? TRUE : FALSE;
+      m->next    = unpackMove(e->next);
+   }
+
+   found->total++;
+}
+
+static void addStats( const archiveEntry_t *e, void *ctx )
+{
+   nextMoves_t *next = ctx;
+   archiveStats_t *s = next->stats;
+   int i;
+
+   s->games++;
+
+   switch(e->result)
+   {
+      case RESULT_WHITE_WINS: s->whiteWins++; break;
+      case RESULT_BLACK_WINS: s->blackWins++; break;
+      case RESULT_DRAW:       s->draws++;     break;
+   }
+
+   if(e->next == 0)
+      return;
+
+   for(i=0;i<next->count && next->move[i] != e->next;i++);
+
+   if(i == next->count)
+   {
+      if(i == MAX_LIST_SIZE)
+         return;
+
+      next->move[i] = e->next;
+      next->times[i] = 0;
+      next->count++;
+   }
+
+   if(++next->times[i] > s->nextCount)
+   {
+      s->nextCount = next->times[i];
+      s->next = unpackMove(e->next);
+   }
+}
+
+static void writeGamePGN( FILE *out, const archivedGame_t *g )
+{
+   static const char *results[] = { "*", "1-0", "0-1", "1/2-1/2" };
+   const archiveGame_t *h = &g->hdr;
+   bool_t imported = (h->flags & ARCHIVE_IMPORTED) ? TRUE : FALSE;
+   time_t date = h->date;
+   pgnWriter_t w;
+   board_t b;
+   char text[PGN_TAG_MAX];
+   int ply;
+
+   PGN_initWriter(&w, out);
+
+   if(!imported)
+      strftime(text, sizeof(text), "%Y.%m.%d", localtime(&date));
+   else
+      dateText(text, h->date);
+
+   PGN_writeTag(&w, "Event", imported ? "?" : "piChess game");
+   PGN_writeTag(&w, "Site",  imported ? "?" : "piChess");
+   PGN_writeTag(&w, "Date",  text);
+   PGN_writeTag(&w, "Round", imported ? "?" : "-");
+   PGN_writeTag(&w, "White", g->white[0] ? g->white : imported ? "?" :
+                             (h->players & ARCHIVE_WHITE_COMPUTER) ? "Computer" : "Human");
+   PGN_writeTag(&w, "Black", g->black[0] ? g->black : imported ? "?" :
+                             (h->players & ARCHIVE_BLACK_COMPUTER) ? "Computer" : "Human");
+   PGN_writeTag(&w, "Result", results[h->result & 3]);
+
+   if(h->fenLength)
+   {
+      PGN_writeTag(&w, "SetUp", "1");
+      PGN_writeTag(&w, "FEN", g->fen);
+   }
+
+   if(h->flags & ARCHIVE_CHESS960)
+      PGN_writeTag(&w, "Variant", "Chess960");
+
+   // What an imported game's time control and ending were isn't kept
+   if(!imported)
+   {
+      switch(h->timing)
+      {
+         case TIME_EQUAL:
+            // Period two only if period one has a move count, period three if two has one too
+            timeControlText(text, sizeof(text), h->timeSettings,
+                            h->timeSettings[0].moves == 0 ? 1 : h->timeSettings[1].moves == 0 ? 2 : 3);
+            PGN_writeTag(&w, "TimeControl", text);
+            break;
+
+         case TIME_ODDS:
+            // Not something the standard tag can say
+            PGN_writeTag(&w, "TimeControl", "?");
+            timeControlText(text, sizeof(text), &h->timeSettings[WHITE], 1);
+            PGN_writeTag(&w, "WhiteTimeControl", text);
+            timeControlText(text, sizeof(text), &h->timeSettings[BLACK], 1);
+            PGN_writeTag(&w, "BlackTimeControl", text);
+            break;
+
+         default:
+            PGN_writeTag(&w, "TimeControl", "-");
+            break;
+      }
+
+      switch(h->reason)
+      {
+         case GAME_END_TIME_EXPIRED:   PGN_writeTag(&w, "Termination", "time forfeit"); break;
+         case GAME_END_TB_WHITE_WINS:
+         case GAME_END_TB_BLACK_WINS:
+         case GAME_END_TB_DRAW:        PGN_writeTag(&w, "Termination", "adjudication"); break;
+         case GAME_END_ABORT:          PGN_writeTag(&w, "Termination", "unterminated"); break;
+         default:                      PGN_writeTag(&w, "Termination", "normal");       break;
+      }
+   }
+
+   setBoard(&b, h->fenLength ? g->fen : NULL);
+   PGN_startMoves(&w, &b);
+
+   for(ply=0;ply<h->plies;ply++)
+   {
+      color_t mover = w.brd.toMove;
+
+      PGN_writeMove(&w, unpackMove(g->moves[ply]));
+
+      if(h->timing != TIME_NONE)
+      {
+         uint32_t secs = g->clocks[ply][mover] / 10;
+
+         snprintf(text, sizeof(text), "[%%clk %u:%02u:%02u]", secs / 3600, secs / 60 % 60, secs % 60);
+         PGN_writeComment(&w, text);
+      }
+   }
+
+   PGN_endGame(&w, results[h->result & 3]);
+}
+
+// A PGN time control tag's value:  "moves/seconds" for a period with a move count, "seconds" for
+//   sudden death, each with "+increment" if it has one, periods separated by ':'
+static void timeControlText( char *text, int size, const periodTimingSettings_t *p, int periods )
+{
+   int i, len = 0;
+
+   text[0] = '\0';
+
+   for(i=0;i<periods && len < size;i++)
+   {
+      if(i > 0)
+         len += snprintf(text + len, size - len, ":");
+
+      if(p[i].moves != 0 && i < periods - 1)
+         len += snprintf(text + len, size - len, "%d/", p[i].moves);
+
+      len += snprintf(text + len, size - len, "%d", p[i].totalTime);
+
+      if(p[i].increment != 0)
+         len += snprintf(text + len, size - len, "+%d", p[i].increment);
+   }
+}
+
+// A PGN Date tag ("YYYY.MM.DD", '?' for what isn't known) as YYYYMMDD, with 0 for the parts
+//   that aren't known
+static uint32_t parseDate( const char *date )
+{
+   unsigned year = 0, month = 0, day = 0;
+
+   // Stops at the first part that's '?'
+   sscanf(date, "%4u.%2u.%2u", &year, &month, &day);
+
+   return year * 10000 + month * 100 + day;
+}
+
+// And back again
+static void dateText( char *text, uint32_t date )
+{
+   char year[5] = "????", month[3] = "??", day[3] = "??";
+
+   if(date / 10000)     snprintf(year, sizeof(year), "%04u", date / 10000 % 10000);
+   if(date / 100 % 100) snprintf(month, sizeof(month), "%02u", date / 100 % 100);
+   if(date % 100)       snprintf(day, sizeof(day), "%02u", date % 100);
+
+   sprintf(text, "%s.%s.%s", year, month, day);
+}
@@ -0,0 +1,120 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+// Game archive
+//
+// Every game played (once it has a move) is kept when it ends, aborted ones included, so a position
+//   can be looked up later:  "have I had this before, and how did it go?".  Two files in the working
+//   directory, next to the options:
+//
+//    ARCHIVE_FILE        the games, appended one record after another and never rewritten.  A record
+//                        is a fixed header (result, how the game ended, players, time control, the
+//                        clocks at the start, when it was played), the start position's FEN if it
+//                        wasn't the standard one, the players' names if it has them, the moves
+//                        packed in 16 bits each (as the engine channel has them) and, for a timed
+//                        game, both clocks after every move.
+//
+//    ARCHIVE_INDEX_FILE  one entry per position reached in each game (its Polyglot hash, the game,
+//                        the ply, the move played from it and the game's result), sorted by hash
+//                        so a lookup is a binary search.  Games saved since the last sort are
+//                        appended unsorted and scanned, until there are ARCHIVE_INDEX_TAIL_MAX
+//                        of those entries and the lot is merged (a run at a time, so an index of
+//                        any size is merged in the same memory).
+//
+// Games from a PGN file (a repertoire, a study collection) can be imported too:  they are looked up
+//   like the ones played on the board, and written back out with the names and dates they came with.
+//
+// The index holds the games' offsets in 32 bits, so the games file can't grow past
+//   ARCHIVE_MAX_SIZE:  a game that would take it there isn't saved (or imported).
+//
+// The index is only ever derived from the games file:  whatever the index doesn't cover yet (a
+//   save cut short by a power loss, a missing or damaged index) is indexed from the games file the
+//   next time it is used, and a partly written game at the end of it is dropped.
+//
+// piChessArchive (archiveTool.c) imports PGN, dumps the archive as PGN and looks positions up off
+//   the board.
+
+#include "types.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#define ARCHIVE_FILE            "games.pga"
+#define ARCHIVE_INDEX_FILE      "games.idx"
+
+#define ARCHIVE_INDEX_TAIL_MAX  4096
+#define ARCHIVE_MAX_SIZE        ((off_t)UINT32_MAX)   // bytes of games the index can address
+
+typedef enum archiveErr_e
+{
+   ARCHIVE_NO_ERROR,
+   ARCHIVE_FILE_ERROR,     // file couldn't be opened or written
+   ARCHIVE_BAD_RECORD,     // games file holds something that isn't a game
+   ARCHIVE_FULL,           // games file has no room for the game (ARCHIVE_MAX_SIZE)
+   ARCHIVE_NO_MEM
+}archiveErr_t;
+
+typedef enum archiveResult_e
+{
+   RESULT_UNFINISHED,
+   RESULT_WHITE_WINS,
+   RESULT_BLACK_WINS,
+   RESULT_DRAW
+}archiveResult_t;
+
+// A position found in the archive
+typedef struct archiveMatch_s
+{
+   uint32_t        game;      // offset of the game in ARCHIVE_FILE
+   uint16_t        ply;       // half moves played in that game before the position
+   archiveResult_t result;    // how the game ended
+   bool_t          hasNext;   // FALSE if the game ended there
+   move_t          next;      // move played from the position
+}archiveMatch_t;
+
+// How the games that reached a position went
+typedef struct archiveStats_s
+{
+   int    games;
+   int    whiteWins;
+   int    blackWins;
+   int    draws;               // the rest were unfinished
+
+   int    nextCount;           // games the move below was played in (0 if none was)
+   move_t next;                // move played from the position most often
+}archiveStats_t;
+
+// What ARCHIVE_importPGN() did
+typedef struct archiveImport_s
+{
+   long   games;               // games added
+   long   partial;             // of those, how many stop short at a move that couldn't be read
+                               //   (or that there wasn't room for)
+   long   skipped;             // games with no move that could be read
+}archiveImport_t;
+
+// A game is starting:  nothing of it has been saved yet
+void         ARCHIVE_newGame( void );
+
+// Save the game, unless it has no moves or has been saved already
+archiveErr_t ARCHIVE_saveGame( const game_t *g, endReason_t reason );
+
+// Find the games that reached a position.  Fills in up to max matches, in the order they were
+//   played, and returns how many there are in all (-1 on error).
+int          ARCHIVE_lookup( U64 hash, archiveMatch_t *matches, int max );
+
+// Sum up the games that reached a position
+archiveErr_t ARCHIVE_positionStats( U64 hash, archiveStats_t *stats );
+
+// Write every game in the archive to out as PGN
+archiveErr_t ARCHIVE_writePGN( FILE *out );
+
+// Add every game in a PGN file to the archive, reading it a game at a time.  ARCHIVE_FULL if it
+//   stopped at a game there was no room for (those before it are added).
+archiveErr_t ARCHIVE_importPGN( FILE *in, archiveImport_t *report );
+
+// Throw the index away and build it again from the games file
+archiveErr_t ARCHIVE_rebuildIndex( void );
+
+#endif
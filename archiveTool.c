@@ -0,0 +1,168 @@
+// Game archive tool (piChessArchive)
+//
+// Reads the game archive (see archive.h) off the board, from a copy of its working directory:
+//
+//    piChessArchive [-d dir] pgn          every game, as PGN on stdout
+//    piChessArchive [-d dir] import file  add the games in a PGN file ("-" for stdin)
+//    piChessArchive [-d dir] find [fen]   the games that reached a position (the standard start
+//                                         if no FEN is given) and how they went
+//    piChessArchive [-d dir] reindex      build the index again from the games
+//
+// dir is where the archive is, the current directory by default.
+
+#include "archive.h"
+#include "board.h"
+#include "diag.h"
+#include "moves.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_LISTED 50      // games listed by find
+
+static void usage( const char *name );
+static int  findPosition( const char *fen );
+static int  importGames( const char *file );
+
+int main( int argc, char *argv[] )
+{
+   archiveErr_t err;
+   int result = 0;
+   int opt;
+
+   while( (opt = getopt(argc, argv, "d:")) != -1)
+   {
+      switch(opt)
+      {
+         case 'd':
+            if(chdir(optarg) != 0)
+            {
+               fprintf(stderr, "Unable to change to %s\n", optarg);
+               return 1;
+            }
+            break;
+
+         default:
+            usage(argv[0]);
+      }
+   }
+
+   if(optind >= argc)
+      usage(argv[0]);
+
+   // Only if something goes wrong
+   DIAG_init();
+   DIAG_setLevel(NULL, DIAG_WARN);
+
+   if(strcmp(argv[optind], "pgn") == 0)
+   {
+      if( (err = ARCHIVE_writePGN(stdout)) == ARCHIVE_FILE_ERROR)
+         fprintf(stderr, "Unable to open %s\n", ARCHIVE_FILE);
+      else if(err == ARCHIVE_BAD_RECORD)
+         fprintf(stderr, "%s is damaged after the games written\n", ARCHIVE_FILE);
+
+      result = (err == ARCHIVE_NO_ERROR) ? 0 : 1;
+   }
+   else if(strcmp(argv[optind], "import") == 0 && optind + 1 < argc)
+      result = importGames(argv[optind + 1]);
+   else if(strcmp(argv[optind], "find") == 0)
+      result = findPosition(optind + 1 < argc ? argv[optind + 1] : NULL);
+   else if(strcmp(argv[optind], "reindex") == 0)
+   {
+      if(ARCHIVE_rebuildIndex() != ARCHIVE_NO_ERROR)
+      {
+         fprintf(stderr, "Unable to rebuild %s\n", ARCHIVE_INDEX_FILE);
+         result = 1;
+      }
+   }
+   else
+      usage(argv[0]);
+
+   DIAG_flush();
+
+   return result;
+}
+
+static void usage( const char *name )
+{
+   fprintf(stderr, "Usage: %s [-d dir] pgn | import file | find [fen] | reindex\n", name);
+   exit(1);
+}
+
+static int importGames( const char *file )
+{
+   archiveImport_t report;
+   archiveErr_t err;
+   FILE *in = strcmp(file, "-") ? fopen(file, "r") : stdin;
+
+   if(in == NULL)
+   {
+      fprintf(stderr, "Unable to open %s\n", file);
+      return 1;
+   }
+
+   err = ARCHIVE_importPGN(in, &report);
+
+   if(in != stdin)
+      fclose(in);
+
+   printf("%ld games imported, %ld of them partly;  %ld skipped\n", report.games, report.partial,
+          report.skipped);
+
+   if(err == ARCHIVE_FULL)
+   {
+      fprintf(stderr, "%s is full:  the rest weren't imported\n", ARCHIVE_FILE);
+      return 1;
+   }
+
+   if(err != ARCHIVE_NO_ERROR)
+   {
+      fprintf(stderr, "Unable to write the archive\n");
+      return 1;
+   }
+
+   return 0;
+}
+
+static int findPosition( const char *fen )
+{
+   static const char *results[] = { "*", "1-0", "0-1", "1/2-1/2" };
+   archiveMatch_t matches[MAX_LISTED];
+   archiveStats_t stats;
+   board_t b;
+   int i, total;
+
+   if(setBoard(&b, fen) != FEN_OK)
+   {
+      fprintf(stderr, "Bad FEN:  %s\n", fen);
+      return 1;
+   }
+
+   if( (total = ARCHIVE_lookup(b.hash, matches, MAX_LISTED)) < 0 ||
+       ARCHIVE_positionStats(b.hash, &stats) != ARCHIVE_NO_ERROR)
+   {
+      fprintf(stderr, "Unable to read the archive\n");
+      return 1;
+   }
+
+   printf("%d games:  white won %d, drew %d, black won %d, unfinished %d\n", stats.games,
+          stats.whiteWins, stats.draws, stats.blackWins,
+          stats.games - stats.whiteWins - stats.draws - stats.blackWins);
+
+   if(stats.nextCount > 0)
+      printf("Played most:  %s (%d games)\n", moveToSAN(stats.next, &b), stats.nextCount);
+
+   for(i=0;i<total && i<MAX_LISTED;i++)
+   {
+      printf("   game at %-8u ply %-4u %-8s %s\n", matches[i].game, matches[i].ply,
+             results[matches[i].result], matches[i].hasNext ? moveToSAN(matches[i].next, &b) : "(end)");
+   }
+
+   if(total > MAX_LISTED)
+      printf("   ... %d more\n", total - MAX_LISTED);
+
+   return 0;
+}
@@ -23,9 +23,10 @@ static void movePiece  (board_t *b, U8 fromSq, U8 toSq, piece_t p, color_t c);
 /// Starting FEN position
 const char *startString = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
-/// Hash of previous positions - used for draw detection
-U64 positionHistory[POSITION_HISTORY_SIZE];
-int positionIndex = 0;
+/// Hash of previous positions - used for draw detection.  Per thread, as bookBuild sets up and
+/// plays boards on several at once.
+static __thread U64 positionHistory[POSITION_HISTORY_SIZE];
+static __thread int positionIndex = 0;
 
 /// Create an empty board
 void setBoardEmpty(board_t *brd)
@@ -9,7 +9,9 @@
 
 #include <time.h>
 #include <stdlib.h>
-#include "bcm2835.h"
+#include "hal.h"
+#include "engine.h"
+#include "trace.h"
 
 static FILE *bk = NULL;
 U32 numEntries = 0;
@@ -32,7 +34,7 @@ bookErr_t openBook( char *file )
    bookErr_t retVal = BOOK_NO_ERROR;
 
    // Seed random number once only when book is opened.
-   srand(bcm2835_st_read());
+   srand(TRACE_seed(HAL_timeMicros()));
 
    char filename[100];
 
@@ -40,7 +42,7 @@ bookErr_t openBook( char *file )
    if(bk != NULL) temp = bk;
 
    // Create name in books folder
-   sprintf(filename, "/home/pi/chess/books/%s", file);
+   sprintf(filename, CHESS_DIR "/books/%s", file);
 
    DPRINT("Attempting to open %s\n", filename);
 
@@ -366,7 +368,8 @@ static void readPositionRecord(U32 offset, candidate_t *c)
    }
    else
    {
-      c->mv.promote = (piece_t)promotion + KNIGHT;
+      // 1 for a knight up to 4 for a queen
+      c->mv.promote = (piece_t)(promotion - 1) + KNIGHT;
    }
 
    // Get the weight of this move
@@ -0,0 +1,686 @@
+// Polyglot book builder (bookBuild)
+//
+// Builds an opening book in the Polyglot format book.c reads from PGN game collections:
+//
+//    bookBuild [-o book] [-p plies] [-n games] [-w win,draw,loss] [-j threads] [-m MB] file.pgn ...
+//
+//       -o   the book to write (default book.bin)
+//       -p   only the first plies of each game go in (default 30)
+//       -n   only moves played in at least this many games go in (default 1)
+//       -w   what a game adds to a move's weight when the side that played it went on to win, draw
+//            or lose (default 2,1,0).  A move that ends up with no weight is left out.
+//       -j   threads (default one per core)
+//       -m   memory for counting moves, shared by the threads (default 256 MB)
+//
+// Each file is cut into chunks at game boundaries (a tag line after a line that isn't one) and the
+//   threads take chunks as they finish the last.  A thread reads its chunk's games with pgn.c,
+//   stopping at the ply limit, replays them and counts each move played from each position, with
+//   how those games went, in a hash table of its own.  A table that fills up is sorted and written
+//   out as a run (next to the book, removed at the end), so memory stays put however many games
+//   there are.  The runs are then merged:  the counts for each move summed, the filters applied,
+//   and the records written sorted by key, each position's moves by weight, scaled down where a
+//   position's heaviest move doesn't fit in 16 bits.
+//
+// A record's learn field is the number of games the move was played in.  Games without a result
+// ("*", as repertoire files often have) count as draws.
+
+#include "pgn.h"
+#include "book.h"
+#include "board.h"
+#include "constants.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define CHUNK_MAX        (16L << 20)   // most bytes of PGN a thread takes at a time
+#define CHUNK_MIN        (64L << 10)
+#define CHUNKS_PER_THREAD 4            // for smaller files, so every thread gets some
+#define TABLE_FILL       3 / 4         // of a table's slots used before it's written out as a run
+#define MAX_RUNS         1000          // open at once merging
+#define MAX_BOOK_MOVES   256           // from one position
+
+typedef enum outcome_e
+{
+   OUTCOME_WON,
+   OUTCOME_DRAWN,
+   OUTCOME_LOST
+}outcome_t;
+
+// How often a move was played from a position, and how those games went for the side playing it
+typedef struct bookCount_s
+{
+   U64      key;
+   uint32_t games[3];         // by outcome_t;  all 0 for an empty slot
+   uint16_t move;             // as Polyglot has it
+}bookCount_t;
+
+typedef struct countTable_s
+{
+   bookCount_t *slot;
+   uint32_t     size;         // a power of 2
+   uint32_t     used;
+}countTable_t;
+
+// Games from start (a game boundary) up to end
+typedef struct chunk_s
+{
+   const char *file;
+   off_t       start;
+   off_t       end;
+}chunk_t;
+
+typedef struct worker_s
+{
+   pthread_t    thread;
+   int          id;
+   countTable_t table;
+   int          runs;         // written so far
+   long         games;
+   bool_t       failed;
+}worker_t;
+
+// A run being merged, and its next count
+typedef struct run_s
+{
+   FILE        *fp;
+   bookCount_t  next;
+}run_t;
+
+// A position's moves, as they're written
+typedef struct bookMove_s
+{
+   uint16_t move;
+   uint64_t weight;
+   uint64_t games;
+}bookMove_t;
+
+static const char *bookFile  = "book.bin";
+static int         maxPlies  = 30;
+static int         minGames  = 1;
+static uint32_t    resultWeight[3] = { 2, 1, 0 };
+
+static chunk_t         *chunks;
+static int              chunkCount;
+static int              nextChunk;
+static pthread_mutex_t  chunkMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void     usage( const char *name );
+static bool_t   addChunks( const char *file, off_t chunkSize );
+static off_t    findGameStart( FILE *fp, off_t offset, off_t size );
+static void    *workerMain( void *arg );
+static void     countGame( worker_t *w, const pgnGame_t *g );
+static uint16_t polyglotMove( const board_t *b, move_t mv );
+static bool_t   writeRun( worker_t *w );
+static void     runName( char *name, int size, int worker, int run );
+static int      compareCounts( const void *a, const void *b );
+static int      compareWeights( const void *a, const void *b );
+static bool_t   mergeRuns( worker_t *workers, int workerCount, long *positions, long *records );
+static bool_t   readRun( run_t *run );
+static void     siftDown( run_t **heap, int count, int i );
+static void     writePosition( FILE *out, U64 key, bookMove_t *moves, int count, long *positions,
+                               long *records );
+static void     putBigEndian( uint8_t *bytes, uint64_t value, int size );
+
+int main( int argc, char *argv[] )
+{
+   worker_t *workers;
+   struct stat st;
+   struct timespec start, parsed, done;
+   long memory = 256, games = 0, positions = 0, records = 0;
+   off_t totalSize = 0, chunkSize;
+   int threads = sysconf(_SC_NPROCESSORS_ONLN);
+   int opt, i, runs = 0;
+   uint32_t slots;
+   bool_t ok = TRUE;
+
+   while( (opt = getopt(argc, argv, "o:p:n:w:j:m:")) != -1)
+   {
+      switch(opt)
+      {
+         case 'o':  bookFile = optarg;          break;
+         case 'p':  maxPlies = atoi(optarg);    break;
+         case 'n':  minGames = atoi(optarg);    break;
+         case 'j':  threads  = atoi(optarg);    break;
+         case 'm':  memory   = atol(optarg);    break;
+
+         case 'w':
+            if(sscanf(optarg, "%u,%u,%u", &resultWeight[OUTCOME_WON], &resultWeight[OUTCOME_DRAWN],
+                      &resultWeight[OUTCOME_LOST]) != 3)
+               usage(argv[0]);
+            break;
+
+         default:
+            usage(argv[0]);
+      }
+   }
+
+   if(optind >= argc || maxPlies < 1 || threads < 1 || memory < 1)
+      usage(argv[0]);
+
+   if(maxPlies > MAX_MOVES_IN_GAME - 1)
+      maxPlies = MAX_MOVES_IN_GAME - 1;
+
+   for(i=optind;i<argc;i++)
+   {
+      if(stat(argv[i], &st) != 0)
+      {
+         fprintf(stderr, "Unable to open %s\n", argv[i]);
+         return 1;
+      }
+
+      totalSize += st.st_size;
+   }
+
+   // Small collections are shared out so each thread has a few chunks
+   chunkSize = totalSize / (threads * CHUNKS_PER_THREAD);
+
+   if(chunkSize > CHUNK_MAX) chunkSize = CHUNK_MAX;
+   if(chunkSize < CHUNK_MIN) chunkSize = CHUNK_MIN;
+
+   for(i=optind;i<argc;i++)
+   {
+      if(!addChunks(argv[i], chunkSize))
+      {
+         fprintf(stderr, "Unable to read %s\n", argv[i]);
+         return 1;
+      }
+   }
+
+   if(threads > chunkCount)
+      threads = chunkCount > 0 ? chunkCount : 1;
+
+   // Each thread's table is the largest power of 2 that fits in its share
+   for(slots=1;(uint64_t)slots * 2 * sizeof(bookCount_t) <= ((uint64_t)memory << 20) / threads && slots < (1u << 30);slots*=2);
+
+   workers = calloc(threads, sizeof(worker_t));
+
+   for(i=0;i<threads && workers != NULL;i++)
+   {
+      workers[i].id = i;
+      workers[i].table.size = slots;
+
+      if( (workers[i].table.slot = calloc(slots, sizeof(bookCount_t))) == NULL)
+         break;
+   }
+
+   if(workers == NULL || i < threads)
+   {
+      fprintf(stderr, "Not enough memory for %d tables of %u moves\n", threads, slots);
+      return 1;
+   }
+
+   printf("%d chunks of PGN, %d threads, %u moves per table\n", chunkCount, threads, slots);
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+
+   for(i=0;i<threads;i++)
+      pthread_create(&workers[i].thread, NULL, workerMain, &workers[i]);
+
+   for(i=0;i<threads;i++)
+   {
+      pthread_join(workers[i].thread, NULL);
+
+      free(workers[i].table.slot);
+
+      games += workers[i].games;
+      runs  += workers[i].runs;
+      ok    &= !workers[i].failed;
+   }
+
+   clock_gettime(CLOCK_MONOTONIC, &parsed);
+
+   printf("%ld games read in %.1f s, %d runs\n", games, (parsed.tv_sec - start.tv_sec) +
+          (parsed.tv_nsec - start.tv_nsec) / 1e9, runs);
+
+   if(ok)
+      ok = mergeRuns(workers, threads, &positions, &records);
+   else
+      fprintf(stderr, "Unable to write a run next to %s\n", bookFile);
+
+   clock_gettime(CLOCK_MONOTONIC, &done);
+
+   if(!ok)
+      return 1;
+
+   printf("%ld positions, %ld moves written to %s in %.1f s\n", positions, records, bookFile,
+          (done.tv_sec - parsed.tv_sec) + (done.tv_nsec - parsed.tv_nsec) / 1e9);
+
+   return 0;
+}
+
+static void usage( const char *name )
+{
+   fprintf(stderr, "Usage: %s [-o book] [-p plies] [-n games] [-w win,draw,loss] [-j threads] "
+                   "[-m MB] file.pgn ...\n", name);
+   exit(1);
+}
+
+// Cut a file into chunks of about chunkSize at game boundaries
+static bool_t addChunks( const char *file, off_t chunkSize )
+{
+   struct stat st;
+   FILE *fp;
+   off_t start = 0, end;
+
+   if(stat(file, &st) != 0 || (fp = fopen(file, "r")) == NULL)
+      return FALSE;
+
+   while(start < st.st_size)
+   {
+      end = findGameStart(fp, start + chunkSize, st.st_size);
+
+      if( (chunkCount & 63) == 0)
+         chunks = realloc(chunks, (chunkCount + 64) * sizeof(chunk_t));
+
+      chunks[chunkCount].file  = file;
+      chunks[chunkCount].start = start;
+      chunks[chunkCount].end   = end;
+      chunkCount++;
+
+      start = end;
+   }
+
+   fclose(fp);
+
+   return TRUE;
+}
+
+// The offset of the first game starting at or after offset (size if there isn't one):  the first
+//   tag line after a line that isn't a tag.  The line offset is in may be partway through a game's
+//   tags, so a game starting on it is left for the chunk before.
+static off_t findGameStart( FILE *fp, off_t offset, off_t size )
+{
+   bool_t afterTag = TRUE;
+   off_t pos;
+   int c;
+
+   if(offset >= size)
+      return size;
+
+   // To the start of the line after the one offset is in
+   fseeko(fp, offset, SEEK_SET);
+   while( (c = getc(fp)) != EOF && c != '\n');
+
+   while(c != EOF)
+   {
+      pos = ftello(fp);
+
+      if( (c = getc(fp)) == '[' && !afterTag)
+         return pos;
+
+      afterTag = (c == '[') ? TRUE : FALSE;
+
+      while(c != EOF && c != '\n')
+         c = getc(fp);
+   }
+
+   return size;
+}
+
+static void *workerMain( void *arg )
+{
+   static __thread pgnGame_t game;
+   worker_t *w = arg;
+   pgnReader_t reader;
+   chunk_t *c;
+   FILE *fp;
+
+   while(!w->failed)
+   {
+      pthread_mutex_lock(&chunkMutex);
+      c = (nextChunk < chunkCount) ? &chunks[nextChunk++] : NULL;
+      pthread_mutex_unlock(&chunkMutex);
+
+      if(c == NULL)
+         break;
+
+      if( (fp = fopen(c->file, "r")) == NULL)
+      {
+         w->failed = TRUE;
+         break;
+      }
+
+      fseeko(fp, c->start, SEEK_SET);
+
+      PGN_initReader(&reader, fp);
+      reader.maxPlies = maxPlies;
+
+      // The last game read starts the next chunk
+      while(PGN_readGame(&reader, &game) == PGN_OK && reader.gameStart < c->end && !w->failed)
+      {
+         countGame(w, &game);
+         w->games++;
+      }
+
+      fclose(fp);
+   }
+
+   if(w->table.used > 0 && !w->failed)
+      writeRun(w);
+
+   return NULL;
+}
+
+static void countGame( worker_t *w, const pgnGame_t *g )
+{
+   countTable_t *t = &w->table;
+   outcome_t white = !strcmp(g->result, "1-0") ? OUTCOME_WON :
+                     !strcmp(g->result, "0-1") ? OUTCOME_LOST : OUTCOME_DRAWN;
+   bookCount_t *s;
+   board_t b = g->start;
+   uint16_t mv;
+   uint32_t i;
+   int ply;
+
+   for(ply=0;ply<g->plies && ply<maxPlies;ply++)
+   {
+      mv = polyglotMove(&b, g->moves[ply]);
+
+      // Zobrist keys are random enough that their low bits do as an index
+      for(i=(b.hash ^ (mv * 0x9E3779B97F4A7C15ULL)) & (t->size - 1);;i=(i + 1) & (t->size - 1))
+      {
+         s = &t->slot[i];
+
+         if(s->games[OUTCOME_WON] + s->games[OUTCOME_DRAWN] + s->games[OUTCOME_LOST] == 0)
+         {
+            s->key  = b.hash;
+            s->move = mv;
+            t->used++;
+            break;
+         }
+
+         if(s->key == b.hash && s->move == mv)
+            break;
+      }
+
+      s->games[(b.toMove == WHITE) ? white : OUTCOME_LOST - white]++;
+
+      if(t->used >= t->size * TABLE_FILL && !writeRun(w))
+         return;
+
+      move(&b, g->moves[ply]);
+   }
+}
+
+// From and to squares (a1 = 0), and the promotion from 1 for a knight to 4 for a queen.  Castling is
+//   the king taking its own rook.
+static uint16_t polyglotMove( const board_t *b, move_t mv )
+{
+   int from = mv.from, to = mv.to, promote = 0;
+
+   if((b->pieces[KING] & squareMask[from]) && (to - from == 2 || from - to == 2))
+      to = (to > from) ? from + 3 : from - 4;
+
+   if(mv.promote >= KNIGHT && mv.promote <= QUEEN && (b->pieces[PAWN] & squareMask[from]))
+      promote = mv.promote - KNIGHT + 1;
+
+   return (to % 8) | (7 - to / 8) << 3 | (from % 8) << 6 | (7 - from / 8) << 9 | promote << 12;
+}
+
+// Sort the table's counts and write them out, leaving it empty
+static bool_t writeRun( worker_t *w )
+{
+   countTable_t *t = &w->table;
+   char name[256];
+   uint32_t i, n = 0;
+   FILE *fp;
+
+   for(i=0;i<t->size;i++)
+   {
+      if(t->slot[i].games[OUTCOME_WON] + t->slot[i].games[OUTCOME_DRAWN] + t->slot[i].games[OUTCOME_LOST])
+         t->slot[n++] = t->slot[i];
+   }
+
+   qsort(t->slot, n, sizeof(bookCount_t), compareCounts);
+
+   runName(name, sizeof(name), w->id, w->runs);
+
+   if( (fp = fopen(name, "wb")) == NULL || fwrite(t->slot, sizeof(bookCount_t), n, fp) != n ||
+       fclose(fp) != 0)
+   {
+      w->failed = TRUE;
+      return FALSE;
+   }
+
+   w->runs++;
+
+   memset(t->slot, 0x00, t->size * sizeof(bookCount_t));
+   t->used = 0;
+
+   return TRUE;
+}
+
+static void runName( char *name, int size, int worker, int run )
+{
+   snprintf(name, size, "%s.%d.%d.run", bookFile, worker, run);
+}
+
+// Book order:  by key, then move
+static int compareCounts( const void *a, const void *b )
+{
+   const bookCount_t *x = a, *y = b;
+
+   if(x->key != y->key) return (x->key < y->key) ? -1 : 1;
+
+   return (int)x->move - (int)y->move;
+}
+
+// Heaviest first
+static int compareWeights( const void *a, const void *b )
+{
+   const bookMove_t *x = a, *y = b;
+
+   if(x->weight != y->weight) return (x->weight > y->weight) ? -1 : 1;
+
+   return (int)x->move - (int)y->move;
+}
+
+// Merge every worker's runs into the book, then remove them
+static bool_t mergeRuns( worker_t *workers, int workerCount, long *positions, long *records )
+{
+   static bookMove_t moves[MAX_BOOK_MOVES];
+   run_t *runs, **heap;
+   bookMove_t *m;
+   bookCount_t c;
+   char name[256];
+   FILE *out = NULL;
+   U64 key = 0;
+   int i, j, count = 0, heapCount = 0, moveCount = 0;
+   bool_t ok = TRUE;
+
+   for(i=0;i<workerCount;i++)
+      count += workers[i].runs;
+
+   runs = calloc(count + 1, sizeof(run_t));
+   heap = calloc(count + 1, sizeof(run_t *));
+
+   if(count > MAX_RUNS)
+   {
+      fprintf(stderr, "%d runs are more than can be merged:  give it more memory (-m)\n", count);
+      ok = FALSE;
+   }
+   else if(runs == NULL || heap == NULL || (out = fopen(bookFile, "wb")) == NULL)
+   {
+      fprintf(stderr, "Unable to write %s\n", bookFile);
+      ok = FALSE;
+   }
+
+   for(i=0;i<workerCount && ok;i++)
+   {
+      for(j=0;j<workers[i].runs && ok;j++)
+      {
+         runName(name, sizeof(name), i, j);
+
+         if( (runs[heapCount].fp = fopen(name, "rb")) == NULL)
+         {
+            fprintf(stderr, "Unable to open %s\n", name);
+            ok = FALSE;
+         }
+         else if(readRun(&runs[heapCount]))
+         {
+            heap[heapCount] = &runs[heapCount];
+            heapCount++;
+         }
+      }
+   }
+
+   for(i=heapCount/2-1;i>=0 && ok;i--)
+      siftDown(heap, heapCount, i);
+
+   // Counts come off the heap in book order, so a position's moves are together and each move's
+   //   counts (one per run it's in) follow each other
+   while(heapCount > 0 && ok)
+   {
+      c = heap[0]->next;
+
+      if(!readRun(heap[0]))
+         heap[0] = heap[--heapCount];
+
+      siftDown(heap, heapCount, 0);
+
+      if(c.key != key || moveCount == 0)
+      {
+         writePosition(out, key, moves, moveCount, positions, records);
+         key = c.key;
+         moveCount = 0;
+      }
+
+      if(moveCount == 0 || moves[moveCount - 1].move != c.move)
+      {
+         // More moves than a position has:  the key isn't unique, and the rest can go
+         if(moveCount == MAX_BOOK_MOVES)
+            continue;
+
+         m = &moves[moveCount++];
+         m->move   = c.move;
+         m->weight = 0;
+         m->games  = 0;
+      }
+
+      m = &moves[moveCount - 1];
+
+      for(i=OUTCOME_WON;i<=OUTCOME_LOST;i++)
+      {
+         m->weight += (uint64_t)c.games[i] * resultWeight[i];
+         m->games  += c.games[i];
+      }
+   }
+
+   if(ok)
+   {
+      writePosition(out, key, moves, moveCount, positions, records);
+
+      if(ferror(out))
+      {
+         fprintf(stderr, "Unable to write %s\n", bookFile);
+         ok = FALSE;
+      }
+   }
+
+   if(out != NULL && fclose(out) != 0)
+      ok = FALSE;
+
+   for(i=0;i<count && runs != NULL;i++)
+   {
+      if(runs[i].fp != NULL)
+         fclose(runs[i].fp);
+   }
+
+   // The runs go whatever happened
+   for(i=0;i<workerCount;i++)
+   {
+      for(j=0;j<workers[i].runs;j++)
+      {
+         runName(name, sizeof(name), i, j);
+         remove(name);
+      }
+   }
+
+   free(runs);
+   free(heap);
+
+   return ok;
+}
+
+// The run's next count.  FALSE at its end.
+static bool_t readRun( run_t *run )
+{
+   return (fread(&run->next, sizeof(bookCount_t), 1, run->fp) == 1) ? TRUE : FALSE;
+}
+
+// Restore the heap below entry i (smallest next count at the top)
+static void siftDown( run_t **heap, int count, int i )
+{
+   run_t *r = heap[i];
+   int child;
+
+   while( (child = 2 * i + 1) < count)
+   {
+      if(child + 1 < count && compareCounts(&heap[child + 1]->next, &heap[child]->next) < 0)
+         child++;
+
+      if(compareCounts(&heap[child]->next, &r->next) >= 0)
+         break;
+
+      heap[i] = heap[child];
+      i = child;
+   }
+
+   heap[i] = r;
+}
+
+// Write a position's moves that pass the filters, heaviest first
+static void writePosition( FILE *out, U64 key, bookMove_t *moves, int count, long *positions,
+                           long *records )
+{
+   uint8_t record[RECORD_SIZE];
+   uint64_t most = 0;
+   int i, n = 0;
+
+   for(i=0;i<count;i++)
+   {
+      if(moves[i].games >= (uint64_t)minGames && moves[i].weight > 0)
+      {
+         moves[n++] = moves[i];
+
+         if(moves[i].weight > most)
+            most = moves[i].weight;
+      }
+   }
+
+   if(n == 0)
+      return;
+
+   qsort(moves, n, sizeof(bookMove_t), compareWeights);
+
+   for(i=0;i<n;i++)
+   {
+      // Scaled so the heaviest is 65535, none below 1
+      if(most > 0xFFFF)
+         moves[i].weight = (moves[i].weight * 0xFFFF / most) ? moves[i].weight * 0xFFFF / most : 1;
+
+      putBigEndian(&record[KEY_OFFSET], key, 8);
+      putBigEndian(&record[MOVE_OFFSET], moves[i].move, 2);
+      putBigEndian(&record[WEIGHT_OFFSET], moves[i].weight, 2);
+      putBigEndian(&record[LEARN_OFFSET], (moves[i].games > 0xFFFFFFFF) ? 0xFFFFFFFF : moves[i].games, 4);
+
+      fwrite(record, RECORD_SIZE, 1, out);
+   }
+
+   (*positions)++;
+   *records += n;
+}
+
+static void putBigEndian( uint8_t *bytes, uint64_t value, int size )
+{
+   while(size-- > 0)
+   {
+      bytes[size] = value & 0xFF;
+      value >>= 8;
+   }
+}
@@ -1,34 +1,465 @@
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "types.h"
 #include "diag.h"
-#include "time.h"
-#include "bcm2835.h"
+#include "hal.h"
 
-void DIAG_print(char *msg, ...)
+// Each thread gets a single producer / single consumer ring the first time it logs.  The slot is
+//   handed back (once drained) when the thread exits, so the engine poll thread being created for
+//   every game doesn't use them up.
+
+#define DIAG_MAX_THREADS   16
+#define DIAG_RING_SIZE     64        // entries per thread, power of 2
+#define DIAG_MSG_LEN       240
+#define DIAG_MAX_MODULES   64
+#define DIAG_MODULE_LEN    24
+#define DIAG_DRAIN_US      20000
+
+typedef enum ringState_e
+{
+   RING_FREE,
+   RING_IN_USE,
+   RING_RETIRED        // owning thread has exited, free the slot once drained
+}ringState_t;
+
+typedef struct diagEntry_s
+{
+   uint64_t time;
+   char     text[DIAG_MSG_LEN];
+}diagEntry_t;
+
+typedef struct diagRing_s
+{
+   atomic_int      state;
+   atomic_uint     head;     // written by the owning thread
+   atomic_uint     tail;     // written by the drain thread
+   diagEntry_t     entry[DIAG_RING_SIZE];
+}diagRing_t;
+
+struct diagModule_s
+{
+   char        name[DIAG_MODULE_LEN];
+   atomic_int  level;
+   bool_t      ownLevel;     // set explicitly, not following the default
+};
+
+static diagRing_t           rings[DIAG_MAX_THREADS];
+static pthread_key_t        ringKey;
+static pthread_once_t       ringKeyOnce = PTHREAD_ONCE_INIT;
+
+static struct diagModule_s  modules[DIAG_MAX_MODULES];
+static atomic_int           moduleCount  = 0;
+static atomic_int           defaultLevel = DIAG_DEBUG;
+static pthread_mutex_t      moduleMutex  = PTHREAD_MUTEX_INITIALIZER;
+
+static atomic_uint          dropped = 0;
+static uint32_t             droppedReported = 0;
+
+// Consumer side.  Only the drain thread and DIAG_flush() touch these, under drainMutex.
+static pthread_mutex_t      drainMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t            drainThread;
+static bool_t               drainStarted = FALSE;
+static FILE                *outFile  = NULL;
+static char                *outName  = NULL;
+static long                 outLimit = 0;
+static long                 outSize  = 0;
+static uint64_t             startTime = 0;
+
+static void                 ringKeyInit( void );
+static void                 ringRelease( void *arg );
+static diagRing_t          *ringGet( void );
+static struct diagModule_s *moduleFind( const char *name, int len );
+static void                 moduleName( const char *file, const char **name, int *len );
+static diagLevel_t          levelFromName( const char *name, int len );
+static void                 drain( void );
+static void                 output( uint64_t time, const char *text );
+static void                *drainTask( void *arg );
+
+void DIAG_init( void )
+{
+   char *env;
+
+   if(drainStarted) return;
+
+   startTime = HAL_timeMicros();
+
+   if( (env = getenv("PICHESS_LOG")) != NULL )
+      DIAG_configure(env);
+
+   if( (env = getenv("PICHESS_LOG_FILE")) != NULL )
+      DIAG_setOutput(env, DIAG_FILE_SIZE);
+
+   pthread_create(&drainThread, NULL, drainTask, NULL);
+   drainStarted = TRUE;
+
+   // Don't lose the tail end when the program exits
+   atexit(DIAG_flush);
+}
+
+void DIAG_log( struct diagModule_s *_Atomic *module, const char *file, diagLevel_t level, const char *msg, ... )
 {
+   struct diagModule_s *mod;
+   diagRing_t *ring;
+   diagEntry_t *e;
+   unsigned int head;
    va_list argp;
-   static bool_t   timeInit  = FALSE;
-   static uint64_t startTime = 0;
+   int len;
+
+   // Find (once per call site) and check this file's level before doing any work
+   if( (mod = atomic_load_explicit(module, memory_order_acquire)) == NULL )
+   {
+      const char *name;
+
+      moduleName(file, &name, &len);
+
+      if( (mod = moduleFind(name, len)) == NULL )
+         return;
+
+      atomic_store_explicit(module, mod, memory_order_release);
+   }
 
-   uint64_t t;
+   if(level > atomic_load_explicit(&mod->level, memory_order_relaxed))
+      return;
 
-   if(timeInit == FALSE)
+   if( (ring = ringGet()) == NULL )
    {
-      startTime = bcm2835_st_read();
-      t = 0;
-      timeInit = TRUE;
+      atomic_fetch_add(&dropped, 1);
+      return;
    }
-   else
+
+   head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+   if( head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= DIAG_RING_SIZE )
    {
-      t = bcm2835_st_read() - startTime;
+      atomic_fetch_add(&dropped, 1);
+      return;
    }
 
-   printf("[%10.6f] ", t/1000000.0);
+   e = &ring->entry[head & (DIAG_RING_SIZE - 1)];
+   e->time = HAL_timeMicros();
+
    va_start(argp, msg);
+   len = vsnprintf(e->text, DIAG_MSG_LEN, msg, argp);
+   va_end(argp);
 
-   vprintf(msg, argp);
+   // Show where a long message was cut off
+   if(len >= DIAG_MSG_LEN)
+      strcpy(&e->text[DIAG_MSG_LEN - 5], "...\n");
 
-   va_end(argp);
+   atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void DIAG_setLevel( const char *module, diagLevel_t level )
+{
+   struct diagModule_s *mod;
+   int i, count;
+
+   if(level >= DIAG_LEVEL_TOTAL) return;
+
+   if(module != NULL)
+   {
+      if( (mod = moduleFind(module, strlen(module))) != NULL )
+      {
+         pthread_mutex_lock(&moduleMutex);
+         mod->ownLevel = TRUE;
+         atomic_store(&mod->level, level);
+         pthread_mutex_unlock(&moduleMutex);
+      }
+      return;
+   }
+
+   pthread_mutex_lock(&moduleMutex);
+
+   atomic_store(&defaultLevel, level);
+
+   count = atomic_load(&moduleCount);
+   for(i=0;i<count;i++)
+   {
+      if(!modules[i].ownLevel)
+         atomic_store(&modules[i].level, level);
+   }
+
+   pthread_mutex_unlock(&moduleMutex);
+}
+
+void DIAG_configure( const char *spec )
+{
+   char item[DIAG_MODULE_LEN * 2];
+   const char *p = spec;
+   char *eq;
+   int len;
+
+   while(*p)
+   {
+      len = strcspn(p, ",");
+
+      if(len > 0 && len < (int)sizeof(item))
+      {
+         memcpy(item, p, len);
+         item[len] = 0x00;
+
+         if( (eq = strchr(item, '=')) == NULL )
+         {
+            DIAG_setLevel(NULL, levelFromName(item, len));
+         }
+         else
+         {
+            *eq = 0x00;
+            DIAG_setLevel(item, levelFromName(eq + 1, strlen(eq + 1)));
+         }
+      }
+
+      p += len;
+      if(*p == ',') p++;
+   }
+}
+
+void DIAG_setOutput( const char *file, long maxBytes )
+{
+   pthread_mutex_lock(&drainMutex);
+
+   if(outFile != NULL && outFile != stdout)
+      fclose(outFile);
+
+   free(outName);
+   outName  = NULL;
+   outFile  = stdout;
+   outLimit = 0;
+
+   if(file != NULL)
+   {
+      FILE *fp;
+
+      if( (fp = fopen(file, "a")) != NULL )
+      {
+         outFile  = fp;
+         outName  = strdup(file);
+         outLimit = maxBytes;
+
+         fseek(fp, 0, SEEK_END);
+         outSize = ftell(fp);
+      }
+   }
+
+   pthread_mutex_unlock(&drainMutex);
+}
+
+void DIAG_flush( void )
+{
+   pthread_mutex_lock(&drainMutex);
+   drain();
+   pthread_mutex_unlock(&drainMutex);
+}
+
+uint32_t DIAG_dropCount( void )
+{
+   return atomic_load(&dropped);
+}
+
+static void ringKeyInit( void )
+{
+   pthread_key_create(&ringKey, ringRelease);
+}
+
+// Thread exit (or cancellation).  The drain thread frees the slot once it's empty.
+static void ringRelease( void *arg )
+{
+   diagRing_t *ring = arg;
+
+   atomic_store(&ring->state, RING_RETIRED);
+}
+
+static diagRing_t *ringGet( void )
+{
+   diagRing_t *ring;
+   int i;
+
+   pthread_once(&ringKeyOnce, ringKeyInit);
+
+   if( (ring = pthread_getspecific(ringKey)) != NULL )
+      return ring;
+
+   for(i=0;i<DIAG_MAX_THREADS;i++)
+   {
+      int expected = RING_FREE;
+
+      if( atomic_compare_exchange_strong(&rings[i].state, &expected, RING_IN_USE) )
+      {
+         pthread_setspecific(ringKey, &rings[i]);
+         return &rings[i];
+      }
+   }
+
+   return NULL;
+}
+
+// Look up a module by name, adding it if it's new.  Only happens once per call site.
+static struct diagModule_s *moduleFind( const char *name, int len )
+{
+   struct diagModule_s *mod = NULL;
+   int i, count;
+
+   if(len >= DIAG_MODULE_LEN) len = DIAG_MODULE_LEN - 1;
+
+   pthread_mutex_lock(&moduleMutex);
+
+   count = atomic_load(&moduleCount);
+
+   for(i=0;i<count;i++)
+   {
+      if( !strncmp(modules[i].name, name, len) && modules[i].name[len] == 0x00 )
+      {
+         mod = &modules[i];
+         break;
+      }
+   }
+
+   if(mod == NULL && count < DIAG_MAX_MODULES)
+   {
+      mod = &modules[count];
+      memcpy(mod->name, name, len);
+      mod->name[len] = 0x00;
+      mod->ownLevel  = FALSE;
+      atomic_store(&mod->level, atomic_load(&defaultLevel));
+      atomic_store(&moduleCount, count + 1);
+   }
+
+   pthread_mutex_unlock(&moduleMutex);
+
+   return mod;
+}
+
+// "dir/st_playerMove.c" -> "st_playerMove"
+static void moduleName( const char *file, const char **name, int *len )
+{
+   const char *slash = strrchr(file, '/');
+   const char *dot;
+
+   *name = (slash == NULL ? file : slash + 1);
+
+   if( (dot = strrchr(*name, '.')) != NULL )
+      *len = dot - *name;
+   else
+      *len = strlen(*name);
+}
+
+static diagLevel_t levelFromName( const char *name, int len )
+{
+   static const char *levelName[DIAG_LEVEL_TOTAL] = { "error", "warn", "info", "debug" };
+   int i;
+
+   for(i=0;i<DIAG_LEVEL_TOTAL;i++)
+   {
+      if( strlen(levelName[i]) == len && !strncmp(levelName[i], name, len) )
+         return i;
+   }
+
+   return DIAG_DEBUG;
+}
+
+// Write out everything waiting in the rings, oldest first.  Caller holds drainMutex.
+static void drain( void )
+{
+   uint32_t drops;
+   int i;
+
+   if(outFile == NULL) outFile = stdout;
+
+   while(1)
+   {
+      diagRing_t *oldest = NULL;
+      uint64_t    oldestTime = 0;
+
+      for(i=0;i<DIAG_MAX_THREADS;i++)
+      {
+         diagRing_t *ring = &rings[i];
+         unsigned int tail;
+
+         if(atomic_load(&ring->state) == RING_FREE) continue;
+
+         tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+         if(tail == atomic_load_explicit(&ring->head, memory_order_acquire))
+         {
+            // Slot of a thread that's gone.  Empty now, so it can be reused.
+            if(atomic_load(&ring->state) == RING_RETIRED &&
+               tail == atomic_load_explicit(&ring->head, memory_order_acquire))
+            {
+               atomic_store(&ring->state, RING_FREE);
+            }
+            continue;
+         }
+
+         if(oldest == NULL || ring->entry[tail & (DIAG_RING_SIZE - 1)].time < oldestTime)
+         {
+            oldest     = ring;
+            oldestTime = ring->entry[tail & (DIAG_RING_SIZE - 1)].time;
+         }
+      }
+
+      if(oldest == NULL) break;
+
+      {
+         unsigned int tail = atomic_load_explicit(&oldest->tail, memory_order_relaxed);
+
+         output(oldestTime, oldest->entry[tail & (DIAG_RING_SIZE - 1)].text);
+
+         atomic_store_explicit(&oldest->tail, tail + 1, memory_order_release);
+      }
+   }
+
+   if( (drops = atomic_load(&dropped)) != droppedReported )
+   {
+      char text[60];
+
+      sprintf(text, "Diagnostic output dropped %u messages\n", drops - droppedReported);
+      output(HAL_timeMicros(), text);
+
+      droppedReported = drops;
+   }
+
+   fflush(outFile);
+}
+
+static void output( uint64_t time, const char *text )
+{
+   if(startTime == 0) startTime = time;
+
+   outSize += fprintf(outFile, "[%10.6f] %s", time >= startTime ? (time - startTime)/1000000.0 : 0.0, text);
+
+   // Keep one old log around
+   if(outName != NULL && outLimit > 0 && outSize >= outLimit)
+   {
+      char oldName[200];
+
+      snprintf(oldName, sizeof(oldName), "%s.1", outName);
+
+      fclose(outFile);
+      rename(outName, oldName);
+
+      if( (outFile = fopen(outName, "w")) == NULL )
+         outFile = stdout;
+
+      outSize = 0;
+   }
+}
+
+static void *drainTask( void *arg )
+{
+   while(1)
+   {
+      usleep(DIAG_DRAIN_US);
+
+      pthread_mutex_lock(&drainMutex);
+      drain();
+      pthread_mutex_unlock(&drainMutex);
+   }
+
+   return NULL;
 }
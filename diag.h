@@ -1,12 +1,71 @@
 #ifndef DIAG_H
 #define DIAG_H
 
+// Diagnostic logger
+//
+// DPRINT/DLOG never block the caller.  Each thread formats its messages into its own ring buffer
+//   and a background thread drains the rings (in time order) to stdout or to a log file.  If a
+//   ring is full the message is dropped and counted rather than waiting for the output to catch up.
+//
+// Each source file is a module, named after the file ("switch", "st_playerMove", ...), and has its
+//   own level that can be changed at run time.  The PICHESS_LOG environment variable sets the
+//   levels at start up, e.g.
+//
+//    PICHESS_LOG="info,switch=debug,led=error"
+//
+//   and PICHESS_LOG_FILE sends the output to a file (kept to DIAG_FILE_SIZE bytes, the previous
+//   contents are moved to <file>.1).
+
+#include <stdint.h>
+
+typedef enum diagLevel_e
+{
+   DIAG_ERROR,
+   DIAG_WARN,
+   DIAG_INFO,
+   DIAG_DEBUG,
+
+   DIAG_LEVEL_TOTAL
+}diagLevel_t;
+
+#define DIAG_FILE_SIZE (1024 * 1024)
+
+struct diagModule_s;
+
 #if DEBUG_OUTPUT
-#define DPRINT(msg, ...)       DIAG_print(msg, ##__VA_ARGS__)
+#define DLOG(level, msg, ...)                                                         \
+   do                                                                                 \
+   {                                                                                  \
+      static struct diagModule_s *_Atomic diagModule;                                 \
+      DIAG_log(&diagModule, __FILE__, level, msg, ##__VA_ARGS__);                     \
+   } while(0)
 #else
-#define DPRINT(msg, ...)
+#define DLOG(level, msg, ...)
 #endif
 
-void DIAG_print(char *msg, ...);
+#define DPRINT(msg, ...)       DLOG(DIAG_DEBUG, msg, ##__VA_ARGS__)
+
+// Start the drain thread and apply PICHESS_LOG / PICHESS_LOG_FILE.  Messages logged before this
+//   are held in the rings.
+void     DIAG_init( void );
+
+// Log a message (use the DLOG / DPRINT macros).  module caches the lookup of file's module.
+void     DIAG_log( struct diagModule_s *_Atomic *module, const char *file, diagLevel_t level, const char *msg, ... )
+                  __attribute__((format(printf, 4, 5)));
+
+// Set the level of one module, or of every module without its own setting if module is NULL
+void     DIAG_setLevel( const char *module, diagLevel_t level );
+
+// Apply a level spec as used by PICHESS_LOG:  comma separated "level" or "module=level" items
+void     DIAG_configure( const char *spec );
+
+// Send output to file (NULL for stdout).  The file is rotated once it grows past maxBytes.
+void     DIAG_setOutput( const char *file, long maxBytes );
+
+// Write out everything logged so far before returning
+void     DIAG_flush( void );
+
+// Number of messages dropped because a ring was full
+uint32_t DIAG_dropCount( void );
 
 #endif
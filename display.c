@@ -3,7 +3,6 @@
 
 #include <string.h>
 
-#include "bcm2835.h"
 #include "diag.h"
 #include "display.h"
 #include "types.h"
@@ -11,6 +10,7 @@
 #include "gpio.h"
 #include "specChars.h"
 #include "hsm.h"
+#include "hal.h"
 
 // Some display parameters
 #define DISPLAY_STACK_DEPTH 10
@@ -249,7 +249,7 @@ void displayClearLine( int line )
    // verify passed parameter
    if( line >= NUM_LINES)
    {
-      DPRINT("Invalid line number passed to displayClearLine\n");
+      DLOG(DIAG_WARN, "Invalid line number passed to displayClearLine\n");
       return;
    }
 
@@ -269,7 +269,7 @@ void displayWriteLine( int line, char *data, bool_t centered)
 
     if( line >= NUM_LINES)
     {
-      DPRINT("Invalid line number passed to displayWriteLine\n");
+      DLOG(DIAG_WARN, "Invalid line number passed to displayWriteLine\n");
       return;
     }
 
@@ -306,7 +306,7 @@ void displayWriteChars( int line, int offset, int len, char *data)
 
    if( line >= NUM_LINES )
    {
-      DPRINT("Invalid line number passed to displayWriteChars\n");
+      DLOG(DIAG_WARN, "Invalid line number passed to displayWriteChars\n");
       return;
    }
 
@@ -325,7 +325,7 @@ void displayWriteChars( int line, int offset, int len, char *data)
 
    if( offset + len > LINE_LENGTH)
    {
-      DPRINT("Warning: truncating line passed to displayWriteChars\n");
+      DLOG(DIAG_WARN, "Warning: truncating line passed to displayWriteChars\n");
       len = LINE_LENGTH - offset;
    }
 
@@ -344,7 +344,7 @@ void displayPush( void )
    }
    else
    {
-      DPRINT("ERROR: Display stack full\n");
+      DLOG(DIAG_ERROR, "ERROR: Display stack full\n");
    }
 }
 
@@ -367,7 +367,7 @@ void displayPop( void )
 
    else
    {
-      DPRINT("ERROR: No stacked display to pop\n");
+      DLOG(DIAG_ERROR, "ERROR: No stacked display to pop\n");
    }
 }
 
@@ -408,7 +408,7 @@ void defineCharacter(uint8_t pos, specCharDefn data)
 
    if(pos >= 8)
    {
-      DPRINT("ERROR:  invalid pos parameter in function defineCharacter\n");
+      DLOG(DIAG_ERROR, "ERROR:  invalid pos parameter in function defineCharacter\n");
       return;
    }
 
@@ -521,7 +521,7 @@ void checkDisplay( event_t ev )
    int i;
 
    // If we can communicate with GPIO Expander...
-   if( i2cSendReceive( GPIO_EXPANDER_UI_ADDR, &cmd, 1, &rsp, 1) == BCM2835_I2C_REASON_OK)
+   if( i2cSendReceive( GPIO_EXPANDER_UI_ADDR, &cmd, 1, &rsp, 1) == HAL_I2C_OK)
    {
        // If Configuration is not correct...
       if(rsp != 0x1F)
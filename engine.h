@@ -2,9 +2,25 @@
 #define _ENGINE_H_
 
 
+// Install location of the engine executable, its result file and the opening books.
+//   Override at build time with "make CHESS_DIR=/some/path"
+#ifndef CHESS_DIR
+#define CHESS_DIR "/home/pi/chess"
+#endif
+
 #define MIN_STRENGTH  0
 #define MAX_STRENGTH 20
 
+// Engine speed used to budget a capped strength level's nodes against the clock, until one has
+//   been measured (OPT_ENGINE_KNPS).  Searches shorter than NPS_SAMPLE_MIN_MS are too short to
+//   measure it by.  A move in a timed game gets at most its share of NPS_BUDGET_MOVES moves of the
+//   time left, plus the increment.
+
+#define DEFAULT_KNPS_PER_THREAD  150
+#define MAX_KNPS_PER_THREAD      100000
+#define NPS_SAMPLE_MIN_MS        1000
+#define NPS_BUDGET_MOVES         30
+
 // For untimed games, computer will search until either a fixed depth or fixed time set by user
 
 #define MIN_PLY_DEPTH      4
@@ -15,4 +31,36 @@
 #define DEFAULT_TIME_SEARCH_SEC   5
 #define MAX_TIME_SEARCH_SEC     120
 
+// Engine transposition table size (MB) and search threads.  An option value of ENGINE_AUTO sizes
+//   them to the machine:  a quarter of the free memory (at least MIN_AUTO_HASH_MB) and a thread
+//   per core.
+
+#define ENGINE_AUTO          0
+#define MIN_AUTO_HASH_MB    16
+#define MAX_HASH_MB       1024
+#define MAX_THREADS         64
+
+// Engines kept started and warm, ready for the next game (see sfInterface.h)
+
+#define DEFAULT_STANDBY_ENGINES  1
+#define MAX_STANDBY_ENGINES      2
+
+// Syzygy endgame tablebases (any of the 3 to 6 piece .rtbw and .rtbz files), used as OPT_TABLEBASES
+//   says (see tb.h).  Override at build time with "make TB_DIR=/some/path"
+#ifndef TB_DIR
+#define TB_DIR CHESS_DIR "/syzygy"
+#endif
+
+// Repeatable searches (OPT_ENGINE_REPEATABLE) count the clock in nodes at this rate, per ms.  Below
+//   the engine's speed on the board, so a timed game isn't lost on time.
+
+#define REPEATABLE_NODES_PER_MS  100
+
+typedef enum tbUse_e
+{
+   TB_OFF,
+   TB_ON,           // the engine plays from them and the result is shown
+   TB_ADJUDICATE    // and a game whose result they decide is ended there
+}tbUse_t;
+
 #endif
@@ -0,0 +1,840 @@
+// Engine benchmark (engineBench)
+//
+// Plays the positions of recorded games to the engine through sfInterface.c, the way a game on the
+//   board does, and reports how the engine behaves under piChess's own search conditions:
+//
+//    engineBench [-t threads] [-l levels] [-c condition] ... [-n stride] [-o file.json] [games]
+//
+//       -t   engine threads (default: as the board picks them, one per core)
+//       -l   strength levels to run, comma separated (default 20)
+//       -c   a search condition;  give any number of them (default clock:60+1, movetime:1000
+//            and depth:12)
+//               clock:<base s>+<inc s>   timed game (SF_findMove).  Each side's clock is run down
+//                                        by the replies, as on the board.
+//               movetime:<ms>            fixed time search (SF_findMoveFixedTime)
+//               depth:<ply>              fixed depth search (SF_findMoveFixedDepth)
+//       -n   search every n'th position of each game (default 2)
+//       -o   also write the results as JSON, for comparing builds, engines and boards
+//
+// games is a text file with one game per line, as the coordinate moves sent to the engine
+//   ("e2e4 e7e5 g1f3 ..."), optionally after "fen <FEN> moves".  Lines starting with '#' are
+//   skipped.  Without it a few built in games are used.
+//
+// For each condition and level it reports:
+//
+//    reply ms     search started to the answer reaching the state machine's queue (percentiles).
+//                 This includes sfInterface's polling for the result file, as on the board.
+//    engine ms    search time the engine reports
+//    knps         nodes per second (thousands)
+//    depth        depth reached
+//    clock        timed:  clocks run out (the clocks are then reset for the rest of the game) and
+//                 the least time left after a reply.  Fixed time:  replies later than the time
+//                 plus OVERRUN_SLACK_MS.
+//    cpu          searches that ran while the clock was throttled, hottest temperature and lowest
+//                 clock seen (thermal.h)
+//
+// The engine's hash table is cleared before each game, so conditions don't learn from each
+//   other.  It runs in a new directory under /tmp so the board's options aren't touched, and the
+//   engines neither load nor save the board's saved hash table.
+
+#include "sfInterface.h"
+#include "hsmDefs.h"
+#include "event.h"
+#include "options.h"
+#include "board.h"
+#include "moves.h"
+#include "util.h"
+#include "moveRecord.h"
+#include "thermal.h"
+#include "diag.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <semaphore.h>
+#include <sys/stat.h>
+
+#define BENCH_VERSION       2
+#define MAX_CONDITIONS      16
+#define MAX_GAMES           200
+#define MAX_LINE            8192
+#define OVERRUN_SLACK_MS    250      // sfInterface polls every 50ms and waits 100ms more
+#define REPLY_TIMEOUT_MS    30000    // beyond what the search was allowed
+#define DEPTH_TIMEOUT_MS    600000
+
+typedef enum condKind_e
+{
+   COND_CLOCK,
+   COND_MOVETIME,
+   COND_DEPTH
+}condKind_t;
+
+typedef struct benchCond_s
+{
+   condKind_t kind;
+   uint32_t   value;      // base ms, movetime ms or depth
+   uint32_t   incMs;
+   char       name[32];
+}benchCond_t;
+
+typedef struct benchGame_s
+{
+   char *fen;             // NULL for the normal start
+   char *moves;
+}benchGame_t;
+
+typedef struct benchStat_s
+{
+   double *vals;
+   int     count;
+   int     size;
+}benchStat_t;
+
+typedef struct benchResult_s
+{
+   const benchCond_t *cond;
+   int         level;
+   int         searches;
+   int         failures;
+   benchStat_t reply;
+   benchStat_t engine;
+   benchStat_t knps;
+   benchStat_t depth;
+   int         flags;
+   int64_t     leastClockMs;
+   int         overruns;
+   int         throttled;
+   int32_t     hottestMilliC;
+   int32_t     lowestFreqKHz;
+}benchResult_t;
+
+static const char *builtInGames[] =
+{
+   // Ruy Lopez, closed
+   "e2e4 e7e5 g1f3 b8c6 f1b5 a7a6 b5a4 g8f6 e1g1 f8e7 f1e1 b7b5 a4b3 d7d6 c2c3 e8g8 h2h3 c6a5 "
+   "b3c2 c7c5 d2d4 d8c7 b1d2 c5d4 c3d4 a5c6 d2b3 a6a5 c1e3 a5a4 b3d2 c8d7",
+
+   // Queen's Gambit Declined
+   "d2d4 d7d5 c2c4 e7e6 b1c3 g8f6 c1g5 f8e7 e2e3 e8g8 g1f3 h7h6 g5h4 b7b6 c4d5 f6d5 h4e7 d8e7 "
+   "c3d5 e6d5 a1c1 c8e6 d1a4 c7c5 a4a3 f8c8 f1e2 a7a6",
+
+   // Sicilian Najdorf, English attack
+   "e2e4 c7c5 g1f3 d7d6 d2d4 c5d4 f3d4 g8f6 b1c3 a7a6 c1e3 e7e5 d4b3 c8e6 f2f3 f8e7 d1d2 e8g8 "
+   "e1c1 b8d7 g2g4 b7b5 g4g5 b5b4 c3e2 f6e8 f3f4 a6a5",
+
+   // Rook ending
+   "fen 8/5pk1/6p1/8/3R4/6P1/5PK1/1r6 w - - 0 40 moves d4d7 b1b2 g2f3 b2b3 f3e4 b3b4 e4e5 b4b5 "
+   "e5e4 b5b4 e4d5 b4b5 d5c6 b5b2 f2f4",
+};
+
+static benchCond_t   conds[MAX_CONDITIONS];
+static int           condCount = 0;
+static int           levels[MAX_STRENGTH + 1];
+static int           levelCount = 0;
+static benchGame_t   games[MAX_GAMES];
+static int           gameCount = 0;
+static int           stride = 2;
+
+static game_t        benchGame;
+static ShmRecord     recs[SHM_RING_SIZE];
+
+static void   usage( const char *name );
+static bool_t parseCondition( const char *text, benchCond_t *c );
+static int    parseLevels( char *text );
+static bool_t addGame( const char *line );
+static int    loadGames( const char *file );
+static void   runBench( benchResult_t *r );
+static bool_t startGame( const benchGame_t *g );
+static bool_t playMove( const char *coord );
+static bool_t runSearch( benchResult_t *r, uint32_t clocks[2] );
+static bool_t waitForReply( uint32_t timeoutMs );
+static void   noteThermal( benchResult_t *r, const thermalState_t *s );
+static void   printResult( benchResult_t *r );
+static void   writeJson( const char *file, benchResult_t *results, int count );
+static void   jsonStat( FILE *fp, const char *name, benchStat_t *s, bool_t last );
+static void   hostModel( char *text, int size );
+static void   statAdd( benchStat_t *s, double val );
+static double statPct( benchStat_t *s, int pct );
+static double statMean( benchStat_t *s );
+static int    compareDouble( const void *a, const void *b );
+static double msSince( const struct timespec *t );
+
+int main( int argc, char *argv[] )
+{
+   char dir[] = "/tmp/engineBench.XXXXXX";
+   const char *jsonFile = NULL;
+   benchResult_t *results;
+   long threads = ENGINE_AUTO;
+   int opt, i, j, n = 0;
+
+   while( (opt = getopt(argc, argv, "t:l:c:n:o:")) != -1)
+   {
+      switch(opt)
+      {
+         case 't':
+            threads = atol(optarg);
+            break;
+
+         case 'l':
+            if(parseLevels(optarg) == 0)
+               usage(argv[0]);
+            break;
+
+         case 'c':
+            if(condCount == MAX_CONDITIONS || !parseCondition(optarg, &conds[condCount]))
+               usage(argv[0]);
+            condCount++;
+            break;
+
+         case 'n':
+            if( (stride = atoi(optarg)) < 1)
+               usage(argv[0]);
+            break;
+
+         case 'o':
+            jsonFile = optarg;
+            break;
+
+         default:
+            usage(argv[0]);
+      }
+   }
+
+   if(condCount == 0)
+   {
+      parseCondition("clock:60+1",    &conds[condCount++]);
+      parseCondition("movetime:1000", &conds[condCount++]);
+      parseCondition("depth:12",      &conds[condCount++]);
+   }
+
+   if(levelCount == 0)
+      levels[levelCount++] = MAX_STRENGTH;
+
+   if(optind < argc)
+   {
+      if(loadGames(argv[optind]) != 0)
+         exit(-1);
+   }
+   else
+   {
+      for(i=0;i<sizeof(builtInGames)/sizeof(builtInGames[0]);i++)
+         addGame(builtInGames[i]);
+   }
+
+   if(gameCount == 0)
+   {
+      fprintf(stderr, "No games to play\n");
+      exit(-1);
+   }
+
+   // The JSON goes where it was asked for, not into the scratch directory
+   if(jsonFile != NULL && jsonFile[0] != '/')
+   {
+      static char path[300];
+      char cwd[200];
+
+      if(getcwd(cwd, sizeof(cwd)) != NULL)
+      {
+         snprintf(path, sizeof(path), "%s/%s", cwd, jsonFile);
+         jsonFile = path;
+      }
+   }
+
+   if(mkdtemp(dir) == NULL || chdir(dir) != 0)
+   {
+      fprintf(stderr, "Unable to create bench directory\n");
+      exit(-1);
+   }
+
+   // Engine messages only if something goes wrong
+   DIAG_init();
+   DIAG_setLevel(NULL, DIAG_WARN);
+
+   initEvent();
+   loadOptions();
+
+   setOption(OPT_ENGINE_THREADS, threads);
+   SF_setHashFile("<empty>");
+
+   printf("Benchmarking in %s:  %d games, every %d position, %d threads, %d MB hash\n\n", dir, gameCount,
+          stride, SF_threadCount(), SF_hashSizeMB());
+
+   results = calloc(condCount * levelCount, sizeof(benchResult_t));
+
+   for(i=0;i<condCount;i++)
+   {
+      for(j=0;j<levelCount;j++)
+      {
+         benchResult_t *r = &results[n++];
+
+         r->cond          = &conds[i];
+         r->level         = levels[j];
+         r->leastClockMs  = -1;
+         r->hottestMilliC = -1;
+         r->lowestFreqKHz = -1;
+
+         runBench(r);
+         printResult(r);
+      }
+   }
+
+   if(jsonFile != NULL)
+      writeJson(jsonFile, results, n);
+
+   DIAG_flush();
+
+   return 0;
+}
+
+static void usage( const char *name )
+{
+   fprintf(stderr, "usage: %s [-t threads] [-l levels] [-c clock:<s>+<inc>|movetime:<ms>|depth:<ply>] ... "
+                   "[-n stride] [-o file.json] [games]\n", name);
+   exit(-1);
+}
+
+static bool_t parseCondition( const char *text, benchCond_t *c )
+{
+   unsigned base, inc = 0;
+
+   memset(c, 0, sizeof(*c));
+   snprintf(c->name, sizeof(c->name), "%s", text);
+
+   if(sscanf(text, "clock:%u+%u", &base, &inc) >= 1)
+   {
+      c->kind  = COND_CLOCK;
+      c->value = base * 1000;
+      c->incMs = inc * 1000;
+   }
+   else if(sscanf(text, "movetime:%u", &base) == 1)
+   {
+      c->kind  = COND_MOVETIME;
+      c->value = base;
+   }
+   else if(sscanf(text, "depth:%u", &base) == 1)
+   {
+      c->kind  = COND_DEPTH;
+      c->value = base;
+   }
+   else
+      return FALSE;
+
+   return (c->value > 0);
+}
+
+static int parseLevels( char *text )
+{
+   char *tok;
+
+   for(tok = strtok(text, ","); tok != NULL; tok = strtok(NULL, ","))
+   {
+      int level = atoi(tok);
+
+      if(level < MIN_STRENGTH || level > MAX_STRENGTH || levelCount > MAX_STRENGTH)
+         return 0;
+
+      levels[levelCount++] = level;
+   }
+
+   return levelCount;
+}
+
+static bool_t addGame( const char *line )
+{
+   benchGame_t *g = &games[gameCount];
+   const char *moves = line;
+
+   if(gameCount == MAX_GAMES)
+      return FALSE;
+
+   g->fen = NULL;
+
+   if(!strncmp(line, "fen ", 4))
+   {
+      const char *end = strstr(line, " moves");
+
+      if(end == NULL)
+         end = line + strlen(line);
+
+      g->fen = strndup(line + 4, end - (line + 4));
+      moves  = *end ? end + 6 : end;
+   }
+
+   g->moves = strdup(moves);
+   gameCount++;
+
+   return TRUE;
+}
+
+static int loadGames( const char *file )
+{
+   static char line[MAX_LINE];
+   FILE *fp;
+
+   if( (fp = fopen(file, "r")) == NULL)
+   {
+      fprintf(stderr, "Unable to open %s\n", file);
+      return -1;
+   }
+
+   while(fgets(line, sizeof(line), fp) != NULL)
+   {
+      line[strcspn(line, "\r\n")] = '\0';
+
+      if(line[0] == '#' || line[strspn(line, " \t")] == '\0')
+         continue;
+
+      if(!addGame(line))
+      {
+         fprintf(stderr, "Only the first %d games are used\n", MAX_GAMES);
+         break;
+      }
+   }
+
+   fclose(fp);
+
+   return 0;
+}
+
+// Every game at one condition and level
+static void runBench( benchResult_t *r )
+{
+   int i;
+
+   setOption(OPT_ENGINE_STRENGTH, r->level);
+
+   for(i=0;i<gameCount;i++)
+   {
+      char *moves = strdup(games[i].moves), *tok, *save;
+      uint32_t clocks[2];
+      int ply = 0;
+
+      if(!startGame(&games[i]))
+      {
+         fprintf(stderr, "Game %d:  bad FEN, skipped\n", i + 1);
+         free(moves);
+         continue;
+      }
+
+      clocks[WHITE] = clocks[BLACK] = r->cond->value;
+
+      SF_initEngine();
+      SF_clearHash();
+
+      for(tok = strtok_r(moves, " ", &save); tok != NULL; tok = strtok_r(NULL, " ", &save))
+      {
+         if(ply++ % stride == 0 && !runSearch(r, clocks))
+            r->failures++;
+
+         if(!playMove(tok))
+         {
+            fprintf(stderr, "Game %d:  illegal move %s, rest of game skipped\n", i + 1, tok);
+            break;
+         }
+      }
+
+      SF_closeEngine();
+      free(moves);
+   }
+}
+
+static bool_t startGame( const benchGame_t *g )
+{
+   free(benchGame.startPos);
+   memset(&benchGame, 0, sizeof(benchGame));
+
+   if(g->fen != NULL)
+      benchGame.startPos = strdup(g->fen);
+
+   if(setBoard(&benchGame.brd, g->fen != NULL ? g->fen : startString) != FEN_OK)
+      return FALSE;
+
+   benchGame.posHistory[0].posHash = benchGame.brd.hash;
+
+   return TRUE;
+}
+
+// Play a move from the game, as st_playingGame.c does
+static bool_t playMove( const char *coord )
+{
+   move_t list[MAX_LIST_SIZE], m;
+   char text[8];
+   int i, n;
+
+   snprintf(text, sizeof(text), "%s", coord);
+
+   if(strlen(text) < 4 || benchGame.playedMoves >= MAX_MOVES_IN_GAME - 1)
+      return FALSE;
+
+   m = convertCoordMove(text);
+   n = findMoves(&benchGame.brd, list);
+
+   for(i=0;i<n;i++)
+   {
+      if(list[i].from == m.from && list[i].to == m.to && list[i].promote == m.promote)
+         break;
+   }
+
+   if(i == n)
+      return FALSE;
+
+   benchGame.posHistory[benchGame.playedMoves].move    = m;
+   benchGame.posHistory[benchGame.playedMoves].revMove = move(&benchGame.brd, m);
+   benchGame.playedMoves++;
+   benchGame.posHistory[benchGame.playedMoves].posHash = benchGame.brd.hash;
+
+   MOVEREC_append(&benchGame.moveRecord, text);
+
+   return TRUE;
+}
+
+// One search for a move from the current position
+static bool_t runSearch( benchResult_t *r, uint32_t clocks[2] )
+{
+   const benchCond_t *c = r->cond;
+   color_t side = benchGame.brd.toMove;
+   thermalState_t before, after;
+   struct timespec start;
+   uint32_t timeoutMs;
+   char line[40] = "";
+   double replyMs;
+   int depth = 0, n, i;
+   bool_t gotBest = FALSE;
+   FILE *fp;
+
+   // Skip the updates from the last search
+   while(SF_readUpdates(recs, SHM_RING_SIZE) > 0);
+
+   THERMAL_read(&before);
+
+   SF_setGame(&benchGame);
+   clock_gettime(CLOCK_MONOTONIC, &start);
+
+   switch(c->kind)
+   {
+      case COND_CLOCK:
+         SF_findMove(clocks[WHITE], clocks[BLACK], c->incMs, c->incMs, side);
+         timeoutMs = clocks[side] + REPLY_TIMEOUT_MS;
+         break;
+
+      case COND_MOVETIME:
+         SF_findMoveFixedTime(c->value);
+         timeoutMs = c->value + REPLY_TIMEOUT_MS;
+         break;
+
+      default:
+         SF_findMoveFixedDepth(c->value);
+         timeoutMs = DEPTH_TIMEOUT_MS;
+         break;
+   }
+
+   if(!waitForReply(timeoutMs))
+   {
+      fprintf(stderr, "No reply from the engine in %u ms\n", timeoutMs);
+      SF_stop();
+      return FALSE;
+   }
+
+   replyMs = msSince(&start);
+
+   if( (fp = fopen(OUTPUT_FILE, "r")) != NULL)
+   {
+      if(fgets(line, sizeof(line), fp) == NULL)
+         line[0] = '\0';
+      fclose(fp);
+      remove(OUTPUT_FILE);
+   }
+
+   if(strncmp(line, "bestmove", 8))
+   {
+      fprintf(stderr, "Unexpected engine result [%s]\n", line);
+      return FALSE;
+   }
+
+   THERMAL_read(&after);
+
+   r->searches++;
+   statAdd(&r->reply, replyMs);
+
+   // The deepest line it reported, and the totals for the search
+   while( (n = SF_readUpdates(recs, SHM_RING_SIZE)) > 0)
+   {
+      for(i=0;i<n;i++)
+      {
+         if(recs[i].type == SHM_REC_PV && recs[i].multiPV == 1 && recs[i].depth > depth)
+            depth = recs[i].depth;
+
+         if(recs[i].type == SHM_REC_BESTMOVE)
+         {
+            statAdd(&r->engine, recs[i].timeMs);
+            statAdd(&r->knps, recs[i].nps / 1000.0);
+            gotBest = TRUE;
+         }
+      }
+   }
+
+   if(gotBest)
+      statAdd(&r->depth, depth);
+
+   if(c->kind == COND_CLOCK)
+   {
+      if(replyMs >= clocks[side])
+      {
+         r->flags++;
+         r->leastClockMs = 0;
+         clocks[WHITE] = clocks[BLACK] = c->value;
+      }
+      else
+      {
+         clocks[side] -= (uint32_t)replyMs;
+
+         if(r->leastClockMs < 0 || clocks[side] < r->leastClockMs)
+            r->leastClockMs = clocks[side];
+
+         clocks[side] += c->incMs;
+      }
+   }
+   else if(c->kind == COND_MOVETIME && replyMs > c->value + OVERRUN_SLACK_MS)
+   {
+      r->overruns++;
+   }
+
+   if(THERMAL_clockThrottled(&before) || THERMAL_clockThrottled(&after))
+      r->throttled++;
+
+   noteThermal(r, &before);
+   noteThermal(r, &after);
+
+   return TRUE;
+}
+
+// Wait for sfInterface to post the engine's answer, as the state machine would get it
+static bool_t waitForReply( uint32_t timeoutMs )
+{
+   struct timespec deadline;
+   event_t *ev;
+
+   clock_gettime(CLOCK_REALTIME, &deadline);
+   deadline.tv_sec  += timeoutMs / 1000 + (deadline.tv_nsec + (timeoutMs % 1000) * 1000000L) / 1000000000L;
+   deadline.tv_nsec  = (deadline.tv_nsec + (timeoutMs % 1000) * 1000000L) % 1000000000L;
+
+   while(1)
+   {
+      if(sem_timedwait(getQueueSem(EVQ_EVENT_MANAGER), &deadline) != 0)
+      {
+         if(errno == EINTR)
+            continue;
+         return FALSE;
+      }
+
+      if( (ev = getEvent(EVQ_EVENT_MANAGER)) != NULL && ev->ev == EV_PROCESS_COMPUTER_MOVE)
+         return TRUE;
+   }
+}
+
+static void noteThermal( benchResult_t *r, const thermalState_t *s )
+{
+   if(s->tempMilliC > r->hottestMilliC)
+      r->hottestMilliC = s->tempMilliC;
+
+   if(s->curFreqKHz > 0 && (r->lowestFreqKHz < 0 || s->curFreqKHz < r->lowestFreqKHz))
+      r->lowestFreqKHz = s->curFreqKHz;
+}
+
+static void printResult( benchResult_t *r )
+{
+   printf("%s level %d:  %d searches", r->cond->name, r->level, r->searches);
+   if(r->failures)
+      printf(", %d failed", r->failures);
+   printf("\n");
+
+   printf("   reply ms    p50 %8.0f   p90 %8.0f   p99 %8.0f   max %8.0f\n",
+          statPct(&r->reply, 50), statPct(&r->reply, 90), statPct(&r->reply, 99), statPct(&r->reply, 100));
+   printf("   engine ms   p50 %8.0f   p90 %8.0f   max %8.0f\n",
+          statPct(&r->engine, 50), statPct(&r->engine, 90), statPct(&r->engine, 100));
+   printf("   knps        p50 %8.0f   min %8.0f\n", statPct(&r->knps, 50), statPct(&r->knps, 0));
+   printf("   depth       mean %7.1f   min %8.0f\n", statMean(&r->depth), statPct(&r->depth, 0));
+
+   if(r->cond->kind == COND_CLOCK)
+      printf("   clock       flags %d   least left %.1f s\n", r->flags, r->leastClockMs / 1000.0);
+   else if(r->cond->kind == COND_MOVETIME)
+      printf("   clock       overruns %d\n", r->overruns);
+
+   printf("   cpu         throttled %d", r->throttled);
+
+   if(r->hottestMilliC >= 0)
+      printf("   hottest %.1fC", r->hottestMilliC / 1000.0);
+   else
+      printf("   hottest n/a");
+
+   if(r->lowestFreqKHz > 0)
+      printf("   lowest clock %d MHz\n\n", r->lowestFreqKHz / 1000);
+   else
+      printf("   lowest clock n/a\n\n");
+}
+
+static void writeJson( const char *file, benchResult_t *results, int count )
+{
+   char model[100];
+   struct stat st;
+   FILE *fp;
+   int i;
+
+   if( (fp = fopen(file, "w")) == NULL)
+   {
+      fprintf(stderr, "Unable to write %s\n", file);
+      return;
+   }
+
+   hostModel(model, sizeof(model));
+
+   if(stat(CHESS_DIR "/stockfish", &st) != 0)
+      memset(&st, 0, sizeof(st));
+
+   fprintf(fp, "{\n");
+   fprintf(fp, "  \"version\": %d,\n", BENCH_VERSION);
+   fprintf(fp, "  \"time\": %ld,\n", (long)time(NULL));
+   fprintf(fp, "  \"build\": \"%s %s\",\n", __DATE__, __TIME__);
+   fprintf(fp, "  \"host\": { \"model\": \"%s\", \"cores\": %d },\n", model, SF_coreCount());
+   fprintf(fp, "  \"engine\": { \"path\": \"%s\", \"size\": %ld, \"mtime\": %ld, \"threads\": %d, \"hashMB\": %d },\n",
+           CHESS_DIR "/stockfish", (long)st.st_size, (long)st.st_mtime, SF_threadCount(), SF_hashSizeMB());
+   fprintf(fp, "  \"games\": %d,\n", gameCount);
+   fprintf(fp, "  \"stride\": %d,\n", stride);
+   fprintf(fp, "  \"results\": [\n");
+
+   for(i=0;i<count;i++)
+   {
+      benchResult_t *r = &results[i];
+
+      fprintf(fp, "    {\n");
+      fprintf(fp, "      \"condition\": \"%s\",\n", r->cond->name);
+      fprintf(fp, "      \"level\": %d,\n", r->level);
+      fprintf(fp, "      \"depthCap\": %d,\n", SF_strengthProfile(r->level)->depth);
+      fprintf(fp, "      \"nodeCap\": %u,\n", SF_strengthProfile(r->level)->nodes);
+      fprintf(fp, "      \"searches\": %d,\n", r->searches);
+      fprintf(fp, "      \"failures\": %d,\n", r->failures);
+      jsonStat(fp, "replyMs",  &r->reply,  FALSE);
+      jsonStat(fp, "engineMs", &r->engine, FALSE);
+      jsonStat(fp, "knps",     &r->knps,   FALSE);
+      jsonStat(fp, "depth",    &r->depth,  FALSE);
+      fprintf(fp, "      \"flags\": %d,\n", r->flags);
+      fprintf(fp, "      \"leastClockMs\": %lld,\n", (long long)r->leastClockMs);
+      fprintf(fp, "      \"overruns\": %d,\n", r->overruns);
+      fprintf(fp, "      \"throttled\": %d,\n", r->throttled);
+
+      // null where the board doesn't report it
+      if(r->hottestMilliC >= 0)
+         fprintf(fp, "      \"hottestC\": %.1f,\n", r->hottestMilliC / 1000.0);
+      else
+         fprintf(fp, "      \"hottestC\": null,\n");
+
+      if(r->lowestFreqKHz > 0)
+         fprintf(fp, "      \"lowestClockMHz\": %d\n", r->lowestFreqKHz / 1000);
+      else
+         fprintf(fp, "      \"lowestClockMHz\": null\n");
+      fprintf(fp, "    }%s\n", i < count - 1 ? "," : "");
+   }
+
+   fprintf(fp, "  ]\n}\n");
+   fclose(fp);
+
+   printf("Results written to %s\n", file);
+}
+
+static void jsonStat( FILE *fp, const char *name, benchStat_t *s, bool_t last )
+{
+   fprintf(fp, "      \"%s\": { \"count\": %d, \"mean\": %.1f, \"min\": %.1f, \"p50\": %.1f, \"p90\": %.1f, "
+               "\"p99\": %.1f, \"max\": %.1f }%s\n", name, s->count, statMean(s), statPct(s, 0), statPct(s, 50),
+               statPct(s, 90), statPct(s, 99), statPct(s, 100), last ? "" : ",");
+}
+
+// The Pi's model from the device tree, or the CPU's name elsewhere
+static void hostModel( char *text, int size )
+{
+   char line[200];
+   FILE *fp;
+
+   snprintf(text, size, "unknown");
+
+   if( (fp = fopen("/proc/device-tree/model", "r")) != NULL)
+   {
+      if(fgets(line, sizeof(line), fp) != NULL)
+         snprintf(text, size, "%s", line);
+      fclose(fp);
+   }
+   else if( (fp = fopen("/proc/cpuinfo", "r")) != NULL)
+   {
+      while(fgets(line, sizeof(line), fp) != NULL)
+      {
+         char *colon = strchr(line, ':');
+
+         if(colon != NULL && (!strncmp(line, "model name", 10) || !strncmp(line, "Model", 5)))
+         {
+            snprintf(text, size, "%s", colon + 2);
+            break;
+         }
+      }
+      fclose(fp);
+   }
+
+   text[strcspn(text, "\"\\\r\n")] = '\0';
+}
+
+static void statAdd( benchStat_t *s, double val )
+{
+   if(s->count == s->size)
+   {
+      s->size = s->size ? s->size * 2 : 64;
+      s->vals = realloc(s->vals, s->size * sizeof(double));
+   }
+
+   s->vals[s->count++] = val;
+}
+
+// Nearest rank percentile;  0 is the minimum, 100 the maximum
+static double statPct( benchStat_t *s, int pct )
+{
+   int i;
+
+   if(s->count == 0)
+      return 0;
+
+   qsort(s->vals, s->count, sizeof(double), compareDouble);
+
+   i = (s->count * pct + 99) / 100 - 1;
+
+   if(i < 0)         i = 0;
+   if(i >= s->count) i = s->count - 1;
+
+   return s->vals[i];
+}
+
+static double statMean( benchStat_t *s )
+{
+   double sum = 0;
+   int i;
+
+   for(i=0;i<s->count;i++)
+      sum += s->vals[i];
+
+   return s->count ? sum / s->count : 0;
+}
+
+static int compareDouble( const void *a, const void *b )
+{
+   double x = *(const double *)a, y = *(const double *)b;
+
+   return (x > y) - (x < y);
+}
+
+static double msSince( const struct timespec *t )
+{
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+
+   return (now.tv_sec - t->tv_sec) * 1000.0 + (now.tv_nsec - t->tv_nsec) / 1000000.0;
+}
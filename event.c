@@ -1,4 +1,5 @@
 // #include "event.h"
+#include "trace.h"
 #include "hsm.h"
 #include "diag.h"
 #include "string.h"
@@ -47,7 +48,7 @@ void putEvent(evQueueIndex_t indx, event_t *evData)
 
    if(indx >= EVQ_TOTAL)
    {
-       DPRINT("Invalid queue index %d passed to putEvent\n", (int)indx);
+       DLOG(DIAG_WARN, "Invalid queue index %d passed to putEvent\n", (int)indx);
        return;
    }
 
@@ -62,6 +63,9 @@ void putEvent(evQueueIndex_t indx, event_t *evData)
    }
    memcpy(&eventQueue[indx].evQueue[eventQueue[indx].evPushIndex], evData, sizeof(event_t));
 
+   // Logged while the queue is locked so the trace order matches the queue order
+   TRACE_event(indx, evData);
+
    if(++eventQueue[indx].evPushIndex >= EVENT_QUEUE_SIZE) eventQueue[indx].evPushIndex = 0;
 
    pthread_mutex_unlock(&eventQueue[indx].mutex);
@@ -76,7 +80,7 @@ event_t *getEvent( evQueueIndex_t indx )
 
    if(indx >= EVQ_TOTAL)
    {
-      DPRINT("Invalid queue index %d passed to getEvent\n", (int)indx);
+      DLOG(DIAG_WARN, "Invalid queue index %d passed to getEvent\n", (int)indx);
       return NULL;
    }
 
@@ -2,7 +2,7 @@
 #include "gpio.h"
 #include "i2c.h"
 #include "diag.h"
-#include "bcm2835.h"
+#include "hal.h"
 
 void gpioInit( void )
 {
@@ -11,15 +11,15 @@ void gpioInit( void )
    DPRINT("Initializing GPIO Expanders\n");
 
 
-   bcm2835_gpio_set_pud(ROW_8_SWITCH_INT_PIN, BCM2835_GPIO_PUD_UP );
-   bcm2835_gpio_set_pud(ROW_7_SWITCH_INT_PIN, BCM2835_GPIO_PUD_UP );
-   bcm2835_gpio_set_pud(ROW_6_SWITCH_INT_PIN, BCM2835_GPIO_PUD_UP );
-   bcm2835_gpio_set_pud(ROW_5_SWITCH_INT_PIN, BCM2835_GPIO_PUD_UP );
-   bcm2835_gpio_set_pud(ROW_4_SWITCH_INT_PIN, BCM2835_GPIO_PUD_UP );
-   bcm2835_gpio_set_pud(ROW_3_SWITCH_INT_PIN, BCM2835_GPIO_PUD_UP );
-   bcm2835_gpio_set_pud(ROW_2_SWITCH_INT_PIN, BCM2835_GPIO_PUD_UP );
-   bcm2835_gpio_set_pud(ROW_1_SWITCH_INT_PIN, BCM2835_GPIO_PUD_UP );
-   bcm2835_gpio_set_pud(BUTTON_SWITCH_INT_PIN, BCM2835_GPIO_PUD_UP );
+   HAL_gpioSetPullUp(ROW_8_SWITCH_INT_PIN);
+   HAL_gpioSetPullUp(ROW_7_SWITCH_INT_PIN);
+   HAL_gpioSetPullUp(ROW_6_SWITCH_INT_PIN);
+   HAL_gpioSetPullUp(ROW_5_SWITCH_INT_PIN);
+   HAL_gpioSetPullUp(ROW_4_SWITCH_INT_PIN);
+   HAL_gpioSetPullUp(ROW_3_SWITCH_INT_PIN);
+   HAL_gpioSetPullUp(ROW_2_SWITCH_INT_PIN);
+   HAL_gpioSetPullUp(ROW_1_SWITCH_INT_PIN);
+   HAL_gpioSetPullUp(BUTTON_SWITCH_INT_PIN);
 
 // REED SWITCHES
 
@@ -0,0 +1,48 @@
+#ifndef HAL_H
+#define HAL_H
+
+// Hardware abstraction layer.
+//
+// All access to the Pi's peripherals (GPIO pins, I2C bus, SPI bus and the free running system
+//   timer) goes through these functions.  The backend is picked at build time:
+//
+//    make            - hal_bcm2835.c, drives the real board through the bcm2835 library
+//    make HAL=sim    - hal_sim.c, models the expanders, LED driver and display in memory so the
+//                      program can run headless on an ordinary Linux box (see hal_sim.c)
+//
+// The drivers above this layer (gpio.c, i2c.c, switch.c, led.c, display.c) are identical for
+//   both backends.
+
+#include <stdint.h>
+
+// Return code of the I2C functions on success (same value as BCM2835_I2C_REASON_OK)
+#define HAL_I2C_OK 0x00
+
+// Initialize the backend.  Must be called before any other HAL function.
+void     HAL_init( void );
+
+// Returns the level (0 or 1) of a GPIO input pin
+uint8_t  HAL_gpioLevel( uint8_t pin );
+
+// Enables the internal pull-up on a GPIO input pin
+void     HAL_gpioSetPullUp( uint8_t pin );
+
+// Start the I2C master
+void     HAL_i2cBegin( void );
+
+// Write len bytes to the given slave.  Returns HAL_I2C_OK on success
+uint8_t  HAL_i2cWrite( uint8_t slaveAddress, const uint8_t *buf, uint8_t len );
+
+// Write cmdLen bytes and read back rspLen bytes with a repeated start.  Returns HAL_I2C_OK on success
+uint8_t  HAL_i2cWriteRead( uint8_t slaveAddress, const uint8_t *cmd, uint8_t cmdLen, uint8_t *rsp, uint8_t rspLen );
+
+// Start the SPI master
+void     HAL_spiBegin( void );
+
+// Write len bytes out over SPI (chip select held for the whole transfer)
+void     HAL_spiWrite( const uint8_t *buf, uint8_t len );
+
+// Free running microsecond counter
+uint64_t HAL_timeMicros( void );
+
+#endif
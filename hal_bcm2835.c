@@ -0,0 +1,55 @@
+// Hardware abstraction layer backend for the real board, built on the bcm2835 library.
+
+#include "hal.h"
+#include "bcm2835.h"
+
+void HAL_init( void )
+{
+   bcm2835_init();
+}
+
+uint8_t HAL_gpioLevel( uint8_t pin )
+{
+   return bcm2835_gpio_lev(pin);
+}
+
+void HAL_gpioSetPullUp( uint8_t pin )
+{
+   bcm2835_gpio_set_pud(pin, BCM2835_GPIO_PUD_UP);
+}
+
+void HAL_i2cBegin( void )
+{
+   bcm2835_i2c_begin();
+   bcm2835_i2c_setClockDivider(BCM2835_I2C_CLOCK_DIVIDER_626);
+}
+
+uint8_t HAL_i2cWrite( uint8_t slaveAddress, const uint8_t *buf, uint8_t len )
+{
+   bcm2835_i2c_setSlaveAddress(slaveAddress);
+   return bcm2835_i2c_write((const char *)buf, len);
+}
+
+uint8_t HAL_i2cWriteRead( uint8_t slaveAddress, const uint8_t *cmd, uint8_t cmdLen, uint8_t *rsp, uint8_t rspLen )
+{
+   bcm2835_i2c_setSlaveAddress(slaveAddress);
+   return bcm2835_i2c_write_read_rs((char *)cmd, cmdLen, (char *)rsp, rspLen);
+}
+
+void HAL_spiBegin( void )
+{
+   bcm2835_spi_begin();
+
+   // Through experimentation, this is the fastest we can go...
+   bcm2835_spi_setClockDivider(BCM2835_SPI_CLOCK_DIVIDER_32);
+}
+
+void HAL_spiWrite( const uint8_t *buf, uint8_t len )
+{
+   bcm2835_spi_writenb((char *)buf, len);
+}
+
+uint64_t HAL_timeMicros( void )
+{
+   return bcm2835_st_read();
+}
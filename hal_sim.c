@@ -0,0 +1,712 @@
+// Hardware abstraction layer backend that simulates the board in memory.
+//
+// The simulation works at the bus level so the real drivers run unmodified:
+//
+//   I2C 0x20-0x23  MCP23017 expanders wired to the 64 reed switches (one row per port)
+//   I2C 0x24       MCP23017 on the U/I box.  Port A = display data, Port B = display control
+//                  lines (bits 7-5) and the five buttons (bits 4-0)
+//   SPI            MAX7219 LED driver (8 digit registers = 8 rows of the LED grid)
+//   Display        HD44780 20x4, clocked through the U/I expander on the falling edge of E
+//
+// Interrupt outputs of the expanders are computed from the register contents (compare against
+//   DEFVAL mode, which is the only mode the drivers use) and show up on the same GPIO pins as
+//   on the real board.
+//
+// The board is driven by a script, one command per line ('#' starts a comment):
+//
+//   setup                 place all 32 pieces on their starting squares, one at a time
+//   clear                 remove every piece
+//   lift <sq>             lift the piece on <sq> (e.g. lift e2)
+//   drop <sq>             set a piece down on <sq>
+//   move <from><to>       lift, (capture), drop and let the switches settle (e.g. move e2e4)
+//   press <btn>           hold a button down (up, down, left, right, center)
+//   release <btn>         let go of a button
+//   button <btn>          press and release a button
+//   wait <ms>             sleep
+//   waitfor <text>        wait (up to 60 seconds) until <text> appears on the display
+//   show                  print the display, LED grid and switch states
+//   quit                  exit the program
+//
+// The script is read from the file named by PICHESS_SIM_SCRIPT ("-" for stdin).  If
+//   PICHESS_SIM_SOCKET names a path, a UNIX domain socket is also opened there and each
+//   connection is read as a script, with the output of "show" sent back over the connection.
+
+#include "hal.h"
+#include "gpio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Time allowed for the switches to debounce after each step of a "move" command
+#define SIM_LIFT_SETTLE_MS    300
+#define SIM_DROP_SETTLE_MS   1000
+#define SIM_BUTTON_HOLD_MS    200
+
+// Pieces are set down one at a time by "setup", just as a person would
+#define SIM_SETUP_STEP_MS      60
+#define SIM_WAITFOR_LIMIT_MS 60000
+
+#define SIM_MAX_LINE_LEN 200
+
+// Characters on each display line
+#define LINE_LEN_SIM 20
+
+// MCP23017 register addresses not already found in gpio.h
+#define OLATA_ADDR 0x14
+#define OLATB_ADDR 0x15
+#define MCP_REG_COUNT 0x16
+
+#define NUM_EXPANDERS 5
+
+typedef struct mcp23017_s
+{
+   uint8_t address;              // I2C slave address
+   uint8_t reg[MCP_REG_COUNT];   // Register file (BANK = 0 layout)
+   uint8_t pins[2];              // Level presented on the input pins of port A and B
+   uint8_t pointer;              // Register address pointer (auto-increments)
+}mcp23017_t;
+
+// Ports of the expanders, in the same order as the rows in the reed switch matrix (row 8 first)
+static mcp23017_t expander[NUM_EXPANDERS] =
+{
+   { GPIO_EXPANDER_87_ADDR },
+   { GPIO_EXPANDER_65_ADDR },
+   { GPIO_EXPANDER_43_ADDR },
+   { GPIO_EXPANDER_21_ADDR },
+   { GPIO_EXPANDER_UI_ADDR },
+};
+
+#define UI_EXPANDER (&expander[NUM_EXPANDERS - 1])
+
+// GPIO pin wired to each expander port's interrupt output
+typedef struct intPin_s
+{
+   uint8_t pin;
+   uint8_t exp;
+   uint8_t port;
+}intPin_t;
+
+static const intPin_t intPins[] =
+{
+   { ROW_8_SWITCH_INT_PIN,  0, 0 },
+   { ROW_7_SWITCH_INT_PIN,  0, 1 },
+   { ROW_6_SWITCH_INT_PIN,  1, 0 },
+   { ROW_5_SWITCH_INT_PIN,  1, 1 },
+   { ROW_4_SWITCH_INT_PIN,  2, 0 },
+   { ROW_3_SWITCH_INT_PIN,  2, 1 },
+   { ROW_2_SWITCH_INT_PIN,  3, 0 },
+   { ROW_1_SWITCH_INT_PIN,  3, 1 },
+   { BUTTON_SWITCH_INT_PIN, 4, 1 },
+};
+
+// HD44780 state
+typedef struct lcd_s
+{
+   uint8_t ddram[0x80];
+   uint8_t cgram[0x40];
+   uint8_t addr;
+   bool    cgMode;
+   bool    on;
+   bool    cursor;
+   bool    blink;
+   uint8_t control;    // Last value of the E/RS/RW lines
+}lcd_t;
+
+static lcd_t lcd;
+
+// MAX7219 state
+static uint8_t ledRows[8];
+static uint8_t ledIntensity;
+static bool    ledShutdown = true;
+
+// Pieces on the physical board. Bit (8 * (8 - rank) + file), i.e. a8 = bit 0
+static uint64_t occupied = 0;
+
+// Buttons currently held down (B_xxx_MASK bits)
+static uint8_t buttonsHeld = 0;
+
+static pthread_mutex_t simMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t scriptThread;
+static pthread_t socketThread;
+
+static void     resetExpander( mcp23017_t *e );
+static mcp23017_t *findExpander( uint8_t address );
+static uint8_t  readRegister( mcp23017_t *e, uint8_t addr );
+static void     writeRegister( mcp23017_t *e, uint8_t addr, uint8_t val );
+static void     refreshPins( void );
+static void     lcdLatch( bool rs, uint8_t data );
+static void     lcdWriteControl( uint8_t control );
+static void     lcdGetLine( int line, char *str );
+static bool     lcdContains( const char *text );
+static void     setOccupied( int sq, bool state );
+static int      parseSquare( const char *str );
+static uint8_t  parseButton( const char *str );
+static void     setButtons( uint8_t held );
+static void     simSleep( uint32_t ms );
+static void     showState( FILE *out );
+static void     runScript( FILE *in, FILE *out );
+static void     *scriptTask( void *arg );
+static void     *socketTask( void *arg );
+
+void HAL_init( void )
+{
+   int i;
+   char *path;
+
+   pthread_mutex_lock(&simMutex);
+
+   for(i=0;i<NUM_EXPANDERS;i++) resetExpander(&expander[i]);
+
+   memset(lcd.ddram, ' ', sizeof(lcd.ddram));
+   refreshPins();
+
+   pthread_mutex_unlock(&simMutex);
+
+   if( (path = getenv("PICHESS_SIM_SCRIPT")) != NULL )
+      pthread_create(&scriptThread, NULL, scriptTask, path);
+
+   if( (path = getenv("PICHESS_SIM_SOCKET")) != NULL )
+      pthread_create(&socketThread, NULL, socketTask, path);
+}
+
+uint8_t HAL_gpioLevel( uint8_t pin )
+{
+   uint8_t level = 1;
+   int i;
+
+   pthread_mutex_lock(&simMutex);
+
+   for(i=0; i < sizeof(intPins) / sizeof(intPins[0]); i++)
+   {
+      if(intPins[i].pin == pin)
+      {
+         mcp23017_t *e = &expander[intPins[i].exp];
+         uint8_t p = intPins[i].port;
+         uint8_t value = readRegister(e, GPIOA_ADDR + p);
+
+         // Active low when an enabled pin differs from its DEFVAL
+         if( (value ^ e->reg[DEFVALA_ADDR + p]) & e->reg[GPINTENA_ADDR + p] & e->reg[INTCONA_ADDR + p] )
+            level = 0;
+
+         break;
+      }
+   }
+
+   pthread_mutex_unlock(&simMutex);
+
+   return level;
+}
+
+void HAL_gpioSetPullUp( uint8_t pin )
+{
+   // Nothing to model.  Every interrupt line in the simulation idles high.
+   (void)pin;
+}
+
+void HAL_i2cBegin( void )
+{
+}
+
+uint8_t HAL_i2cWrite( uint8_t slaveAddress, const uint8_t *buf, uint8_t len )
+{
+   mcp23017_t *e;
+   int i;
+
+   pthread_mutex_lock(&simMutex);
+
+   if( (e = findExpander(slaveAddress)) == NULL || len == 0)
+   {
+      pthread_mutex_unlock(&simMutex);
+      return 0x01; // NACK
+   }
+
+   // First byte sets the register pointer, the rest are written sequentially
+   e->pointer = buf[0] % MCP_REG_COUNT;
+
+   for(i=1;i<len;i++)
+   {
+      writeRegister(e, e->pointer, buf[i]);
+      e->pointer = (e->pointer + 1) % MCP_REG_COUNT;
+   }
+
+   pthread_mutex_unlock(&simMutex);
+
+   return HAL_I2C_OK;
+}
+
+uint8_t HAL_i2cWriteRead( uint8_t slaveAddress, const uint8_t *cmd, uint8_t cmdLen, uint8_t *rsp, uint8_t rspLen )
+{
+   mcp23017_t *e;
+   int i;
+
+   pthread_mutex_lock(&simMutex);
+
+   if( (e = findExpander(slaveAddress)) == NULL || cmdLen == 0)
+   {
+      pthread_mutex_unlock(&simMutex);
+      return 0x01; // NACK
+   }
+
+   e->pointer = cmd[0] % MCP_REG_COUNT;
+
+   for(i=0;i<rspLen;i++)
+   {
+      rsp[i] = readRegister(e, e->pointer);
+      e->pointer = (e->pointer + 1) % MCP_REG_COUNT;
+   }
+
+   pthread_mutex_unlock(&simMutex);
+
+   return HAL_I2C_OK;
+}
+
+void HAL_spiBegin( void )
+{
+}
+
+void HAL_spiWrite( const uint8_t *buf, uint8_t len )
+{
+   int i;
+
+   pthread_mutex_lock(&simMutex);
+
+   // MAX7219 takes 16 bit frames: register, then data
+   for(i=0; i + 1 < len; i += 2)
+   {
+      uint8_t reg  = buf[i] & 0x0F;
+      uint8_t data = buf[i+1];
+
+      if(reg >= 1 && reg <= 8)  ledRows[reg - 1] = data;
+      else if(reg == 0x0A)      ledIntensity = data & 0x0F;
+      else if(reg == 0x0C)      ledShutdown = ((data & 0x01) == 0);
+   }
+
+   pthread_mutex_unlock(&simMutex);
+}
+
+uint64_t HAL_timeMicros( void )
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//////////////////// LOCAL HELPER FUNCTIONS ////////////////////////
+
+static void resetExpander( mcp23017_t *e )
+{
+   memset(e->reg, 0x00, sizeof(e->reg));
+   e->reg[IODIRA_ADDR] = 0xFF;
+   e->reg[IODIRB_ADDR] = 0xFF;
+   e->pins[0] = e->pins[1] = 0xFF;
+   e->pointer = 0;
+}
+
+static mcp23017_t *findExpander( uint8_t address )
+{
+   int i;
+
+   for(i=0;i<NUM_EXPANDERS;i++)
+      if(expander[i].address == address) return &expander[i];
+
+   return NULL;
+}
+
+// Value seen when reading a register.  GPIO reads return the input pins for
+//   inputs and the output latch for outputs.
+static uint8_t readRegister( mcp23017_t *e, uint8_t addr )
+{
+   if(addr == GPIOA_ADDR || addr == GPIOB_ADDR)
+   {
+      uint8_t p = addr - GPIOA_ADDR;
+      uint8_t dir = e->reg[IODIRA_ADDR + p];
+      uint8_t pins = e->pins[p];
+
+      // Display drives the data lines during a read cycle (busy flag is never set)
+      if(e == UI_EXPANDER && p == 0 && (lcd.control & RW_MASK) && (lcd.control & E_MASK))
+         pins = lcd.addr & 0x7F;
+
+      return (pins & dir) | (e->reg[OLATA_ADDR + p] & ~dir);
+   }
+
+   return e->reg[addr];
+}
+
+static void writeRegister( mcp23017_t *e, uint8_t addr, uint8_t val )
+{
+   // Writing the port writes the output latch
+   if(addr == GPIOA_ADDR || addr == GPIOB_ADDR)
+      addr += OLATA_ADDR - GPIOA_ADDR;
+
+   e->reg[addr] = val;
+
+   if(e == UI_EXPANDER && addr == OLATB_ADDR)
+      lcdWriteControl(val & (E_MASK | RS_MASK | RW_MASK));
+}
+
+// Recompute the input pin levels from the physical board and buttons
+static void refreshPins( void )
+{
+   int row;
+
+   for(row=0;row<8;row++)
+   {
+      // Reed switch pulls the line to ground when a piece sits on it
+      expander[row / 2].pins[row % 2] = ~((occupied >> (row * 8)) & 0xFF);
+   }
+
+   UI_EXPANDER->pins[1] = (uint8_t)~buttonsHeld;
+}
+
+static void lcdWriteControl( uint8_t control )
+{
+   // Data and commands are latched on the falling edge of E
+   if( (lcd.control & E_MASK) && !(control & E_MASK) && !(control & RW_MASK) )
+      lcdLatch( (control & RS_MASK) != 0, UI_EXPANDER->reg[OLATA_ADDR] );
+
+   lcd.control = control;
+}
+
+static void lcdLatch( bool rs, uint8_t data )
+{
+   if(rs)
+   {
+      if(lcd.cgMode)
+      {
+         lcd.cgram[lcd.addr & 0x3F] = data;
+         lcd.addr = (lcd.addr + 1) & 0x3F;
+      }
+      else
+      {
+         lcd.ddram[lcd.addr & 0x7F] = data;
+         lcd.addr = (lcd.addr + 1) & 0x7F;
+      }
+   }
+   else if(data & 0x80)
+   {
+      lcd.addr = data & 0x7F;
+      lcd.cgMode = false;
+   }
+   else if(data & 0x40)
+   {
+      lcd.addr = data & 0x3F;
+      lcd.cgMode = true;
+   }
+   else if(data & 0x08 && !(data & 0x30))
+   {
+      lcd.on     = (data & 0x04) != 0;
+      lcd.cursor = (data & 0x02) != 0;
+      lcd.blink  = (data & 0x01) != 0;
+   }
+   else if(data == 0x01)
+   {
+      memset(lcd.ddram, ' ', sizeof(lcd.ddram));
+      lcd.addr = 0;
+      lcd.cgMode = false;
+   }
+   else if( (data & 0xFE) == 0x02 )
+   {
+      lcd.addr = 0;
+      lcd.cgMode = false;
+   }
+
+   // Entry mode, shift and function set commands don't change anything we model
+}
+
+static const uint8_t lcdRowOffset[4] = { 0x00, 0x40, 0x14, 0x54 };
+
+// Copy one display line, replacing user defined characters with '#'
+static void lcdGetLine( int line, char *str )
+{
+   int i;
+
+   for(i=0;i<LINE_LEN_SIM;i++)
+   {
+      uint8_t c = lcd.ddram[lcdRowOffset[line] + i];
+      str[i] = (c < 0x08) ? '#' : (isprint(c) ? c : '?');
+   }
+   str[LINE_LEN_SIM] = '\0';
+}
+
+static bool lcdContains( const char *text )
+{
+   char line[LINE_LEN_SIM + 1];
+   bool found = false;
+   int i;
+
+   pthread_mutex_lock(&simMutex);
+
+   for(i=0; i<4 && !found; i++)
+   {
+      lcdGetLine(i, line);
+      found = (strstr(line, text) != NULL);
+   }
+
+   pthread_mutex_unlock(&simMutex);
+
+   return found;
+}
+
+static void setOccupied( int sq, bool state )
+{
+   pthread_mutex_lock(&simMutex);
+
+   if(state) occupied |=  ((uint64_t)1 << sq);
+   else      occupied &= ~((uint64_t)1 << sq);
+
+   refreshPins();
+
+   pthread_mutex_unlock(&simMutex);
+}
+
+// "e2" -> 52.  Returns -1 on error
+static int parseSquare( const char *str )
+{
+   if(str == NULL) return -1;
+
+   if( str[0] < 'a' || str[0] > 'h' || str[1] < '1' || str[1] > '8')
+      return -1;
+
+   return 8 * ('8' - str[1]) + (str[0] - 'a');
+}
+
+static uint8_t parseButton( const char *str )
+{
+   if(str == NULL)                return 0;
+   if(!strcmp(str, "up"))         return B_UP_MASK;
+   if(!strcmp(str, "down"))       return B_DOWN_MASK;
+   if(!strcmp(str, "left"))       return B_LEFT_MASK;
+   if(!strcmp(str, "right"))      return B_RIGHT_MASK;
+   if(!strcmp(str, "center"))     return B_PRESS_MASK;
+   return 0;
+}
+
+static void setButtons( uint8_t held )
+{
+   pthread_mutex_lock(&simMutex);
+   buttonsHeld = held;
+   refreshPins();
+   pthread_mutex_unlock(&simMutex);
+}
+
+static void simSleep( uint32_t ms )
+{
+   usleep(ms * 1000);
+}
+
+static void showState( FILE *out )
+{
+   char line[LINE_LEN_SIM + 1];
+   int row, col;
+
+   pthread_mutex_lock(&simMutex);
+
+   fprintf(out, "+--------------------+\n");
+   for(row=0;row<4;row++)
+   {
+      lcdGetLine(row, line);
+      fprintf(out, "|%s|\n", line);
+   }
+   fprintf(out, "+--------------------+\n");
+
+   fprintf(out, "  LEDs%s      Pieces\n", ledShutdown ? "(off)" : "     ");
+   for(row=0;row<8;row++)
+   {
+      fprintf(out, "%d ", 8 - row);
+      for(col=0;col<8;col++)
+         fprintf(out, "%c", (ledRows[row] & (0x01 << col)) ? '*' : '.');
+
+      fprintf(out, "       ");
+      for(col=0;col<8;col++)
+         fprintf(out, "%c", (occupied & ((uint64_t)1 << (row * 8 + col))) ? 'P' : '.');
+
+      fprintf(out, "\n");
+   }
+   fprintf(out, "  abcdefgh       abcdefgh\n");
+
+   pthread_mutex_unlock(&simMutex);
+
+   fflush(out);
+}
+
+static void runScript( FILE *in, FILE *out )
+{
+   char lineContents[SIM_MAX_LINE_LEN];
+
+   while( fgets(lineContents, sizeof(lineContents), in) != NULL )
+   {
+      char *cmd, *arg;
+      int from, to;
+      uint8_t btn;
+
+      // Strip comments and line endings
+      lineContents[strcspn(lineContents, "#\r\n")] = '\0';
+
+      if( (cmd = strtok(lineContents, " \t")) == NULL ) continue;
+      arg = strtok(NULL, "\r\n");
+      while(arg != NULL && (*arg == ' ' || *arg == '\t')) arg++;
+
+      if(!strcmp(cmd, "setup"))
+      {
+         int sq;
+
+         for(sq=0;sq<64;sq++)
+         {
+            if(sq >= 16 && sq < 48) continue;
+
+            setOccupied(sq, true);
+            simSleep(SIM_SETUP_STEP_MS);
+         }
+      }
+      else if(!strcmp(cmd, "clear"))
+      {
+         pthread_mutex_lock(&simMutex);
+         occupied = 0;
+         refreshPins();
+         pthread_mutex_unlock(&simMutex);
+      }
+      else if(!strcmp(cmd, "lift") && (from = parseSquare(arg)) >= 0)
+      {
+         setOccupied(from, false);
+      }
+      else if(!strcmp(cmd, "drop") && (to = parseSquare(arg)) >= 0)
+      {
+         setOccupied(to, true);
+      }
+      else if(!strcmp(cmd, "move") && arg != NULL && (from = parseSquare(arg)) >= 0 &&
+              strlen(arg) >= 4 && (to = parseSquare(arg + 2)) >= 0)
+      {
+         // Captures: remove the captured piece first
+         if(occupied & ((uint64_t)1 << to))
+         {
+            setOccupied(to, false);
+            simSleep(SIM_LIFT_SETTLE_MS);
+         }
+         setOccupied(from, false);
+         simSleep(SIM_LIFT_SETTLE_MS);
+         setOccupied(to, true);
+         simSleep(SIM_DROP_SETTLE_MS);
+      }
+      else if(!strcmp(cmd, "press") && (btn = parseButton(arg)) != 0)
+      {
+         setButtons(buttonsHeld | btn);
+      }
+      else if(!strcmp(cmd, "release") && (btn = parseButton(arg)) != 0)
+      {
+         setButtons(buttonsHeld & ~btn);
+      }
+      else if(!strcmp(cmd, "button") && (btn = parseButton(arg)) != 0)
+      {
+         setButtons(buttonsHeld | btn);
+         simSleep(SIM_BUTTON_HOLD_MS);
+         setButtons(buttonsHeld & ~btn);
+         simSleep(SIM_BUTTON_HOLD_MS);
+      }
+      else if(!strcmp(cmd, "wait") && arg != NULL)
+      {
+         simSleep(strtoul(arg, NULL, 10));
+      }
+      else if(!strcmp(cmd, "waitfor") && arg != NULL)
+      {
+         uint32_t waited = 0;
+
+         while(!lcdContains(arg) && waited < SIM_WAITFOR_LIMIT_MS)
+         {
+            simSleep(10);
+            waited += 10;
+         }
+
+         if(waited >= SIM_WAITFOR_LIMIT_MS)
+            fprintf(out, "waitfor timed out: [%s]\n", arg);
+      }
+      else if(!strcmp(cmd, "show"))
+      {
+         showState(out);
+      }
+      else if(!strcmp(cmd, "quit"))
+      {
+         fflush(out);
+         exit(0);
+      }
+      else
+      {
+         fprintf(out, "Unrecognized sim command: %s %s\n", cmd, arg ? arg : "");
+      }
+
+      fflush(out);
+   }
+}
+
+static void *scriptTask( void *arg )
+{
+   char *path = (char *)arg;
+   FILE *in;
+
+   if(!strcmp(path, "-"))
+      in = stdin;
+   else if( (in = fopen(path, "r")) == NULL )
+   {
+      fprintf(stderr, "Could not open sim script %s\n", path);
+      return NULL;
+   }
+
+   runScript(in, stdout);
+
+   if(in != stdin) fclose(in);
+
+   return NULL;
+}
+
+static void *socketTask( void *arg )
+{
+   char *path = (char *)arg;
+   struct sockaddr_un addr;
+   int listenFd;
+
+   if( (listenFd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 )
+   {
+      perror("sim socket");
+      return NULL;
+   }
+
+   memset(&addr, 0x00, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+   unlink(path);
+
+   if( bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listenFd, 1) < 0)
+   {
+      perror("sim socket");
+      close(listenFd);
+      return NULL;
+   }
+
+   while(1)
+   {
+      int fd;
+      FILE *in, *out;
+
+      if( (fd = accept(listenFd, NULL, NULL)) < 0 ) continue;
+
+      in  = fdopen(fd, "r");
+      out = fdopen(dup(fd), "w");
+
+      if(in != NULL && out != NULL)
+         runScript(in, out);
+
+      if(in  != NULL) fclose(in);
+      if(out != NULL) fclose(out);
+   }
+
+   return NULL;
+}
@@ -9,76 +9,85 @@
 #include "hashtable.h"
 
 // VISUALIZATION OF THE HASH TABLE....
-//                                                           +-+-+-+-+-+--+
-//                                                       +-->|m y K e y \0|
-//                                                       |   +-+-+-+-+-+--+
-//                                                       |
-//                                                       |       +-+-+-+-+-+-+-+--+
-//    hashTable_t                                        |   +-->|m y V a l u e \0|
-// +---------------+                                     |   |   +-+-+-+-+-+-+-+--+
-// |     size      |      entry_t*[]           entry_t   |   |                       +-+-+-+-+--+
-// +---------------+      +-------+           +-------+  |   |        +-------+  +-->|k e y 2 \0|
-// |     table     |----->|       |---------->|  key  |--+   |    +-->|  key  |--+   +-+-+-+-+--+
-// +---------------+      +-------+           +-------+      |    |   +-------+   +-+-+-+-+--+
-//                        |       |--x        | value |------+    |   | value |-->|v a l 2 \0|
-//                        +-------+           +-------+           |   +-------+   +-+-+-+-+--+
-//                      / |       |--x        |  nxt  |-----------+   |  nxt  |--x
-//                     /  +-------+           +-------+               +-------+
-//                    /       .
-//                   /        .
-// size elements ___/         .
-//                        +-------+
-//                        |       |--x
-//                        +-------+
 //
+//    hashTable_t            htSlot_t[]              htEntry_t[]               pool
+// +---------------+        +-----+------+          +------------+          +-----------------+
+// |   slotCount   |        |  0  |      |    +---->| hash       |    +---->|k e y \0 v a l \0|
+// +---------------+        +-----+------+    |     | keyOffset  |----+     |k 2 \0 v 2 \0 ...|
+// |     slots     |------->|  2  | hash |----+     | valueOffset|          |                 |
+// +---------------+        +-----+------+          | ...        |          +-----------------+
+// |    entries    |---+    |  1  | hash |--+       +------------+
+// +---------------+   |    +-----+------+  +------>|    ...     |
+// |     pool      |   |    |  0  |      |          +------------+
+// +---------------+   |    +-----+------+
+//                     |
+//                     +--> entries in the order they were added
+//
+// A key is looked for starting at slot (hash & (slotCount - 1)) and moving up.  Robin Hood
+//   insertion keeps each run of slots sorted by distance from the entry's home slot, so a search
+//   can stop as soon as it reaches an entry closer to home than the key would be.  Deleting shifts
+//   the rest of the run back one slot rather than leaving a marker behind.
+//
+// Deleted entries and replaced values stay in the entry array and pool until the next time the
+//   table has to grow, when everything still in use is copied down.
+
+// Start sizes
+#define HT_MIN_SLOTS    8
+#define HT_MIN_ENTRIES  4
+#define HT_MIN_POOL     64
 
+// Largest fraction of slots in use before the slot array is doubled
+#define HT_LOAD_NUM     3
+#define HT_LOAD_DEN     4
+
+#define MAX_LINE_LEN 200
 
 // Helper Functions
 
-// returns a hash index for given key and table size
-static uint16_t ht_hash(uint16_t tableSize, char *key);
+// Hash a key
+static uint32_t ht_hash(const void *key, uint16_t keyLen);
 
-// Creates an entry and returns the pointer.  NULL return
-//   indicates a failure.
-static entry_t *ht_createEntry( char *key, char *value );
+// Find the slot holding key, -1 if it isn't there
+static int32_t ht_findSlot(hashtable_t *ht, const void *key, uint16_t keyLen, uint32_t hash);
 
-// Keys should have no spaces...
-static bool confirmValidKey( char *key );
+// Put entry number entry into the slot array
+static void ht_insertSlot(hashtable_t *ht, uint32_t entry, uint32_t hash);
 
-// Helper functions for optimization...
-static uint16_t ht_getIndex(hashtable_t *ht, char *key);
-static uint16_t ht_getDepth(hashtable_t *ht, uint16_t index);
+// Make sure there's room for one more entry and extra more bytes of pool
+static bool ht_makeRoom(hashtable_t *ht, uint32_t extra);
+
+// Copy the entries in use into new arrays of the given sizes
+static bool ht_rebuild(hashtable_t *ht, uint32_t slotCount, uint32_t entrySize, uint32_t poolSize);
+
+// Copy len bytes to the end of the pool, followed by a terminator.  Room must have been made.
+static uint32_t ht_poolAdd(hashtable_t *ht, const void *data, uint32_t len);
+
+// Keys should have no spaces...
+static int keyLength( char *key );
 
 // API FUNCTIONS...
 
-// Create a hash table of given size
-hashtable_t *ht_create(uint16_t size)
+// Create a hash table with room for size entries
+hashtable_t *ht_create(uint32_t size)
 {
    hashtable_t *hashtable;
-   uint16_t i;
-
-   // Sanity check the size...
-   if( size < 1 )
-      return NULL;
+   uint32_t slotCount = HT_MIN_SLOTS;
 
    // Create the memory for the handle
-   if( ( hashtable = malloc( sizeof( hashtable_t ) ) ) == NULL )
+   if( ( hashtable = calloc( 1, sizeof( hashtable_t ) ) ) == NULL )
       return NULL;
 
-   // Create the memory for the table it points to
-   if( ( hashtable->table = malloc( sizeof( entry_t* ) * size ) ) == NULL )
+   while( (uint64_t)slotCount * HT_LOAD_NUM < (uint64_t)size * HT_LOAD_DEN ) slotCount *= 2;
+
+   if( !ht_rebuild(hashtable, slotCount,
+                   size > HT_MIN_ENTRIES ? size : HT_MIN_ENTRIES,
+                   size * 16 > HT_MIN_POOL ? size * 16 : HT_MIN_POOL) )
    {
       // On error, release the hash table handle we already allocated
       free(hashtable);
       return NULL;
    }
 
-   // Set the size
-   hashtable->size = size;
-
-   // Set all linked-list pointers to NULL
-   for( i = 0; i < size; i++ ) hashtable->table[i] = NULL;
-
    // Return the pointer
    return hashtable;
 }
@@ -87,37 +96,12 @@ hashtable_t *ht_create(uint16_t size)
 // Destroy a hash table
 hashtableErr_t ht_destroy(hashtable_t *ht)
 {
-   uint16_t i;
-
    // Sanity check...
    if(ht == NULL) return HT_NULL_PTR;
 
-   // for each linked list
-   for(i=0; i < ht->size; i++)
-   {
-      // Point to top of list
-      entry_t *ptr = ht->table[i];
-
-      // While more items in list
-      while(ptr != NULL)
-      {
-         // Grab the next pointer before we do anything else...
-         entry_t *next = ptr->next;
-
-         // Free the space taken by the key and value strings
-         free(ptr->key);
-         free(ptr->value);
-
-         // Free the entry itself
-         free(ptr);
-
-         // move to the next one
-         ptr = next;
-      }
-   }
-
-   // Free the table
-   free(ht->table);
+   free(ht->slots);
+   free(ht->entries);
+   free(ht->pool);
 
    // Free the handle...
    free(ht);
@@ -125,244 +109,209 @@ hashtableErr_t ht_destroy(hashtable_t *ht)
    return HT_NO_ERROR;
 }
 
-// Delete a key/value pair from the hashtable
-hashtableErr_t ht_delKey(hashtable_t *hashtable, char *key)
+void ht_clear(hashtable_t *ht)
 {
-   uint16_t hash;
-
-   // Sanity check
-   if(hashtable == NULL) return HT_NULL_PTR;
-
-   if(!confirmValidKey(key)) return HT_INVALID_KEY;
-
-   // Hash the key
-   hash = ht_hash(hashtable->size, key);
+   if(ht == NULL) return;
 
-   // Point both this and previous to the first item in the list
-   entry_t *thisEntry = hashtable->table[hash];
-   entry_t *prevEntry = thisEntry;
+   memset(ht->slots, 0, ht->slotCount * sizeof(htSlot_t));
 
-   // Look for end of list or match...
-   while(thisEntry != NULL)
-   {
-      // Bail if we have a match
-      if(!strcmp(thisEntry->key, key)) break;
-
-      // Move to next
-      prevEntry = thisEntry;
-      thisEntry = thisEntry->next;
-   }
-
-   // If we found a match, thisEntry will be non-null
-   if(thisEntry != NULL)
-   {
-      // Was this the top of the list?
-      if(thisEntry == hashtable->table[hash])
-         // Yes...
-         hashtable->table[hash] = thisEntry->next;
-      else
-         // Point the "next" pointer of the previous entry to the
-         //   same place this entry was pointing, skipping this one.
-         prevEntry->next = thisEntry->next;
-
-      // Free the entry...
-      free(thisEntry->key);
-      free(thisEntry->value);
-      free(thisEntry);
-      return HT_NO_ERROR;
-   }
-   else
-      return HT_KEY_NOT_FOUND;
+   ht->entryCount = 0;
+   ht->liveCount  = 0;
+   ht->poolUsed   = 0;
+   ht->poolDead   = 0;
 }
 
 // Set a key/value pair to the hash table.  If key already exists, the
 //   value will be updated .
-hashtableErr_t ht_setKey( hashtable_t *hashtable, char *key, char *value)
+hashtableErr_t ht_set(hashtable_t *ht, const void *key, uint16_t keyLen, const void *value, uint32_t valueLen)
 {
+   uint32_t hash;
+   int32_t slot;
+   htEntry_t *e;
 
-   uint16_t hash;
    // Sanity check
-   if(hashtable == NULL)     return HT_MEM_ERROR;
-   if(!confirmValidKey(key)) return HT_INVALID_KEY;
+   if(ht == NULL || key == NULL || (value == NULL && valueLen > 0)) return HT_NULL_PTR;
+   if(keyLen == 0 || keyLen > HT_MAX_KEY_LEN)                       return HT_INVALID_KEY;
 
-   // Point both this and previous to the first item in the list
-   entry_t *thisEntry = hashtable->table[(hash = ht_hash(hashtable->size, key))];
-   entry_t *prevEntry = thisEntry;
-
-   // Look for end of list or match...
-   while(thisEntry != NULL)
-   {
-      if(!strcmp(thisEntry->key, key)) break;
-      prevEntry = thisEntry;
-      thisEntry = thisEntry->next;
-   }
+   hash = ht_hash(key, keyLen);
 
    // If we had a match, replace data...
-   if(thisEntry != NULL)
+   if( (slot = ht_findSlot(ht, key, keyLen, hash)) >= 0 )
    {
-      // Free existing value, replace with new value
-      free(thisEntry->value);
-      if((thisEntry->value = strdup(value)) == NULL)
-         return HT_MEM_ERROR;
-      else
+      e = &ht->entries[ht->slots[slot].entry - 1];
+
+      // Shorter or the same length...  just write over the old value
+      if(valueLen <= e->valueRoom)
+      {
+         memcpy(&ht->pool[e->valueOffset], value, valueLen);
+         ht->pool[e->valueOffset + valueLen] = 0x00;
+         e->valueLen = valueLen;
          return HT_DUP_KEY;
+      }
+
+      // Longer, so it goes at the end of the pool.  Making room may move the entries.
+      if(!ht_makeRoom(ht, valueLen + 1))
+         return HT_MEM_ERROR;
+
+      slot = ht_findSlot(ht, key, keyLen, hash);
+      e = &ht->entries[ht->slots[slot].entry - 1];
+
+      ht->poolDead  += e->valueRoom + 1;
+      e->valueOffset = ht_poolAdd(ht, value, valueLen);
+      e->valueLen    = valueLen;
+      e->valueRoom   = valueLen;
+
+      return HT_DUP_KEY;
    }
 
-   else
-   {
-      // No matches... add a new entry
+   // No matches... add a new entry
+   if(!ht_makeRoom(ht, keyLen + 1 + valueLen + 1))
+      return HT_MEM_ERROR;
 
-      entry_t *tmp;
+   e = &ht->entries[ht->entryCount];
 
-      if((tmp = ht_createEntry(key,value)) == NULL)
-         return HT_MEM_ERROR;
+   e->hash        = hash;
+   e->keyLen      = keyLen;
+   e->keyOffset   = ht_poolAdd(ht, key, keyLen);
+   e->valueOffset = ht_poolAdd(ht, value, valueLen);
+   e->valueLen    = valueLen;
+   e->valueRoom   = valueLen;
 
-      // If we started with a NULL list...
-      if(prevEntry == NULL)
-         // Set the pointer to this (only) entry
-         hashtable->table[hash] = tmp;
-      else
-         // Set the next item in the list to point here...
-         prevEntry->next = tmp;
+   ht_insertSlot(ht, ht->entryCount, hash);
 
-      return HT_NO_ERROR;
-   }
+   ht->entryCount++;
+   ht->liveCount++;
+
+   return HT_NO_ERROR;
 }
 
 // Get the value for a specific key
-char *ht_getKey( hashtable_t *hashtable, char *key )
+void *ht_get(hashtable_t *ht, const void *key, uint16_t keyLen, uint32_t *valueLen)
 {
-   entry_t *thisEntry;
+   int32_t slot;
+   htEntry_t *e;
 
    // Sanity checks
-   if(hashtable == NULL)     return NULL;
-   if(!confirmValidKey(key)) return NULL;
+   if(ht == NULL || key == NULL) return NULL;
 
-   // Start walking pointer at first item in linked list
-   thisEntry = hashtable->table[ht_hash(hashtable->size, key)];
+   if( (slot = ht_findSlot(ht, key, keyLen, ht_hash(key, keyLen))) < 0 )
+      return NULL;
 
-   // Search until found or end of list reached...
-   while( thisEntry != NULL && (strcmp(thisEntry->key, key) != 0) )
-      thisEntry = thisEntry->next;
+   e = &ht->entries[ht->slots[slot].entry - 1];
 
-   // If we hit the end of the list, just return
-   if(thisEntry == NULL) return NULL;
+   if(valueLen != NULL) *valueLen = e->valueLen;
 
-   // Else return the value.
-   else                  return thisEntry->value;
+   return &ht->pool[e->valueOffset];
 }
 
-// Return number of entries
-uint32_t ht_countEntries(hashtable_t *ht)
+// Delete a key/value pair from the hashtable
+hashtableErr_t ht_del(hashtable_t *ht, const void *key, uint16_t keyLen)
 {
-   uint32_t total = 0;
-   uint32_t i;
+   uint32_t mask, i, next;
+   int32_t slot;
+   htEntry_t *e;
 
-   if(ht == NULL) return 0;
+   // Sanity check
+   if(ht == NULL || key == NULL) return HT_NULL_PTR;
+
+   if( (slot = ht_findSlot(ht, key, keyLen, ht_hash(key, keyLen))) < 0 )
+      return HT_KEY_NOT_FOUND;
+
+   // The entry stays where it is (so an iteration in progress isn't upset), just marked deleted
+   e = &ht->entries[ht->slots[slot].entry - 1];
+
+   ht->poolDead += e->keyLen + 1 + e->valueRoom + 1;
+   e->keyLen = HT_DELETED;
+   ht->liveCount--;
 
-   for(i=0;i<ht->size;i++)
+   // Shift the rest of the run back a slot, up to an empty slot or one already in its home slot
+   mask = ht->slotCount - 1;
+   i = slot;
+
+   while(1)
    {
-      entry_t *walkingPointer = ht->table[i];
-      while(walkingPointer)
-      {
-         total++;
-         walkingPointer = walkingPointer->next;
-      }
+      next = (i + 1) & mask;
+
+      if( ht->slots[next].entry == 0 || (ht->slots[next].hash & mask) == next )
+         break;
+
+      ht->slots[i] = ht->slots[next];
+      i = next;
    }
-   return total;
+
+   ht->slots[i].entry = 0;
+
+   return HT_NO_ERROR;
 }
 
-#if 0
-// Optimize an existing hash table by finding a solution using <= maxSize bins AND
-//   <= maxDepth entries in every bin.  Return pointer to new solution.  Will return
-//   original if solution cannot be found
-hashtable_t *ht_optimize(hashtable_t *ht, uint32_t maxSize, uint8_t maxDepth)
+hashtableErr_t ht_setKey( hashtable_t *hashtable, char *key, char *value)
 {
+   int len;
 
-   hashtable_t *newTable;
-   uint32_t testSize;
-   bool solutionFound = false;
-   bool bail = false;
-
-   // Bail out on errors
-   if(ht == NULL) return NULL;
-   if(ht->size == 0) return NULL;
+   // Sanity check
+   if(hashtable == NULL || key == NULL || value == NULL) return HT_NULL_PTR;
+   if( (len = keyLength(key)) < 0 )                      return HT_INVALID_KEY;
 
-   // printf("Looking for solution with a maximum of %d bins all with maximum depth of %d\n", maxSize, maxDepth);
+   return ht_set(hashtable, key, len, value, strlen(value));
+}
 
-   testSize = ht_countEntries(ht) / maxDepth;
+char *ht_getKey( hashtable_t *hashtable, char *key )
+{
+   int len;
 
-   // Keep going until we find a size that doesn't require multiple entries in a "bin"
-   while(testSize <= maxSize)
-   {
-      int i;
+   // Sanity checks
+   if(hashtable == NULL || key == NULL) return NULL;
+   if( (len = keyLength(key)) < 0 )     return NULL;
 
-      // Create a new, temporary hash table...
-      newTable = ht_create(testSize);
+   // Values are always followed by a terminator in the pool
+   return ht_get(hashtable, key, len, NULL);
+}
 
-      bail = false;
+hashtableErr_t ht_delKey(hashtable_t *hashtable, char *key)
+{
+   int len;
 
-      // Walk through our existing table, copying each entry into the new hash table
-      for(i=0;i<ht->size;i++)
-      {
-         // If this index is not null
-         if(ht->table[i] != NULL)
-         {
-            // walk through all the entries...
-            entry_t *walkingPointer = ht->table[i];
-            while(walkingPointer && !bail)
-            {
-               // Add the key to the new table.
-               ht_setKey(newTable, walkingPointer->key, walkingPointer->value);
-
-               // Find the depth at this new insertion point
-               if(ht_getDepth(newTable, ht_getIndex(newTable, walkingPointer->key)) > maxDepth)
-               {
-                  bail = true;
-                  break; // break out of while loop
-               }
-               walkingPointer = walkingPointer->next;
-            }
-
-            if(bail == true)
-               break; // break out of for loop
-         }
-      }
+   // Sanity check
+   if(hashtable == NULL || key == NULL) return HT_NULL_PTR;
+   if( (len = keyLength(key)) < 0 )     return HT_INVALID_KEY;
 
-      if(bail == true)
-      {
-         // this isn't the best solution yet
-         ht_destroy(newTable);
-      }
-      else
-      {
-         // Good to go..
-         solutionFound = true;
-         ht_destroy(ht);
-         break; // break out of while loop
-      }
+   return ht_del(hashtable, key, len);
+}
 
-      testSize++;
-   }
+int ht_next(hashtable_t *ht, uint32_t *pos, void **key, uint16_t *keyLen, void **value, uint32_t *valueLen)
+{
+   if(ht == NULL || pos == NULL) return 0;
 
-   if(solutionFound == true)
-   {
-//      printf("Optimized table has capacity of %d with max depth of %d\n", newTable->size, maxDepth);
-      return newTable;
-   }
-   else
+   while(*pos < ht->entryCount)
    {
-//      printf("Optimal solution not found\n");
-      return ht;
+      htEntry_t *e = &ht->entries[(*pos)++];
+
+      if(e->keyLen == HT_DELETED) continue;
+
+      if(key      != NULL) *key      = &ht->pool[e->keyOffset];
+      if(keyLen   != NULL) *keyLen   = e->keyLen;
+      if(value    != NULL) *value    = &ht->pool[e->valueOffset];
+      if(valueLen != NULL) *valueLen = e->valueLen;
+
+      return 1;
    }
+
+   return 0;
 }
 
-#endif
+// Return number of entries
+uint32_t ht_countEntries(hashtable_t *ht)
+{
+   if(ht == NULL) return 0;
+
+   return ht->liveCount;
+}
 
 hashtableErr_t ht_save(hashtable_t *ht, char *htName)
 {
    FILE *output;
-   int i;
+   uint32_t pos = 0;
+   void *key, *value;
 
    if( ht == NULL)
       return HT_NULL_PTR;
@@ -370,24 +319,15 @@ hashtableErr_t ht_save(hashtable_t *ht, char *htName)
    if( (output = fopen(htName, "w")) == NULL)
       return HT_FILE_ERROR;
 
-   // Walk through our existing, copying each entry into the new hash table
-   for(i=0;i<(ht->size);i++)
-   {
-      // walk through all the entries...
-      entry_t *walkingPointer = ht->table[i];
-      while(walkingPointer)
-      {
-         fprintf(output,"%s %s\n", walkingPointer->key, walkingPointer->value);
-         walkingPointer = walkingPointer->next;
-      }
-   }
+   // Keys and values are terminated in the pool, so they can be written as strings
+   while( ht_next(ht, &pos, &key, NULL, &value, NULL) )
+      fprintf(output,"%s %s\n", (char *)key, (char *)value);
 
    fclose(output);
    return HT_NO_ERROR;
 
 }
 
-#define MAX_LINE_LEN 200
 hashtableErr_t ht_load(hashtable_t *ht, char *htName)
 {
 
@@ -411,7 +351,7 @@ hashtableErr_t ht_load(hashtable_t *ht, char *htName)
       char* value;
 
       // grab next line from input file
-      if( fgets(lineContents, MAX_LINE_LEN + 1, input) == NULL ) break;
+      if( fgets(lineContents, MAX_LINE_LEN, input) == NULL ) break;
 
       // Parse the two tokens on the line.  Should be a key followed by a value
       key = strtok(lineContents, " ");
@@ -435,67 +375,203 @@ hashtableErr_t ht_load(hashtable_t *ht, char *htName)
 
 //////////////////// LOCAL HELPER FUNCTIONS ////////////////////////
 
-static bool confirmValidKey( char *key )
+// Returns the key's length, or -1 if it has a space in it
+static int keyLength( char *key )
 {
-   while(*key != ' ' && *key != '\0') key++;
+   size_t len = strcspn(key, " ");
 
-   return(*key == '\0');
+   return (key[len] == '\0' && len <= HT_MAX_KEY_LEN) ? (int)len : -1;
 }
 
-// Given a table size and a character string, find a hash value
-static uint16_t ht_hash(uint16_t tableSize, char *key)
+// Multiply/xor-shift mix taken 8 bytes at a time, folded to 32 bits.  The low bits (which pick the
+//   home slot) depend on every byte of the key.
+static uint32_t ht_hash(const void *key, uint16_t keyLen)
 {
-   uint32_t hash = 5381;
-   uint8_t c;
+   const uint8_t *p = key;
+   uint64_t hash = 0x9E3779B97F4A7C15ull ^ keyLen;
+   uint64_t word;
 
-   while ( (c = *key++) )
-       hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+   while(keyLen >= 8)
+   {
+      memcpy(&word, p, 8);
+      hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+      hash ^= hash >> 31;
+      p += 8;
+      keyLen -= 8;
+   }
+
+   if(keyLen > 0)
+   {
+      word = 0;
+      memcpy(&word, p, keyLen);
+      hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+      hash ^= hash >> 31;
+   }
 
-   return hash % tableSize;
+   hash *= 0x94D049BB133111EBull;
+
+   return (uint32_t)(hash >> 32);
 }
 
-// Allocate space for an entry and return it...
-static entry_t *ht_createEntry( char *key, char *value )
+static int32_t ht_findSlot(hashtable_t *ht, const void *key, uint16_t keyLen, uint32_t hash)
 {
-   entry_t *newEntry;
-
-   if( ( newEntry = malloc( sizeof( entry_t ) ) ) == NULL )
-      return NULL;
+   uint32_t mask = ht->slotCount - 1;
+   uint32_t i    = hash & mask;
+   uint32_t dist = 0;
 
-   if( ( newEntry->key = strdup( key ) ) == NULL )
+   while(1)
    {
-      free(newEntry);
-      return NULL;
+      htSlot_t *s = &ht->slots[i];
+
+      // An empty slot, or an entry nearer its home than we'd be, means the key isn't here
+      if( s->entry == 0 || ((i - (s->hash & mask)) & mask) < dist )
+         return -1;
+
+      if( s->hash == hash )
+      {
+         htEntry_t *e = &ht->entries[s->entry - 1];
+
+         if( e->keyLen == keyLen && !memcmp(&ht->pool[e->keyOffset], key, keyLen) )
+            return i;
+      }
+
+      i = (i + 1) & mask;
+      dist++;
    }
+}
+
+static void ht_insertSlot(hashtable_t *ht, uint32_t entry, uint32_t hash)
+{
+   uint32_t mask = ht->slotCount - 1;
+   uint32_t i    = hash & mask;
+   uint32_t dist = 0;
+   htSlot_t carry = { entry + 1, hash };
 
-   if( ( newEntry->value = strdup( value ) ) == NULL )
+   while(1)
    {
-      free(newEntry->key);
-      free(newEntry);
-      return NULL;
-   }
+      htSlot_t *s = &ht->slots[i];
+      uint32_t theirDist;
 
-   newEntry->next = NULL;
+      if(s->entry == 0)
+      {
+         *s = carry;
+         return;
+      }
+
+      // Take the slot from an entry that is closer to home, and find that one a place instead
+      if( (theirDist = (i - (s->hash & mask)) & mask) < dist )
+      {
+         htSlot_t tmp = *s;
+
+         *s    = carry;
+         carry = tmp;
+         dist  = theirDist;
+      }
 
-   return newEntry;
+      i = (i + 1) & mask;
+      dist++;
+   }
 }
 
-#if 0
-static uint16_t ht_getIndex(hashtable_t *ht, char *key)
+static bool ht_makeRoom(hashtable_t *ht, uint32_t extra)
 {
-   return ht_hash(ht->size, key);
+   uint32_t slotCount = ht->slotCount;
+   uint32_t entrySize = ht->entrySize;
+   uint32_t poolSize  = ht->poolSize;
+   uint32_t poolLive  = ht->poolUsed - ht->poolDead;
+
+   if( (uint64_t)(ht->liveCount + 1) * HT_LOAD_DEN <= (uint64_t)slotCount * HT_LOAD_NUM &&
+       ht->entryCount < entrySize &&
+       (uint64_t)ht->poolUsed + extra <= poolSize )
+      return true;
+
+   // Something has run out.  Grow whatever is too small (allowing for what the rebuild will
+   //   recover) and copy down.
+   while( (uint64_t)(ht->liveCount + 1) * HT_LOAD_DEN > (uint64_t)slotCount * HT_LOAD_NUM )
+      slotCount *= 2;
+
+   while( entrySize < ht->liveCount + 1 + ht->liveCount / 2 )
+      entrySize *= 2;
+
+   while( (uint64_t)poolSize < (uint64_t)poolLive + extra + poolLive / 2 )
+   {
+      if(poolSize > UINT32_MAX / 2) return false;
+      poolSize *= 2;
+   }
+
+   return ht_rebuild(ht, slotCount, entrySize, poolSize);
 }
 
-static uint16_t ht_getDepth(hashtable_t *ht, uint16_t index)
+static bool ht_rebuild(hashtable_t *ht, uint32_t slotCount, uint32_t entrySize, uint32_t poolSize)
 {
-   uint16_t depth = 0;
-   entry_t *walkingPointer = ht->table[index];
+   htSlot_t  *slots;
+   htEntry_t *entries;
+   uint8_t   *pool;
+   uint32_t i, n = 0, used = 0;
+
+   slots   = calloc(slotCount, sizeof(htSlot_t));
+   entries = malloc(entrySize * sizeof(htEntry_t));
+   pool    = malloc(poolSize);
 
-   while(walkingPointer)
+   if(slots == NULL || entries == NULL || pool == NULL)
    {
-      depth++;
-      walkingPointer = walkingPointer->next;
+      free(slots);
+      free(entries);
+      free(pool);
+      return false;
+   }
+
+   // Copy the live entries down, keeping their order
+   for(i=0;i<ht->entryCount;i++)
+   {
+      htEntry_t *old = &ht->entries[i];
+      htEntry_t *e   = &entries[n];
+
+      if(old->keyLen == HT_DELETED) continue;
+
+      *e = *old;
+
+      e->keyOffset = used;
+      memcpy(&pool[used], &ht->pool[old->keyOffset], old->keyLen + 1);
+      used += old->keyLen + 1;
+
+      e->valueOffset = used;
+      e->valueRoom   = old->valueLen;
+      memcpy(&pool[used], &ht->pool[old->valueOffset], old->valueLen + 1);
+      used += old->valueLen + 1;
+
+      n++;
    }
-   return depth;
+
+   free(ht->slots);
+   free(ht->entries);
+   free(ht->pool);
+
+   ht->slots      = slots;
+   ht->slotCount  = slotCount;
+   ht->entries    = entries;
+   ht->entrySize  = entrySize;
+   ht->entryCount = n;
+   ht->liveCount  = n;
+   ht->pool       = pool;
+   ht->poolSize   = poolSize;
+   ht->poolUsed   = used;
+   ht->poolDead   = 0;
+
+   for(i=0;i<n;i++)
+      ht_insertSlot(ht, i, entries[i].hash);
+
+   return true;
+}
+
+static uint32_t ht_poolAdd(hashtable_t *ht, const void *data, uint32_t len)
+{
+   uint32_t offset = ht->poolUsed;
+
+   if(len > 0) memcpy(&ht->pool[offset], data, len);
+   ht->pool[offset + len] = 0x00;
+
+   ht->poolUsed += len + 1;
+
+   return offset;
 }
-#endif
@@ -3,24 +3,59 @@
 #ifndef HASH_TABLE_H
 #define HASH_TABLE_H
 
-// An entry in the table is a key/value pair.  The key must be unique
-struct entry_s
+// General purpose hash table
+//
+// Open addressing with Robin Hood probing over a power of two slot array.  Entries live in one
+//   array in the order they were added and their keys and values are copied into one string
+//   pool, so adding an entry costs no allocation of its own and iterating visits the entries in
+//   insertion order.  The table grows itself (slots, entries and pool) as needed.
+//
+// Keys and values are byte strings;  the ht_setKey()/ht_getKey() calls are the same thing for
+//   ordinary C strings (keys may not contain spaces so the table can be saved as text).
+//
+// A pointer returned by ht_get(), ht_getKey() or ht_next() is only good until the table is next
+//   changed.
+
+// Where an entry's key and value are in the pool
+typedef struct htEntry_s
 {
-   char *key;
-   char *value;
-   struct entry_s *next;  // Pointer to next entry in this list
-};
+   uint32_t hash;
+   uint32_t keyOffset;
+   uint32_t valueOffset;
+   uint16_t keyLen;        // HT_DELETED once the entry is removed
+   uint32_t valueLen;
+   uint32_t valueRoom;     // bytes available at valueOffset for an update in place
+}htEntry_t;
 
-typedef struct entry_s entry_t;
+// One probe slot:  entry number + 1 (0 for an empty slot) and the low bits of its hash
+typedef struct htSlot_s
+{
+   uint32_t entry;
+   uint32_t hash;
+}htSlot_t;
 
-// The handle for the hash table.  Consists only of a size indicator
-//   and a pointer to an array of pointers to linked lists (i.e. entry_t)
+// The handle for the hash table
 typedef struct hashtable_s
 {
-   uint16_t size;
-   entry_t **table;
+   uint32_t   slotCount;      // always a power of two
+   htSlot_t  *slots;
+
+   htEntry_t *entries;
+   uint32_t   entryCount;     // used, including deleted ones
+   uint32_t   entrySize;      // allocated
+   uint32_t   liveCount;
+
+   uint8_t   *pool;
+   uint32_t   poolUsed;
+   uint32_t   poolSize;
+   uint32_t   poolDead;       // bytes no longer referenced, recovered when the table is rebuilt
 }hashtable_t;
 
+#define HT_DELETED 0xFFFF
+
+// Longest key accepted
+#define HT_MAX_KEY_LEN 1024
+
 // Return types
 typedef enum hashtableErr_e
 {
@@ -35,29 +70,38 @@ typedef enum hashtableErr_e
 
 // API
 
-// Create a new, empty hash table
-hashtable_t*   ht_create(uint16_t size);
+// Create a new, empty hash table with room for about size entries before it has to grow
+hashtable_t*   ht_create(uint32_t size);
 
 // Delete hashtable and free its memory
 hashtableErr_t ht_destroy(hashtable_t *ht);
 
+// Remove every entry, keeping the memory for reuse
+void           ht_clear(hashtable_t *ht);
+
+// Set a key/value pair.  If key already exists, updates the value and returns HT_DUP_KEY
+hashtableErr_t ht_set(hashtable_t *ht, const void *key, uint16_t keyLen, const void *value, uint32_t valueLen);
+
+// Returns the value for a key (and its length in *valueLen if not NULL).  NULL if not found.
+void*          ht_get(hashtable_t *ht, const void *key, uint16_t keyLen, uint32_t *valueLen);
+
 // Delete a key from the table
-hashtableErr_t ht_delKey(hashtable_t *ht, char *key);
+hashtableErr_t ht_del(hashtable_t *ht, const void *key, uint16_t keyLen);
 
-// Set a key/value pair.  If key already exists, updates the value
+// The same for C string keys and values
 hashtableErr_t ht_setKey(hashtable_t *ht, char *key, char *value);
-
-// Returns the value associated with a key.  NULL indicates the key wasn't found
 char*          ht_getKey(hashtable_t *ht, char *key );
+hashtableErr_t ht_delKey(hashtable_t *ht, char *key);
+
+// Step through the entries in the order they were added.  Start with *pos = 0;  returns FALSE
+//   (0) after the last one.
+int            ht_next(hashtable_t *ht, uint32_t *pos, void **key, uint16_t *keyLen, void **value, uint32_t *valueLen);
 
-// read/write hashtable to memory
+// read/write a table of C strings as "key value" lines
 hashtableErr_t ht_save(hashtable_t *ht, char *htName);
 hashtableErr_t ht_load(hashtable_t *ht, char *htName);
 
 // Return number of entries in table
 uint32_t       ht_countEntries(hashtable_t *ht);
 
-// Resize hashtable for optimal performance
-hashtable_t *ht_optimize(hashtable_t *ht, uint32_t maxSize, uint8_t maxDepth);
-
 #endif
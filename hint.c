@@ -0,0 +1,224 @@
+#include "hint.h"
+
+#include "hsmDefs.h"
+#include "idle.h"
+#include "constants.h"
+#include "diag.h"
+#include "display.h"
+#include "led.h"
+#include "moves.h"
+#include "options.h"
+#include "sfInterface.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+extern game_t game;
+
+typedef struct hintLine_s
+{
+   bool_t   valid;
+   move_t   move;
+   int32_t  score;       // centipawns, or moves to mate if mate is TRUE (side to move's view)
+   bool_t   mate;
+   uint8_t  depth;
+}hintLine_t;
+
+static bool_t     hintsOn = FALSE;
+static bool_t     running = FALSE;
+
+static hintLine_t lines[HINT_LINES];
+static int        shownLine;
+static int        pollCount;
+
+// Records from searches up to staleSearch are left over from before this one started
+static uint32_t   staleSearch;
+static uint32_t   currentSearch;
+
+static move_t     legalMoves[MAX_LIST_SIZE];
+static int        legalCount;
+
+static ShmRecord  recs[SHM_RING_SIZE];
+
+static bool_t isLegal( move_t m );
+static void   showHint( void );
+
+bool_t HINT_available( void )
+{
+   // Whether the engine was started for this game (as st_inGame.c decides).  Whether it has
+   //   attached to the channel yet is left to HINT_start(), so the menus don't depend on it.
+   return (getOption(OPT_WHITE_PLAYER) == PLAYER_COMPUTER || getOption(OPT_BLACK_PLAYER) == PLAYER_COMPUTER);
+}
+
+bool_t HINT_enabled( void )
+{
+   return hintsOn;
+}
+
+void HINT_setEnabled( bool_t on )
+{
+   hintsOn = on;
+
+   if(!on)
+      HINT_cancel();
+}
+
+void HINT_start( void )
+{
+   int n, i;
+
+   if(!hintsOn || running)
+      return;
+
+   if(!SF_channelAttached())
+   {
+      DPRINT("Engine not attached to its channel, no hints\n");
+      return;
+   }
+
+   // Skip past what's already been written, noting the newest search it came from
+   staleSearch = 0;
+
+   while( (n = SF_readUpdates(recs, SHM_RING_SIZE)) > 0)
+      for(i=0;i<n;i++)
+         if(recs[i].searchId > staleSearch)
+            staleSearch = recs[i].searchId;
+
+   currentSearch = staleSearch;
+   memset(lines, 0, sizeof(lines));
+   shownLine = 0;
+   pollCount = 0;
+
+   // The engine's moves are checked against these, so nothing from another position is shown
+   legalCount = findMoves(&game.brd, legalMoves);
+
+   if(legalCount <= 0)
+      return;
+
+   SF_setGame(&game);
+   SF_findHints(HINT_LINES);
+
+   running = TRUE;
+   timerStart(TMR_HINT_POLL, HINT_POLL_MS, HINT_POLL_MS, EV_HINT_POLL);
+
+   displayWriteLine(2, "Hint: thinking...", TRUE);
+}
+
+void HINT_cancel( void )
+{
+   if(!running)
+      return;
+
+   SF_stop();
+   timerKill(TMR_HINT_POLL);
+   running = FALSE;
+
+   displayClearLine(2);
+   LED_FlashGridState(0);
+}
+
+void HINT_poll( event_t ev )
+{
+   bool_t changed = FALSE;
+   int n, i;
+
+   if(!running)
+      return;
+
+   while( (n = SF_readUpdates(recs, SHM_RING_SIZE)) > 0)
+   {
+      for(i=0;i<n;i++)
+      {
+         ShmRecord *r = &recs[i];
+         hintLine_t *l;
+         move_t m;
+
+         if(r->type != SHM_REC_PV || r->searchId <= staleSearch || r->pvLength == 0 ||
+            r->multiPV < 1 || r->multiPV > HINT_LINES)
+            continue;
+
+         // A newer search (the engine never restarts one by itself, but be safe) starts afresh
+         if(r->searchId != currentSearch)
+         {
+            currentSearch = r->searchId;
+            memset(lines, 0, sizeof(lines));
+         }
+
+         m = SF_unpackMove(r->pv[0]);
+
+         if(!isLegal(m))
+            continue;
+
+         l = &lines[r->multiPV - 1];
+
+         // Only redraw the hint being shown if it has actually changed
+         if(r->multiPV - 1 == shownLine &&
+            (!l->valid || l->move.from != m.from || l->move.to != m.to || l->score != r->score || l->depth != r->depth))
+            changed = TRUE;
+
+         l->valid = TRUE;
+         l->move  = m;
+         l->score = r->score;
+         l->mate  = (r->scoreType == SHM_SCORE_MATE);
+         l->depth = r->depth;
+
+         // The best line is the position's score for the accuracy summary
+         if(r->multiPV == 1 && r->bound == SHM_BOUND_EXACT)
+         {
+            searchSummary_t s = { m, m, FALSE, r->depth, r->score, l->mate, r->nodes };
+
+            IDLE_noteSearch(&game, &s);
+         }
+      }
+   }
+
+   // Move on to the next candidate every so often
+   if(++pollCount >= HINT_ROTATE_POLLS)
+   {
+      pollCount = 0;
+
+      do
+      {
+         shownLine = (shownLine + 1) % HINT_LINES;
+      }while(!lines[shownLine].valid && shownLine != 0);
+
+      changed = TRUE;
+   }
+
+   if(changed)
+      showHint();
+}
+
+static bool_t isLegal( move_t m )
+{
+   int i;
+
+   for(i=0;i<legalCount;i++)
+   {
+      if(legalMoves[i].from == m.from && legalMoves[i].to == m.to && legalMoves[i].promote == m.promote)
+         return TRUE;
+   }
+
+   return FALSE;
+}
+
+static void showHint( void )
+{
+   hintLine_t *l = &lines[shownLine];
+   char text[30], score[10];
+
+   if(!l->valid)
+      return;
+
+   if(l->mate)
+      sprintf(score, "M%d", (int)l->score);
+   else
+      sprintf(score, "%+.2f", l->score / 100.0);
+
+   snprintf(text, sizeof(text), "%d.%s %s d%d", shownLine + 1, moveToSAN(l->move, &game.brd), score, l->depth);
+   text[20] = '\0';
+
+   displayWriteLine(2, text, TRUE);
+   LED_FlashGridState(squareMask[l->move.from] | squareMask[l->move.to]);
+}
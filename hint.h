@@ -0,0 +1,38 @@
+#ifndef HINT_H
+#define HINT_H
+
+// Hints (in-game analysis mode)
+//
+// While hints are on, the engine analyses the position in the background whenever it is the
+//   human's move:  an open-ended MultiPV search for the best HINT_LINES moves.  HINT_poll(), run
+//   from a timer, keeps the lines current as the engine reports them through the shared memory
+//   channel and shows them one at a time, best first:  the move's squares flash on the board and
+//   its SAN, score and depth are shown on display line 2.
+//
+// Nothing here blocks the state machine.  Any piece lifted or dropped cancels the search straight
+//   away (HINT_cancel());  it starts again if the board goes back to the position.
+
+#include "types.h"
+#include "hsm.h"
+
+#define HINT_LINES        3     // candidate moves searched for and shown
+#define HINT_POLL_MS      250   // how often the engine's updates are read
+#define HINT_ROTATE_POLLS 8     // polls before the next candidate is shown (2 seconds)
+
+// Hints can be turned on in this game (the engine is running).  They are only shown once the
+//   engine has attached to the shared memory channel.
+bool_t HINT_available( void );
+
+bool_t HINT_enabled( void );
+void   HINT_setEnabled( bool_t on );
+
+// Start analysing the current position (if hints are on and not already running)
+void   HINT_start( void );
+
+// Stop the analysis and take the hint off the board and display
+void   HINT_cancel( void );
+
+// Timer action:  read the engine's updates and show the current hint
+void   HINT_poll( event_t ev );
+
+#endif
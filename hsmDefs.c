@@ -26,6 +26,8 @@
 #include "st_timeOptionMenu.h"
 #include "st_fixBoard.h"
 #include "st_checkBoard.h"
+#include "hint.h"
+#include "tb.h"
 #include "util.h"
 #include "display.h"
 
@@ -174,7 +176,7 @@ transDef_t myTransDef[] =
    { EV_GOTO_GAME,              ST_TOP,               NULL_GUARD_FUNC,               NULL_ACTION_FUNC,                 ST_IN_GAME,            FALSE },
    { EV_GOTO_PLAYING_GAME,      ST_IN_GAME,           NULL_GUARD_FUNC,               NULL_ACTION_FUNC,                 ST_PLAYING_GAME,       TRUE  },
    { EV_GOTO_GAMEMENU,          ST_IN_GAME,           NULL_GUARD_FUNC,               NULL_ACTION_FUNC,                 ST_GAMEMENU,           FALSE },
-   { EV_GAME_DONE,              ST_IN_GAME,           NULL_GUARD_FUNC,               NULL_ACTION_FUNC,                 ST_EXITING_GAME,       FALSE },
+   { EV_GAME_DONE,              ST_IN_GAME,           NULL_GUARD_FUNC,               inGame_gameDone,                  ST_EXITING_GAME,       FALSE },
    { EV_MOVE_CLOCK_TIC,         ST_IN_GAME,           NULL_GUARD_FUNC,               inGame_moveClockTick,             ST_NONE,               FALSE },
    { EV_UI_BOX_CHECK,           ST_TOP,               NULL_GUARD_FUNC,               checkDisplay,                     ST_NONE,               FALSE },
    { EV_PROCESS_COMPUTER_MOVE,  ST_IN_GAME,           NULL_GUARD_FUNC,               computerMove_computerPicked,      ST_NONE,               FALSE },
@@ -183,6 +185,10 @@ transDef_t myTransDef[] =
    { EV_FIX_BOARD,              ST_IN_GAME,           NULL_GUARD_FUNC,               NULL_ACTION_FUNC,                 ST_FIX_BOARD,          TRUE  },
 
    { EV_TAKEBACK,               ST_GAMEMENU,          NULL_GUARD_FUNC,               gameMenu_goBack2,                 ST_FIX_BOARD,          FALSE  },
+
+   { EV_TOGGLE_HINTS,           ST_GAMEMENU,          NULL_GUARD_FUNC,               gameMenu_toggleHints,             ST_PLAYING_GAME,       FALSE  },
+   { EV_HINT_POLL,              ST_IN_GAME,           NULL_GUARD_FUNC,               HINT_poll,                        ST_NONE,               FALSE  },
+   { EV_TB_RESULT,              ST_PLAYING_GAME,      NULL_GUARD_FUNC,               TB_result,                        ST_NONE,               FALSE  },
 };
 
 const uint16_t transDefCount = (sizeof(myTransDef)/sizeof(myTransDef[0]));
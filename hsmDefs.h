@@ -86,7 +86,12 @@ typedef enum eventId_e
 
    EV_FIX_BOARD,
 
-   EV_TAKEBACK
+   EV_TAKEBACK,
+
+   EV_TOGGLE_HINTS,  // User selected "show/hide hints" from in-game menu
+   EV_HINT_POLL,     // Time to read the engine's hint updates
+
+   EV_TB_RESULT      // The position has been looked up in the tablebases (data:  see tb.c)
 
 }eventId_t;
 
@@ -0,0 +1,371 @@
+// Hash table micro-benchmark (htBench)
+//
+// Times the hash table in hashTable.c against the chained table it replaced (kept below, as it
+//   was, for comparison) on string keys:
+//
+//    htBench [count ...]
+//
+// For each table size (default 32, 1000, 100000 entries) it reports the time per operation for
+//   inserting every key, looking each one up, looking up keys that aren't there, updating every
+//   value, iterating and deleting every key, along with the heap used once all keys are in.
+//   Both tables are created with room for every key;  the chained table gets one bucket per key
+//   (up to its 65535 limit), its best case.
+
+#include "hashtable.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <malloc.h>
+
+#define REPEAT_OPS 2000000    // each test is repeated until it has done at least this many ops
+
+/////////////////////// Previous chained implementation /////////////////////
+
+typedef struct chainEntry_s
+{
+   char *key;
+   char *value;
+   struct chainEntry_s *next;
+}chainEntry_t;
+
+typedef struct chainTable_s
+{
+   uint16_t size;
+   chainEntry_t **table;
+}chainTable_t;
+
+static uint16_t chain_hash(uint16_t tableSize, char *key)
+{
+   uint32_t hash = 5381;
+   uint8_t c;
+
+   while ( (c = *key++) )
+       hash = ((hash << 5) + hash) + c;
+
+   return hash % tableSize;
+}
+
+static chainTable_t *chain_create(uint16_t size)
+{
+   chainTable_t *t = malloc(sizeof(chainTable_t));
+
+   t->table = calloc(size, sizeof(chainEntry_t *));
+   t->size  = size;
+
+   return t;
+}
+
+static void chain_destroy(chainTable_t *t)
+{
+   uint16_t i;
+
+   for(i=0;i<t->size;i++)
+   {
+      chainEntry_t *p = t->table[i];
+
+      while(p != NULL)
+      {
+         chainEntry_t *next = p->next;
+
+         free(p->key);
+         free(p->value);
+         free(p);
+         p = next;
+      }
+   }
+
+   free(t->table);
+   free(t);
+}
+
+static void chain_setKey(chainTable_t *t, char *key, char *value)
+{
+   uint16_t hash = chain_hash(t->size, key);
+   chainEntry_t *p = t->table[hash], *prev = p;
+
+   while(p != NULL)
+   {
+      if(!strcmp(p->key, key)) break;
+      prev = p;
+      p = p->next;
+   }
+
+   if(p != NULL)
+   {
+      free(p->value);
+      p->value = strdup(value);
+      return;
+   }
+
+   p = malloc(sizeof(chainEntry_t));
+   p->key   = strdup(key);
+   p->value = strdup(value);
+   p->next  = NULL;
+
+   if(prev == NULL) t->table[hash] = p;
+   else             prev->next = p;
+}
+
+static char *chain_getKey(chainTable_t *t, char *key)
+{
+   chainEntry_t *p = t->table[chain_hash(t->size, key)];
+
+   while(p != NULL && strcmp(p->key, key) != 0)
+      p = p->next;
+
+   return p == NULL ? NULL : p->value;
+}
+
+static void chain_delKey(chainTable_t *t, char *key)
+{
+   uint16_t hash = chain_hash(t->size, key);
+   chainEntry_t *p = t->table[hash], *prev = p;
+
+   while(p != NULL)
+   {
+      if(!strcmp(p->key, key)) break;
+      prev = p;
+      p = p->next;
+   }
+
+   if(p == NULL) return;
+
+   if(p == t->table[hash]) t->table[hash] = p->next;
+   else                    prev->next = p->next;
+
+   free(p->key);
+   free(p->value);
+   free(p);
+}
+
+static uint32_t chain_walk(chainTable_t *t)
+{
+   uint32_t total = 0;
+   uint16_t i;
+
+   for(i=0;i<t->size;i++)
+   {
+      chainEntry_t *p;
+
+      for(p = t->table[i]; p != NULL; p = p->next)
+         total += p->value[0];
+   }
+
+   return total;
+}
+
+/////////////////////////////////// Benchmark ///////////////////////////////
+
+typedef enum benchOp_e
+{
+   OP_INSERT,
+   OP_HIT,
+   OP_MISS,
+   OP_UPDATE,
+   OP_ITERATE,
+   OP_DELETE,
+
+   OP_TOTAL
+}benchOp_t;
+
+static const char *opName[OP_TOTAL] = { "insert", "lookup", "miss", "update", "iterate", "delete" };
+
+static char **keys, **missKeys, **values, **newValues;
+
+static volatile uint32_t sink;
+
+static double nowNs( void )
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static size_t heapInUse( void )
+{
+   struct mallinfo2 mi = mallinfo2();
+
+   return mi.uordblks;
+}
+
+static void makeKeys( int count )
+{
+   int i;
+   char buf[40];
+
+   keys      = malloc(count * sizeof(char *));
+   missKeys  = malloc(count * sizeof(char *));
+   values    = malloc(count * sizeof(char *));
+   newValues = malloc(count * sizeof(char *));
+
+   // Keys like the option names and position keys the table is used for
+   for(i=0;i<count;i++)
+   {
+      sprintf(buf, "key%dPos%x", i, i * 2654435761u);
+      keys[i] = strdup(buf);
+      sprintf(buf, "other%dPos%x", i, i * 40503u);
+      missKeys[i] = strdup(buf);
+      sprintf(buf, "%d", i);
+      values[i] = strdup(buf);
+      sprintf(buf, "value-%d", i * 7);
+      newValues[i] = strdup(buf);
+   }
+}
+
+static void freeKeys( int count )
+{
+   int i;
+
+   for(i=0;i<count;i++)
+   {
+      free(keys[i]);
+      free(missKeys[i]);
+      free(values[i]);
+      free(newValues[i]);
+   }
+
+   free(keys);
+   free(missKeys);
+   free(values);
+   free(newValues);
+}
+
+// Run every op over count keys, rounds times, adding the time taken to ns[] (per op)
+static void runOpen( int count, int rounds, double *ns, size_t *heap )
+{
+   int r, i;
+
+   for(r=0;r<rounds;r++)
+   {
+      size_t before = heapInUse();
+      hashtable_t *ht = ht_create(count);
+      double t[OP_TOTAL + 1];
+      uint32_t pos = 0;
+      void *value;
+
+      t[OP_INSERT] = nowNs();
+      for(i=0;i<count;i++) ht_setKey(ht, keys[i], values[i]);
+
+      t[OP_HIT] = nowNs();
+      for(i=0;i<count;i++) sink += ht_getKey(ht, keys[i])[0];
+
+      t[OP_MISS] = nowNs();
+      for(i=0;i<count;i++) sink += (ht_getKey(ht, missKeys[i]) == NULL);
+
+      t[OP_UPDATE] = nowNs();
+      for(i=0;i<count;i++) ht_setKey(ht, keys[i], newValues[i]);
+
+      t[OP_ITERATE] = nowNs();
+      while(ht_next(ht, &pos, NULL, NULL, &value, NULL)) sink += ((char *)value)[0];
+
+      t[OP_DELETE] = nowNs();
+      if(r == 0) *heap = heapInUse() - before;
+      for(i=0;i<count;i++) ht_delKey(ht, keys[i]);
+
+      t[OP_TOTAL] = nowNs();
+
+      for(i=0;i<OP_TOTAL;i++) ns[i] += (t[i+1] - t[i]) / count;
+
+      ht_destroy(ht);
+   }
+}
+
+static void runChained( int count, int rounds, double *ns, size_t *heap )
+{
+   int r, i;
+
+   for(r=0;r<rounds;r++)
+   {
+      size_t before = heapInUse();
+      chainTable_t *ct = chain_create(count < 65535 ? count : 65535);
+      double t[OP_TOTAL + 1];
+
+      t[OP_INSERT] = nowNs();
+      for(i=0;i<count;i++) chain_setKey(ct, keys[i], values[i]);
+
+      t[OP_HIT] = nowNs();
+      for(i=0;i<count;i++) sink += chain_getKey(ct, keys[i])[0];
+
+      t[OP_MISS] = nowNs();
+      for(i=0;i<count;i++) sink += (chain_getKey(ct, missKeys[i]) == NULL);
+
+      t[OP_UPDATE] = nowNs();
+      for(i=0;i<count;i++) chain_setKey(ct, keys[i], newValues[i]);
+
+      t[OP_ITERATE] = nowNs();
+      sink += chain_walk(ct);
+
+      t[OP_DELETE] = nowNs();
+      if(r == 0) *heap = heapInUse() - before;
+      for(i=0;i<count;i++) chain_delKey(ct, keys[i]);
+
+      t[OP_TOTAL] = nowNs();
+
+      for(i=0;i<OP_TOTAL;i++) ns[i] += (t[i+1] - t[i]) / count;
+
+      chain_destroy(ct);
+   }
+}
+
+static void bench( int count )
+{
+   double open[OP_TOTAL] = { 0 }, chained[OP_TOTAL] = { 0 };
+   size_t openHeap = 0, chainedHeap = 0;
+   int rounds = REPEAT_OPS / count + 1;
+   int i;
+
+   makeKeys(count);
+
+   // One untimed pass of each to warm up the caches and the allocator
+   runOpen(count, 1, open, &openHeap);
+   runChained(count, 1, chained, &chainedHeap);
+   memset(open,    0, sizeof(open));
+   memset(chained, 0, sizeof(chained));
+
+   runOpen(count, rounds, open, &openHeap);
+   runChained(count, rounds, chained, &chainedHeap);
+
+   printf("\n%d entries (%d rounds)\n", count, rounds);
+   printf("              open addr    chained    speedup   (ns/op)\n");
+
+   for(i=0;i<OP_TOTAL;i++)
+      printf("%-10s %12.1f %10.1f %9.2fx\n", opName[i], open[i] / rounds, chained[i] / rounds,
+             open[i] > 0 ? chained[i] / open[i] : 0.0);
+
+   printf("%-10s %12zu %10zu %9.2fx   (bytes)\n", "heap", openHeap, chainedHeap,
+          openHeap > 0 ? (double)chainedHeap / openHeap : 0.0);
+
+   freeKeys(count);
+}
+
+int main( int argc, char *argv[] )
+{
+   int i;
+
+   if(argc < 2)
+   {
+      bench(32);
+      bench(1000);
+      bench(100000);
+   }
+
+   for(i=1;i<argc;i++)
+   {
+      int count = atoi(argv[i]);
+
+      if(count <= 0)
+      {
+         fprintf(stderr, "usage: %s [count ...]\n", argv[0]);
+         return 1;
+      }
+
+      bench(count);
+   }
+
+   return 0;
+}
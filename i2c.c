@@ -1,5 +1,5 @@
 #include "diag.h"
-#include "bcm2835.h"
+#include "hal.h"
 
 #include <pthread.h>
 
@@ -14,8 +14,7 @@ void i2cInit( void )
 
    DPRINT("Initializing I2C \n");
 
-   bcm2835_i2c_begin();
-   bcm2835_i2c_setClockDivider(BCM2835_I2C_CLOCK_DIVIDER_626);
+   HAL_i2cBegin();
 }
 
 
@@ -24,8 +23,7 @@ uint8_t i2cSendCommand( uint8_t slaveAddress, uint8_t *command, uint8_t len )
     uint8_t result;
     pthread_mutex_lock(&I2C_Mutex);
 
-    bcm2835_i2c_setSlaveAddress( slaveAddress );
-    result = bcm2835_i2c_write((char *)command, len);
+    result = HAL_i2cWrite( slaveAddress, command, len );
 
     pthread_mutex_unlock(&I2C_Mutex);
     return result;
@@ -37,8 +35,7 @@ uint8_t i2cSendReceive( uint8_t slaveAddress, uint8_t *command, uint8_t cmdLen,
     uint8_t result;
     pthread_mutex_lock(&I2C_Mutex);
 
-    bcm2835_i2c_setSlaveAddress( slaveAddress );
-    result = bcm2835_i2c_write_read_rs( (char *)command, cmdLen, (char *)rsp, rspLen);
+    result = HAL_i2cWriteRead( slaveAddress, command, cmdLen, rsp, rspLen );
 
     pthread_mutex_unlock(&I2C_Mutex);
 
@@ -0,0 +1,356 @@
+#include "idle.h"
+
+#include "analysis.h"
+#include "board.h"
+#include "moves.h"
+#include "options.h"
+#include "hint.h"
+#include "trace.h"
+#include "diag.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define IDLE_MATE_CP     1000   // a mate (or anything past it) counts as this many centipawns
+
+// Winning chances (percent) a move gives away to count as...
+#define IDLE_INACCURACY  5
+#define IDLE_MISTAKE     10
+#define IDLE_BLUNDER     15
+
+extern game_t game;
+
+// The engine's verdict on the position at a ply of the game
+typedef struct plyScore_s
+{
+   U64      hash;         // the position it's for
+   move_t   best;
+   int32_t  score;        // side to move's view
+   bool_t   mate;
+   uint8_t  depth;        // 0 for none
+}plyScore_t;
+
+static plyScore_t scores[MAX_MOVES_IN_GAME];
+
+static bool_t     running = FALSE;
+static bool_t     pending = FALSE;     // stopped, with its lines not yet collected
+
+// The position the background search is of
+static int        searchPly;
+static board_t    searchBoard;
+static bool_t     searchChess960;
+
+// Records from searches up to staleSearch are left over from before it started
+static uint32_t   staleSearch;
+static uint32_t   newestSearch;
+
+static ShmRecord  recs[SHM_RING_SIZE];
+
+static char       totals[32];
+static bool_t     haveTotals = FALSE;
+
+static bool_t readLines( searchSummary_t *s );
+static void   noteScore( int ply, U64 hash, const searchSummary_t *s );
+static bool_t knownScore( const game_t *g, int ply, double *win );
+static double winChance( int32_t score, bool_t mate );
+static void   sideTotal( FILE *fp, const char *name, int rated, double accSum, const int *counts );
+
+void IDLE_start( void )
+{
+   searchSummary_t s;
+
+   if(running || !getOption(OPT_IDLE_ANALYSIS) || HINT_enabled() || game.disposition != GAME_PLAYABLE)
+      return;
+
+   if(!SF_channelAttached())
+      return;
+
+   // What the search stopped in this position left, then skip anything else
+   IDLE_collect();
+   readLines(&s);
+
+   staleSearch = newestSearch;
+
+   searchPly      = game.playedMoves;
+   searchBoard    = game.brd;
+   searchChess960 = game.chess960;
+
+   // Background first:  threads the search starts take the main thread's policy
+   SF_setBackground(TRUE);
+   SF_setGame(&game);
+   SF_findHints(1);
+
+   running = TRUE;
+}
+
+void IDLE_cancel( void )
+{
+   if(!running)
+      return;
+
+   SF_stop();
+   SF_setBackground(FALSE);
+
+   running = FALSE;
+   pending = TRUE;
+}
+
+void IDLE_collect( void )
+{
+   searchSummary_t s;
+   bool_t found;
+
+   if(!pending)
+      return;
+
+   found   = readLines(&s);
+   pending = FALSE;
+
+   if(!found)
+      return;
+
+   DPRINT("Background search:  depth %d, score %d%s\n", s.depth, s.score, s.mate ? " (mate)" : "");
+
+   noteScore(searchPly, searchBoard.hash, &s);
+
+   if(!searchChess960)
+      ANALYSIS_keep(&searchBoard, &s);
+}
+
+void IDLE_noteSearch( const game_t *g, const searchSummary_t *s )
+{
+   noteScore(g->playedMoves, g->brd.hash, s);
+}
+
+void IDLE_newGame( void )
+{
+   memset(scores, 0x00, sizeof(scores));
+}
+
+void IDLE_summarize( const game_t *g )
+{
+   board_t b = g->brd;
+   char played[MOVE_TEXT_MAX], best[MOVE_TEXT_MAX], white[8], black[8];
+   int ply, rated[2] = { 0, 0 }, counts[2][3] = { { 0 } };
+   double accSum[2] = { 0, 0 }, before, after, lost, acc;
+   FILE *fp;
+
+   haveTotals = FALSE;
+
+   if(TRACE_isReplaying())
+      return;
+
+   // Back to the start
+   for(ply=g->playedMoves-1;ply>=0;ply--)
+      unmove(&b, g->posHistory[ply].revMove);
+
+   if( (fp = fopen(ACCURACY_FILE, "w")) == NULL)
+   {
+      DLOG(DIAG_ERROR, "Unable to open %s\n", ACCURACY_FILE);
+      return;
+   }
+
+   for(ply=0;ply<g->playedMoves;ply++)
+   {
+      const plyScore_t *p = &scores[ply];
+      move_t mv = g->posHistory[ply].move;
+      color_t side = b.toMove;
+
+      snprintf(played, sizeof(played), "%d%s%s", b.moveNumber, side == WHITE ? "." : "...", moveToSAN(mv, &b));
+
+      if(!knownScore(g, ply, &before) || !knownScore(g, ply + 1, &after))
+      {
+         fprintf(fp, "%-14s not rated\n", played);
+         move(&b, mv);
+         continue;
+      }
+
+      snprintf(best, sizeof(best), "%s", moveToSAN(p->best, &b));
+
+      // The next position's score is the opponent's view
+      after = 100.0 - after;
+
+      lost = (mv.from == p->best.from && mv.to == p->best.to) ? 0.0 : before - after;
+
+      if(lost < 0.0)
+         lost = 0.0;
+
+      acc = 103.1668 * exp(-0.04354 * lost) - 3.1669;
+
+      if(acc < 0.0)   acc = 0.0;
+      if(acc > 100.0) acc = 100.0;
+
+      rated[side]++;
+      accSum[side] += acc;
+
+      fprintf(fp, "%-14s best %-8s win %3.0f%% -> %3.0f%%  accuracy %3.0f", played, best, before, after, acc);
+
+      if(lost >= IDLE_BLUNDER)
+      {
+         counts[side][2]++;
+         fprintf(fp, "  blunder");
+      }
+      else if(lost >= IDLE_MISTAKE)
+      {
+         counts[side][1]++;
+         fprintf(fp, "  mistake");
+      }
+      else if(lost >= IDLE_INACCURACY)
+      {
+         counts[side][0]++;
+         fprintf(fp, "  inaccuracy");
+      }
+
+      fprintf(fp, "\n");
+      move(&b, mv);
+   }
+
+   fprintf(fp, "\n");
+   sideTotal(fp, "White", rated[WHITE], accSum[WHITE], counts[WHITE]);
+   sideTotal(fp, "Black", rated[BLACK], accSum[BLACK], counts[BLACK]);
+
+   if(ferror(fp) | fclose(fp))
+      DLOG(DIAG_ERROR, "Unable to write %s\n", ACCURACY_FILE);
+
+   if(rated[WHITE] == 0 && rated[BLACK] == 0)
+      return;
+
+   snprintf(white, sizeof(white), rated[WHITE] ? "%.0f%%" : "--", accSum[WHITE] / (rated[WHITE] ? rated[WHITE] : 1));
+   snprintf(black, sizeof(black), rated[BLACK] ? "%.0f%%" : "--", accSum[BLACK] / (rated[BLACK] ? rated[BLACK] : 1));
+   snprintf(totals, sizeof(totals), "Accuracy W%s B%s", white, black);
+
+   haveTotals = TRUE;
+}
+
+bool_t IDLE_takeTotals( char *text, int size )
+{
+   if(!haveTotals)
+      return FALSE;
+
+   snprintf(text, size, "%s", totals);
+   haveTotals = FALSE;
+
+   return TRUE;
+}
+
+// Read the engine's updates:  the background search's deepest exact line, if it is running or
+//   waiting to be collected and has found one
+static bool_t readLines( searchSummary_t *s )
+{
+   move_t list[MAX_LIST_SIZE], m;
+   bool_t found = FALSE;
+   int n, i, j, count = -1;
+
+   memset(s, 0x00, sizeof(*s));
+
+   while( (n = SF_readUpdates(recs, SHM_RING_SIZE)) > 0)
+   {
+      for(i=0;i<n;i++)
+      {
+         ShmRecord *r = &recs[i];
+
+         if(r->searchId > newestSearch)
+            newestSearch = r->searchId;
+
+         if(!pending || r->type != SHM_REC_PV || r->searchId <= staleSearch || r->multiPV != 1 ||
+            r->pvLength == 0 || r->bound != SHM_BOUND_EXACT || r->depth < s->depth)
+            continue;
+
+         // Not from another position
+         if(count < 0)
+            count = findMoves(&searchBoard, list);
+
+         m = SF_unpackMove(r->pv[0]);
+
+         for(j=0;j<count;j++)
+         {
+            if(list[j].from == m.from && list[j].to == m.to &&
+               (list[j].promote == m.promote || m.promote < KNIGHT || m.promote > QUEEN))
+               break;
+         }
+
+         if(j >= count)
+            continue;
+
+         s->best      = list[j];
+         s->hasPonder = (r->pvLength > 1) ? TRUE : FALSE;
+         s->ponder    = SF_unpackMove(s->hasPonder ? r->pv[1] : 0);
+         s->depth     = r->depth;
+         s->score     = r->score;
+         s->mate      = (r->scoreType == SHM_SCORE_MATE) ? TRUE : FALSE;
+         s->nodes     = r->nodes;
+         found = TRUE;
+      }
+   }
+
+   return found;
+}
+
+// Keep the search's score for the position at ply, unless one as deep is kept already
+static void noteScore( int ply, U64 hash, const searchSummary_t *s )
+{
+   plyScore_t *p = &scores[ply];
+
+   if(s->depth <= 0 || ply < 0 || ply >= MAX_MOVES_IN_GAME)
+      return;
+
+   if(p->depth != 0 && p->hash == hash && p->depth > s->depth)
+      return;
+
+   p->hash  = hash;
+   p->best  = s->best;
+   p->score = s->score;
+   p->mate  = s->mate;
+   p->depth = (s->depth > 255) ? 255 : s->depth;
+}
+
+// The winning chances (percent) of the side to move at ply.  FALSE if there's no score for it.
+static bool_t knownScore( const game_t *g, int ply, double *win )
+{
+   const plyScore_t *p = &scores[ply];
+
+   // The game ended here:  no search needed
+   if(ply == g->playedMoves && g->disposition == GAME_AT_CHECKMATE)
+   {
+      *win = 0.0;
+      return TRUE;
+   }
+
+   if(ply == g->playedMoves && g->disposition == GAME_AT_STALEMATE)
+   {
+      *win = 50.0;
+      return TRUE;
+   }
+
+   if(p->depth == 0 || p->hash != g->posHistory[ply].posHash)
+      return FALSE;
+
+   *win = winChance(p->score, p->mate);
+
+   return TRUE;
+}
+
+// Centipawns to winning chances (percent), on the curve fitted to games between players rated
+//   about the same
+static double winChance( int32_t score, bool_t mate )
+{
+   double cp = mate ? (score > 0 ? IDLE_MATE_CP : -IDLE_MATE_CP) : score;
+
+   if(cp > IDLE_MATE_CP)  cp = IDLE_MATE_CP;
+   if(cp < -IDLE_MATE_CP) cp = -IDLE_MATE_CP;
+
+   return 50.0 + 50.0 * (2.0 / (1.0 + exp(-0.00368208 * cp)) - 1.0);
+}
+
+static void sideTotal( FILE *fp, const char *name, int rated, double accSum, const int *counts )
+{
+   if(rated == 0)
+   {
+      fprintf(fp, "%s:  no moves rated\n", name);
+      return;
+   }
+
+   fprintf(fp, "%s:  accuracy %.0f%% over %d moves, %d inaccuracies, %d mistakes, %d blunders\n", name,
+           accSum / rated, rated, counts[0], counts[1], counts[2]);
+}
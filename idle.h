@@ -0,0 +1,52 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+// Background analysis
+//
+// With OPT_IDLE_ANALYSIS on, the engine searches the position while the human is to move rather
+//   than waiting for the move:  a one line hint search (SF_findHints()) that nothing is shown for,
+//   with the engine's threads at SCHED_IDLE (SF_setBackground()) so the rest of the board never
+//   waits on it.  The first lift or drop stops it and puts the threads back, before the board
+//   change is looked at;  it starts again if the board goes back to the position.  It runs in the
+//   engine playing the game, so its hash table has the replies to the human's likely moves when the
+//   computer's own search starts, and the line it found goes in the analysis cache (analysis.h).
+//   It doesn't run while hints are on:  they are the same search.
+//
+// Accuracy summary
+//
+// The engine's score for each position of the game is noted as the game goes:  the background
+//   search's (or the hints') on the human's turns, the computer's own search on its turns if it is
+//   one the analysis cache would take (a capped or repeatable one's score is a weaker player's
+//   guess).  When the game ends IDLE_summarize() works out from them how much each move gave away,
+//   in winning chances, and each side's accuracy, without searching anything again.  Moves either
+//   side of a position with no score (book moves, a turn too short to search, a capped search)
+//   aren't rated.  The summary is written to ACCURACY_FILE, one line per move, and its totals
+//   shown when the game is over.
+
+#include "types.h"
+#include "sfInterface.h"
+
+#define ACCURACY_FILE  CHESS_DIR "/accuracy.txt"
+
+// Player's turn:  start the background search of the game's position (if it's on and not running)
+void   IDLE_start( void );
+
+// Stop the background search.  Only sends the engine its stop and restores its threads.
+void   IDLE_cancel( void );
+
+// Take what the background search found since it started (once it has been cancelled)
+void   IDLE_collect( void );
+
+// Note the engine's search for the game's current position (the computer's move, or a hint line)
+void   IDLE_noteSearch( const game_t *g, const searchSummary_t *s );
+
+// New game:  forget the scores noted
+void   IDLE_newGame( void );
+
+// The game has ended:  write the accuracy summary.  Its totals are kept for IDLE_takeTotals().
+void   IDLE_summarize( const game_t *g );
+
+// The totals for the game over screen ("Accuracy W91% B78%"), once.  FALSE if there are none.
+bool_t IDLE_takeTotals( char *text, int size );
+
+#endif
@@ -3,7 +3,7 @@
 
 #include "led.h"
 #include "diag.h"
-#include "bcm2835.h"
+#include "hal.h"
 #include "util.h"
 #include "constants.h"
 #include "options.h"
@@ -47,6 +47,7 @@ static pthread_mutex_t LED_dataMutex;
 
 // Local functions
 static void *LED_FlashToggle ( void *arg );
+static void LED_brightnessChanged( optionId_t id, long int value );
 
 bool flippedBoard = false;
 
@@ -59,29 +60,27 @@ void LED_Init( void )
 
 	DPRINT("Initializing LED driver\n");
 
-   // Initialize broadcom spi driver
-	bcm2835_spi_begin();
-
-   // Through experimentation, this is the fastest we can go...
-	bcm2835_spi_setClockDivider(BCM2835_SPI_CLOCK_DIVIDER_32);
+   // Initialize spi driver
+	HAL_spiBegin();
 
    // Set to scan ALL LEDs
 	command[0] = SCAN_LIMIT_COMMAND;
 	command[1] = SCAN_ALL;
-	bcm2835_spi_writenb((char *)command, 2);
+	HAL_spiWrite(command, 2);
 
    // Set intensity
-   LED_SetBrightness(options.board.LED_Brightness);
+   LED_SetBrightness(getOption(OPT_LED_BRIGHTNESS));
+   addOptionCallback(OPT_LED_BRIGHTNESS, LED_brightnessChanged);
 
    // Make sure display test mode is OFF
 	command[0] = DISPLAY_TEST_COMMAND;
 	command[1] = TEST_OFF;
-	bcm2835_spi_writenb((char *)command, 2);
+	HAL_spiWrite(command, 2);
 
    // Don't try to interpret data as a digit - its binary with each bit controlling one of 8 LEDs
 	command[0] = DECODE_MODE_COMMAND;
 	command[1] = NO_DECODE;
-	bcm2835_spi_writenb((char *)command, 2);
+	HAL_spiWrite(command, 2);
 
    // Set all LEDs to off and no blinking
 	for(i=0;i<8;i++)
@@ -96,7 +95,7 @@ void LED_Init( void )
 
    command[0] = SHUTDOWN_COMMAND;
 	command[1] = NORMAL_MODE;
-	bcm2835_spi_writenb((char *)command, 2);
+	HAL_spiWrite(command, 2);
 
 
    // TODO should we do something here to ensure we don't re-create a 2nd process
@@ -276,7 +275,7 @@ void LED_FlashGridState ( uint64_t bits )
 
    // LED_AllOff();
 
-   DPRINT("Flashing LED grid state to %016llX\n", bits);
+   DPRINT("Flashing LED grid state to %016llX\n", (unsigned long long)bits);
 
    pthread_mutex_lock(&LED_dataMutex);
 
@@ -317,7 +316,7 @@ void LED_Flush ( void )
          command[0] = i+1;
          command[1] = ledRowData[i].ledState;
 
-         bcm2835_spi_writenb((char *)command, 2);
+         HAL_spiWrite(command, 2);
 
          ledRowData[i].rowDirty = FALSE;
       }
@@ -372,8 +371,13 @@ void LED_SetBrightness( unsigned char level)
 
    command[0] = INTENSITY_COMMAND;
 	command[1] = level;
-	bcm2835_spi_writenb((char *)command, 2);
+	HAL_spiWrite(command, 2);
+
+}
 
+static void LED_brightnessChanged( optionId_t id, long int value )
+{
+   LED_SetBrightness(value);
 }
 
 void LED_SetFlip( bool_t state )
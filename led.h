@@ -42,10 +42,10 @@ void LED_Flash( int led );
 void LED_Flush( void );
 
 // Set an arbitrary solid pattern
-void LED_SetGridState ( unsigned long long bits );
+void LED_SetGridState ( uint64_t bits );
 
 // Set an arbitrary flashing pattern
-void LED_FlashGridState ( unsigned long long bits );
+void LED_FlashGridState ( uint64_t bits );
 
 void LED_SetBrightness( unsigned char level);
 
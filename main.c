@@ -63,13 +63,13 @@ int main ( void )
 
       // report any errors found...
 //      if(err == HSM_EV_NOT_IN_TABLE)
-//         DPRINT("Warning: HSM_ProcessEvent() could not find event %d in transition table\n", eventData.ev);
+//         DLOG(DIAG_WARN, "Warning: HSM_ProcessEvent() could not find event %d in transition table\n", eventData.ev);
 
 //      else if(err == HSM_NO_EV_HANDLER_FOUND)
-//         DPRINT("Warning: HSM_ProcessEvent() could not find transition for event %d in state %d\n", eventData.ev, sm.currentState);
+//         DLOG(DIAG_WARN, "Warning: HSM_ProcessEvent() could not find transition for event %d in state %d\n", eventData.ev, sm.currentState);
 
       if(err != HSM_NO_ERROR && err != HSM_NO_EV_HANDLER_FOUND)
-         DPRINT("Error: HSM_ProcessEvent() returned error %d while processing event %d in state %d\n", err, eventData.ev, sm.currentState);
+         DLOG(DIAG_ERROR, "Error: HSM_ProcessEvent() returned error %d while processing event %d in state %d\n", err, eventData.ev, sm.currentState);
 
    }
 
@@ -349,19 +349,19 @@ void drawMenu(menu_t *menu)
 
    if(menu == NULL)
    {
-      DPRINT("ERROR: Trying to draw a menu from a NULL pointer\n");
+      DLOG(DIAG_ERROR, "ERROR: Trying to draw a menu from a NULL pointer\n");
       return;
    }
 
    if(menu->itemCount == 0)
    {
-      DPRINT("ERROR: Trying to draw a menu with no items\n");
+      DLOG(DIAG_ERROR, "ERROR: Trying to draw a menu with no items\n");
       return;
    }
 
    if(menu->selectedItem >= menu->itemCount)
    {
-      DPRINT("Warning: Invalid selection index when drawing menu.  Setting back to zero\n");
+      DLOG(DIAG_WARN, "Warning: Invalid selection index when drawing menu.  Setting back to zero\n");
       menu->selectedItem = 0;
    }
 
@@ -369,7 +369,7 @@ void drawMenu(menu_t *menu)
 
    if(menu->cursorLine > (NUM_LINES - 1) || menu->cursorLine < topDisplayLine)
    {
-      DPRINT("Warning: Invalid cursorLine range when drawing menu.  Setting back to zero\n");
+      DLOG(DIAG_WARN, "Warning: Invalid cursorLine range when drawing menu.  Setting back to zero\n");
       menu->cursorLine = 0;
    }
 
@@ -377,7 +377,7 @@ void drawMenu(menu_t *menu)
    {
       if(menu->cursorLine > menu->selectedItem)
       {
-         DPRINT("Warning: Invalid cursorLine when drawing menu.  Setting back\n");
+         DLOG(DIAG_WARN, "Warning: Invalid cursorLine when drawing menu.  Setting back\n");
          menu->cursorLine = menu->selectedItem;
       }
    }
@@ -385,7 +385,7 @@ void drawMenu(menu_t *menu)
    {
       if(menu->cursorLine > menu->selectedItem + 1)
       {
-         DPRINT("Warning: Invalid cursorLine when drawing menu.  Setting back\n");
+         DLOG(DIAG_WARN, "Warning: Invalid cursorLine when drawing menu.  Setting back\n");
          menu->cursorLine = menu->selectedItem;
       }
    }
@@ -0,0 +1,64 @@
+#include "moveRecord.h"
+
+#include <string.h>
+
+void MOVEREC_clear( moveRecord_t *r )
+{
+   r->plies   = 0;
+   r->length  = 0;
+   r->text[0] = '\0';
+}
+
+bool_t MOVEREC_append( moveRecord_t *r, const char *text )
+{
+   int len = strlen(text);
+   int sep = (r->plies > 0) ? 1 : 0;
+
+   if(r->plies >= MAX_MOVES_IN_GAME || len >= MOVE_TEXT_MAX ||
+      r->length + sep + len >= sizeof(r->text))
+      return FALSE;
+
+   r->offset[r->plies++] = r->length;
+
+   if(sep)
+      r->text[r->length++] = ' ';
+
+   memcpy(&r->text[r->length], text, len + 1);
+   r->length += len;
+
+   return TRUE;
+}
+
+void MOVEREC_truncate( moveRecord_t *r, int plies )
+{
+   if(plies < 0) plies = 0;
+
+   if(plies >= r->plies)
+      return;
+
+   r->plies  = plies;
+   r->length = r->offset[plies];
+   r->text[r->length] = '\0';
+}
+
+const char *MOVEREC_ply( const moveRecord_t *r, int ply )
+{
+   if(ply <= 0)
+      return r->text;
+
+   if(ply >= r->plies)
+      return &r->text[r->length];
+
+   // Past the separator
+   return &r->text[r->offset[ply] + 1];
+}
+
+const char *MOVEREC_tail( const moveRecord_t *r, int maxLen )
+{
+   int ply = r->plies;
+
+   while(ply > 0 && r->length - r->offset[ply - 1] - (ply > 1 ? 1 : 0) <= maxLen)
+      ply--;
+
+   return MOVEREC_ply(r, ply);
+}
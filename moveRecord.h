@@ -0,0 +1,28 @@
+#ifndef MOVE_RECORD_H
+#define MOVE_RECORD_H
+
+// Move records
+//
+// The text of a game's moves (moveRecord_t, types.h), built up a ply at a time:  appending a ply
+//   or taking plies back costs the same however long the game, since the record keeps its length
+//   and where each ply starts.  record->text is the whole of it, plies separated by single spaces.
+//   Each append is at most MOVE_TEXT_MAX - 1 characters, which the text has room for in every ply
+//   of the longest game.
+
+#include "types.h"
+
+void        MOVEREC_clear( moveRecord_t *r );
+
+// Add a ply.  FALSE (and the record unchanged) if it's full or the text is too long.
+bool_t      MOVEREC_append( moveRecord_t *r, const char *text );
+
+// Take the record back to its first plies
+void        MOVEREC_truncate( moveRecord_t *r, int plies );
+
+// The text from a ply on
+const char *MOVEREC_ply( const moveRecord_t *r, int ply );
+
+// The text of the last plies that fit in maxLen characters
+const char *MOVEREC_tail( const moveRecord_t *r, int maxLen );
+
+#endif
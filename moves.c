@@ -5,14 +5,16 @@
 #include "debug.h"
 // #include "eval.h"
 #include "board.h"
+#include "util.h"
 
 #include <string.h>
 #include <stdlib.h>
 
 #define MAX_LIST_SIZE 200
 
-static int moveIndex;
-static int insertIndex;
+// Per thread, so moves can be found on more than one thread at once (bookBuild.c)
+static __thread int moveIndex;
+static __thread int insertIndex;
 
 static void addMovePromote(int from, int to, move_t *moveList);
 static void addMove(int from, int to, move_t *moveList);
@@ -1617,6 +1619,98 @@ char *moveToSAN(move_t mv, board_t *b)
 	return SANtext;
 }
 
+// Find the legal move SAN text names (the reverse of moveToSAN).  Takes what PGN files have in
+//   practice too:  check and annotation marks, castling with zeros, a promotion without the '=',
+//   a capture mark left out or put in where there's no capture.  Returns TRUE, with the move in
+//   mv, if exactly one legal move matches.
+bool_t SANtoMove(board_t *b, const char *san, move_t *mv)
+{
+   move_t list[MAX_LIST_SIZE];
+   piece_t piece = PAWN, promote = PIECE_NONE;
+   int fromFile = -1, fromRow = -1, to, castle = 0;
+   int count, i, len = 0, found = 0;
+   char text[16];
+   const char *p;
+
+   // Keep the letters and digits that matter
+   for(p=san;*p != '\0' && len < (int)sizeof(text) - 1;p++)
+   {
+      if(strchr("x:-+#!?=", *p) == NULL)
+         text[len++] = *p;
+   }
+
+   text[len] = '\0';
+
+   if(!strcmp(text, "OO") || !strcmp(text, "00"))
+      castle = 2;
+   else if(!strcmp(text, "OOO") || !strcmp(text, "000"))
+      castle = -2;
+   else
+   {
+      p = text;
+
+      if(*p != '\0' && strchr("NBRQK", *p) != NULL)
+      {
+         piece = (*p == 'N') ? KNIGHT : (*p == 'B') ? BISHOP : (*p == 'R') ? ROOK : (*p == 'Q') ? QUEEN : KING;
+         p++;
+         len--;
+      }
+
+      // Promotion piece last
+      if(piece == PAWN && len > 0 && strchr("NBRQnbrq", p[len - 1]) != NULL)
+      {
+         switch(p[--len])
+         {
+            case 'N': case 'n': promote = KNIGHT; break;
+            case 'B': case 'b': promote = BISHOP; break;
+            case 'R': case 'r': promote = ROOK;   break;
+            default:            promote = QUEEN;  break;
+         }
+      }
+
+      // Destination square last, anything before it is the square (or file or row) moved from
+      if(len < 2 || len > 4 || p[len - 2] < 'a' || p[len - 2] > 'h' || p[len - 1] < '1' || p[len - 1] > '8')
+         return FALSE;
+
+      to = (p[len - 2] - 'a') + ('8' - p[len - 1]) * 8;
+
+      for(i=0;i<len-2;i++)
+      {
+         if(p[i] >= 'a' && p[i] <= 'h')
+            fromFile = p[i] - 'a';
+         else if(p[i] >= '1' && p[i] <= '8')
+            fromRow = '8' - p[i];
+         else
+            return FALSE;
+      }
+   }
+
+   if( (count = findMoves(b, list)) <= 0)
+      return FALSE;
+
+   for(i=0;i<count;i++)
+   {
+      piece_t moved = getPieceAtSquare(b, list[i].from);
+
+      if(castle)
+      {
+         if(moved != KING || list[i].to - list[i].from != castle)
+            continue;
+      }
+      else if(moved != piece || list[i].to != to || list[i].promote != promote ||
+              (fromFile >= 0 && list[i].from % 8 != fromFile) ||
+              (fromRow >= 0 && list[i].from / 8 != fromRow))
+      {
+         continue;
+      }
+
+      *mv = list[i];
+      found++;
+   }
+
+   return (found == 1) ? TRUE : FALSE;
+}
+
 // Adds 4 "copies" of a pawn promotion with the four possible promotion pieces...
 static void addMovePromote(int from, int to, move_t *moveList)
 {
@@ -7,5 +7,6 @@
 #define MAX_LIST_SIZE 200
 
 char *moveToSAN(move_t mv, board_t *b);
+bool_t SANtoMove(board_t *b, const char *san, move_t *mv);
 
 int findMoves(board_t *b, move_t *moveList);
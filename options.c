@@ -7,124 +7,262 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Options file layout (all values little endian)
+//
+//    "PCOP", uint16 version, uint16 count
+//    count x { uint8 name length, name, int32 value }
+//    uint32 CRC-32 of everything before it
+//
+// Options are stored by name so entries can be added or retired without a version change.
+//   Unknown names are ignored and missing ones take their default.
+
+#define OPTIONS_MAGIC        "PCOP"
+#define OPTIONS_VERSION      1
+#define OPTIONS_TEMP_FILE    OPTIONS_FILE ".tmp"
+#define OPTIONS_MAX_FILE     4096
+#define OPTIONS_MAX_CALLBACK 4
+
+typedef enum optionType_e
+{
+   OPT_TYPE_INT,
+   OPT_TYPE_BOOL,
+   OPT_TYPE_ENUM
+}optionType_t;
 
-static void checkOptions( void );
+typedef struct optionDef_s
+{
+   const char   *name;
+   optionType_t  type;
+   long int      min;
+   long int      max;
+   long int      def;
+   const char  **valueNames;   // BOOL and ENUM:  names of the values min..max
+}optionDef_t;
+
+static const char *boolNames[]     = { "false", "true" };
+static const char *playerNames[]   = { "human", "computer" };
+static const char *timingNames[]   = { "untimed", "equal", "odds" };
+static const char *strategyNames[] = { "fixedDepth", "fixedTime", "tillButton" };
+static const char *tablebaseNames[] = { "off", "on", "adjudicate" };
+
+#define INT_OPT(n, lo, hi, d)   { n, OPT_TYPE_INT,  lo,    hi,    d,     NULL  }
+#define BOOL_OPT(n, d)          { n, OPT_TYPE_BOOL, FALSE, TRUE,  d,     boolNames }
+#define ENUM_OPT(n, names, d)   { n, OPT_TYPE_ENUM, 0, (sizeof(names)/sizeof(names[0])) - 1, d, names }
+
+// Order must match optionId_t
+static const optionDef_t optionDef[OPT_TOTAL] =
+{
+   ENUM_OPT("whitePlayer",                   playerNames,   PLAYER_HUMAN),
+   ENUM_OPT("blackPlayer",                   playerNames,   PLAYER_COMPUTER),
+   ENUM_OPT("timeControl",                   timingNames,   TIME_NONE),
+   ENUM_OPT("computerStrategy",              strategyNames, STRAT_FIXED_DEPTH),
+   INT_OPT ("searchDepth",                   MIN_PLY_DEPTH, MAX_PLY_DEPTH, DEFAULT_PLY_DEPTH),
+   INT_OPT ("searchTimeInMs",                1000, 999000, 3000),
+   INT_OPT ("timePeriod1.timeInSec",         0, 36000, 180),
+   INT_OPT ("timePeriod1.increment",         0, 99, 0),
+   INT_OPT ("timePeriod1.moves",             0, 99, 0),
+   INT_OPT ("timePeriod2.timeInSec",         0, 36000, 180),
+   INT_OPT ("timePeriod2.increment",         0, 99, 0),
+   INT_OPT ("timePeriod2.moves",             0, 99, 0),
+   INT_OPT ("timePeriod3.timeInSec",         0, 36000, 180),
+   INT_OPT ("timePeriod3.increment",         0, 99, 0),
+   INT_OPT ("timePeriod3.moves",             0, 99, 0),
+   BOOL_OPT("chess960",                      FALSE),
+   INT_OPT ("graceTimeForComputerMoveInSec", 0, 60, 4),
+   BOOL_OPT("openingBook",                   TRUE),
+   BOOL_OPT("coaching",                      TRUE),
+   BOOL_OPT("takeBack",                      TRUE),
+   INT_OPT ("dropDebounceInTicks",           1, 100, (600 / MS_PER_TIC)),
+   INT_OPT ("liftDebounceInTicks",           1, 100, (100 / MS_PER_TIC)),
+   INT_OPT ("ledBrightness",                 1, 15, 15),
+   INT_OPT ("engineStrength",                MIN_STRENGTH, MAX_STRENGTH, 20),
+   INT_OPT ("engineHashMB",                  ENGINE_AUTO, MAX_HASH_MB, ENGINE_AUTO),
+   INT_OPT ("engineThreads",                 ENGINE_AUTO, MAX_THREADS, ENGINE_AUTO),
+   INT_OPT ("engineStandby",                 0, MAX_STANDBY_ENGINES, DEFAULT_STANDBY_ENGINES),
+   ENUM_OPT("tablebases",                    tablebaseNames, TB_ON),
+   INT_OPT ("engineKnpsPerThread",           0, MAX_KNPS_PER_THREAD, 0),
+   BOOL_OPT("engineRepeatable",              FALSE),
+   BOOL_OPT("ponder",                        FALSE),
+   BOOL_OPT("eventTrace",                    FALSE),
+   BOOL_OPT("idleAnalysis",                  FALSE),
+};
 
 options_t options;
-hashtable_t *optionsHashTable = NULL;
 
-bool disableSaveOnChange = false;
+static long int         optionValue[OPT_TOTAL];
+static optionCallback_t optionCallback[OPT_TOTAL][OPTIONS_MAX_CALLBACK];
+
+// Guards the values against the save thread and the pending save state
+static pthread_mutex_t  optionMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   saveCond    = PTHREAD_COND_INITIALIZER;
+static pthread_t        saveThread;
+static bool_t           saveThreadStarted = FALSE;
+static bool_t           saveDirty = FALSE;
+static struct timespec  saveDue;
+
+// Only one writer of the file at a time
+static pthread_mutex_t  fileMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void     setDefaults( void );
+static void     setStructDefaults( void );
+static bool_t   readOptionsFile( void );
+static bool_t   readLegacyFile( void );
+static void     writeOptionsFile( long int *values );
+static long int parseValue( optionId_t id, const char *text, bool_t *ok );
+static int      findOption( const char *name, int len );
+static uint32_t crc32( const uint8_t *buf, int len );
+static void     debounceChanged( optionId_t id, long int value );
+static void    *saveTask( void *arg );
 
 void loadOptions( void )
 {
-   if(optionsHashTable == NULL)
-      optionsHashTable = ht_create(50);
+   bool_t converted = FALSE;
+
+   setDefaults();
+   setStructDefaults();
+
+   if(!readOptionsFile())
+   {
+      // Older releases kept the options as text;  carry the settings over.
+      if(readLegacyFile())
+      {
+         DPRINT("Converted text options file\n");
+      }
+      converted = TRUE;
+   }
 
-   ht_load(optionsHashTable, "options");
+   options.board.pieceDropDebounce = optionValue[OPT_DROP_DEBOUNCE];
+   options.board.pieceLiftDebounce = optionValue[OPT_LIFT_DEBOUNCE];
 
-   // Ensure every option exists and has legal values
-   checkOptions();
+   addOptionCallback(OPT_DROP_DEBOUNCE, debounceChanged);
+   addOptionCallback(OPT_LIFT_DEBOUNCE, debounceChanged);
 
-   // Save results
-   ht_save(optionsHashTable, "options");
+   if(!saveThreadStarted)
+   {
+      pthread_create(&saveThread, NULL, saveTask, NULL);
+      saveThreadStarted = TRUE;
+
+      // Don't lose a change made just before exiting
+      atexit(flushOptions);
+   }
 
+   // Write out a file in the current format right away
+   if(converted)
+      writeOptionsFile(optionValue);
 }
 
-static void checkOptions( void )
+long int getOption( optionId_t id )
 {
+   if(id >= OPT_TOTAL) return 0;
 
-   disableSaveOnChange = true;
-   long int depth;
+   return optionValue[id];
+}
 
+optionErr_t setOption( optionId_t id, long int value )
+{
+   int i;
 
-   if(
-       getOptionStr("whitePlayer") == NULL ||
-       (
-         !isOptionStr("whitePlayer","human") &&
-         !isOptionStr("whitePlayer","computer")
-       )
-     )
+   if(id >= OPT_TOTAL)
    {
-      setOptionStr("whitePlayer", "human");
+      DLOG(DIAG_WARN, "Invalid option id %d passed to setOption\n", (int)id);
+      return OPT_ERR_INVALID_ID;
    }
 
-   if(
-       getOptionStr("blackPlayer") == NULL ||
-       (
-         !isOptionStr("blackPlayer","human") &&
-         !isOptionStr("blackPlayer","computer")
-       )
-     )
+   if(value < optionDef[id].min || value > optionDef[id].max)
    {
-      setOptionStr("blackPlayer", "computer");
+      DLOG(DIAG_WARN, "Value %ld out of range for option %s\n", value, optionDef[id].name);
+      return OPT_ERR_OUT_OF_RANGE;
    }
 
-   if(
-       getOptionStr("timeControl") == NULL ||
-       (
-         !isOptionStr("timeControl", "untimed") &&
-         !isOptionStr("timeControl", "equal")   &&
-         !isOptionStr("timeControl", "odds")
-       )
-     )
+   if(optionValue[id] == value) return OPT_ERR_NONE;
+
+   pthread_mutex_lock(&optionMutex);
+
+   optionValue[id] = value;
+
+   // (Re)start the save delay
+   clock_gettime(CLOCK_REALTIME, &saveDue);
+   saveDue.tv_sec  += OPTIONS_SAVE_DELAY_MS / 1000;
+   saveDue.tv_nsec += (OPTIONS_SAVE_DELAY_MS % 1000) * 1000000L;
+   if(saveDue.tv_nsec >= 1000000000L)
    {
-      setOptionStr("timeControl", "untimed");
+      saveDue.tv_sec++;
+      saveDue.tv_nsec -= 1000000000L;
    }
+   saveDirty = TRUE;
+   pthread_cond_signal(&saveCond);
+
+   pthread_mutex_unlock(&optionMutex);
 
+   for(i=0;i<OPTIONS_MAX_CALLBACK && optionCallback[id][i] != NULL;i++)
+      optionCallback[id][i](id, value);
+
+   return OPT_ERR_NONE;
+}
 
-   if(
-       getOptionStr("computerStrategy") == NULL ||
-       (
-         !isOptionStr("computerStrategy", "fixedDepth")  &&
-         !isOptionStr("computerStrategy", "fixedTime")   &&
-         !isOptionStr("computerStrategy", "tillButton")
-       )
-     )
+const char *getOptionValueName( optionId_t id )
+{
+   if(id >= OPT_TOTAL || optionDef[id].valueNames == NULL) return "";
+
+   return optionDef[id].valueNames[optionValue[id] - optionDef[id].min];
+}
+
+optionErr_t addOptionCallback( optionId_t id, optionCallback_t cb )
+{
+   int i;
+
+   if(id >= OPT_TOTAL) return OPT_ERR_INVALID_ID;
+
+   for(i=0;i<OPTIONS_MAX_CALLBACK;i++)
    {
-      setOptionStr("computerStrategy", "fixedDepth");
+      if(optionCallback[id][i] == cb) return OPT_ERR_NONE;
+
+      if(optionCallback[id][i] == NULL)
+      {
+         optionCallback[id][i] = cb;
+         return OPT_ERR_NONE;
+      }
    }
 
+   return OPT_ERR_NO_ROOM;
+}
+
+void flushOptions( void )
+{
+   long int snapshot[OPT_TOTAL];
+   bool_t   dirty;
+
+   pthread_mutex_lock(&optionMutex);
 
-   depth = getOptionVal("searchDepth");
-   if(
-       getOptionStr("searchDepth") == NULL ||
-       (
-         depth > MAX_PLY_DEPTH ||
-         depth < MIN_PLY_DEPTH
-       )
-     )
+   if( (dirty = saveDirty) == TRUE )
    {
-      setOptionVal("searchDepth", DEFAULT_PLY_DEPTH );
+      memcpy(snapshot, optionValue, sizeof(snapshot));
+      saveDirty = FALSE;
    }
 
-   setOptionVal("searchTimeInMs", 3000);
-   setOptionVal("timePeriod1.timeInSec", 180);
-   setOptionVal("timePeriod1.increment", 0);
-   setOptionVal("timePeriod1.moves", 0);
-   setOptionVal("timePeriod2.timeInSec", 180);
-   setOptionVal("timePeriod2.increment", 0);
-   setOptionVal("timePeriod2.moves", 0);
-   setOptionVal("timePeriod3.timeInSec", 180);
-   setOptionVal("timePeriod3.increment", 0);
-   setOptionVal("timePeriod3.moves", 0);
-   setOptionStr("chess960", "false");
-   setOptionVal("graceTimeForComputerMoveInSec", 4);
-   setOptionStr("openingBook", "true");
-   setOptionStr("coaching", "true");
-   setOptionStr("takeBack", "true");
-   setOptionVal("dropDebounceInTicks", (600 / MS_PER_TIC));
-   setOptionVal("liftDebounceInTicks", (100 / MS_PER_TIC));
-   setOptionVal("ledBrightness", 15);
-   setOptionVal("engineStrength", 20);
-   setOptionStr("ponder", "false");
-
-   disableSaveOnChange = false;
+   pthread_mutex_unlock(&optionMutex);
 
+   if(dirty)
+      writeOptionsFile(snapshot);
+}
 
-//////////
+static void setDefaults( void )
+{
+   int i;
 
-   DPRINT("Setting all options to their default values\n");
+   for(i=0;i<OPT_TOTAL;i++)
+      optionValue[i] = optionDef[i].def;
+}
 
+// Settings that aren't saved
+static void setStructDefaults( void )
+{
 //   options.game.white                                 = PLAYER_HUMAN;
 //   options.game.black                                 = PLAYER_COMPUTER;
 
@@ -148,68 +286,257 @@ static void checkOptions( void )
    options.game.graceTimeForComputerMove              = 40; // allow 4 seconds to make move for computer
    options.game.useOpeningBook                        = FALSE;
 
-   options.board.pieceDropDebounce                    = (600 / MS_PER_TIC);
-   options.board.pieceLiftDebounce                    = (100 / MS_PER_TIC);
-   options.board.LED_Brightness                       = 15;
-
 //   options.engine.strength                            = 20;
    options.engine.ponder                              = FALSE;
    options.engine.egtb                                = FALSE;
-
 }
 
-char *getOptionStr(char *opt)
+static bool_t readOptionsFile( void )
 {
-   return ht_getKey(optionsHashTable, opt);
+   uint8_t buf[OPTIONS_MAX_FILE];
+   FILE *fp;
+   int len, pos, count, i;
+
+   if( (fp = fopen(OPTIONS_FILE, "rb")) == NULL)
+      return FALSE;
+
+   len = fread(buf, 1, sizeof(buf), fp);
+   fclose(fp);
+
+   if(len < 12 || memcmp(buf, OPTIONS_MAGIC, 4))
+      return FALSE;
+
+   if( crc32(buf, len - 4) != (buf[len-4] | buf[len-3] << 8 | buf[len-2] << 16 | (uint32_t)buf[len-1] << 24) )
+   {
+      DLOG(DIAG_ERROR, "Options file is corrupt, using defaults\n");
+      return TRUE;
+   }
+
+   if( (buf[4] | buf[5] << 8) != OPTIONS_VERSION )
+   {
+      DLOG(DIAG_ERROR, "Unknown options file version %d, using defaults\n", buf[4] | buf[5] << 8);
+      return TRUE;
+   }
+
+   count = buf[6] | buf[7] << 8;
+   pos   = 8;
+
+   for(i=0; i<count && pos < len - 4; i++)
+   {
+      int      nameLen = buf[pos];
+      int      id;
+      long int value;
+
+      if(pos + 1 + nameLen + 4 > len - 4) break;
+
+      value = (int32_t)(buf[pos+1+nameLen] | buf[pos+2+nameLen] << 8 | buf[pos+3+nameLen] << 16 | (uint32_t)buf[pos+4+nameLen] << 24);
+
+      if( (id = findOption((char *)&buf[pos+1], nameLen)) >= 0 )
+      {
+         if(value >= optionDef[id].min && value <= optionDef[id].max)
+            optionValue[id] = value;
+         else
+            DLOG(DIAG_WARN, "Value %ld out of range for option %s, using default\n", value, optionDef[id].name);
+      }
+
+      pos += 1 + nameLen + 4;
+   }
+
+   return TRUE;
 }
 
-void setOptionStr(char *opt, char *val)
+// "name value" lines, as written by ht_save()
+static bool_t readLegacyFile( void )
 {
-   ht_setKey(optionsHashTable, opt, val);
+   hashtable_t *ht;
+   char *text;
+   bool_t ok;
+   int i;
+
+   if( (ht = ht_create(50)) == NULL)
+      return FALSE;
+
+   if(ht_load(ht, OPTIONS_FILE) != HT_NO_ERROR)
+   {
+      ht_destroy(ht);
+      return FALSE;
+   }
+
+   for(i=0;i<OPT_TOTAL;i++)
+   {
+      if( (text = ht_getKey(ht, (char *)optionDef[i].name)) != NULL )
+      {
+         long int value = parseValue(i, text, &ok);
 
-   if(!disableSaveOnChange)
-      ht_save(optionsHashTable, "options");
+         if(ok) optionValue[i] = value;
+      }
+   }
+
+   ht_destroy(ht);
+
+   return TRUE;
 }
 
-bool isOptionStr(char *opt, char *val)
+// Write the whole file to a temporary and rename it over the old one, so a power cut part way
+//   through leaves either the old or the new file.
+static void writeOptionsFile( long int *values )
 {
-   return(!strcmp(val, ht_getKey(optionsHashTable, opt)));
+   uint8_t buf[OPTIONS_MAX_FILE];
+   uint32_t crc;
+   int pos = 8, i, fd;
+   FILE *fp;
+
+   memcpy(buf, OPTIONS_MAGIC, 4);
+   buf[4] = OPTIONS_VERSION & 0xFF;
+   buf[5] = OPTIONS_VERSION >> 8;
+   buf[6] = OPT_TOTAL & 0xFF;
+   buf[7] = OPT_TOTAL >> 8;
+
+   for(i=0;i<OPT_TOTAL;i++)
+   {
+      int nameLen = strlen(optionDef[i].name);
+
+      buf[pos++] = nameLen;
+      memcpy(&buf[pos], optionDef[i].name, nameLen);
+      pos += nameLen;
+
+      buf[pos++] = values[i] & 0xFF;
+      buf[pos++] = (values[i] >> 8)  & 0xFF;
+      buf[pos++] = (values[i] >> 16) & 0xFF;
+      buf[pos++] = (values[i] >> 24) & 0xFF;
+   }
+
+   crc = crc32(buf, pos);
+   buf[pos++] = crc & 0xFF;
+   buf[pos++] = (crc >> 8)  & 0xFF;
+   buf[pos++] = (crc >> 16) & 0xFF;
+   buf[pos++] = (crc >> 24) & 0xFF;
+
+   pthread_mutex_lock(&fileMutex);
+
+   if( (fp = fopen(OPTIONS_TEMP_FILE, "wb")) == NULL)
+   {
+      DLOG(DIAG_ERROR, "Unable to write %s\n", OPTIONS_TEMP_FILE);
+      pthread_mutex_unlock(&fileMutex);
+      return;
+   }
+
+   if( fwrite(buf, 1, pos, fp) != pos || fflush(fp) != 0 || fsync(fileno(fp)) != 0 )
+   {
+      DLOG(DIAG_ERROR, "Error writing %s\n", OPTIONS_TEMP_FILE);
+      fclose(fp);
+      remove(OPTIONS_TEMP_FILE);
+      pthread_mutex_unlock(&fileMutex);
+      return;
+   }
+
+   fclose(fp);
+
+   if(rename(OPTIONS_TEMP_FILE, OPTIONS_FILE) != 0)
+   {
+      DLOG(DIAG_ERROR, "Unable to replace %s (%d)\n", OPTIONS_FILE, errno);
+   }
+   else if( (fd = open(".", O_RDONLY)) >= 0 )
+   {
+      // Make the rename itself stick
+      fsync(fd);
+      close(fd);
+   }
+
+   pthread_mutex_unlock(&fileMutex);
 }
 
-long int getOptionVal(char *opt)
+static long int parseValue( optionId_t id, const char *text, bool_t *ok )
 {
-   char *resultPtr;
+   long int value;
+   char *end;
+   int i;
 
-   resultPtr = ht_getKey(optionsHashTable, opt);
+   *ok = FALSE;
 
-   if(resultPtr == NULL)
+   if(optionDef[id].valueNames != NULL)
+   {
+      for(i=0; i <= optionDef[id].max - optionDef[id].min; i++)
+      {
+         if(!strcmp(text, optionDef[id].valueNames[i]))
+         {
+            *ok = TRUE;
+            return optionDef[id].min + i;
+         }
+      }
       return 0;
-   else
-      return strtol(resultPtr, NULL, 10);
+   }
+
+   value = strtol(text, &end, 10);
+
+   if(end != text && value >= optionDef[id].min && value <= optionDef[id].max)
+      *ok = TRUE;
+
+   return value;
 }
 
-void setOptionVal(char *opt, long int val)
+static int findOption( const char *name, int len )
 {
-   char str[20];
-
-   sprintf(str, "%ld", val);
+   int i;
 
-   ht_setKey(optionsHashTable, opt, str);
+   for(i=0;i<OPT_TOTAL;i++)
+   {
+      if( strlen(optionDef[i].name) == len && !strncmp(optionDef[i].name, name, len) )
+         return i;
+   }
 
-   if(!disableSaveOnChange)
-      ht_save(optionsHashTable, "options");
+   return -1;
 }
 
-bool isOptionVal(char *opt, int val)
+static uint32_t crc32( const uint8_t *buf, int len )
 {
-   char *resultPtr;
+   uint32_t crc = 0xFFFFFFFF;
+   int i, bit;
 
-   resultPtr = ht_getKey(optionsHashTable, opt);
+   for(i=0;i<len;i++)
+   {
+      crc ^= buf[i];
+
+      for(bit=0;bit<8;bit++)
+         crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+   }
 
-   if(resultPtr == NULL)
-      return false;
+   return ~crc;
+}
+
+static void debounceChanged( optionId_t id, long int value )
+{
+   if(id == OPT_DROP_DEBOUNCE)
+      options.board.pieceDropDebounce = value;
    else
-      return (val == strtol(resultPtr, NULL, 10));
+      options.board.pieceLiftDebounce = value;
 }
 
+// Writes the file once no change has been made for OPTIONS_SAVE_DELAY_MS
+static void *saveTask( void *arg )
+{
+   long int snapshot[OPT_TOTAL];
+
+   pthread_mutex_lock(&optionMutex);
+
+   while(1)
+   {
+      while(!saveDirty)
+         pthread_cond_wait(&saveCond, &optionMutex);
 
+      // Each change pushes saveDue back and signals, so just keep waiting until it comes due
+      if(pthread_cond_timedwait(&saveCond, &optionMutex, &saveDue) != ETIMEDOUT)
+         continue;
+
+      if(!saveDirty) continue;
+
+      memcpy(snapshot, optionValue, sizeof(snapshot));
+      saveDirty = FALSE;
+
+      pthread_mutex_unlock(&optionMutex);
+      writeOptionsFile(snapshot);
+      pthread_mutex_lock(&optionMutex);
+   }
+
+   return NULL;
+}
@@ -1,3 +1,6 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
 #include <stdlib.h>
 #include <stdbool.h>
 
@@ -28,9 +31,8 @@ typedef struct engineOptions_s
 
 typedef struct boardOptions_s
 {
-   uint16_t pieceDropDebounce;
-   uint16_t pieceLiftDebounce;
-   uint8_t  LED_Brightness;
+   uint16_t pieceDropDebounce;   // follow OPT_DROP_DEBOUNCE / OPT_LIFT_DEBOUNCE, but the sensor
+   uint16_t pieceLiftDebounce;   //   test overrides them while it runs
 }boardOptions_t;
 
 typedef struct options_s
@@ -42,14 +44,83 @@ typedef struct options_s
 
 extern options_t options;
 
-char *getOptionStr(char *opt);
-void setOptionStr(char *opt, char *val);
+// Saved options
+//
+// Every saved option has an id below and an entry in the table in options.c giving its name in
+//   the options file, its type and its legal range.  Values are held parsed, so getOption() is
+//   just an array load.  setOption() range checks the value, calls any callbacks registered for
+//   the option and schedules a save;  changes are written out OPTIONS_SAVE_DELAY_MS after the last
+//   one, to a temporary file that then replaces the options file.
+//
+// Enumerated options hold the matching enum value (player_t, timingType_t, computerStrategy_t, tbUse_t),
+//   the on/off options hold TRUE or FALSE.
+
+#define OPTIONS_FILE           "options"
+#define OPTIONS_SAVE_DELAY_MS  1000
+
+typedef enum optionId_e
+{
+   OPT_WHITE_PLAYER,       // player_t
+   OPT_BLACK_PLAYER,       // player_t
+   OPT_TIME_CONTROL,       // timingType_t
+   OPT_COMPUTER_STRATEGY,  // computerStrategy_t
+   OPT_SEARCH_DEPTH,
+   OPT_SEARCH_TIME_MS,
+   OPT_PERIOD1_TIME,
+   OPT_PERIOD1_INCREMENT,
+   OPT_PERIOD1_MOVES,
+   OPT_PERIOD2_TIME,
+   OPT_PERIOD2_INCREMENT,
+   OPT_PERIOD2_MOVES,
+   OPT_PERIOD3_TIME,
+   OPT_PERIOD3_INCREMENT,
+   OPT_PERIOD3_MOVES,
+   OPT_CHESS960,
+   OPT_GRACE_TIME,
+   OPT_OPENING_BOOK,
+   OPT_COACHING,
+   OPT_TAKEBACK,
+   OPT_DROP_DEBOUNCE,
+   OPT_LIFT_DEBOUNCE,
+   OPT_LED_BRIGHTNESS,
+   OPT_ENGINE_STRENGTH,    // strength profile, MAX_STRENGTH for full strength
+   OPT_ENGINE_HASH_MB,     // ENGINE_AUTO or MB
+   OPT_ENGINE_THREADS,     // ENGINE_AUTO or thread count
+   OPT_ENGINE_STANDBY,     // warm engines kept ready for the next game
+   OPT_TABLEBASES,         // tbUse_t
+   OPT_ENGINE_KNPS,        // measured engine speed, kilo-nodes/s per thread (0 until measured)
+   OPT_ENGINE_REPEATABLE,  // searches the engine can repeat move for move (see sfInterface.h)
+   OPT_PONDER,
+   OPT_EVENT_TRACE,
+   OPT_IDLE_ANALYSIS,      // engine searches while the human is to move (see idle.h)
+
+   OPT_TOTAL
+}optionId_t;
+
+typedef enum optionErr_e
+{
+   OPT_ERR_NONE,
+   OPT_ERR_INVALID_ID,
+   OPT_ERR_OUT_OF_RANGE,
+   OPT_ERR_NO_ROOM
+}optionErr_t;
+
+// Called (from the thread calling setOption) after an option's value changes
+typedef void (*optionCallback_t)( optionId_t id, long int value );
+
+// Read the options file (converting an old text format file if need be), falling back to the
+//   default for anything missing or out of range.
+void        loadOptions( void );
+
+long int    getOption( optionId_t id );
+optionErr_t setOption( optionId_t id, long int value );
 
-long int getOptionVal(char *opt);
-void setOptionVal(char *opt, long int val);
+// Name of an option's current value for enumerated and on/off options ("human", "true", ...)
+const char *getOptionValueName( optionId_t id );
 
-bool isOptionStr(char *opt, char *val);
-bool isOptionVal(char *opt, int val);
+optionErr_t addOptionCallback( optionId_t id, optionCallback_t cb );
 
-void loadOptions( void );
+// Write any pending change now
+void        flushOptions( void );
 
+#endif
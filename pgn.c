@@ -0,0 +1,289 @@
+#include "pgn.h"
+
+#include "board.h"
+#include "moves.h"
+
+#include <ctype.h>
+#include <string.h>
+
+static void skipPast( FILE *fp, int end );
+static void readTag( FILE *fp, pgnGame_t *g );
+static void readToken( FILE *fp, int c, char *tok );
+static bool_t isResult( const char *tok );
+static void copyValue( char *dst, const char *src );
+static void writeToken( pgnWriter_t *w, const char *text );
+
+void PGN_initReader( pgnReader_t *r, FILE *fp )
+{
+   r->fp        = fp;
+   r->games     = 0;
+   r->gameStart = 0;
+   r->maxPlies  = MAX_MOVES_IN_GAME - 1;
+}
+
+pgnErr_t PGN_readGame( pgnReader_t *r, pgnGame_t *g )
+{
+   char tok[PGN_TOKEN_MAX];
+   board_t b;
+   move_t mv;
+   bool_t inMoves = FALSE, any = FALSE, started = FALSE;
+   int c, depth = 0;
+
+   g->white[0] = g->black[0] = g->date[0] = g->fen[0] = '\0';
+   strcpy(g->result, "*");
+
+   g->plies     = 0;
+   g->badPly    = -1;
+   g->truncated = FALSE;
+
+   while( (c = getc(r->fp)) != EOF)
+   {
+      if(isspace(c))
+         continue;
+
+      if(!started)
+      {
+         r->gameStart = ftello(r->fp) - 1;
+         started = TRUE;
+      }
+
+      switch(c)
+      {
+         case '[':
+            // The next game's tags:  this one had no result at the end
+            if(inMoves)
+            {
+               ungetc(c, r->fp);
+               r->games++;
+               return PGN_OK;
+            }
+
+            readTag(r->fp, g);
+            any = TRUE;
+            continue;
+
+         case '{':  skipPast(r->fp, '}');   continue;
+         case ';':  skipPast(r->fp, '\n');  continue;
+         case '%':  skipPast(r->fp, '\n');  continue;
+         case ']':                          continue;
+         case '(':  depth++;                continue;
+         case ')':  if(depth) depth--;      continue;
+         case '.':                          continue;
+      }
+
+      readToken(r->fp, c, tok);
+
+      // NAGs, and anything in a variation
+      if(c == '$' || depth > 0)
+         continue;
+
+      if(!inMoves)
+      {
+         if(setBoard(&g->start, g->fen[0] ? g->fen : NULL) != FEN_OK)
+            g->badPly = 0;
+
+         b = g->start;
+         inMoves = any = TRUE;
+      }
+
+      if(isResult(tok))
+      {
+         copyValue(g->result, tok);
+         r->games++;
+         return PGN_OK;
+      }
+
+      // Move number
+      if(strspn(tok, "0123456789") == strlen(tok))
+         continue;
+
+      if(g->badPly >= 0 || g->truncated)
+         continue;
+
+      if(g->plies >= r->maxPlies)
+         g->truncated = TRUE;
+      else if(!SANtoMove(&b, tok, &mv))
+         g->badPly = g->plies;
+      else
+      {
+         g->moves[g->plies++] = mv;
+         move(&b, mv);
+      }
+   }
+
+   if(!any)
+      return PGN_END;
+
+   // Tags with no moves after them
+   if(!inMoves && setBoard(&g->start, g->fen[0] ? g->fen : NULL) != FEN_OK)
+      g->badPly = 0;
+
+   r->games++;
+
+   return PGN_OK;
+}
+
+void PGN_initWriter( pgnWriter_t *w, FILE *fp )
+{
+   w->fp    = fp;
+   w->col   = 0;
+   w->first = TRUE;
+}
+
+void PGN_writeTag( pgnWriter_t *w, const char *name, const char *value )
+{
+   fprintf(w->fp, "[%s \"", name);
+
+   for(;*value != '\0';value++)
+   {
+      if(*value == '"' || *value == '\\')
+         fputc('\\', w->fp);
+
+      fputc(*value, w->fp);
+   }
+
+   fprintf(w->fp, "\"]\n");
+}
+
+void PGN_startMoves( pgnWriter_t *w, const board_t *start )
+{
+   fprintf(w->fp, "\n");
+
+   w->brd   = *start;
+   w->col   = 0;
+   w->first = TRUE;
+}
+
+void PGN_writeMove( pgnWriter_t *w, move_t mv )
+{
+   char text[MOVE_TEXT_MAX];
+
+   if(w->brd.toMove == WHITE || w->first)
+   {
+      snprintf(text, sizeof(text), w->brd.toMove == WHITE ? "%d." : "%d...", w->brd.moveNumber);
+      writeToken(w, text);
+   }
+
+   writeToken(w, moveToSAN(mv, &w->brd));
+   move(&w->brd, mv);
+
+   w->first = FALSE;
+}
+
+void PGN_writeComment( pgnWriter_t *w, const char *text )
+{
+   char comment[PGN_LINE_LENGTH + 1];
+
+   snprintf(comment, sizeof(comment), "{%s}", text);
+   writeToken(w, comment);
+}
+
+void PGN_endGame( pgnWriter_t *w, const char *result )
+{
+   writeToken(w, result);
+   fprintf(w->fp, "\n\n");
+
+   w->col = 0;
+}
+
+// Skip to just after the end character (or the end of the file)
+static void skipPast( FILE *fp, int end )
+{
+   int c;
+
+   while( (c = getc(fp)) != EOF && c != end);
+}
+
+// The rest of a tag pair, after its '['.  Only the tags there's a place for are kept.
+static void readTag( FILE *fp, pgnGame_t *g )
+{
+   char name[PGN_TOKEN_MAX], value[PGN_TAG_MAX];
+   int c, len = 0;
+
+   while( (c = getc(fp)) != EOF && !isspace(c) && c != '"' && c != ']')
+   {
+      if(len < PGN_TOKEN_MAX - 1)
+         name[len++] = c;
+   }
+
+   name[len] = '\0';
+
+   if(c != '"')
+      while( (c = getc(fp)) != EOF && c != '"' && c != ']');
+
+   len = 0;
+
+   if(c == '"')
+   {
+      while( (c = getc(fp)) != EOF && c != '"')
+      {
+         if(c == '\\' && (c = getc(fp)) == EOF)
+            break;
+
+         if(len < PGN_TAG_MAX - 1)
+            value[len++] = c;
+      }
+   }
+
+   value[len] = '\0';
+
+   if(c != ']')
+      skipPast(fp, ']');
+
+   if(!strcmp(name, "White"))       copyValue(g->white, value);
+   else if(!strcmp(name, "Black"))  copyValue(g->black, value);
+   else if(!strcmp(name, "Date"))   copyValue(g->date, value);
+   else if(!strcmp(name, "Result")) copyValue(g->result, value);
+   else if(!strcmp(name, "FEN"))    copyValue(g->fen, value);
+}
+
+// A movetext word starting with c.  The character after it is left to be read.
+static void readToken( FILE *fp, int c, char *tok )
+{
+   int len = 0;
+
+   do
+   {
+      if(len < PGN_TOKEN_MAX - 1)
+         tok[len++] = c;
+   }
+   while( (c = getc(fp)) != EOF && !isspace(c) && strchr("[]{}();$.", c) == NULL);
+
+   if(c != EOF)
+      ungetc(c, fp);
+
+   tok[len] = '\0';
+}
+
+static bool_t isResult( const char *tok )
+{
+   return (!strcmp(tok, "1-0") || !strcmp(tok, "0-1") || !strcmp(tok, "1/2-1/2") || !strcmp(tok, "*")) ?
+          TRUE : FALSE;
+}
+
+static void copyValue( char *dst, const char *src )
+{
+   strncpy(dst, src, PGN_TAG_MAX - 1);
+   dst[PGN_TAG_MAX - 1] = '\0';
+}
+
+// Add a word of movetext, starting a new line before it would run past PGN_LINE_LENGTH
+static void writeToken( pgnWriter_t *w, const char *text )
+{
+   int len = strlen(text);
+
+   if(w->col != 0 && w->col + 1 + len > PGN_LINE_LENGTH)
+   {
+      fprintf(w->fp, "\n");
+      w->col = 0;
+   }
+
+   if(w->col != 0)
+   {
+      fputc(' ', w->fp);
+      w->col++;
+   }
+
+   fputs(text, w->fp);
+   w->col += len;
+}
@@ -0,0 +1,79 @@
+#ifndef PGN_H
+#define PGN_H
+
+// PGN reading and writing
+//
+// The reader takes the games of a PGN file one at a time, as it comes to them, so a file of any
+//   size is read in the same memory:  the game being read, with the tags piChess has a use for and
+//   the moves of its main line (up to MAX_MOVES_IN_GAME - 1 plies).  Comments, variations, NAGs,
+//   annotation marks and move numbers are skipped.  Each move is found with SANtoMove() in the
+//   game's position, so the moves that come back are legal;  a game stops at one that isn't.
+//
+// The writer lays games out as the standard's export format has them:  tags, then the moves in
+//   SAN (moveToSAN()) with their numbers, lines kept to PGN_LINE_LENGTH characters.
+
+#include "types.h"
+
+#include <stdio.h>
+#include <sys/types.h>
+
+#define PGN_TAG_MAX      100   // longest tag value kept (the rest is dropped)
+#define PGN_TOKEN_MAX    32    // longest movetext word kept
+#define PGN_LINE_LENGTH  79
+
+typedef enum pgnErr_e
+{
+   PGN_OK,
+   PGN_END        // no more games
+}pgnErr_t;
+
+typedef struct pgnGame_s
+{
+   char    white[PGN_TAG_MAX];
+   char    black[PGN_TAG_MAX];
+   char    date[PGN_TAG_MAX];     // "YYYY.MM.DD", with '?' for what isn't known
+   char    result[PGN_TAG_MAX];   // "1-0", "0-1", "1/2-1/2" or "*"
+   char    fen[PGN_TAG_MAX];      // start position, empty for the standard one
+
+   board_t start;                 // the position the moves are played from
+   int     plies;
+   move_t  moves[MAX_MOVES_IN_GAME];
+
+   int     badPly;                // ply of the first move that couldn't be played (or 0 for a
+                                  //   FEN that couldn't be set up), -1 if there wasn't one
+   bool_t  truncated;             // the game went on past the moves read (see maxPlies)
+}pgnGame_t;
+
+typedef struct pgnReader_s
+{
+   FILE     *fp;
+   uint64_t  games;               // games read so far
+   off_t     gameStart;           // file offset the last game read starts at
+   int       maxPlies;            // moves after this many are skipped (MAX_MOVES_IN_GAME - 1 unless
+                                  //   set lower after PGN_initReader(), to save finding them)
+}pgnReader_t;
+
+void     PGN_initReader( pgnReader_t *r, FILE *fp );
+
+// Read the next game.  PGN_END once there are no more.
+pgnErr_t PGN_readGame( pgnReader_t *r, pgnGame_t *g );
+
+typedef struct pgnWriter_s
+{
+   FILE    *fp;
+   int      col;                  // length of the movetext line so far
+   board_t  brd;                  // position the next move is played from
+   bool_t   first;                // no move written yet
+}pgnWriter_t;
+
+void PGN_initWriter( pgnWriter_t *w, FILE *fp );
+
+// A game is its tags, PGN_startMoves(), its moves (each maybe followed by a comment) and
+//   PGN_endGame()
+void PGN_writeTag( pgnWriter_t *w, const char *name, const char *value );
+void PGN_startMoves( pgnWriter_t *w, const board_t *start );
+void PGN_writeMove( pgnWriter_t *w, move_t mv );
+void PGN_writeComment( pgnWriter_t *w, const char *text );
+void PGN_endGame( pgnWriter_t *w, const char *result );
+
+#endif
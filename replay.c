@@ -0,0 +1,469 @@
+// Event trace replay driver (piChessReplay)
+//
+// Feeds an event trace recorded on a board (see trace.h) through a fresh copy of the state machine,
+//   using the simulated hardware backend so it runs on any Linux box:
+//
+//    piChessReplay [-r] [-e engine] trace-file
+//
+//       -r    real time:  wait out the recorded gaps between events (default is as fast as possible)
+//       -e    recompute the engine's repeatable searches (see sfInterface.h) with this engine
+//
+// Only the events that came from outside the state machine (switches, buttons, timers, engine)
+//   are fed in.  The ones the state machine posts to itself are regenerated and checked against
+//   the trace, so any divergence from the recorded session is reported.
+//
+// The replay runs in a new directory under /tmp, where the recorded options are restored.  Engine
+//   answers are taken from the trace and written to the engine result file as they are needed.
+//
+// At the end a summary is printed with the time spent in the state machine per event and the
+//   latencies seen on the board while recording:
+//
+//    move accepted   - piece set down to the player's move being accepted
+//    engine reply    - player's move accepted to the computer's reply being shown
+//    end to end      - piece set down to the computer's reply being shown
+//
+// With -e each search for a move logged in the trace is run through the engine again, in order
+//   and each from a cleared engine, after the replay.  A move that comes out different from the
+//   one the trace has is reported, and the time the searches took goes in the summary (engine
+//   search), so a change to the engine can be checked for both.
+
+#include "hsm.h"
+#include "hsmDefs.h"
+#include "event.h"
+#include "trace.h"
+#include "switch.h"
+#include "sfInterface.h"
+#include "hal.h"
+#include "diag.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+
+#define MAX_DIVERGENCE_REPORTS 10
+
+// Where the recomputed searches' answers go, and how long one may take
+#define RECOMPUTE_RESULT       "recompute.txt"
+#define RECOMPUTE_TIMEOUT_SEC  600
+
+typedef struct replayStat_s
+{
+   char     *name;
+   uint64_t *vals;
+   int       count;
+   int       size;
+}replayStat_t;
+
+static traceRecord_t *recs;
+static int            recCount;
+static int            internalCursor = 0;
+static int            divergences = 0;
+
+static replayStat_t   hsmTime     = { "state machine" };
+static replayStat_t   accepted    = { "move accepted" };
+static replayStat_t   reply       = { "engine reply"  };
+static replayStat_t   endToEnd    = { "end to end"    };
+static replayStat_t   search      = { "engine search" };
+
+static uint64_t       pieceTime   = 0;
+static uint64_t       acceptTime  = 0;
+static uint64_t       acceptPiece = 0;
+static bool_t         replyPending = FALSE;
+
+static int  restoreOptions( void );
+static int  recomputeSearches( const char *engine );
+static bool_t searchMove( const char *line, char move[8] );
+static void prepareEngineResult( int i );
+static void dispatch( HSM_Handle_t *sm, event_t ev );
+static void drainInternal( HSM_Handle_t *sm );
+static void checkInternal( HSM_Handle_t *sm, event_t ev );
+static void statAdd( replayStat_t *s, uint64_t val );
+static void statPrint( replayStat_t *s );
+static int  compareU64( const void *a, const void *b );
+
+static uint16_t replayInit( event_t ev )
+{
+   return ST_SPLASH_SCREEN;
+}
+
+static void replayExit( event_t ev )
+{
+}
+
+int main( int argc, char *argv[] )
+{
+   HSM_Error_t err;
+   HSM_Handle_t sm;
+   traceErr_t terr;
+   bool_t realTime = FALSE;
+   char engine[PATH_MAX] = "";
+   uint64_t startTime, t;
+   int opt, i, fed = 0, moveChanges = 0;
+
+   while( (opt = getopt(argc, argv, "re:")) != -1)
+   {
+      if(opt == 'r')
+         realTime = TRUE;
+      else if(opt == 'e')
+      {
+         // The replay runs in a directory of its own
+         if(realpath(optarg, engine) == NULL)
+         {
+            fprintf(stderr, "Unable to find engine %s\n", optarg);
+            exit(-1);
+         }
+      }
+      else
+      {
+         fprintf(stderr, "usage: %s [-r] [-e engine] trace-file\n", argv[0]);
+         exit(-1);
+      }
+   }
+
+   if(optind >= argc)
+   {
+      fprintf(stderr, "usage: %s [-r] [-e engine] trace-file\n", argv[0]);
+      exit(-1);
+   }
+
+   if( (terr = TRACE_load(argv[optind], &recs, &recCount)) != TRACE_ERR_NONE)
+   {
+      fprintf(stderr, "Unable to load %s (error %d)\n", argv[optind], terr);
+      exit(-1);
+   }
+
+   if(restoreOptions() != 0)
+      exit(-1);
+
+   TRACE_setReplay(recs, recCount);
+
+   if ( (err = HSM_createHSM(myStateDef, myTransDef, ST_COUNT, transDefCount, replayInit, replayExit,  &sm ) ) != HSM_NO_ERROR)
+   {
+      fprintf(stderr, "HSM_createHSM() failed with return value of %d\n", err);
+      exit(-1);
+   }
+
+   if ( (err = HSM_init(&sm) ) != HSM_NO_ERROR)
+   {
+      fprintf(stderr, "HSM_init() failed with return value of %d\n", err);
+      exit(-1);
+   }
+
+   drainInternal(&sm);
+
+   startTime = HAL_timeMicros();
+
+   for(i=0;i<recCount;i++)
+   {
+      if(recs[i].type != TRACE_REC_EVENT || recs[i].internal) continue;
+
+      // The timer tic signal cuts sleeps short, so keep at it until the event is due
+      while(realTime && (t = HAL_timeMicros() - startTime) < recs[i].time)
+         usleep(recs[i].time - t);
+
+      // Whatever the handlers read back from the switches or the engine must match the trace
+      if(recs[i].ev.ev == EV_PIECE_DROP)
+      {
+         SW_injectChange(recs[i].ev.data, FALSE);
+         pieceTime = recs[i].time;
+      }
+      else if(recs[i].ev.ev == EV_PIECE_LIFT)
+      {
+         SW_injectChange(recs[i].ev.data, TRUE);
+      }
+      else if(recs[i].ev.ev == EV_PROCESS_COMPUTER_MOVE)
+      {
+         prepareEngineResult(i);
+      }
+
+      t = HAL_timeMicros();
+
+      dispatch(&sm, recs[i].ev);
+      drainInternal(&sm);
+
+      statAdd(&hsmTime, HAL_timeMicros() - t);
+      fed++;
+   }
+
+   // Anything recorded that never came back?
+   for(;internalCursor < recCount; internalCursor++)
+   {
+      if(recs[internalCursor].type == TRACE_REC_EVENT && recs[internalCursor].internal)
+         divergences++;
+   }
+
+   DIAG_flush();
+
+   if(engine[0] != '\0')
+      moveChanges = recomputeSearches(engine);
+
+   printf("\n");
+   printf("Replayed %d events from %s in %.3f s\n", fed, argv[optind], (HAL_timeMicros() - startTime) / 1000000.0);
+   printf("Recorded session length %.3f s\n", recCount ? recs[recCount-1].time / 1000000.0 : 0.0);
+   printf("Divergences from recorded session: %d\n", divergences);
+
+   if(engine[0] != '\0')
+      printf("Engine searches recomputed: %d, moves changed: %d\n", search.count, moveChanges);
+
+   printf("\n%-15s %8s %10s %10s %10s %10s   (us)\n", "", "count", "mean", "p50", "p95", "max");
+   statPrint(&hsmTime);
+   statPrint(&accepted);
+   statPrint(&reply);
+   statPrint(&endToEnd);
+
+   if(engine[0] != '\0')
+      statPrint(&search);
+
+   TRACE_free(recs, recCount);
+
+   return (divergences == 0 && moveChanges == 0 ? 0 : 1);
+}
+
+// Set up a scratch directory holding the options the session was recorded with
+static int restoreOptions( void )
+{
+   char dir[] = "/tmp/piChessReplay.XXXXXX";
+   FILE *fp;
+   int i;
+
+   if(mkdtemp(dir) == NULL || chdir(dir) != 0)
+   {
+      fprintf(stderr, "Unable to create replay directory\n");
+      return -1;
+   }
+
+   printf("Replaying in %s\n", dir);
+
+   for(i=0;i<recCount;i++)
+   {
+      if(recs[i].type == TRACE_REC_OPTIONS)
+      {
+         if( (fp = fopen("options", "w")) == NULL)
+         {
+            fprintf(stderr, "Unable to write options file\n");
+            return -1;
+         }
+
+         fwrite(recs[i].payload, 1, recs[i].len, fp);
+         fclose(fp);
+         break;
+      }
+   }
+
+   return 0;
+}
+
+// Run the searches logged in the trace (TRACE_REC_SEARCH) through the engine again, and compare
+//   each move with the engine line logged after it.  Returns the number of moves that changed.
+static int recomputeSearches( const char *engine )
+{
+   char cmd[PATH_MAX + 32];
+   char line[100], was[8], now[8];
+   FILE *pipe, *fp;
+   uint64_t t;
+   int i, j, changed = 0;
+
+   // Its output isn't needed, only the result file
+   snprintf(cmd, sizeof(cmd), "%s > /dev/null", engine);
+
+   if( (pipe = popen(cmd, "w")) == NULL)
+   {
+      fprintf(stderr, "Unable to start engine %s\n", engine);
+      return 0;
+   }
+
+   setbuf(pipe, NULL);
+   fprintf(pipe, "setoption name Threads value 1\nsetoption name ResultFile value %s\n", RECOMPUTE_RESULT);
+
+   for(i=0;i<recCount;i++)
+   {
+      if(recs[i].type != TRACE_REC_SEARCH) continue;
+
+      // What the board's engine answered
+      for(j=i+1;j<recCount && recs[j].type != TRACE_REC_ENGINE && recs[j].type != TRACE_REC_SEARCH;j++);
+
+      if(j == recCount || recs[j].type != TRACE_REC_ENGINE || !searchMove(recs[j].payload, was))
+         continue;
+
+      remove(RECOMPUTE_RESULT);
+      t = HAL_timeMicros();
+
+      fputs(recs[i].payload, pipe);
+
+      // The engine writes the file under another name and renames it, so it's whole once it's there
+      while(access(RECOMPUTE_RESULT, R_OK) != 0 && HAL_timeMicros() - t < RECOMPUTE_TIMEOUT_SEC * 1000000ULL)
+         usleep(1000);
+
+      statAdd(&search, HAL_timeMicros() - t);
+
+      line[0] = '\0';
+      if( (fp = fopen(RECOMPUTE_RESULT, "r")) != NULL)
+      {
+         if(fgets(line, sizeof(line), fp) == NULL)
+            line[0] = '\0';
+         fclose(fp);
+      }
+
+      if(!searchMove(line, now))
+         strcpy(now, "nothing");
+
+      if(strcmp(was, now) && changed++ < MAX_DIVERGENCE_REPORTS)
+         printf("Engine move changed at %.3f s:  trace has %s, engine now plays %s\n",
+                recs[i].time / 1000000.0, was, now);
+   }
+
+   fprintf(pipe, "quit\n");
+   pclose(pipe);
+
+   return changed;
+}
+
+// The move out of a "bestmove" line.  FALSE if it isn't one.
+static bool_t searchMove( const char *line, char move[8] )
+{
+   if(strncmp(line, "bestmove ", 9) || sscanf(&line[9], "%7s", move) != 1)
+      return FALSE;
+
+   return TRUE;
+}
+
+// The engine line logged after this event (and before the next request for one) is what the
+//   engine answered.  Put it where the state machine will look for it.
+static void prepareEngineResult( int i )
+{
+   FILE *fp;
+
+   for(i++;i<recCount;i++)
+   {
+      if(recs[i].type == TRACE_REC_ENGINE)
+      {
+         if( (fp = fopen(OUTPUT_FILE, "w")) != NULL)
+         {
+            fprintf(fp, "%s", recs[i].payload);
+            fclose(fp);
+         }
+         return;
+      }
+
+      if(recs[i].type == TRACE_REC_EVENT && !recs[i].internal && recs[i].ev.ev == EV_PROCESS_COMPUTER_MOVE)
+         return;
+   }
+}
+
+static void dispatch( HSM_Handle_t *sm, event_t ev )
+{
+   HSM_Error_t err;
+
+   if( (err = HSM_processEvent(sm, ev)) != HSM_NO_ERROR && err != HSM_NO_EV_HANDLER_FOUND)
+      printf("Error: HSM_ProcessEvent() returned error %d while processing event %d in state %d\n", err, ev.ev, sm->currentState);
+}
+
+// Process everything the state machine posted to itself
+static void drainInternal( HSM_Handle_t *sm )
+{
+   event_t *evPtr;
+   event_t ev;
+
+   while( (evPtr = getEvent(EVQ_EVENT_MANAGER)) != NULL)
+   {
+      memcpy(&ev, evPtr, sizeof(event_t));
+
+      checkInternal(sm, ev);
+      dispatch(sm, ev);
+   }
+}
+
+// Compare a regenerated event with the next one in the trace, and pick up latencies on the way.
+//   Only the event ids are compared;  several states post events without filling in the data.
+static void checkInternal( HSM_Handle_t *sm, event_t ev )
+{
+   traceRecord_t *r = NULL;
+
+   while(internalCursor < recCount)
+   {
+      if(recs[internalCursor].type == TRACE_REC_EVENT && recs[internalCursor].internal)
+      {
+         r = &recs[internalCursor++];
+         break;
+      }
+      internalCursor++;
+   }
+
+   if(r == NULL || r->ev.ev != ev.ev)
+   {
+      if(divergences++ < MAX_DIVERGENCE_REPORTS)
+      {
+         if(r == NULL)
+            printf("Divergence: state machine posted event %d, trace has no more\n", ev.ev);
+         else
+            printf("Divergence at %.3f s: state machine posted event %d, trace has %d\n",
+                   r->time / 1000000.0, ev.ev, r->ev.ev);
+      }
+      return;
+   }
+
+   if(ev.ev != EV_GOTO_PLAYING_GAME) return;
+
+   if(sm->currentState == ST_PLAYER_MOVE)
+   {
+      statAdd(&accepted, r->time - pieceTime);
+      acceptTime   = r->time;
+      acceptPiece  = pieceTime;
+      replyPending = TRUE;
+   }
+   else if(sm->currentState == ST_COMPUTER_MOVE && replyPending)
+   {
+      statAdd(&reply, r->time - acceptTime);
+      statAdd(&endToEnd, r->time - acceptPiece);
+      replyPending = FALSE;
+   }
+}
+
+static void statAdd( replayStat_t *s, uint64_t val )
+{
+   if(s->count == s->size)
+   {
+      uint64_t *bigger;
+
+      s->size = (s->size == 0 ? 256 : s->size * 2);
+
+      if( (bigger = realloc(s->vals, s->size * sizeof(uint64_t))) == NULL) return;
+
+      s->vals = bigger;
+   }
+
+   s->vals[s->count++] = val;
+}
+
+static void statPrint( replayStat_t *s )
+{
+   uint64_t sum = 0;
+   int i;
+
+   if(s->count == 0)
+   {
+      printf("%-15s %8d\n", s->name, 0);
+      return;
+   }
+
+   qsort(s->vals, s->count, sizeof(uint64_t), compareU64);
+
+   for(i=0;i<s->count;i++)
+      sum += s->vals[i];
+
+   printf("%-15s %8d %10llu %10llu %10llu %10llu\n", s->name, s->count,
+          (unsigned long long)(sum / s->count),
+          (unsigned long long)s->vals[s->count / 2],
+          (unsigned long long)s->vals[(s->count * 95) / 100],
+          (unsigned long long)s->vals[s->count - 1]);
+}
+
+static int compareU64( const void *a, const void *b )
+{
+   uint64_t x = *(const uint64_t *)a;
+   uint64_t y = *(const uint64_t *)b;
+
+   return (x > y) - (x < y);
+}
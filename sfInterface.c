@@ -1,6 +1,9 @@
+#define _GNU_SOURCE      // SCHED_IDLE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
 
 #include "types.h"
 #include "diag.h"
@@ -10,79 +13,546 @@
 #include "st_computerMove.h"
 #include "hsmDefs.h"
 #include "event.h"
+#include "trace.h"
+#include "board.h"
+#include "thermal.h"
 
 #include <pthread.h>
 
-#include <stropts.h>
 #include <poll.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sched.h>
+#include <dirent.h>
+
+
+#define SF_EXE      CHESS_DIR "/stockfish"
+
+// Where the engines' own output goes
+// #define SF_OUTPUT   CHESS_DIR "/sfOutput.txt"
+#define SF_OUTPUT   "/dev/null"
 
+// An engine that dies within this many seconds of starting, this many times running, is given up on
+#define ENGINE_MIN_LIFE_SEC  10
+#define ENGINE_MAX_FAILURES   3
 
-// #define SF_EXE      "/home/pi/chess/stockfish > sfOutput.txt"
-#define SF_EXE      "/home/pi/chess/stockfish > /dev/null"
+// How often (in 50ms polls) the engines are checked on
+#define ENGINE_CHECK_POLLS   20
+
+// Thermal scheduling
+//
+// The board is closed and fanless, so under a long search the Pi gets hot and lowers its clock,
+//   and a move gets fewer nodes than the same time would give when cool.  Every THERMAL_CHECK_POLLS
+//   the CPU temperature and clock are read (thermal.h).  From THERMAL_HOT_MC up a search thread is
+//   dropped, one at a time and at most every THERMAL_STEP_SEC so the temperature has time to
+//   answer;  they're given back one at a time below THERMAL_COOL_MC at full clock.  Changes take
+//   effect with the next search.
+//
+// While throttled or short of threads, a search for a move in a timed game is told it has more
+//   time than the clock shows, by the engine's measured speed over its recent speed (up to
+//   THERMAL_MAX_STRETCH_PCT), so it still searches about as many nodes.  The time is lent only
+//   with THERMAL_STRETCH_MIN_MS or more left;  it comes back out of later moves, which are given
+//   what is really left on the clock.
+
+#define THERMAL_CHECK_POLLS        20
+#define THERMAL_HOT_MC          75000
+#define THERMAL_COOL_MC         68000
+#define THERMAL_STEP_SEC           30
+#define THERMAL_MAX_STRETCH_PCT   150
+#define THERMAL_STRETCH_MIN_MS  30000
 
-FILE *sfPipe = NULL;
 struct pollfd fds[1];
 
+typedef enum sfEngineState_e
+{
+   ENGINE_FREE,      // slot not in use
+   ENGINE_STANDBY,   // running and warm, waiting for a game
+   ENGINE_ACTIVE     // playing the current game
+}sfEngineState_t;
+
+typedef struct sfEngine_s
+{
+   sfEngineState_t state;
+   pid_t       pid;
+   FILE       *pipe;
+   int         hashMB;            // what the engine was started with
+   int         threads;
+   int         runThreads;        // threads it's searching with now (thermal scheduling)
+   time_t      started;
+   int         failures;          // quick deaths in a row
+
+   ShmSegment *channel;
+   uint32_t    channelRead;
+
+   int         hintLines;         // MultiPV it has from SF_findHints(), 0 if none
+   int         nodesTime;         // nodestime it has been given (repeatable searches), 0 for none
+   bool_t      background;        // threads at SCHED_IDLE (SF_setBackground())
+   char       *lastPosition;      // last position sent, to restart a failed engine with
+   char        lastGo[80];        // and the search it's on ("" once stopped or answered)
+
+   char        resultFile[100];
+   char        channelName[40];
+   char        tbPath[100];       // SyzygyPath it has been given ("" for none yet)
+}sfEngine_t;
+
+// Node and depth caps grow together, each level searching 1.5 to 2 times the nodes of the last.
+//   No rating is claimed for them (they haven't been played against rated opponents):  the menu
+//   shows the node cap.
+static const strengthProfile_t strengthProfile[MAX_STRENGTH + 1] =
+{
+   // depth    nodes
+   {   1,       50 },
+   {   2,      100 },
+   {   2,      200 },
+   {   3,      400 },
+   {   4,      800 },
+   {   5,     1500 },
+   {   6,     2500 },
+   {   7,     4000 },
+   {   8,     6000 },
+   {   9,    10000 },
+   {  10,    16000 },
+   {  11,    25000 },
+   {  12,    40000 },
+   {  13,    65000 },
+   {  14,   100000 },
+   {  16,   160000 },
+   {  18,   250000 },
+   {  20,   400000 },
+   {  22,   650000 },
+   {   0,  1000000 },
+   {   0,        0 },    // MAX_STRENGTH:  no limits
+};
+
+static sfEngine_t  engines[SF_MAX_ENGINES];
+static sfEngine_t *active = NULL;
+
+// Guards the engines:  the poll task restarts failed ones while the state machine uses them
+static pthread_mutex_t poolMutex;
+static pthread_once_t  poolOnce = PTHREAD_ONCE_INIT;
+
 static pthread_t enginePollThread;
+static bool_t    enginePollRunning = FALSE;
+
+static long      freeMemoryMB = -1;
+static char      hashFile[100] = HASH_FILE;
+
+static bool_t    cpuThrottled   = FALSE;   // hot, or the clock lowered
+static int       threadLimit    = 0;       // threads the thermal scheduler allows, 0 for no limit
+static time_t    threadStepTime = 0;
+static long      recentNps      = 0;       // speed of the last search long enough to tell
+
+static char     *searchPosition = NULL;    // last game set, as a UCI position command (recordSearch())
 
+static void  poolInit( void );
+static void  poolStart( void );
+static void  lockPool( void );
+static void  unlockPool( void );
+static void  fillPool( sfEngine_t *keep );
+static sfEngine_t *startEngine( int hashMB, int threads, sfEngineState_t state );
+static bool_t launchEngine( sfEngine_t *e );
+static void  quitEngine( sfEngine_t *e );
+static void  checkEngines( void );
+static void  engineSend( sfEngine_t *e, const char *fmt, ... );
 static void *enginePollTask ( void *arg );
+static void *engineCloseTask ( void *arg );
+static long  availableMemoryMB( void );
+static bool_t openChannel( sfEngine_t *e );
+static void  moveSearchOptions( void );
+static void  recordSearch( void );
+static char *positionCommand( const game_t *g );
+static char *allocPrintf( const char *fmt, ... );
+static void  strengthLimits( char *text, int size, int depth, uint32_t budgetMs );
+static void  measureSpeed( sfEngine_t *e );
+static bool_t readRecord( ShmSegment *channel, uint32_t n, ShmRecord *r );
+static void  setEnginePolicy( pid_t pid, int policy );
+static void  coordText( char *text, move_t m );
+static void  checkThermal( void );
+static void  scheduleThreads( void );
+static int   timeStretchPct( uint32_t ownTimeMs );
+static void  tablebaseOptions( sfEngine_t *e );
 
 void SF_initEngine( void )
 {
+   sfEngine_t *e = NULL;
+   int hashMB, threads, i;
 
-   char skillLevelText[3];
+   // When replaying an event trace the engine's answers come from the trace
+   if(TRACE_isReplaying())
+   {
+      DPRINT("Replaying event trace, engine not started\n");
+      return;
+   }
 
-   remove(OUTPUT_FILE);
+   poolStart();
 
-   // Spin up a task here...
-   pthread_create(&enginePollThread, NULL, enginePollTask , NULL);
+   lockPool();
 
-   // Start Stockfish
-   sfPipe = popen(SF_EXE, "w");
+   hashMB  = SF_hashSizeMB();
+   threads = SF_threadCount();
 
-   // Verify pipe was successfull.
-   if(sfPipe == NULL)
+   // A warm engine started with the right hash size and threads, if there is one
+   for(i=0;i<SF_MAX_ENGINES && e == NULL;i++)
    {
-      DPRINT("Failed to open pipe for stockfish engine\n");
+      if(engines[i].state == ENGINE_STANDBY && engines[i].hashMB == hashMB && engines[i].threads == threads)
+         e = &engines[i];
+   }
 
-      return;
+   if(e != NULL)
+   {
+      DPRINT("Handing the game to warm engine %d\n", (int)(e - engines));
+      e->state = ENGINE_ACTIVE;
+   }
+   else
+   {
+      DPRINT("No warm engine for this game, starting one\n");
+      e = startEngine(hashMB, threads, ENGINE_ACTIVE);
    }
 
-   // Remove buffering so sprintf will send commands immediately.
-   setbuf(sfPipe, NULL);
+   if(e != NULL)
+   {
+      remove(e->resultFile);
+      active = e;
 
-   // Set up our default parameters to Stockfish
-   SF_setOption("Threads", "4");
+      // In case OPT_TABLEBASES has changed since it was started
+      tablebaseOptions(e);
+   }
+   else
+   {
+      DLOG(DIAG_ERROR, "Unable to start an engine for the game\n");
+   }
+
+   // And a replacement standby, starting up while the game gets going
+   fillPool(NULL);
 
-   sprintf(skillLevelText, "%ld", getOptionVal("engineStrength"));
-   SF_setOption("Skill Level", skillLevelText);
+   unlockPool();
 }
 
 void SF_closeEngine( void )
 {
-   pthread_cancel(enginePollThread);
-   if(sfPipe != NULL)
+   if(active == NULL)
+      return;
+
+   lockPool();
+
+   // Keep it for the next game, saving what it has learned in case the power goes before then
+   engineSend(active, "stop\n");
+   engineSend(active, "setoption name Save Hash\n");
+
+   DPRINT("Engine %d back to standby\n", (int)(active - engines));
+   active->state = ENGINE_STANDBY;
+
+   // It knows most about the games being played, so it's the last to go if there are too many
+   fillPool(active);
+   active = NULL;
+
+   unlockPool();
+}
+
+void SF_refreshPool( void )
+{
+   if(TRACE_isReplaying())
+      return;
+
+   poolStart();
+
+   lockPool();
+   fillPool(NULL);
+   unlockPool();
+}
+
+const char *SF_resultFile( void )
+{
+   pthread_once(&poolOnce, poolInit);
+
+   return active != NULL ? active->resultFile : engines[0].resultFile;
+}
+
+void SF_setHashFile( const char *file )
+{
+   lockPool();
+   snprintf(hashFile, sizeof(hashFile), "%s", file);
+   unlockPool();
+}
+
+void SF_clearHash( void )
+{
+   if(active == NULL)
    {
-      fprintf(sfPipe, "quit\n");
-      pclose(sfPipe);
-      sfPipe = NULL;
+      DPRINT("SF_clearHash called with no engine running\n");
+      return;
+   }
 
+   engineSend(active, "setoption name Clear Hash\n");
+}
+
+int SF_hashSizeMB( void )
+{
+   long mb = getOption(OPT_ENGINE_HASH_MB);
+
+   if(mb == ENGINE_AUTO)
+   {
+      long avail;
+
+      // Measured once:  later on the engines already running have some of it
+      if(freeMemoryMB < 0)
+         freeMemoryMB = availableMemoryMB();
+
+      // A quarter of it, shared by the engine playing and those on standby
+      avail = freeMemoryMB / 4 / (1 + getOption(OPT_ENGINE_STANDBY));
+
+      // The engine only uses a power of two worth of its table, so don't ask for more
+      for(mb = MIN_AUTO_HASH_MB; mb * 2 <= avail && mb * 2 <= MAX_HASH_MB; mb *= 2);
+   }
+
+   return mb;
+}
+
+int SF_threadCount( void )
+{
+   long threads = getOption(OPT_ENGINE_THREADS);
+
+   // Threads racing each other through the hash table search differently every time
+   if(getOption(OPT_ENGINE_REPEATABLE))
+      return 1;
+
+   if(threads == ENGINE_AUTO)
+      threads = SF_coreCount();
+
+   return threads;
+}
+
+int SF_coreCount( void )
+{
+   long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+   if(cores < 1)           cores = 1;
+   if(cores > MAX_THREADS) cores = MAX_THREADS;
+
+   return cores;
+}
+
+const strengthProfile_t *SF_strengthProfile( int level )
+{
+   if(level < MIN_STRENGTH) level = MIN_STRENGTH;
+   if(level > MAX_STRENGTH) level = MAX_STRENGTH;
+
+   return &strengthProfile[level];
+}
+
+long SF_engineNps( void )
+{
+   long knps = getOption(OPT_ENGINE_KNPS);
+
+   if(getOption(OPT_ENGINE_REPEATABLE))
+      return REPEATABLE_NODES_PER_MS * 1000L;
+
+   if(knps == 0)
+      knps = DEFAULT_KNPS_PER_THREAD;
+
+   return knps * 1000 * SF_threadCount();
+}
+
+bool_t SF_channelAttached( void )
+{
+   return (active != NULL && active->channel != NULL && active->pipe != NULL &&
+           __atomic_load_n(&active->channel->attached, __ATOMIC_ACQUIRE)) ? TRUE : FALSE;
+}
+
+bool_t SF_setBoard( const board_t *start, const posHistory_t *history, int count )
+{
+   ShmPosition *p;
+   int i;
+
+   if(!SF_channelAttached() || count > SHM_MAX_POS_MOVES)
+      return FALSE;
+
+   p = &active->channel->position;
+
+   // The engine only reads this when told to by the "position shm" below
+   memcpy(p->colors, start->colors, sizeof(p->colors));
+   memcpy(p->pieces, start->pieces, sizeof(p->pieces));
+   p->moveNumber   = start->moveNumber;
+   p->halfMoves    = start->halfMoves;
+   p->toMove       = start->toMove;
+   p->castleBits   = start->castleBits;
+   p->enPassantCol = start->enPassantCol;
+   p->chess960     = 0;
+   p->moveCount    = count;
+
+   for(i=0;i<count;i++)
+   {
+      p->moves[i] = SF_packMove(history[i].move);
    }
+
+   DPRINT("Setting board through shared memory (%d moves)\n", count);
+   engineSend(active, "position shm\n");
+
+   return TRUE;
+}
+
+void SF_setGame( const game_t *g )
+{
+   board_t start = g->brd;
+   int i;
+
+   free(searchPosition);
+   searchPosition = positionCommand(g);
+
+   if(SF_channelAttached())
+   {
+      for(i=g->playedMoves-1;i>=0;i--)
+         unmove(&start, g->posHistory[i].revMove);
+
+      if(SF_setBoard(&start, g->posHistory, g->playedMoves))
+         return;
+   }
+
+   SF_setPosition(g->startPos, (char *)g->moveRecord.text);
+}
+
+int SF_readUpdates( ShmRecord *recs, int max )
+{
+   ShmSegment *channel;
+   uint32_t written;
+   int n = 0;
+
+   if(active == NULL || (channel = active->channel) == NULL) return 0;
+
+   written = __atomic_load_n(&channel->written, __ATOMIC_ACQUIRE);
+
+   // Lapped by the engine:  skip to the oldest record still there
+   if(written - active->channelRead > SHM_RING_SIZE)
+      active->channelRead = written - SHM_RING_SIZE;
+
+   while(active->channelRead != written && n < max)
+   {
+      ShmRecord *r = &channel->ring[active->channelRead % SHM_RING_SIZE];
+      uint32_t before = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+
+      memcpy(&recs[n], r, sizeof(ShmRecord));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+      if(before == active->channelRead + 1 && __atomic_load_n(&r->seq, __ATOMIC_RELAXED) == before)
+         n++;
+
+      active->channelRead++;
+   }
+
+   return n;
+}
+
+move_t SF_unpackMove( uint16_t packed )
+{
+   move_t m;
+
+   m.from    = packed & 0x3F;
+   m.to      = (packed >> 6) & 0x3F;
+   m.promote = (packed >> 12) ? (packed >> 12) & 0x07 : PIECE_NONE;
+
+   return m;
+}
+
+uint16_t SF_packMove( move_t m )
+{
+   return m.from | m.to << 6 | ((m.promote >= KNIGHT && m.promote <= QUEEN) ? m.promote << 12 : 0);
+}
+
+bool_t SF_lastSearch( searchSummary_t *s )
+{
+   ShmSegment *channel;
+   ShmRecord r;
+   uint32_t written, n, searchId;
+   bool_t found = FALSE;
+
+   memset(s, 0x00, sizeof(*s));
+
+   lockPool();
+
+   if(active != NULL && (channel = active->channel) != NULL &&
+      __atomic_load_n(&channel->attached, __ATOMIC_ACQUIRE) &&
+      (written = __atomic_load_n(&channel->written, __ATOMIC_ACQUIRE)) > 0 &&
+      readRecord(channel, written - 1, &r) && r.type == SHM_REC_BESTMOVE && r.pvLength > 0)
+   {
+      s->best      = SF_unpackMove(r.pv[0]);
+      s->hasPonder = (r.pvLength > 1) ? TRUE : FALSE;
+      s->ponder    = SF_unpackMove(s->hasPonder ? r.pv[1] : 0);
+      s->nodes     = r.nodes;
+      searchId     = r.searchId;
+
+      // Back through the search's progress to its last line
+      for(n=written-1;n>0 && written - n < SHM_RING_SIZE && readRecord(channel, n - 1, &r) &&
+          r.searchId == searchId;n--)
+      {
+         if(r.type == SHM_REC_PV && r.multiPV == 1)
+         {
+            s->depth = r.depth;
+            s->score = r.score;
+            s->mate  = (r.scoreType == SHM_SCORE_MATE) ? TRUE : FALSE;
+            found = TRUE;
+            break;
+         }
+      }
+   }
+
+   unlockPool();
+
+   return found;
+}
+
+void SF_postResult( move_t best, move_t ponder )
+{
+   char bestText[8], ponderText[8], temp[110];
+   FILE *fp;
+
+   coordText(bestText, best);
+   coordText(ponderText, ponder);
+
+   lockPool();
+
+   if(active != NULL)
+   {
+      // Whole, before the poll task can see it
+      snprintf(temp, sizeof(temp), "%s.tmp", active->resultFile);
+
+      if( (fp = fopen(temp, "w")) != NULL)
+      {
+         if(ponder.from != ponder.to)
+            fprintf(fp, "bestmove %s ponder %s", bestText, ponderText);
+         else
+            fprintf(fp, "bestmove %s", bestText);
+
+         if(ferror(fp) | fclose(fp) || rename(temp, active->resultFile) != 0)
+            DLOG(DIAG_ERROR, "Unable to write %s\n", active->resultFile);
+      }
+   }
+
+   unlockPool();
 }
 
 void SF_setOption( char *name, char *value)
 {
-   fprintf(sfPipe,"setoption name %s value %s\n", name, value);
+   if(active == NULL)
+   {
+      DPRINT("SF_setOption called with no engine running\n");
+      return;
+   }
+
+   engineSend(active, "setoption name %s value %s\n", name, value);
 }
 
 void SF_setPosition( char *fen, char *moveList)
 {
-   // Verify pipe first
-   if(sfPipe == NULL)
+   // Verify engine first
+   if(active == NULL)
    {
-      DPRINT("setPosition called with uninitialized stockfish pipe\n");
+      DPRINT("setPosition called with no engine running\n");
    }
 
    // Is this the start position?
@@ -93,12 +563,12 @@ void SF_setPosition( char *fen, char *moveList)
       // Should the engine apply a move list?
       if(moveList == NULL)
       {
-         fprintf(sfPipe,"position startpos\n");
+         engineSend(active, "position startpos\n");
       }
       else
       {
          DPRINT("Setting move list to %s\n", moveList);
-         fprintf(sfPipe,"position startpos moves %s\n", moveList);
+         engineSend(active, "position startpos moves %s\n", moveList);
       }
    }
    // Not starting position...
@@ -109,74 +579,156 @@ void SF_setPosition( char *fen, char *moveList)
       // Should the engine apply a move list?
       if(moveList == NULL)
       {
-         fprintf(sfPipe,"position fen %s\n", fen);
+         engineSend(active, "position fen %s\n", fen);
       }
       else
       {
          DPRINT("Setting move list to %s\n", moveList);
-         fprintf(sfPipe,"position fen %s moves %s\n", fen, moveList);
+         engineSend(active, "position fen %s moves %s\n", fen, moveList);
       }
       // TODO grab results.
    }
 }
 
-void SF_findMove( uint32_t wt, uint32_t bt, uint32_t wi, uint32_t bi)
+void SF_findMove( uint32_t wt, uint32_t bt, uint32_t wi, uint32_t bi, color_t toMove )
 {
+   char limits[40];
+   int stretch;
 
-   if(sfPipe == NULL)
+   if(active == NULL)
    {
-      DPRINT("SF_findMove called with uninitialized stockfish pipe\n");
+      DPRINT("SF_findMove called with no engine running\n");
       return;
    }
 
+   moveSearchOptions();
+
+   // A capped level gets no more nodes than its share of the time left allows
+   if(toMove == WHITE)
+      strengthLimits(limits, sizeof(limits), 0, wt / NPS_BUDGET_MOVES + wi);
+   else
+      strengthLimits(limits, sizeof(limits), 0, bt / NPS_BUDGET_MOVES + bi);
+
    DPRINT("Computer beginning time-budgeted search\n");
 
-   fprintf(sfPipe, "go wtime %d btime %d winc %d binc%d\n", wt, bt, wi, bi );
+   // With limits the engine doesn't manage its time, it just searches them
+   if(limits[0] != '\0')
+   {
+      engineSend(active, "go%s\n", limits);
+      recordSearch();
+      return;
+   }
+
+   if( (stretch = timeStretchPct(toMove == WHITE ? wt : bt)) != 100)
+   {
+      DPRINT("Engine running slow, giving it %d%% of its time\n", stretch);
+
+      wt = (uint64_t)wt * stretch / 100;
+      bt = (uint64_t)bt * stretch / 100;
+      wi = (uint64_t)wi * stretch / 100;
+      bi = (uint64_t)bi * stretch / 100;
+   }
+
+   engineSend(active, "go wtime %d btime %d winc %d binc %d\n", wt, bt, wi, bi );
+   recordSearch();
 }
 
 void SF_findMoveFixedDepth( int d )
 {
-   if(sfPipe == NULL)
+   if(active == NULL)
    {
-      DPRINT("SF_findMoveFixedDepth called with uninitialized stockfish pipe\n");
+      DPRINT("SF_findMoveFixedDepth called with no engine running\n");
       return;
    }
 
+   char limits[40];
+
+   moveSearchOptions();
+   strengthLimits(limits, sizeof(limits), d, 0);
+
    DPRINT("Computer beginning fixed-depth search of %d ply\n", d);
-   fprintf(sfPipe,"go depth %d\n", d);
+   engineSend(active, "go%s\n", limits);
+   recordSearch();
 }
 
 void SF_findMoveFixedTime( uint32_t t )
 {
-   if(sfPipe == NULL)
+   if(active == NULL)
    {
-      DPRINT("SF_findMoveFixedTime called with uninitialized stockfish pipe\n");
+      DPRINT("SF_findMoveFixedTime called with no engine running\n");
       return;
    }
 
+   char limits[40];
+
+   moveSearchOptions();
+   strengthLimits(limits, sizeof(limits), 0, 0);
+
    DPRINT("Computer beginning fixed-time search of %dms\n", t);
-   fprintf(sfPipe,"go movetime %d\n", t);
+   engineSend(active, "go movetime %d%s\n", t, limits);
+   recordSearch();
 }
 
 void SF_stop( void )
 {
-   if(sfPipe == NULL)
+   if(active == NULL)
    {
-      DPRINT("SF_stop called with uninitialized stockfish pipe\n");
+      DPRINT("SF_stop called with no engine running\n");
       return;
    }
-   fprintf(sfPipe,"stop\n");
+   engineSend(active, "stop\n");
 }
 
 void SF_go( void )
 {
-   if(sfPipe == NULL)
+   if(active == NULL)
+   {
+      DPRINT("SF_go called with no engine running\n");
+      return;
+   }
+
+   char limits[40];
+
+   moveSearchOptions();
+   strengthLimits(limits, sizeof(limits), 0, 0);
+
+   // A capped level finishes early and waits for the button like any other
+   DPRINT("Starting untimed computer analysis\n");
+   engineSend(active, "go infinite%s\n", limits);
+}
+
+void SF_findHints( int lines )
+{
+   char linesText[12];
+
+   if(active == NULL)
    {
-      DPRINT("SF_go called with uninitialized stockfish pipe\n");
+      DPRINT("SF_findHints called with no engine running\n");
       return;
    }
-   DPRINT("Starting untimed computer analysis");
-   fprintf(sfPipe,"go infinite\n");
+
+   // UCI_AnalyseMode tells the engine there's no move to play, so it leaves no result file
+   sprintf(linesText, "%d", lines);
+   scheduleThreads();
+   SF_setOption("UCI_AnalyseMode", "true");
+   SF_setOption("MultiPV", linesText);
+   active->hintLines = lines;
+
+   DPRINT("Starting %d line hint search\n", lines);
+   engineSend(active, "go infinite\n");
+}
+
+void SF_setBackground( bool_t background )
+{
+   lockPool();
+
+   if(active != NULL && active->background != background)
+   {
+      setEnginePolicy(active->pid, background ? SCHED_IDLE : SCHED_OTHER);
+      active->background = background;
+   }
+
+   unlockPool();
 }
 
 
@@ -185,16 +737,753 @@ void SF_go( void )
 
 extern bool_t computerMovePending;
 
+// Put back the options a search for a move needs after hints.  Left until now, rather than sent
+//   with the stop, so the engine isn't given options while the hint search is still winding down.
+static void moveSearchOptions( void )
+{
+   int nodesTime = getOption(OPT_ENGINE_REPEATABLE) ? REPEATABLE_NODES_PER_MS : 0;
+
+   SF_setBackground(FALSE);
+   scheduleThreads();
+
+   if(active->hintLines)
+   {
+      SF_setOption("UCI_AnalyseMode", "false");
+      SF_setOption("MultiPV", "1");
+      active->hintLines = 0;
+   }
+
+   if(active->nodesTime != nodesTime)
+   {
+      engineSend(active, "setoption name nodestime value %d\n", nodesTime);
+      active->nodesTime = nodesTime;
+   }
+
+   // A repeatable search owes nothing to the searches before it (hints included)
+   if(nodesTime)
+      engineSend(active, "ucinewgame\n");
+}
+
+// Log a repeatable search for a move in the event trace, as the engine commands that repeat it
+//   (see sfInterface.h).  Called once its "go" has been sent.
+static void recordSearch( void )
+{
+   const char *tbPath;
+   char *text;
+
+   if(!getOption(OPT_ENGINE_REPEATABLE) || searchPosition == NULL)
+      return;
+
+   lockPool();
+
+   // None given yet is the engine's default:  no tablebases
+   tbPath = active->tbPath[0] != '\0' ? active->tbPath : "<empty>";
+
+   text = allocPrintf("setoption name Hash value %d\n"
+                      "setoption name nodestime value %d\n"
+                      "setoption name SyzygyPath value %s\n"
+                      "setoption name SyzygyInstantMove value %s\n"
+                      "ucinewgame\n%s%s",
+                      active->hashMB, active->nodesTime, tbPath,
+                      strcmp(tbPath, "<empty>") ? "true" : "false",
+                      searchPosition, active->lastGo);
+
+   unlockPool();
+
+   if(text != NULL)
+   {
+      TRACE_engineSearch(text);
+      free(text);
+   }
+}
+
+// The game as the UCI position command for it (NULL if out of memory)
+static char *positionCommand( const game_t *g )
+{
+   const char *moves = (g->moveRecord.plies > 0) ? " moves " : "";
+
+   if(g->startPos == NULL)
+      return allocPrintf("position startpos%s%s\n", moves, g->moveRecord.text);
+
+   return allocPrintf("position fen %s%s%s\n", g->startPos, moves, g->moveRecord.text);
+}
+
+// sprintf() into a string malloc'd to fit (NULL if out of memory), for the caller to free
+static char *allocPrintf( const char *fmt, ... )
+{
+   va_list args;
+   char *text;
+   int len;
+
+   va_start(args, fmt);
+   len = vsnprintf(NULL, 0, fmt, args);
+   va_end(args);
+
+   if(len < 0 || (text = malloc(len + 1)) == NULL)
+      return NULL;
+
+   va_start(args, fmt);
+   vsnprintf(text, len + 1, fmt, args);
+   va_end(args);
+
+   return text;
+}
+
+// The depth and node limits for a search for a move at the strength set, as " depth d nodes n"
+//   (empty if there are none).  depth is a depth asked for (0 for none) and budgetMs the time the
+//   clock allows the move (0 if untimed);  the tighter of each limit is used.
+static void strengthLimits( char *text, int size, int depth, uint32_t budgetMs )
+{
+   const strengthProfile_t *p = SF_strengthProfile(getOption(OPT_ENGINE_STRENGTH));
+   uint64_t nodes = p->nodes;
+   int len = 0;
+
+   if(p->depth && (depth == 0 || p->depth < depth))
+      depth = p->depth;
+
+   if(nodes && budgetMs)
+   {
+      uint64_t budget = (uint64_t)SF_engineNps() * budgetMs / 1000;
+
+      if(budget < nodes)
+         nodes = budget > 0 ? budget : 1;
+   }
+
+   text[0] = '\0';
+
+   if(depth)
+      len += snprintf(text + len, size - len, " depth %d", depth);
+
+   if(nodes)
+      snprintf(text + len, size - len, " nodes %llu", (unsigned long long)nodes);
+}
+
+// Update the engine speed from the search an engine has just answered, if it ran long enough to
+//   tell.  The last record on its channel is the bestmove, with the nodes and time of the whole
+//   search.  Call with the pool locked.
+static void measureSpeed( sfEngine_t *e )
+{
+   ShmSegment *channel = e->channel;
+   ShmRecord r;
+   uint32_t written, seq;
+   long knps, old;
+
+   if(channel == NULL || !__atomic_load_n(&channel->attached, __ATOMIC_ACQUIRE))
+      return;
+
+   if( (written = __atomic_load_n(&channel->written, __ATOMIC_ACQUIRE)) == 0)
+      return;
+
+   seq = __atomic_load_n(&channel->ring[(written - 1) % SHM_RING_SIZE].seq, __ATOMIC_ACQUIRE);
+   memcpy(&r, &channel->ring[(written - 1) % SHM_RING_SIZE], sizeof(r));
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+   if(seq != written || r.seq != seq || r.type != SHM_REC_BESTMOVE || r.timeMs < NPS_SAMPLE_MIN_MS)
+      return;
+
+   recentNps = (long)r.nps;
+
+   // The engine's own speed is what it does cool, with all its threads
+   if(cpuThrottled || e->runThreads != e->threads)
+      return;
+
+   knps = (long)(r.nps / 1000 / (e->threads > 0 ? e->threads : 1));
+
+   if(knps <= 0 || knps > MAX_KNPS_PER_THREAD)
+      return;
+
+   // Smoothed, since how fast the engine goes depends on the position
+   if( (old = getOption(OPT_ENGINE_KNPS)) != 0)
+      knps = (old * 3 + knps) / 4;
+
+   if(knps != old)
+   {
+      DPRINT("Engine speed now %ld knps per thread\n", knps);
+      setOption(OPT_ENGINE_KNPS, knps);
+   }
+}
+
+// Copy record n from the channel's ring.  FALSE if it has been overwritten, or was being.
+static bool_t readRecord( ShmSegment *channel, uint32_t n, ShmRecord *r )
+{
+   ShmRecord *shared = &channel->ring[n % SHM_RING_SIZE];
+   uint32_t before = __atomic_load_n(&shared->seq, __ATOMIC_ACQUIRE);
+
+   memcpy(r, shared, sizeof(*r));
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+   return (before == n + 1 && __atomic_load_n(&shared->seq, __ATOMIC_RELAXED) == before) ? TRUE : FALSE;
+}
+
+// Give every thread of the engine the scheduling policy.  The main thread goes first:  threads
+//   the engine starts later take its policy.
+static void setEnginePolicy( pid_t pid, int policy )
+{
+   struct sched_param param = { 0 };
+   struct dirent *d;
+   char path[40];
+   pid_t tid;
+   DIR *dir;
+
+   if(sched_setscheduler(pid, policy, &param) != 0)
+   {
+      DLOG(DIAG_WARN, "Unable to set engine scheduling policy %d\n", policy);
+      return;
+   }
+
+   snprintf(path, sizeof(path), "/proc/%d/task", (int)pid);
+
+   if( (dir = opendir(path)) == NULL)
+      return;
+
+   while( (d = readdir(dir)) != NULL)
+   {
+      if( (tid = atoi(d->d_name)) > 0 && tid != pid)
+         sched_setscheduler(tid, policy, &param);
+   }
+
+   closedir(dir);
+}
+
+// A move as the engine writes it ("e7e8q")
+static void coordText( char *text, move_t m )
+{
+   static const char promotions[] = " nbrq";
+
+   text[0] = 'a' + m.from % 8;
+   text[1] = '8' - m.from / 8;
+   text[2] = 'a' + m.to % 8;
+   text[3] = '8' - m.to / 8;
+   text[4] = (m.promote >= KNIGHT && m.promote <= QUEEN) ? promotions[m.promote] : '\0';
+   text[5] = '\0';
+}
+
+// Read the CPU temperature and clock, log throttling as it starts and stops, and step the
+//   search threads allowed down or up
+static void checkThermal( void )
+{
+   thermalState_t s;
+   bool_t hot, throttled;
+   int threads = SF_threadCount();
+   time_t now = time(NULL);
+
+   if(!THERMAL_read(&s))
+      return;
+
+   hot       = (s.tempMilliC >= THERMAL_HOT_MC);
+   throttled = (hot || THERMAL_clockThrottled(&s));
+
+   lockPool();
+
+   if(throttled != cpuThrottled)
+   {
+      if(throttled)
+         DLOG(DIAG_WARN, "CPU throttling:  %d.%dC, clock %d of %d MHz\n", s.tempMilliC / 1000,
+              (s.tempMilliC % 1000) / 100, s.curFreqKHz / 1000, s.maxFreqKHz / 1000);
+      else
+         DLOG(DIAG_WARN, "CPU no longer throttling:  %d.%dC, clock %d MHz\n", s.tempMilliC / 1000,
+              (s.tempMilliC % 1000) / 100, s.curFreqKHz / 1000);
+
+      cpuThrottled = throttled;
+   }
+
+   if(threadLimit == 0 || threadLimit > threads)
+      threadLimit = threads;
+
+   if(now - threadStepTime >= THERMAL_STEP_SEC)
+   {
+      if(hot && threadLimit > 1)
+      {
+         threadLimit--;
+         threadStepTime = now;
+         DLOG(DIAG_WARN, "CPU too hot, engine down to %d of %d threads\n", threadLimit, threads);
+      }
+      else if(!throttled && s.tempMilliC < THERMAL_COOL_MC && threadLimit < threads)
+      {
+         threadLimit++;
+         threadStepTime = now;
+         DLOG(DIAG_WARN, "CPU cooler, engine back up to %d of %d threads\n", threadLimit, threads);
+      }
+   }
+
+   unlockPool();
+}
+
+// Have the engine playing search with the threads the thermal scheduler allows.  Only between
+//   searches:  the engine can't change them under a running one.
+static void scheduleThreads( void )
+{
+   int threads = SF_threadCount();
+
+   if(threadLimit > 0 && threadLimit < threads)
+      threads = threadLimit;
+
+   if(active->runThreads != threads)
+   {
+      DPRINT("Engine searching with %d threads\n", threads);
+      engineSend(active, "setoption name Threads value %d\n", threads);
+      active->runThreads = threads;
+   }
+}
+
+// The time a search for a move is given, as a percentage of what the clock shows (see Thermal
+//   scheduling above)
+static int timeStretchPct( uint32_t ownTimeMs )
+{
+   long pct;
+
+   if(!cpuThrottled && (threadLimit == 0 || threadLimit >= SF_threadCount()))
+      return 100;
+
+   // The clock a repeatable search is given is the clock;  it counts nodes anyway
+   if(getOption(OPT_ENGINE_REPEATABLE))
+      return 100;
+
+   if(recentNps <= 0 || getOption(OPT_ENGINE_KNPS) == 0 || ownTimeMs < THERMAL_STRETCH_MIN_MS)
+      return 100;
+
+   pct = SF_engineNps() * 100 / recentNps;
+
+   if(pct < 100)                     pct = 100;
+   if(pct > THERMAL_MAX_STRETCH_PCT) pct = THERMAL_MAX_STRETCH_PCT;
+
+   return (int)pct;
+}
+
+static void poolInit( void )
+{
+   pthread_mutexattr_t attr;
+   int i;
+
+   // The pool functions call each other with the lock held
+   pthread_mutexattr_init(&attr);
+   pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+   pthread_mutex_init(&poolMutex, &attr);
+   pthread_mutexattr_destroy(&attr);
+
+   for(i=0;i<SF_MAX_ENGINES;i++)
+   {
+      sprintf(engines[i].resultFile,  CHESS_DIR "/result%d.txt", i);
+      sprintf(engines[i].channelName, SF_CHANNEL_NAME "%d", i);
+   }
+}
+
+// Start watching the engines (once)
+static void poolStart( void )
+{
+   pthread_once(&poolOnce, poolInit);
+
+   if(enginePollRunning)
+      return;
+
+   // A write to an engine that has died must fail, not kill us;  the poll task will restart it
+   signal(SIGPIPE, SIG_IGN);
+
+   pthread_create(&enginePollThread, NULL, enginePollTask , NULL);
+   enginePollRunning = TRUE;
+}
+
+static void lockPool( void )
+{
+   pthread_once(&poolOnce, poolInit);
+   pthread_mutex_lock(&poolMutex);
+}
+
+static void unlockPool( void )
+{
+   pthread_mutex_unlock(&poolMutex);
+}
+
+// Quit standby engines that no longer match the options (or aren't needed, keeping keep if
+//   possible) and start any more that are wanted.  Call with the pool locked.
+static void fillPool( sfEngine_t *keep )
+{
+   int hashMB  = SF_hashSizeMB();
+   int threads = SF_threadCount();
+   int wanted  = getOption(OPT_ENGINE_STANDBY);
+   int i;
+
+   if(keep != NULL && keep->hashMB == hashMB && keep->threads == threads && wanted > 0)
+      wanted--;
+   else
+      keep = NULL;
+
+   for(i=0;i<SF_MAX_ENGINES;i++)
+   {
+      sfEngine_t *e = &engines[i];
+
+      if(e->state != ENGINE_STANDBY || e == keep)
+         continue;
+
+      if(e->hashMB == hashMB && e->threads == threads && wanted > 0)
+         wanted--;
+      else
+         quitEngine(e);
+   }
+
+   while(wanted-- > 0)
+   {
+      if(startEngine(hashMB, threads, ENGINE_STANDBY) == NULL)
+         break;
+   }
+}
+
+// Take a free slot and start an engine in it.  Call with the pool locked.
+static sfEngine_t *startEngine( int hashMB, int threads, sfEngineState_t state )
+{
+   int i;
+
+   for(i=0;i<SF_MAX_ENGINES;i++)
+   {
+      sfEngine_t *e = &engines[i];
+
+      if(e->state != ENGINE_FREE)
+         continue;
+
+      e->hashMB   = hashMB;
+      e->threads  = threads;
+      e->failures = 0;
+
+      if(!launchEngine(e))
+         return NULL;
+
+      e->state = state;
+
+      return e;
+   }
+
+   return NULL;
+}
+
+// Start the engine process for a slot and give it its options.  Call with the pool locked.
+static bool_t launchEngine( sfEngine_t *e )
+{
+   int fd[2];
+   pid_t pid;
+
+   if(pipe(fd) != 0)
+   {
+      DLOG(DIAG_ERROR, "Failed to open pipe for stockfish engine\n");
+      return FALSE;
+   }
+
+   // Other engines mustn't inherit this engine's end of the pipe, or it would never see EOF
+   fcntl(fd[0], F_SETFD, FD_CLOEXEC);
+   fcntl(fd[1], F_SETFD, FD_CLOEXEC);
+
+   if( (pid = fork()) < 0)
+   {
+      DLOG(DIAG_ERROR, "Failed to start stockfish engine\n");
+      close(fd[0]);
+      close(fd[1]);
+      return FALSE;
+   }
+
+   if(pid == 0)
+   {
+      int out = open(SF_OUTPUT, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+      dup2(fd[0], STDIN_FILENO);
+      if(out >= 0)
+         dup2(out, STDOUT_FILENO);
+
+      signal(SIGPIPE, SIG_DFL);
+
+      execl(SF_EXE, SF_EXE, (char *)NULL);
+      _exit(127);
+   }
+
+   close(fd[0]);
+
+   e->pid        = pid;
+   e->pipe       = fdopen(fd[1], "w");
+   e->started    = time(NULL);
+   e->runThreads = e->threads;
+   e->hintLines  = 0;
+   e->nodesTime  = 0;
+   e->background = FALSE;
+   e->lastGo[0]  = '\0';
+   e->tbPath[0]  = '\0';
+
+   // Remove buffering so commands are sent immediately.
+   setbuf(e->pipe, NULL);
+
+   // Threads goes first;  the engine clears the hash table with every thread once it has been
+   //   resized.  HashFile after Hash, so the saved table is loaded into the table it will use.
+   engineSend(e, "setoption name Threads value %d\n", e->threads);
+   engineSend(e, "setoption name Hash value %d\n", e->hashMB);
+   engineSend(e, "setoption name HashFile value %s\n", hashFile);
+   engineSend(e, "setoption name ResultFile value %s\n", e->resultFile);
+
+   // With more than one thread, one pawn and material table for all of them (sized from Hash)
+   //   instead of each thread working out the same entries in its own
+   engineSend(e, "setoption name SharedEvalTables value %s\n", e->threads > 1 ? "true" : "false");
+
+   // Tablebases are opened now too, so a standby engine has them ready
+   tablebaseOptions(e);
+
+   // The slot's channel is kept from engine to engine;  each new one attaches to it again
+   if(openChannel(e))
+   {
+      __atomic_store_n(&e->channel->attached, 0, __ATOMIC_RELEASE);
+      e->channelRead = __atomic_load_n(&e->channel->written, __ATOMIC_ACQUIRE);
+      engineSend(e, "setoption name ShmChannel value %s\n", e->channelName);
+   }
+
+   DPRINT("Engine %d (pid %d) using %d threads, %d MB hash\n", (int)(e - engines), (int)pid, e->threads, e->hashMB);
+
+   return TRUE;
+}
+
+// Tell an engine to quit and free its slot.  It saves its hash table on the way out, which can
+//   take a moment, so the waiting is left to another thread.  Call with the pool locked.
+static void quitEngine( sfEngine_t *e )
+{
+   pthread_t closeThread;
+
+   DPRINT("Closing engine %d\n", (int)(e - engines));
+
+   if(e->pipe != NULL)
+   {
+      engineSend(e, "quit\n");
+      fclose(e->pipe);
+      e->pipe = NULL;
+   }
+
+   if(pthread_create(&closeThread, NULL, engineCloseTask, (void *)(intptr_t)e->pid) == 0)
+      pthread_detach(closeThread);
+
+   free(e->lastPosition);
+   e->lastPosition = NULL;
+   e->state = ENGINE_FREE;
+}
+
+// Restart any engine that has died.  The one playing gets its game back, and its search if it
+//   was on one.
+static void checkEngines( void )
+{
+   int i;
+
+   lockPool();
+
+   for(i=0;i<SF_MAX_ENGINES;i++)
+   {
+      sfEngine_t *e = &engines[i];
+      char valueText[12], lastGo[sizeof(e->lastGo)];
+      int status, hintLines;
+
+      if(e->state == ENGINE_FREE || e->pipe == NULL || waitpid(e->pid, &status, WNOHANG) != e->pid)
+         continue;
+
+      DLOG(DIAG_ERROR, "Engine %d (pid %d) has died (status %d)\n", i, (int)e->pid, status);
+
+      fclose(e->pipe);
+      e->pipe = NULL;
+
+      if(time(NULL) - e->started < ENGINE_MIN_LIFE_SEC)
+         e->failures++;
+      else
+         e->failures = 0;
+
+      if(e->failures >= ENGINE_MAX_FAILURES)
+      {
+         DLOG(DIAG_ERROR, "Engine %d keeps failing, not restarting it\n", i);
+
+         if(e->state == ENGINE_STANDBY)
+            e->state = ENGINE_FREE;
+
+         continue;
+      }
+
+      hintLines = e->hintLines;
+      strcpy(lastGo, e->lastGo);
+
+      if(!launchEngine(e))
+         continue;
+
+      if(e->state == ENGINE_ACTIVE)
+      {
+         char *position = e->lastPosition;
+
+         // A hint search mustn't come back as a move
+         if(hintLines)
+         {
+            sprintf(valueText, "%d", hintLines);
+            engineSend(e, "setoption name UCI_AnalyseMode value true\n");
+            engineSend(e, "setoption name MultiPV value %s\n", valueText);
+            e->hintLines = hintLines;
+         }
+
+         if(position != NULL && lastGo[0] != '\0')
+         {
+            DPRINT("Resending the search to engine %d\n", i);
+
+            e->lastPosition = NULL;
+            engineSend(e, "%s", position);
+            free(position);
+            engineSend(e, "%s", lastGo);
+         }
+      }
+   }
+
+   unlockPool();
+}
+
+// Send a command to an engine, keeping track of what it's been asked to search
+static void engineSend( sfEngine_t *e, const char *fmt, ... )
+{
+   va_list args;
+   char *cmd;
+   int len;
+
+   va_start(args, fmt);
+   len = vsnprintf(NULL, 0, fmt, args);
+   va_end(args);
+
+   if(len < 0 || (cmd = malloc(len + 1)) == NULL)
+      return;
+
+   va_start(args, fmt);
+   vsnprintf(cmd, len + 1, fmt, args);
+   va_end(args);
+
+   lockPool();
+
+   if(e->pipe != NULL)
+      fputs(cmd, e->pipe);
+
+   if(!strncmp(cmd, "position", 8))
+   {
+      free(e->lastPosition);
+      e->lastPosition = cmd;
+      cmd = NULL;
+   }
+   else if(!strncmp(cmd, "go", 2))
+   {
+      strncpy(e->lastGo, cmd, sizeof(e->lastGo) - 1);
+   }
+   else if(!strncmp(cmd, "stop", 4))
+   {
+      e->lastGo[0] = '\0';
+   }
+
+   unlockPool();
+
+   free(cmd);
+}
+
+// Create a slot's shared memory channel (once).  Any failure just leaves the engine on UCI text.
+static bool_t openChannel( sfEngine_t *e )
+{
+   int fd;
+   void *p;
+
+   if(e->channel != NULL) return TRUE;
+
+   if( (fd = shm_open(e->channelName, O_CREAT | O_RDWR, 0600)) < 0 )
+   {
+      DLOG(DIAG_WARN, "Unable to create shared memory %s\n", e->channelName);
+      return FALSE;
+   }
+
+   if( ftruncate(fd, sizeof(ShmSegment)) != 0 ||
+       (p = mmap(NULL, sizeof(ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED )
+   {
+      DLOG(DIAG_WARN, "Unable to map shared memory %s\n", e->channelName);
+      close(fd);
+      return FALSE;
+   }
+
+   close(fd);
+
+   e->channel = p;
+   memset(e->channel, 0, sizeof(ShmSegment));
+   e->channel->magic   = SHM_CHANNEL_MAGIC;
+   e->channel->version = SHM_CHANNEL_VERSION;
+   e->channel->size    = sizeof(ShmSegment);
+
+   return TRUE;
+}
+
+// Memory that can be had without swapping:  MemAvailable if the kernel reports it, otherwise
+//   just the free pages
+static long availableMemoryMB( void )
+{
+   FILE *fp;
+   char line[100];
+   long kb = -1;
+
+   if( (fp = fopen("/proc/meminfo", "r")) != NULL)
+   {
+      while(fgets(line, sizeof(line), fp) != NULL)
+      {
+         if(sscanf(line, "MemAvailable: %ld kB", &kb) == 1)
+            break;
+      }
+      fclose(fp);
+   }
+
+   if(kb >= 0)
+      return kb / 1024;
+
+   return (long)(sysconf(_SC_AVPHYS_PAGES) / 1024) * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+static void *engineCloseTask ( void *arg )
+{
+   waitpid((pid_t)(intptr_t)arg, NULL, 0);
+
+   return NULL;
+}
+
+// Point the engine at the tablebases, or away from them, as OPT_TABLEBASES says.  Opening them
+//   means scanning TB_DIR, so only when that changes.  Call with the pool locked.
+static void tablebaseOptions( sfEngine_t *e )
+{
+   bool_t use = (getOption(OPT_TABLEBASES) != TB_OFF);
+   const char *path = use ? TB_DIR : "<empty>";
+
+   if(!strcmp(e->tbPath, path))
+      return;
+
+   engineSend(e, "setoption name SyzygyPath value %s\n", path);
+   engineSend(e, "setoption name SyzygyInstantMove value %s\n", use ? "true" : "false");
+
+   snprintf(e->tbPath, sizeof(e->tbPath), "%s", path);
+}
+
 static void *enginePollTask ( void *arg )
 {
+   int polls = 0;
+
    while(1)
    {
+      bool_t moveReady;
+
       usleep(50000);
 
-      if( computerMovePending == false && access( OUTPUT_FILE, R_OK ) != -1 )
+      if(++polls % ENGINE_CHECK_POLLS == 0)
+         checkEngines();
+
+      if(polls % THERMAL_CHECK_POLLS == 0)
+         checkThermal();
+
+      lockPool();
+      moveReady = (active != NULL && computerMovePending == false && access( active->resultFile, R_OK ) != -1);
+
+      // The engine has answered;  nothing to resend if it dies now
+      if(moveReady)
+      {
+         active->lastGo[0] = '\0';
+         measureSpeed(active);
+      }
+
+      unlockPool();
+
+      // The result file is renamed into place whole, so it can be read as soon as it is there
+      if( moveReady )
       {
          event_t ev = {EV_PROCESS_COMPUTER_MOVE, 0};
-         usleep(100000);
          putEvent(EVQ_EVENT_MANAGER, &ev);
          usleep(100000);
       }
@@ -2,17 +2,146 @@
 #define SFINTERFACE_H
 
 #include "types.h"
+#include "engine.h"
+#include "stockfish-8-src/src/shmchannel.h"
 
-#define OUTPUT_FILE "/home/pi/chess/result.txt"
+// Each engine writes its best move to its own file;  this is the one for the engine playing the
+//   current game
+#define OUTPUT_FILE SF_resultFile()
+
+// The engine saves the best of its hash table here when a game ends and loads it back when it
+//   starts
+#define HASH_FILE   CHESS_DIR "/engine.tt"
+
+// Engine pool
+//
+// Engines are kept running between games.  Besides the one playing (if any), the pool keeps
+//   getOption(OPT_ENGINE_STANDBY) engines started, with their hash table allocated and loaded, for
+//   the hash size and thread count the options call for.  SF_initEngine() hands the game to one of
+//   those and starts a replacement in the background;  SF_closeEngine() stops the engine and keeps
+//   it for the next game.  An engine that dies is restarted (and the search it was on resent).
+
+#define SF_MAX_ENGINES (1 + MAX_STANDBY_ENGINES)
 
 void   SF_initEngine( void );
+void   SF_closeEngine( void );
+
+// Bring the standby engines in line with the options (count, hash size, threads)
+void   SF_refreshPool( void );
+
+const char *SF_resultFile( void );
+
+// Where engines started from now on load and save their hash table:  HASH_FILE unless changed,
+//   "<empty>" for nowhere (engineBench, so it neither uses nor spoils the board's)
+void   SF_setHashFile( const char *file );
+
+// Have the engine playing forget what it has learned (hash table and move history)
+void   SF_clearHash( void );
+
+// Strength
+//
+// Each level of OPT_ENGINE_STRENGTH is a profile capping the work the engine does for a move,
+//   rather than having it search at full strength and then pick a worse move (Skill Level):  a
+//   node limit and a depth limit, sent with every search for a move.  A weak level answers at
+//   once and leaves the CPU idle.  The node limit doesn't depend on the machine;  in a timed game it
+//   is further held to what the clock allows, at the engine speed measured from earlier searches.
+//   MAX_STRENGTH has no limits.
+
+typedef struct strengthProfile_s
+{
+   int      depth;       // depth cap in ply, 0 for none
+   uint32_t nodes;       // nodes per move cap, 0 for none
+}strengthProfile_t;
+
+const strengthProfile_t *SF_strengthProfile( int level );
+
+// Engine speed for budgeting, nodes per second:  measured, or a default until it has been (the
+//   fixed rate for repeatable searches)
+long   SF_engineNps( void );
+
+// Repeatable searches
+//
+// With OPT_ENGINE_REPEATABLE on, any move the engine plays can be recomputed exactly, on the board
+//   or off it.  The engine searches with one thread and counts the clock and time limits in nodes,
+//   at REPEATABLE_NODES_PER_MS (its "nodestime" option), rather than in time.  Each search for a
+//   move starts from a cleared hash table and history ("ucinewgame").  Thermal scheduling leaves it
+//   alone and a capped strength level is budgeted at the fixed rate.
+//
+//   Each search for a move goes in the event trace as the engine commands that repeat it
+//   (TRACE_REC_SEARCH):  the options it depends on, the position and the "go".  "piChessReplay -e"
+//   runs them through an engine again and checks it plays the same moves.  A search stopped by the
+//   button (SF_go()) isn't logged, since where it stopped can't be repeated.
+
 void   SF_setPosition( char *fen, char *moveList);
 void   SF_setOption( char *name, char *value);
-void   SF_findMove( uint32_t wt, uint32_t bt, uint32_t wi, uint32_t bi);
+void   SF_findMove( uint32_t wt, uint32_t bt, uint32_t wi, uint32_t bi, color_t toMove );
 void   SF_findMoveFixedDepth( int d );
 void   SF_findMoveFixedTime( uint32_t t );
 void   SF_stop( void );
 void   SF_go( void );
-void   SF_closeEngine( void );
+
+// Analyse the position set for its best lines until SF_stop().  The lines come through the channel
+//   (SF_readUpdates());  no result file is written.  The next search for a move goes back to one line.
+void   SF_findHints( int lines );
+
+// Run the engine's threads at SCHED_IDLE, so its search only gets the cores nothing else wants
+//   (background analysis, idle.h), or back at the normal policy.  The next search for a move puts
+//   them back anyway.
+void   SF_setBackground( bool_t background );
+
+// Transposition table size and thread count the engine is started with (the options, or sized to
+//   the machine if they're set to ENGINE_AUTO;  one thread for repeatable searches)
+int    SF_hashSizeMB( void );
+int    SF_threadCount( void );
+int    SF_coreCount( void );
+
+// Shared memory channel to the engine (see shmchannel.h).  Search updates and positions cross it
+//   as binary records;  the UCI text commands are still there if the engine doesn't attach.
+//   Each engine in the pool has its own, SF_CHANNEL_NAME followed by its number.
+
+#define SF_CHANNEL_NAME "/piChess.engine"
+
+bool_t SF_channelAttached( void );
+
+// Post the position at the start of the game and the moves played since.  FALSE if the engine
+//   isn't attached to the channel, in which case use SF_setPosition().
+bool_t SF_setBoard( const board_t *start, const posHistory_t *history, int count );
+
+// Give the engine the game so far:  through the channel if it's attached, else as UCI text
+void   SF_setGame( const game_t *g );
+
+// Copy up to max search updates the engine has written since the last call.  Returns the
+//   number copied;  updates overwritten before they could be read are skipped.
+int    SF_readUpdates( ShmRecord *recs, int max );
+
+move_t   SF_unpackMove( uint16_t packed );
+uint16_t SF_packMove( move_t m );
+
+// The search the engine has just answered:  its move and the reply it expects, with the score and
+//   depth of its last line and the nodes of the whole search (see analysis.h).  FALSE if the
+//   engine isn't attached to the channel, or that line has gone from it.
+typedef struct searchSummary_s
+{
+   move_t   best;
+   move_t   ponder;
+   bool_t   hasPonder;
+   int      depth;
+   int      score;        // for the side to move
+   bool_t   mate;         // score is moves to mate (negative if mated), not centipawns
+   uint64_t nodes;
+}searchSummary_t;
+
+bool_t SF_lastSearch( searchSummary_t *s );
+
+// Answer the search for a move without the engine:  the move is left in the result file as the
+//   engine would leave it, and comes back the same way (EV_PROCESS_COMPUTER_MOVE).  A ponder move
+//   with from == to is none.
+void   SF_postResult( move_t best, move_t ponder );
+
+// Tablebases
+//
+// The engines are given TB_DIR while OPT_TABLEBASES is on, and then play a position in the DTZ
+//   tables straight from them (with only the WDL tables, they search the moves that hold the
+//   result).  The game's own lookups are piChess's (tb.h), not the engine's.
 
 #endif
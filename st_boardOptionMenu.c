@@ -69,21 +69,23 @@ static char *boardOptionMen_pickLEDBrightness( int dir )
 
    static char valueString[3];
 
-   if(dir == 1 && options.board.LED_Brightness < 15)
+   long int brightness = getOption(OPT_LED_BRIGHTNESS);
+
+   // The new level is sent to the LED driver by its option callback
+   if(dir == 1 && brightness < 15)
    {
-      options.board.LED_Brightness++;
+      setOption(OPT_LED_BRIGHTNESS, ++brightness);
    }
-   else if( dir == -1 && options.board.LED_Brightness > 1)
+   else if( dir == -1 && brightness > 1)
    {
-      options.board.LED_Brightness--;
+      setOption(OPT_LED_BRIGHTNESS, --brightness);
    }
 
-   sprintf(valueString, "%d", options.board.LED_Brightness);
+   snprintf(valueString, sizeof(valueString), "%ld", brightness);
    valueString[2] = 0;
 
    if(dir != 0)
    {
-      LED_SetBrightness( options.board.LED_Brightness );
       LED_SetGridState( 0x0000001818000000);
    }
    return valueString;
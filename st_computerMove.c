@@ -16,10 +16,15 @@
 #include "util.h"
 #include "book.h"
 #include "switch.h"
+#include "trace.h"
+#include "analysis.h"
+#include "idle.h"
 
 extern bool_t computerMovePending;
 extern game_t game;
 bool_t waitingForButton = FALSE;
+static bool_t fromCache = FALSE;     // the move coming is the analysis cache's, not a search's
+static searchSummary_t cached;       // and what the cache had for it
 
 static void computerMove_engineSelection( move_t mv, move_t ponder );
 
@@ -42,39 +47,45 @@ void computerMoveEntry( event_t ev )
    else
    {
 
-      SF_setPosition(game.startPos, game.moveRecord);
+      SF_setGame(&game);
 
-      if(isOptionStr("timeControl","untimed"))
+      fromCache = ANALYSIS_answer(&game, &cached);
+
+      if(fromCache)
+      {
+         DPRINT("Move taken from analysis cache\n");
+      }
+      else if(getOption(OPT_TIME_CONTROL) == TIME_NONE)
       {
-         if(isOptionStr("computerStrategy", "fixedTime"))
+         if(getOption(OPT_COMPUTER_STRATEGY) == STRAT_FIXED_TIME)
          {
             SF_findMoveFixedTime(options.game.timeControl.compStrategySetting.timeInMs);
          }
-         else if(isOptionStr("computerStrategy", "fixedDepth"))
+         else if(getOption(OPT_COMPUTER_STRATEGY) == STRAT_FIXED_DEPTH)
          {
-            SF_findMoveFixedDepth((int)getOptionVal("searchDepth"));
+            SF_findMoveFixedDepth((int)getOption(OPT_SEARCH_DEPTH));
          }
-         else if(isOptionStr("computerStrategy", "tillButton"))
+         else if(getOption(OPT_COMPUTER_STRATEGY) == STRAT_TILL_BUTTON)
          {
             waitingForButton = true;
             SF_go();
          }
          else
          {
-            DPRINT("Unexpected Value [%s] for computerStrategy.  Setting to fixedDepth\n", getOptionStr("computerStrategy"));
-            setOptionStr("computerStrategy", "fixedDepth");
+            DPRINT("Unexpected Value [%ld] for computerStrategy.  Setting to fixedDepth\n", getOption(OPT_COMPUTER_STRATEGY));
+            setOption(OPT_COMPUTER_STRATEGY, STRAT_FIXED_DEPTH);
          }
       }
       else
       {
-         SF_findMove( game.wtime * 100, game.btime * 100, game.wIncrement * 100, game.bIncrement * 100 );
+         SF_findMove( game.wtime * 100, game.btime * 100, game.wIncrement * 100, game.bIncrement * 100, game.brd.toMove );
       }
 
 
       // timerStart(TMR_COMPUTER_POLL, 100, 100, EV_CHECK_COMPUTER_DONE);
 
       // If there is only one computer player...
-      if(strcmp(getOptionStr("whitePlayer"),getOptionStr("blackPlayer")))
+      if(getOption(OPT_WHITE_PLAYER) != getOption(OPT_BLACK_PLAYER))
       {
          displayWriteLine(0, "Computer thinking...", true);
       }
@@ -118,15 +129,19 @@ void computerMove_computerPicked( event_t ev)
    FILE *tmpFile;
    char engineResultLine[MAX_LINE_LEN];
    move_t selectedMove, ponderMove;
+   searchSummary_t found;
 
    tmpFile = fopen(OUTPUT_FILE, "r");
 
    if(tmpFile != NULL)
    {
-      fgets(engineResultLine, MAX_LINE_LEN, tmpFile);
+      if(fgets(engineResultLine, MAX_LINE_LEN, tmpFile) == NULL)
+         engineResultLine[0] = 0x00;
       fclose(tmpFile);
       remove(OUTPUT_FILE);
 
+      TRACE_engineResult(engineResultLine);
+
       DPRINT("Found text in engine result file: [%s]\n", engineResultLine);
 
       if(!strncmp(engineResultLine, "bestmove", 8))
@@ -150,21 +165,35 @@ void computerMove_computerPicked( event_t ev)
 
          if( selectedMove.to != selectedMove.from )
          {
+            // The position's score for the accuracy summary.  Only a search the analysis cache would
+            //   take is the engine's verdict:  a capped or repeatable one leaves the ply unrated.
+            if(ANALYSIS_usable(&game))
+            {
+               if(fromCache)
+                  IDLE_noteSearch(&game, &cached);
+               else if(SF_lastSearch(&found))
+                  IDLE_noteSearch(&game, &found);
+            }
+
+            if(!fromCache)
+               ANALYSIS_learn(&game, selectedMove);
+
+            fromCache = FALSE;
             computerMove_engineSelection(selectedMove, ponderMove);
          }
          else
          {
-            DPRINT("Error unexpected contents in %s\n", OUTPUT_FILE);
+            DLOG(DIAG_ERROR, "Error unexpected contents in %s\n", OUTPUT_FILE);
          }
       }
       else
       {
-         DPRINT("Error unexpected contents in %s\n", OUTPUT_FILE);
+         DLOG(DIAG_ERROR, "Error unexpected contents in %s\n", OUTPUT_FILE);
       }
    }
    else
    {
-      DPRINT("Error opening %s\n", OUTPUT_FILE);
+      DLOG(DIAG_ERROR, "Error opening %s\n", OUTPUT_FILE);
    }
 }
 
@@ -3,10 +3,14 @@
 #include "st_diagMenu.h"
 
 #include "menu.h"
+#include "options.h"
 #include <stddef.h>
+#include <stdio.h>
 
 menu_t *diagMenu = NULL;
 
+static char *diagMenu_pickEventTrace( int dir );
+
 void diagMenuEntry( event_t ev )
 {
 
@@ -14,6 +18,7 @@ void diagMenuEntry( event_t ev )
    {
       diagMenu = createMenu("-----Diagnostics-----", EV_GOTO_MAIN_MENU);
       menuAddItem(diagMenu, ADD_TO_END, "Switches", EV_START_SENSOR_DIAG, EV_START_SENSOR_DIAG, NULL);
+      menuAddItem(diagMenu, ADD_TO_END, "Event trace", 0, 0, diagMenu_pickEventTrace);
    }
 
    drawMenu( diagMenu );
@@ -24,3 +29,18 @@ void diagMenuExit( event_t ev )
    destroyMenu(diagMenu);
    diagMenu = NULL;
 }
+
+// Recording starts with the next power up, so the trace holds the whole session
+static char *diagMenu_pickEventTrace( int dir )
+{
+   static char valueString[4];
+
+   if(dir == 1 || dir == -1)
+   {
+      setOption(OPT_EVENT_TRACE, !getOption(OPT_EVENT_TRACE));
+   }
+
+   sprintf(valueString, "%s", (getOption(OPT_EVENT_TRACE) ? " on" : "off"));
+
+   return valueString;
+}
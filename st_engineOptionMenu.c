@@ -4,10 +4,18 @@
 #include "menu.h"
 #include <stddef.h>
 #include "options.h"
+#include "engine.h"
+#include "sfInterface.h"
 #include "stdio.h"
 
 static char *engineOptionsMenu_pickStrength( int dir );
 static char *engineOptionsMenu_pickBook( int dir );
+static char *engineOptionsMenu_pickHash( int dir );
+static char *engineOptionsMenu_pickThreads( int dir );
+static char *engineOptionsMenu_pickStandby( int dir );
+static char *engineOptionsMenu_pickTablebases( int dir );
+static char *engineOptionsMenu_pickRepeatable( int dir );
+static char *engineOptionsMenu_pickBackground( int dir );
 
 menu_t *engineOptionMenu;
 
@@ -20,6 +28,12 @@ void engineOptionMenuEntry( event_t ev )
       menuAddItem(engineOptionMenu, ADD_TO_END, "Go Back",      EV_GOTO_OPTION_MENU, EV_GOTO_OPTION_MENU, NULL);
       menuAddItem(engineOptionMenu, ADD_TO_END, "Strength",     0,                   0,                   engineOptionsMenu_pickStrength);
       menuAddItem(engineOptionMenu, ADD_TO_END, "OpeningBook",  0,                   0,                   engineOptionsMenu_pickBook);
+      menuAddItem(engineOptionMenu, ADD_TO_END, "Hash MB",      0,                   0,                   engineOptionsMenu_pickHash);
+      menuAddItem(engineOptionMenu, ADD_TO_END, "Threads",      0,                   0,                   engineOptionsMenu_pickThreads);
+      menuAddItem(engineOptionMenu, ADD_TO_END, "Standby",      0,                   0,                   engineOptionsMenu_pickStandby);
+      menuAddItem(engineOptionMenu, ADD_TO_END, "Tablebases",   0,                   0,                   engineOptionsMenu_pickTablebases);
+      menuAddItem(engineOptionMenu, ADD_TO_END, "Repeatable",   0,                   0,                   engineOptionsMenu_pickRepeatable);
+      menuAddItem(engineOptionMenu, ADD_TO_END, "Background",   0,                   0,                   engineOptionsMenu_pickBackground);
 
    }
 
@@ -32,6 +46,8 @@ void engineOptionMenuExit( event_t ev )
    destroyMenu(engineOptionMenu);
    engineOptionMenu = NULL;
 
+   // Start (or replace) the standby engines now, so they're warm by the next game
+   SF_refreshPool();
 }
 
 static char* engineOptionsMenu_pickBook( int dir )
@@ -53,24 +69,170 @@ static char* engineOptionsMenu_pickBook( int dir )
 }
 
 
+// Level and the nodes it may search for a move ("7 4k"), "20 Max" for full strength
 static char *engineOptionsMenu_pickStrength( int dir )
 {
-   static char textString[3];
+   static char textString[10];
 
-   int strength = getOptionVal("engineStrength");
+   int strength = getOption(OPT_ENGINE_STRENGTH);
 
    if(dir == 1)
    {
-      if(strength < 20)
-         setOptionVal("engineStrength", ++strength);
+      if(strength < MAX_STRENGTH)
+         setOption(OPT_ENGINE_STRENGTH, ++strength);
    }
    else if(dir == -1)
    {
-      if(strength > 0)
-         setOptionVal("engineStrength", --strength);
+      if(strength > MIN_STRENGTH)
+         setOption(OPT_ENGINE_STRENGTH, --strength);
+   }
+
+   if(strength == MAX_STRENGTH)
+      snprintf(textString, sizeof(textString), "%d Max", strength);
+   else
+   {
+      uint32_t nodes = SF_strengthProfile(strength)->nodes;
+
+      if(nodes >= 1000000)
+         snprintf(textString, sizeof(textString), "%d %uM", strength, nodes / 1000000);
+      else if(nodes >= 1000)
+         snprintf(textString, sizeof(textString), "%d %uk", strength, nodes / 1000);
+      else
+         snprintf(textString, sizeof(textString), "%d %u", strength, nodes);
    }
 
-   sprintf(textString, "%d", strength);
-   textString[2] = 0;
    return textString;
 }
+
+// Auto, then powers of two from MIN_AUTO_HASH_MB up.  Takes effect with the next game.
+static char *engineOptionsMenu_pickHash( int dir )
+{
+   static char textString[6];
+
+   long int mb = getOption(OPT_ENGINE_HASH_MB);
+
+   if(dir == 1)
+   {
+      if(mb == ENGINE_AUTO)
+         mb = MIN_AUTO_HASH_MB;
+      else if(mb * 2 <= MAX_HASH_MB)
+         mb *= 2;
+
+      setOption(OPT_ENGINE_HASH_MB, mb);
+   }
+   else if(dir == -1)
+   {
+      if(mb <= MIN_AUTO_HASH_MB)
+         mb = ENGINE_AUTO;
+      else
+         mb /= 2;
+
+      setOption(OPT_ENGINE_HASH_MB, mb);
+   }
+
+   if(mb == ENGINE_AUTO)
+      return "Auto";
+
+   snprintf(textString, sizeof(textString), "%ld", mb);
+   return textString;
+}
+
+// Auto, then 1 up to a thread per core
+static char *engineOptionsMenu_pickThreads( int dir )
+{
+   static char textString[4];
+
+   long int threads = getOption(OPT_ENGINE_THREADS);
+
+   if(dir == 1)
+   {
+      if(threads < SF_coreCount())
+         setOption(OPT_ENGINE_THREADS, ++threads);
+   }
+   else if(dir == -1)
+   {
+      if(threads > ENGINE_AUTO)
+         setOption(OPT_ENGINE_THREADS, --threads);
+   }
+
+   if(threads == ENGINE_AUTO)
+      return "Auto";
+
+   snprintf(textString, sizeof(textString), "%ld", threads);
+   return textString;
+}
+
+// Engines kept warm for the next game, 0 to MAX_STANDBY_ENGINES
+static char *engineOptionsMenu_pickStandby( int dir )
+{
+   static char textString[4];
+
+   long int standby = getOption(OPT_ENGINE_STANDBY);
+
+   if(dir == 1)
+   {
+      if(standby < MAX_STANDBY_ENGINES)
+         setOption(OPT_ENGINE_STANDBY, ++standby);
+   }
+   else if(dir == -1)
+   {
+      if(standby > 0)
+         setOption(OPT_ENGINE_STANDBY, --standby);
+   }
+
+   snprintf(textString, sizeof(textString), "%ld", standby);
+   return textString;
+}
+
+// Off, On (the engine plays from them and the result is shown), Adjud (and ends decided games)
+static char *engineOptionsMenu_pickTablebases( int dir )
+{
+   static char *names[] = { "Off", "On", "Adjud" };
+
+   long int use = getOption(OPT_TABLEBASES);
+
+   if(dir == 1)
+   {
+      if(use < TB_ADJUDICATE)
+         setOption(OPT_TABLEBASES, ++use);
+   }
+   else if(dir == -1)
+   {
+      if(use > TB_OFF)
+         setOption(OPT_TABLEBASES, --use);
+   }
+
+   return names[use];
+}
+
+// On:  one thread, the clock counted in nodes, each search from a cleared engine, so a game's
+//   engine moves can be recomputed from its event trace
+static char *engineOptionsMenu_pickRepeatable( int dir )
+{
+   static char valueString[4];
+
+   if(dir == 1 || dir == -1)
+   {
+      setOption(OPT_ENGINE_REPEATABLE, !getOption(OPT_ENGINE_REPEATABLE));
+   }
+
+   sprintf(valueString, "%s", (getOption(OPT_ENGINE_REPEATABLE) ? " on" : "off"));
+
+   return valueString;
+}
+
+// On:  the engine searches at idle priority while the human is to move, for its own move and the
+//   accuracy summary at the end of the game
+static char *engineOptionsMenu_pickBackground( int dir )
+{
+   static char valueString[4];
+
+   if(dir == 1 || dir == -1)
+   {
+      setOption(OPT_IDLE_ANALYSIS, !getOption(OPT_IDLE_ANALYSIS));
+   }
+
+   sprintf(valueString, "%s", (getOption(OPT_IDLE_ANALYSIS) ? " on" : "off"));
+
+   return valueString;
+}
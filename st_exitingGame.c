@@ -3,9 +3,12 @@
 #include "st_exitingGame.h"
 #include "timer.h"
 #include "display.h"
+#include "idle.h"
 
 void exitingGameEntry( event_t ev )
 {
+   char accuracy[24];
+
    timerKill(TMR_GAME_CLOCK_TIC);
 
    displayClear();
@@ -23,7 +26,22 @@ void exitingGameEntry( event_t ev )
       case GAME_END_ABORT:
          displayWriteLine(0, "Aborted", TRUE);
          break;
+
+      case GAME_END_TB_WHITE_WINS:
+         displayWriteLine(0, "TB: White wins", TRUE);
+         break;
+
+      case GAME_END_TB_BLACK_WINS:
+         displayWriteLine(0, "TB: Black wins", TRUE);
+         break;
+
+      case GAME_END_TB_DRAW:
+         displayWriteLine(0, "TB: Draw", TRUE);
+         break;
    }
+   if(IDLE_takeTotals(accuracy, sizeof(accuracy)))
+      displayWriteLine(1, accuracy, TRUE);
+
    displayWriteLine(2, "Press any button to", TRUE);
    displayWriteLine(3, "return to main menu", TRUE);
 
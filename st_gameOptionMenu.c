@@ -46,17 +46,17 @@ static char* gameOptionsMenu_pickWhitePlayer( int dir )   // 0 = return current,
 
    if( dir == 1 || dir == -1 )
    {
-      if(isOptionStr("whitePlayer", "human"))
+      if(getOption(OPT_WHITE_PLAYER) == PLAYER_HUMAN)
       {
-         setOptionStr("whitePlayer", "computer");
+         setOption(OPT_WHITE_PLAYER, PLAYER_COMPUTER);
       }
       else
       {
-         setOptionStr("whitePlayer", "human");
+         setOption(OPT_WHITE_PLAYER, PLAYER_HUMAN);
       }
    }
 
-   return getOptionStr("whitePlayer");
+   return (char *)getOptionValueName(OPT_WHITE_PLAYER);
 }
 
 static char* gameOptionsMenu_pickBlackPlayer( int dir )   // 0 = return current, 1 = set/return next, -1 = set/return prev.
@@ -64,34 +64,34 @@ static char* gameOptionsMenu_pickBlackPlayer( int dir )   // 0 = return current,
 
    if( dir == 1 || dir == -1 )
    {
-      if(isOptionStr("blackPlayer", "human"))
+      if(getOption(OPT_BLACK_PLAYER) == PLAYER_HUMAN)
       {
-         setOptionStr("blackPlayer", "computer");
+         setOption(OPT_BLACK_PLAYER, PLAYER_COMPUTER);
       }
       else
       {
-         setOptionStr("blackPlayer", "human");
+         setOption(OPT_BLACK_PLAYER, PLAYER_HUMAN);
       }
    }
 
-   return getOptionStr("blackPlayer");
+   return (char *)getOptionValueName(OPT_BLACK_PLAYER);
 }
 
 static char* gameOptionsMenu_pickCoaching(int dir)
 {
    if( dir == 1 || dir == -1 )
    {
-      if( isOptionStr("coaching", "true") )
+      if( getOption(OPT_COACHING) )
       {
-         setOptionStr("coaching", "false");
+         setOption(OPT_COACHING, FALSE);
       }
       else
       {
-         setOptionStr("coaching", "true");
+         setOption(OPT_COACHING, TRUE);
       }
    }
 
-   return ( isOptionStr("coaching", "true") ? "On" : "Off");
+   return ( getOption(OPT_COACHING) ? "On" : "Off");
 
 }
 
@@ -99,17 +99,17 @@ static char* gameOptionsMenu_pickTakeback(int dir)
 {
    if( dir == 1 || dir == -1 )
    {
-      if(isOptionStr("takeBack", "true"))
+      if(getOption(OPT_TAKEBACK))
       {
-         setOptionStr("takeBack", "false");
+         setOption(OPT_TAKEBACK, FALSE);
       }
       else
       {
-         setOptionStr("takeBack", "true");
+         setOption(OPT_TAKEBACK, TRUE);
       }
    }
 
-   return ( isOptionStr("takeBack", "true") ? "On" : "Off");
+   return ( getOption(OPT_TAKEBACK) ? "On" : "Off");
 
 }
 
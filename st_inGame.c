@@ -19,6 +19,10 @@
 #include "display.h"
 #include "led.h"
 #include "book.h"
+#include "archive.h"
+#include "analysis.h"
+#include "idle.h"
+#include "moveRecord.h"
 
 game_t game;
 
@@ -35,12 +39,15 @@ void inGameEntry( event_t ev )
 
    game.graceTime = 0;
    game.playedMoves = 0;
-   game.moveRecord[0] = '\0';
-   game.SANRecord[0] = '\0';
+   MOVEREC_clear(&game.moveRecord);
+   MOVEREC_clear(&game.SANRecord);
 
    memset(&game.posHistory, 0x00, sizeof(game.posHistory));
 
-   switch(options.game.timeControl.type)
+   ARCHIVE_newGame();
+   IDLE_newGame();
+
+   switch(getOption(OPT_TIME_CONTROL))
    {
       case TIME_EQUAL:
          game.wtime      = options.game.timeControl.timeSettings[0].totalTime * 10;
@@ -71,7 +78,7 @@ void inGameEntry( event_t ev )
       timerStart(TMR_GAME_CLOCK_TIC, 100, 100, EV_MOVE_CLOCK_TIC);
 
    // If either or both player is the computer, set up stockfish Engine and opening book
-   if( isOptionStr("whitePlayer","computer") || isOptionStr("blackPlayer","computer"))
+   if( getOption(OPT_WHITE_PLAYER) == PLAYER_COMPUTER || getOption(OPT_BLACK_PLAYER) == PLAYER_COMPUTER)
    {
       DPRINT("Starting Chess Engine\n");
       SF_initEngine();
@@ -84,6 +91,10 @@ void inGameEntry( event_t ev )
 
 void inGameExit( event_t ev )
 {
+   // A game that ended has been archived already;  this keeps one left from the menu
+   ARCHIVE_saveGame(&game, GAME_END_ABORT);
+   ANALYSIS_save();
+
    SF_closeEngine();
    computerMovePending = FALSE;
    LED_AllOff();
@@ -103,15 +114,22 @@ uint16_t inGamePickSubstate( event_t ev)
    }
 }
 
+// EV_GAME_DONE action:  archive and rate the game while it's all there (the transition re-enters the state)
+void inGame_gameDone( event_t ev)
+{
+   ARCHIVE_saveGame(&game, ev.data);
+   IDLE_summarize(&game);
+}
+
 void inGame_moveClockTick( event_t ev)
 {
 
-   if(isOptionStr("timeControl", "untimed")) return;
+   if(getOption(OPT_TIME_CONTROL) == TIME_NONE) return;
 
    // Don't move computer clock (or grace clock) when both players are computer
    //    and human is making the move for the computer
-   if(isOptionStr("whitePlayer","computer") &&
-      isOptionStr("blackPlayer","computer") &&
+   if(getOption(OPT_WHITE_PLAYER) == PLAYER_COMPUTER &&
+      getOption(OPT_BLACK_PLAYER) == PLAYER_COMPUTER &&
       computerMovePending) return;
 
    // bail if game is not playable
@@ -177,7 +195,7 @@ void inGame_SetPosition( const char *FEN)
       }
       else
       {
-         game.startPos = malloc(strlen(startString));
+         game.startPos = malloc(strlen(startString)+1);
          strcpy( game.startPos, startString);
       }
 
@@ -215,7 +233,7 @@ void inGame_udpateClocks( void )
    const char *timeString;
    char fullString[10];
 
-   if(isOptionStr("timeControl", "untimed") ) return;
+   if(getOption(OPT_TIME_CONTROL) == TIME_NONE ) return;
 
    if(inGameMenu != NULL) return;
 
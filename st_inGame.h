@@ -6,5 +6,6 @@ uint16_t inGamePickSubstate( event_t ev);
 // extern game_t game;
 
 void inGame_moveClockTick( event_t ev);
+void inGame_gameDone( event_t ev);
 void inGame_SetPosition( const char *FEN);
 void inGame_udpateClocks( void );
@@ -10,6 +10,10 @@
 #include "constants.h"
 #include "st_fixBoard.h"
 #include "options.h"
+#include "hint.h"
+#include "archive.h"
+#include "moveRecord.h"
+#include <stdio.h>
 
 #include "diag.h"
 extern game_t game;
@@ -20,14 +24,30 @@ void inGameMenuEntry( event_t ev )
 {
    if(inGameMenu == NULL)
    {
+      archiveStats_t seen;
+      char seenText[32];
+
       inGameMenu = createMenu("---- Game Menu -----", 0);
 
       //          menu      offset      text                   press                  right   picker
       menuAddItem(inGameMenu, ADD_TO_END, "Back to Game",        EV_GOTO_PLAYING_GAME,  0,      NULL);
 
-      if(isOptionStr("takeBack", "true"))
+      if(getOption(OPT_TAKEBACK))
          menuAddItem(inGameMenu, ADD_TO_END, "Take back move",      EV_TAKEBACK,           0,      NULL);
 
+      if(HINT_available())
+         menuAddItem(inGameMenu, ADD_TO_END, HINT_enabled() ? "Hide Hints" : "Show Hints",
+                                                                    EV_TOGGLE_HINTS,       0,      NULL);
+
+      // How earlier games that reached this position went (white wins, draws, black wins).  Always
+      //   there, so the menu is laid out the same whatever the archive holds (as in a replay).
+      if(ARCHIVE_positionStats(game.brd.hash, &seen) == ARCHIVE_NO_ERROR && seen.games > 0)
+         snprintf(seenText, sizeof(seenText), "Seen %d: %dW %dD %dB", seen.games, seen.whiteWins, seen.draws, seen.blackWins);
+      else
+         snprintf(seenText, sizeof(seenText), "Not seen before");
+
+      menuAddItem(inGameMenu, ADD_TO_END, seenText,            EV_GOTO_PLAYING_GAME,  0,      NULL);
+
       menuAddItem(inGameMenu, ADD_TO_END, "Abort Game",          EV_GOTO_MAIN_MENU,     0,      NULL);
       menuAddItem(inGameMenu, ADD_TO_END, "Verify Board",        EV_START_BOARD_CHECK,  0,      NULL);
    }
@@ -43,6 +63,11 @@ void inGameMenuExit( event_t ev )
    displayClear();
 }
 
+void gameMenu_toggleHints( event_t ev)
+{
+   HINT_setEnabled(!HINT_enabled());
+}
+
 void gameMenu_goBack2( event_t ev)
 {
    int i;
@@ -53,8 +78,6 @@ void gameMenu_goBack2( event_t ev)
 
       for(i=0;i<2;i++)
       {
-         char *tempPtr;
-
          // Save off existing board...
          board_t prev;
          memcpy(&prev, &game.brd, sizeof(board_t));
@@ -65,7 +88,7 @@ void gameMenu_goBack2( event_t ev)
 
          // Mark as dirty the newly occupied square
          dirtySquares |= squareMask[rev.move.to];
-         DPRINT("dirty: %016llX\n", dirtySquares );
+         DPRINT("dirty: %016llX\n", (unsigned long long)dirtySquares );
 
          // Ensure Rook moves during castling are marked too...
          if(rev.priorCastleBits != game.brd.castleBits)
@@ -86,21 +109,9 @@ void gameMenu_goBack2( event_t ev)
             }
          }
 
-         // Remove last move from game record
-         tempPtr = &game.moveRecord[strlen(game.moveRecord)];
-
-         while(*tempPtr != ' ' && (tempPtr != game.moveRecord))
-            tempPtr--;
-
-         *tempPtr = '\0';
-
-         // Remove last move from SAN record
-         tempPtr = &game.SANRecord[strlen(game.SANRecord)];
-
-         while(*tempPtr != ' ' && (tempPtr != game.SANRecord))
-            tempPtr--;
-
-         *tempPtr = '\0';
+         // Remove last move from game record and SAN record
+         MOVEREC_truncate(&game.moveRecord, game.playedMoves - 1);
+         MOVEREC_truncate(&game.SANRecord, game.playedMoves - 1);
 
          // Restore clock times
          game.wtime = game.posHistory[game.playedMoves -1].clocks[WHITE];
@@ -115,7 +126,7 @@ void gameMenu_goBack2( event_t ev)
       // Remove those dirty squares that are not currently occupied...
       dirtySquares &= (game.brd.colors[WHITE] | game.brd.colors[BLACK]);
 
-      DPRINT("dirty: %016llX\n", dirtySquares );
+      DPRINT("dirty: %016llX\n", (unsigned long long)dirtySquares );
 
 
       fixBoard_setDirty(dirtySquares);
@@ -1,3 +1,4 @@
 void inGameMenuEntry( event_t ev );
 void inGameMenuExit( event_t ev );
 void gameMenu_goBack2( event_t ev);
+void gameMenu_toggleHints( event_t ev);
@@ -17,6 +17,7 @@
 #include "st_fixBoard.h"
 #include "board.h"
 #include "diag.h"
+#include "tb.h"
 
 uint64_t occupiedSquares;
 extern bool_t computerMovePending;
@@ -136,6 +137,7 @@ void moveForComputer_boardChange( event_t ev)
 static void evaluateNextAction( void )
 {
      event_t event;
+     endReason_t reason;
 
       int totalMovesFound = findMoves(&game.brd , NULL);
 
@@ -155,6 +157,12 @@ static void evaluateNextAction( void )
             event.data = GAME_END_STALEMATE;
          }
       }
+      // The tablebases decided the game while the move was being made
+      else if(TB_adjudication(&reason))
+      {
+         event.ev = EV_GAME_DONE;
+         event.data = reason;
+      }
       else
       {
          game.graceTime = 0;
@@ -15,6 +15,8 @@
 #include "options.h"
 #include "bitboard.h"
 #include "st_fixBoard.h"
+#include "hint.h"
+#include "idle.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -73,7 +75,7 @@ void playerMoveEntry( event_t ev )
 
    displayClearLine(0);
 
-   if(strcmp(getOptionStr("whitePlayer"),getOptionStr("blackPlayer")))
+   if(getOption(OPT_WHITE_PLAYER) != getOption(OPT_BLACK_PLAYER))
       displayWriteLine(0, "Human's Move", TRUE);
    else if(game.brd.toMove == WHITE)
       displayWriteLine(0, "White's Move", TRUE);
@@ -90,10 +92,17 @@ void playerMoveEntry( event_t ev )
 
    dirtySquares    = 0;
    boardChangeCount = 0;
+
+   HINT_start();
+   IDLE_start();
 }
 
 void playerMoveExit( event_t ev )
 {
+   HINT_cancel();
+   IDLE_cancel();
+   IDLE_collect();
+
    // Leave LEDs on in case we are going to the in-game menu state
 }
 
@@ -102,6 +111,10 @@ void playerMoves_boardChange( event_t ev)
    move_t     *moveMade;
    moveVal_t  moveProgress;
 
+   // A hint is no use once a piece has moved;  stop the engine straight away
+   HINT_cancel();
+   IDLE_cancel();
+
    // Find out which squares have pieces on them
    occupiedSquares = GetSwitchStates();
 
@@ -178,7 +191,7 @@ void playerMoves_boardChange( event_t ev)
          }
 
 
-         if(isOptionStr("coaching", "true")                   && // Coaching is on
+         if(getOption(OPT_COACHING)                   && // Coaching is on
             dirtySquares == squareMask[ev.data]             && // Only dirty square is the one just changed
             (game.brd.colors[game.brd.toMove] & dirtySquares) )    // and it belongs to the player on move
          {
@@ -197,6 +210,13 @@ void playerMoves_boardChange( event_t ev)
          {
             LED_SetGridState(dirtySquares);
          }
+
+         // Back to the position:  pick the hint up again
+         if(dirtySquares == 0)
+         {
+            HINT_start();
+            IDLE_start();
+         }
          break;
 
       case MV_ILLEGAL:
@@ -285,7 +305,7 @@ static void calculateMoveEffects(const move_t *moves, const board_t *brd, moveEf
 
    if(num <= 0)
    {
-      DPRINT("Error: Trying to calculate move effects with zero (or negative) num\n");
+      DLOG(DIAG_ERROR, "Error: Trying to calculate move effects with zero (or negative) num\n");
       return;
    }
 
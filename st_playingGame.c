@@ -17,6 +17,8 @@
 #include "display.h"
 
 #include "sfInterface.h"
+#include "tb.h"
+#include "moveRecord.h"
 
 extern game_t game;
 
@@ -24,7 +26,7 @@ extern game_t game;
 
 bool_t computerMovePending = FALSE;
 
-static void showMoveHistory(char* string);
+static void showMoveHistory( const moveRecord_t *record );
 
 void playingGameEntry( event_t ev )
 {
@@ -34,13 +36,13 @@ void playingGameEntry( event_t ev )
    if(
        (
        (game.brd.toMove == WHITE &&
-       isOptionStr("whitePlayer","human"))
+       getOption(OPT_WHITE_PLAYER) == PLAYER_HUMAN)
        ||
        (game.brd.toMove == BLACK &&
-       isOptionStr("blackPlayer","human"))
+       getOption(OPT_BLACK_PLAYER) == PLAYER_HUMAN)
        )
        &&
-       isOptionStr("timeControl", "untimed")
+       getOption(OPT_TIME_CONTROL) == TIME_NONE
       )
    {
       displayWriteLine(3, "Untimed Game", true);
@@ -48,20 +50,20 @@ void playingGameEntry( event_t ev )
 
 
    // If computer is on move with no clocks, note the strategy it is using...
-   else if(isOptionStr("timeControl", "untimed"))
+   else if(getOption(OPT_TIME_CONTROL) == TIME_NONE)
    {
-      if(isOptionStr("computerStrategy", "fixedTime"))
+      if(getOption(OPT_COMPUTER_STRATEGY) == STRAT_FIXED_TIME)
          displayWriteLine(3, "Fixed time search", true);
 
-      else if(isOptionStr("computerStrategy", "fixedDepth"))
+      else if(getOption(OPT_COMPUTER_STRATEGY) == STRAT_FIXED_DEPTH)
          displayWriteLine(3, "Fixed depth search", true);
 
-      else if(isOptionStr("computerStrategy", "tillButton"))
+      else if(getOption(OPT_COMPUTER_STRATEGY) == STRAT_TILL_BUTTON)
          displayWriteLine(3, "Search till button", true);
    }
 
    // Display the last few moves...
-   showMoveHistory(game.SANRecord);
+   showMoveHistory(&game.SANRecord);
 }
 
 void playingGameExit( event_t ev )
@@ -74,24 +76,20 @@ void playingGame_processSelectedMove( move_t mv)
 {
    event_t ev;
    int16_t totalMovesFound;
+   char text[MOVE_TEXT_MAX];
 
    DPRINT("ProcessSelectedMove()\n");
 
    // Record the selected move
    game.posHistory[game.playedMoves].move = mv;
 
-   if(strlen(game.SANRecord)!= 0)
-      strcat(game.SANRecord," ");
-
    if(game.brd.toMove == WHITE)
-   {
-      char temp[4];
-      sprintf(temp, "%d.", game.brd.moveNumber);
-      strcat(game.SANRecord, temp);
-   }
+      snprintf(text, sizeof(text), "%d.%s", game.brd.moveNumber, moveToSAN(mv, &game.brd));
+   else
+      snprintf(text, sizeof(text), "%s", moveToSAN(mv, &game.brd));
 
-   strcat(game.SANRecord, moveToSAN(mv, &game.brd));
-   showMoveHistory(game.SANRecord);
+   MOVEREC_append(&game.SANRecord, text);
+   showMoveHistory(&game.SANRecord);
 
    // Make the move on the board and store reverse information
    game.posHistory[game.playedMoves].revMove = move(&game.brd, mv);
@@ -102,14 +100,14 @@ void playingGame_processSelectedMove( move_t mv)
       // Set back in range...
       game.playedMoves = MAX_MOVES_IN_GAME - 1;
 
-      DPRINT("ERROR: Game exceeded %d moves... undo no longer possible", MAX_MOVES_IN_GAME);
+      DLOG(DIAG_ERROR, "ERROR: Game exceeded %d moves... undo no longer possible", MAX_MOVES_IN_GAME);
    }
 
    game.posHistory[game.playedMoves].posHash = game.brd.hash;
 
 
    // If this is an equal time setting, it may be time to move to a new period
-   if(isOptionStr("timeControl", "equal"))
+   if(getOption(OPT_TIME_CONTROL) == TIME_EQUAL)
    {
       uint8_t periodOneMoves;
 
@@ -166,19 +164,18 @@ void playingGame_processSelectedMove( move_t mv)
    game.posHistory[game.playedMoves].clocks[BLACK] = game.btime;
 
    // pump out to move record...
-   if(strlen(game.moveRecord) != 0)
-      strcat(game.moveRecord," ");
-
-   strcat(game.moveRecord, convertSqNumToCoord(mv.from));
-   strcat(game.moveRecord, convertSqNumToCoord(mv.to));
+   strcpy(text, convertSqNumToCoord(mv.from));
+   strcat(text, convertSqNumToCoord(mv.to));
    switch(mv.promote)
    {
-      case QUEEN:  strcat(game.moveRecord, "q"); break;
-      case ROOK:   strcat(game.moveRecord, "r"); break;
-      case BISHOP: strcat(game.moveRecord, "b"); break;
-      case KNIGHT: strcat(game.moveRecord, "n"); break;
+      case QUEEN:  strcat(text, "q"); break;
+      case ROOK:   strcat(text, "r"); break;
+      case BISHOP: strcat(text, "b"); break;
+      case KNIGHT: strcat(text, "n"); break;
    }
 
+   MOVEREC_append(&game.moveRecord, text);
+
 
    // These first two are not optional and have no associated options with them.
    // TODO test for 75-move rule
@@ -206,8 +203,8 @@ void playingGame_processSelectedMove( move_t mv)
    // if(game.brd.halfMoves >= 100)
 
    // If a computer just finished,
-   if( (game.brd.toMove == WHITE && isOptionStr("blackPlayer", "computer")) ||
-       (game.brd.toMove == BLACK && isOptionStr("whitePlayer", "computer")))
+   if( (game.brd.toMove == WHITE && getOption(OPT_BLACK_PLAYER) == PLAYER_COMPUTER) ||
+       (game.brd.toMove == BLACK && getOption(OPT_WHITE_PLAYER) == PLAYER_COMPUTER))
    {
          // This will ultimately move us to the ST_MOVE_FOR_COMPUTER state
          ev.ev = EV_GOTO_PLAYING_GAME;
@@ -240,6 +237,10 @@ void playingGame_processSelectedMove( move_t mv)
       }
    }
 
+   // Play goes on:  have the tablebases looked at (the answer comes back as EV_TB_RESULT)
+   if(ev.ev == EV_GOTO_PLAYING_GAME)
+      TB_probe();
+
    putEvent(EVQ_EVENT_MANAGER, &ev);
 }
 
@@ -250,34 +251,23 @@ uint16_t playingGamePickSubstate( event_t ev)
       return ST_MOVE_FOR_COMPUTER;
 
    else if(game.brd.toMove == WHITE)
-      if(isOptionStr("whitePlayer", "human"))
+      if(getOption(OPT_WHITE_PLAYER) == PLAYER_HUMAN)
          return ST_PLAYER_MOVE;
       else
          return ST_COMPUTER_MOVE;
 
    else
-      if(isOptionStr("blackPlayer", "human"))
+      if(getOption(OPT_BLACK_PLAYER) == PLAYER_HUMAN)
          return ST_PLAYER_MOVE;
       else
          return ST_COMPUTER_MOVE;
 
 }
 
-static void showMoveHistory(char* string)
+static void showMoveHistory( const moveRecord_t *record )
 {
-
-   // As long as the string is too long...
-   while(strlen(string) > 20)
-   {
-      // search for the next space character
-      while(*string != ' ') string++;
-
-      // Advance beyond it to the next character
-      string++;
-   }
-
-   displayWriteLine(1, string, true);
-
+   // As many of the last moves as fit on the line
+   displayWriteLine(1, (char *)MOVEREC_tail(record, 20), true);
 }
 
 
@@ -61,19 +61,19 @@ void timeOptionNavButtonHandler( event_t ev)
                {
                   case 1:
                   default:
-                     setOptionStr("timeControl", "equal");
+                     setOption(OPT_TIME_CONTROL, TIME_EQUAL);
                      period = 1;
                      subState = SUBSTATE_EVEN;
                      drawEvenScreen(period);
                      break;
                   case 2:
-                     setOptionStr("timeControl", "odds");
+                     setOption(OPT_TIME_CONTROL, TIME_ODDS);
                      subState = SUBSTATE_ODDS;
                      pickRow = 0;
                      drawOddsScreen();
                      break;
                   case 3:
-                     setOptionStr("timeControl", "untimed");
+                     setOption(OPT_TIME_CONTROL, TIME_NONE);
                      subState = SUBSTATE_UNTIMED;
                      pickRow = 1;
                      drawUntimedScreen();
@@ -213,11 +213,11 @@ void timeOptionNavButtonHandler( event_t ev)
             case SUBSTATE_UNTIMED:
                if(pickRow == 1)
                {
-                  long int depth = getOptionVal("searchDepth");
+                  long int depth = getOption(OPT_SEARCH_DEPTH);
                   if(depth > MIN_PLY_DEPTH)
                   {
                      char temp[4];
-                     setOptionVal("searchDepth",depth-1);
+                     setOption(OPT_SEARCH_DEPTH,depth-1);
                      sprintf(temp,"%3ld",depth-1);
                      displayWriteChars(1,17,3,temp);
                   }
@@ -251,11 +251,11 @@ void timeOptionNavButtonHandler( event_t ev)
                   displayWriteLine(2, " Time Odds", FALSE);
                   displayWriteLine(3, " No Time", FALSE);
 
-                  if(isOptionStr("timeControl", "equal"))
+                  if(getOption(OPT_TIME_CONTROL) == TIME_EQUAL)
                      pickRow = 1;
-                  else if(isOptionStr("timeControl", "odds"))
+                  else if(getOption(OPT_TIME_CONTROL) == TIME_ODDS)
                      pickRow = 2;
-                  else if(isOptionStr("timeControl", "untimed"))
+                  else if(getOption(OPT_TIME_CONTROL) == TIME_NONE)
                      pickRow = 3;
 
                   displayWriteChars(pickRow,0,1,">");
@@ -364,12 +364,12 @@ void timeOptionNavButtonHandler( event_t ev)
                if(pickRow == 1)
                {
 
-                  long int depth = getOptionVal("searchDepth");
+                  long int depth = getOption(OPT_SEARCH_DEPTH);
 
                   if(depth < MAX_PLY_DEPTH)
                   {
                      char temp[4];
-                     setOptionVal("searchDepth",depth+1);
+                     setOption(OPT_SEARCH_DEPTH,depth+1);
                      sprintf(temp,"%3ld",depth+1);
                      displayWriteChars(1,17,3,temp);
                   }
@@ -440,20 +440,20 @@ void timeOptionNavButtonHandler( event_t ev)
                   if(pickRow == 1)
                   {
                      char temp[4];
-                     setOptionStr("computerStrategy", "fixedDepth");
-                     sprintf(temp,"%3ld",getOptionVal("searchDepth"));
+                     setOption(OPT_COMPUTER_STRATEGY, STRAT_FIXED_DEPTH);
+                     sprintf(temp,"%3ld",getOption(OPT_SEARCH_DEPTH));
                      displayWriteChars(pickRow,17,3,temp);
                   }
                   else if (pickRow == 2)
                   {
                      char temp[4];
-                     setOptionStr("computerStrategy", "fixedTime");
+                     setOption(OPT_COMPUTER_STRATEGY, STRAT_FIXED_TIME);
                      sprintf(temp,"%3d",options.game.timeControl.compStrategySetting.timeInMs / 1000);
                      displayWriteChars(pickRow,17,3,temp);
                   }
                   else
                   {
-                     setOptionStr("computerStrategy", "tillButton");
+                     setOption(OPT_COMPUTER_STRATEGY, STRAT_TILL_BUTTON);
                   }
                }
                break;
@@ -511,20 +511,20 @@ void timeOptionNavButtonHandler( event_t ev)
                   if(pickRow == 1)
                   {
                      char temp[4];
-                     setOptionStr("computerStrategy", "fixedDepth");
-                     sprintf(temp,"%3ld",getOptionVal("searchDepth"));
+                     setOption(OPT_COMPUTER_STRATEGY, STRAT_FIXED_DEPTH);
+                     sprintf(temp,"%3ld",getOption(OPT_SEARCH_DEPTH));
                      displayWriteChars(pickRow,17,3,temp);
                   }
                   else if (pickRow == 2)
                   {
                      char temp[4];
-                     setOptionStr("computerStrategy", "fixedTime");
+                     setOption(OPT_COMPUTER_STRATEGY, STRAT_FIXED_TIME);
                      sprintf(temp,"%3d",options.game.timeControl.compStrategySetting.timeInMs / 1000);
                      displayWriteChars(pickRow,17,3,temp);
                   }
                   else
                   {
-                     setOptionStr("computerStrategy", "tillButton");
+                     setOption(OPT_COMPUTER_STRATEGY, STRAT_TILL_BUTTON);
 
                   }
                }
@@ -549,23 +549,23 @@ static void drawStatusScreen( void )
    displayClear();
 
 
-   if(isOptionStr("timeControl", "untimed"))
+   if(getOption(OPT_TIME_CONTROL) == TIME_NONE)
    {
          displayWriteLine(0, "Untimed Game", TRUE);
          displayWriteLine(1, "Computer will search", TRUE);
 
-         if     (isOptionStr("computerStrategy", "fixedTime"))
+         if     (getOption(OPT_COMPUTER_STRATEGY) == STRAT_FIXED_TIME)
             sprintf(tempString,"for %d seconds", options.game.timeControl.compStrategySetting.timeInMs / 1000);
-         else if(isOptionStr("computerStrategy", "fixedDepth"))
-            sprintf(tempString,"for %ld ply", getOptionVal("searchDepth"));
-         else if(isOptionStr("computerStrategy", "tillButton"))
+         else if(getOption(OPT_COMPUTER_STRATEGY) == STRAT_FIXED_DEPTH)
+            sprintf(tempString,"for %ld ply", getOption(OPT_SEARCH_DEPTH));
+         else if(getOption(OPT_COMPUTER_STRATEGY) == STRAT_TILL_BUTTON)
             sprintf(tempString,"until button press");
          else
             sprintf(tempString, "???");
 
          displayWriteLine(2, tempString, TRUE);
    }
-   else if(isOptionStr("timeControl", "equal"))
+   else if(getOption(OPT_TIME_CONTROL) == TIME_EQUAL)
    {
 
          strcpy(lineString[0], createPeriodSummary(&options.game.timeControl.timeSettings[0]));
@@ -604,7 +604,7 @@ static void drawStatusScreen( void )
          }
 
    }
-   else if(isOptionStr("timeControl", "odds"))
+   else if(getOption(OPT_TIME_CONTROL) == TIME_ODDS)
    {
 
          displayWriteLine(0, "Time Odds Game", TRUE);
@@ -694,9 +694,9 @@ static void drawUntimedScreen( void )
 
    displayWriteLine(0,"-Computer Strategy--", FALSE);
 
-   if(isOptionStr("computerStrategy", "fixedDepth"))
+   if(getOption(OPT_COMPUTER_STRATEGY) == STRAT_FIXED_DEPTH)
    {
-      sprintf(lineText, ">Fixed Depth(ply) %2ld", getOptionVal("searchDepth"));
+      sprintf(lineText, ">Fixed Depth(ply) %2ld", getOption(OPT_SEARCH_DEPTH));
       pickRow = 1;
    }
    else
@@ -705,7 +705,7 @@ static void drawUntimedScreen( void )
    }
    displayWriteLine(1,lineText, FALSE);
 
-   if(isOptionStr("computerStrategy", "fixedTime"))
+   if(getOption(OPT_COMPUTER_STRATEGY) == STRAT_FIXED_TIME)
    {
       sprintf(lineText, ">Fixed Time(sec) %3d", options.game.timeControl.compStrategySetting.timeInMs / 1000);
       pickRow = 2;
@@ -716,7 +716,7 @@ static void drawUntimedScreen( void )
    }
    displayWriteLine(2,lineText, FALSE);
 
-   if(isOptionStr("computerStrategy", "tillButton"))
+   if(getOption(OPT_COMPUTER_STRATEGY) == STRAT_TILL_BUTTON)
    {
       displayWriteLine(3,">Until Button", FALSE);
       pickRow = 3;
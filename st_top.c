@@ -2,7 +2,7 @@
 #include "hsmDefs.h"
 #include "st_top.h"
 
-#include "bcm2835.h"
+#include "hal.h"
 #include "diag.h"
 #include "options.h"
 #include "timer.h"
@@ -12,7 +12,9 @@
 #include "led.h"
 #include "switch.h"
 #include "event.h"
+#include "trace.h"
 #include "st_inGame.h"
+#include "sfInterface.h"
 #include "hsmDefs.h"
 
 
@@ -23,13 +25,20 @@ void topEntry( event_t ev )
    if(!initDone)
    {
       // Init the hardware
-      bcm2835_init();
+      HAL_init();
+
+      // Start the diagnostic output
+      DIAG_init();
 
       DPRINT("Program start\n");
 
       // set all options
       loadOptions();
 
+      // Record everything from here on if asked to
+      if(getOption(OPT_EVENT_TRACE))
+         TRACE_start(TRACE_FILE);
+
       // Set up the timer tic...
       timerInit();
 
@@ -51,6 +60,9 @@ void topEntry( event_t ev )
 
       timerStart(TMR_UI_BOX_CHECK, 1000, 1000, EV_UI_BOX_CHECK);
 
+      // Get the standby engines going, so even the first game has one ready
+      SF_refreshPool();
+
 
       initDone = TRUE;
 
@@ -19,10 +19,12 @@
 */
 
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <istream>
 #include <vector>
 
+#include "evaluate.h"
 #include "misc.h"
 #include "position.h"
 #include "search.h"
@@ -181,3 +183,145 @@ void benchmark(const Position& current, istream& is) {
        << "\nNodes searched  : " << nodes
        << "\nNodes/second    : " << 1000 * nodes / elapsed << endl;
 }
+
+
+/// eval_cache_benchmark() measures what the eval cache does for the speed of
+/// the search: it searches the benchmark positions without the cache and then
+/// with it, both times from cleared tables. The parameters are the cache size
+/// in MB (default 16), the depth (default 13) and the number of threads
+/// (default 1). With one thread the node counts are the same both times, the
+/// cache only saves evaluating positions again.
+
+void eval_cache_benchmark(istream& is) {
+
+  string token;
+  Search::LimitsType limits;
+
+  string cacheSize = (is >> token) ? token : "16";
+  string depth     = (is >> token) ? token : "13";
+  string threads   = (is >> token) ? token : "1";
+
+  const int savedSize = Options["EvalCache"];
+  uint64_t nodes[2];
+  TimePoint elapsed[2];
+  HashStats evals;
+  Position pos;
+
+  Options["Threads"] = threads;
+  limits.depth = stoi(depth);
+
+  for (int on = 0; on <= 1; ++on)
+  {
+      Options["EvalCache"] = on ? cacheSize : "0";
+      Search::clear();
+
+      nodes[on] = 0;
+      elapsed[on] = now();
+
+      for (const string& fen : Defaults)
+      {
+          StateListPtr states(new std::deque<StateInfo>(1));
+          pos.set(fen, false, &states->back(), Threads.main());
+
+          limits.startTime = now();
+          Threads.start_thinking(pos, states, limits);
+          Threads.main()->wait_for_search_finished();
+          nodes[on] += Threads.nodes_searched();
+
+          if (on)
+              evals += Threads.eval_stats();
+      }
+
+      elapsed[on] = now() - elapsed[on] + 1;
+  }
+
+  Options["EvalCache"] = std::to_string(savedSize);
+
+  uint64_t nps[] = { 1000 * nodes[0] / elapsed[0], 1000 * nodes[1] / elapsed[1] };
+
+  cerr << "\n==========================="
+       << "\nEval cache      : none / " << cacheSize << " MB"
+       << "\nNodes searched  : " << nodes[0] << " / " << nodes[1]
+       << "\nNodes/second    : " << nps[0] << " / " << nps[1]
+       << fixed << setprecision(1)
+       << "\nSpeed up        : " << 100.0 * nps[1] / nps[0] - 100 << "%"
+       << "\nCache hits      : " << (evals.probes ? 100.0 * evals.hits / evals.probes : 0.0)
+       << "% of " << evals.probes << " evaluations" << endl;
+}
+
+
+/// smp_benchmark() compares the two ways of searching with several threads,
+/// lazy SMP and the root split ("RootSplit"), by time to depth: it searches the
+/// benchmark positions to a fixed depth with 1, 2 and 4 threads, each time from
+/// cleared tables, and reports the time taken and the speed-up over 1 thread.
+/// The parameters are the depth (default 13) and the hash size in MB (default 16).
+
+void smp_benchmark(istream& is) {
+
+  string token;
+  Search::LimitsType limits;
+
+  string depth    = (is >> token) ? token : "13";
+  string ttSize   = (is >> token) ? token : "16";
+
+  const int savedThreads = Options["Threads"], savedSize = Options["Hash"];
+  const bool savedSplit = Options["RootSplit"];
+  const int threads[] = { 1, 2, 4 };
+  TimePoint elapsed[2][3];
+  uint64_t nodes[2][3];
+  Position pos;
+
+  Options["Hash"] = ttSize;
+  limits.depth = stoi(depth);
+
+  for (int split = 0; split <= 1; ++split)
+      for (int t = 0; t < 3; ++t)
+      {
+          // With one thread there is nothing to split
+          if (split && threads[t] == 1)
+          {
+              elapsed[1][t] = elapsed[0][t], nodes[1][t] = nodes[0][t];
+              continue;
+          }
+
+          Options["RootSplit"] = string(split ? "true" : "false");
+          Options["Threads"] = std::to_string(threads[t]);
+          Search::clear();
+
+          nodes[split][t] = 0;
+          elapsed[split][t] = now();
+
+          for (const string& fen : Defaults)
+          {
+              StateListPtr states(new std::deque<StateInfo>(1));
+              pos.set(fen, false, &states->back(), Threads.main());
+
+              limits.startTime = now();
+              Threads.start_thinking(pos, states, limits);
+              Threads.main()->wait_for_search_finished();
+              nodes[split][t] += Threads.nodes_searched();
+          }
+
+          elapsed[split][t] = now() - elapsed[split][t] + 1;
+      }
+
+  Options["Threads"] = std::to_string(savedThreads);
+  Options["Hash"] = std::to_string(savedSize);
+  Options["RootSplit"] = string(savedSplit ? "true" : "false");
+
+  cerr << "\n==========================="
+       << "\nTime to depth " << depth << " (ms), nodes and speed-up over 1 thread"
+       << fixed << setprecision(2);
+
+  for (int split = 0; split <= 1; ++split)
+  {
+      cerr << (split ? "\nRoot split" : "\nLazy SMP");
+
+      for (int t = 0; t < 3; ++t)
+          cerr << "\n  " << threads[t] << " thread" << (t ? "s : " : "  : ")
+               << setw(8) << elapsed[split][t] << setw(12) << nodes[split][t]
+               << setw(8) << double(elapsed[split][0]) / elapsed[split][t];
+  }
+
+  cerr << endl;
+}
@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "bitboard.h"
+#include "tables.h"
 #include "types.h"
 
 namespace {
@@ -82,6 +83,14 @@ bool Bitbases::probe(Square wksq, Square wpsq, Square bksq, Color us) {
 }
 
 
+/// Bitbases::tables() lists the bitbase for the tables file
+
+void Bitbases::tables(std::vector<Tables::Block>& blocks) {
+
+  blocks.push_back({ "KPKBitbase", KPKBitbase, sizeof(KPKBitbase) });
+}
+
+
 void Bitbases::init() {
 
   std::vector<KPKPosition> db(MAX_INDEX);
@@ -22,6 +22,7 @@
 
 #include "bitboard.h"
 #include "misc.h"
+#include "tables.h"
 
 uint8_t PopCnt16[1 << 16];
 int SquareDistance[SQUARE_NB][SQUARE_NB];
@@ -66,6 +67,8 @@ namespace {
   void init_magics(Bitboard table[], Bitboard* attacks[], Bitboard magics[],
                    Bitboard masks[], unsigned shifts[], Square deltas[], Fn index);
 
+  void link_table(Bitboard table[], Bitboard* attacks[], Bitboard masks[]);
+
   // bsf_index() returns the index into BSFTable[] to look up the bitscan. Uses
   // Matt Taylor's folding for 32 bit case, extended to 64 bit by Kim Walisch.
 
@@ -146,6 +149,37 @@ const std::string Bitboards::pretty(Bitboard b) {
 }
 
 
+/// Bitboards::tables() lists the tables init() fills in, for the tables file.
+/// The attack pointers aren't among them: they point into RookTable[] and
+/// BishopTable[], so link_attacks() sets them again after a load.
+
+#define BLOCK(t) Tables::Block{ #t, t, sizeof(t) }
+
+void Bitboards::tables(std::vector<Tables::Block>& blocks) {
+
+  blocks.insert(blocks.end(), {
+      BLOCK(PopCnt16), BLOCK(SquareDistance), BLOCK(MSBTable), BLOCK(BSFTable),
+      BLOCK(RookMasks), BLOCK(RookMagics), BLOCK(RookShifts), BLOCK(RookTable),
+      BLOCK(BishopMasks), BLOCK(BishopMagics), BLOCK(BishopShifts), BLOCK(BishopTable),
+      BLOCK(SquareBB), BLOCK(FileBB), BLOCK(RankBB), BLOCK(AdjacentFilesBB),
+      BLOCK(InFrontBB), BLOCK(StepAttacksBB), BLOCK(BetweenBB), BLOCK(LineBB),
+      BLOCK(DistanceRingBB), BLOCK(ForwardBB), BLOCK(PassedPawnMask),
+      BLOCK(PawnAttackSpan), BLOCK(PseudoAttacks) });
+}
+
+#undef BLOCK
+
+
+/// Bitboards::link_attacks() points RookAttacks[] and BishopAttacks[] at each
+/// square's slice of the attack tables, which are laid out by the masks.
+
+void Bitboards::link_attacks() {
+
+  link_table(RookTable, RookAttacks, RookMasks);
+  link_table(BishopTable, BishopAttacks, BishopMasks);
+}
+
+
 /// Bitboards::init() initializes various bitboard tables. It is called at
 /// startup and relies on global objects to be already zero-initialized.
 
@@ -250,6 +284,18 @@ namespace {
   }
 
 
+  // link_table() sets the attacks[] pointers as init_magics() does: each
+  // square's attacks take 2 to the power of the bits in its mask.
+
+  void link_table(Bitboard table[], Bitboard* attacks[], Bitboard masks[]) {
+
+    attacks[SQ_A1] = table;
+
+    for (Square s = SQ_A1; s < SQ_H8; ++s)
+        attacks[s + 1] = attacks[s] + (1 << popcount(masks[s]));
+  }
+
+
   // init_magics() computes all rook and bishop attacks at startup. Magic
   // bitboards are used to look up attacks of sliding pieces. As a reference see
   // chessprogramming.wikispaces.com/Magic+Bitboards. In particular, here we
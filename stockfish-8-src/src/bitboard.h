@@ -22,12 +22,16 @@
 #define BITBOARD_H_INCLUDED
 
 #include <string>
+#include <vector>
 
 #include "types.h"
 
+namespace Tables { struct Block; }
+
 namespace Bitbases {
 
 void init();
+void tables(std::vector<Tables::Block>& blocks);
 bool probe(Square wksq, Square wpsq, Square bksq, Color us);
 
 }
@@ -35,6 +39,8 @@ bool probe(Square wksq, Square wpsq, Square bksq, Color us);
 namespace Bitboards {
 
 void init();
+void tables(std::vector<Tables::Block>& blocks);
+void link_attacks();
 const std::string pretty(Bitboard b);
 
 }
@@ -925,3 +925,31 @@ std::string Eval::trace(const Position& pos) {
 
   return ss.str();
 }
+
+
+Eval::CacheTable Eval::Cache; // Global object
+
+
+/// CacheTable::resize() sets the size of the eval cache in megabytes, rounded
+/// down to a power of two entries. 0 frees it.
+
+void Eval::CacheTable::resize(size_t mbSize) {
+
+  size_t entries = 0;
+
+  if (mbSize)
+      for (entries = 1; entries * 2 * sizeof(Entry) <= (mbSize << 20); entries *= 2) {}
+
+  mem.assign(entries ? entries + CacheLineSize / sizeof(Entry) : 0, Entry());
+  mem.shrink_to_fit();
+  table = entries ? (Entry*)((uintptr_t(mem.data()) + CacheLineSize - 1) & ~uintptr_t(CacheLineSize - 1)) : nullptr;
+  mask = entries ? entries - 1 : 0;
+}
+
+
+/// CacheTable::clear() empties the eval cache
+
+void Eval::CacheTable::clear() {
+
+  std::fill(mem.begin(), mem.end(), Entry());
+}
@@ -22,6 +22,7 @@
 #define EVALUATE_H_INCLUDED
 
 #include <string>
+#include <vector>
 
 #include "types.h"
 
@@ -35,6 +36,53 @@ std::string trace(const Position& pos);
 
 template<bool DoTrace = false>
 Value evaluate(const Position& pos);
-}
+
+
+/// Eval::Cache keeps the static evaluations made in search by position key,
+/// for all the threads ("EvalCache" option, in MB; none at 0). An entry is
+/// two 32 bit words: the upper half of the key xored with the value word, and
+/// the value word (the evaluation, with a bit set to tell it from an empty
+/// entry). There are no locks: a copy torn by another thread's write fails the
+/// check and is taken for a miss. The table is cache line aligned, so a probe
+/// touches one line.
+
+class CacheTable {
+
+  struct Entry {
+    uint32_t check, value;
+  };
+
+  static const int CacheLineSize = 64;
+  static const uint32_t Valid = 1 << 16;
+
+public:
+  void resize(size_t mbSize);
+  void clear();
+  bool enabled() const { return table != nullptr; } // Before probe() or save()
+
+  bool probe(Key key, Value& v) const {
+    Entry e = table[key & mask];
+    if ((e.check ^ e.value) != uint32_t(key >> 32) || !(e.value & Valid))
+        return false;
+    v = Value(int16_t(e.value));
+    return true;
+  }
+
+  void save(Key key, Value v) {
+    Entry& e = table[key & mask];
+    uint32_t value = Valid | uint16_t(v);
+    e.check = uint32_t(key >> 32) ^ value;
+    e.value = value;
+  }
+
+private:
+  std::vector<Entry> mem;
+  Entry* table = nullptr;
+  size_t mask = 0;
+};
+
+extern CacheTable Cache;
+
+} // namespace Eval
 
 #endif // #ifndef EVALUATE_H_INCLUDED
@@ -23,6 +23,7 @@
 #include "bitboard.h"
 #include "position.h"
 #include "search.h"
+#include "tables.h"
 #include "thread.h"
 #include "tt.h"
 #include "uci.h"
@@ -38,9 +39,8 @@ int main(int argc, char* argv[]) {
 
   UCI::init(Options);
   PSQT::init();
-  Bitboards::init();
+  Tables::init(argv[0]);
   Position::init();
-  Bitbases::init();
   Search::init();
   Pawns::init();
   Threads.init();
@@ -49,6 +49,7 @@ int main(int argc, char* argv[]) {
 
   UCI::loop(argc, argv);
 
+  TT.save(Options["HashFile"]);
   Threads.exit();
   return 0;
 }
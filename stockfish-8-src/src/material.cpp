@@ -113,112 +113,142 @@ namespace {
 
 namespace Material {
 
-/// Material::probe() looks up the current position's material configuration in
-/// the material hash table. It returns a pointer to the Entry if the position
-/// is found. Otherwise a new Entry is computed and stored there, so we don't
-/// have to recompute all when the same material configuration occurs again.
+SharedHashTable<Entry> SharedTable;
 
-Entry* probe(const Position& pos) {
+namespace {
 
-  Key key = pos.material_key();
-  Entry* e = pos.this_thread()->materialTable[key];
+  // compute() fills in e for the material configuration of pos. The endgame
+  // functions it points to are the thread's own, so the shared table must be
+  // cleared when threads are deleted.
 
-  if (e->key == key)
-      return e;
+  Entry* compute(const Position& pos, Key key, Entry* e) {
 
-  std::memset(e, 0, sizeof(Entry));
-  e->key = key;
-  e->factor[WHITE] = e->factor[BLACK] = (uint8_t)SCALE_FACTOR_NORMAL;
-  e->gamePhase = pos.game_phase();
+    std::memset(e, 0, sizeof(Entry));
+    e->key = key;
+    e->factor[WHITE] = e->factor[BLACK] = (uint8_t)SCALE_FACTOR_NORMAL;
+    e->gamePhase = pos.game_phase();
 
-  // Let's look if we have a specialized evaluation function for this particular
-  // material configuration. Firstly we look for a fixed configuration one, then
-  // for a generic one if the previous search failed.
-  if ((e->evaluationFunction = pos.this_thread()->endgames.probe<Value>(key)) != nullptr)
-      return e;
+    // Let's look if we have a specialized evaluation function for this particular
+    // material configuration. Firstly we look for a fixed configuration one, then
+    // for a generic one if the previous search failed.
+    if ((e->evaluationFunction = pos.this_thread()->endgames.probe<Value>(key)) != nullptr)
+        return e;
 
-  for (Color c = WHITE; c <= BLACK; ++c)
-      if (is_KXK(pos, c))
-      {
-          e->evaluationFunction = &EvaluateKXK[c];
-          return e;
-      }
+    for (Color c = WHITE; c <= BLACK; ++c)
+        if (is_KXK(pos, c))
+        {
+            e->evaluationFunction = &EvaluateKXK[c];
+            return e;
+        }
 
-  // OK, we didn't find any special evaluation function for the current material
-  // configuration. Is there a suitable specialized scaling function?
-  EndgameBase<ScaleFactor>* sf;
+    // OK, we didn't find any special evaluation function for the current material
+    // configuration. Is there a suitable specialized scaling function?
+    EndgameBase<ScaleFactor>* sf;
 
-  if ((sf = pos.this_thread()->endgames.probe<ScaleFactor>(key)) != nullptr)
-  {
-      e->scalingFunction[sf->strong_side()] = sf; // Only strong color assigned
-      return e;
-  }
+    if ((sf = pos.this_thread()->endgames.probe<ScaleFactor>(key)) != nullptr)
+    {
+        e->scalingFunction[sf->strong_side()] = sf; // Only strong color assigned
+        return e;
+    }
 
-  // We didn't find any specialized scaling function, so fall back on generic
-  // ones that refer to more than one material distribution. Note that in this
-  // case we don't return after setting the function.
-  for (Color c = WHITE; c <= BLACK; ++c)
-  {
-    if (is_KBPsKs(pos, c))
-        e->scalingFunction[c] = &ScaleKBPsK[c];
+    // We didn't find any specialized scaling function, so fall back on generic
+    // ones that refer to more than one material distribution. Note that in this
+    // case we don't return after setting the function.
+    for (Color c = WHITE; c <= BLACK; ++c)
+    {
+      if (is_KBPsKs(pos, c))
+          e->scalingFunction[c] = &ScaleKBPsK[c];
 
-    else if (is_KQKRPs(pos, c))
-        e->scalingFunction[c] = &ScaleKQKRPs[c];
+      else if (is_KQKRPs(pos, c))
+          e->scalingFunction[c] = &ScaleKQKRPs[c];
+    }
+
+    Value npm_w = pos.non_pawn_material(WHITE);
+    Value npm_b = pos.non_pawn_material(BLACK);
+
+    if (npm_w + npm_b == VALUE_ZERO && pos.pieces(PAWN)) // Only pawns on the board
+    {
+        if (!pos.count<PAWN>(BLACK))
+        {
+            assert(pos.count<PAWN>(WHITE) >= 2);
+
+            e->scalingFunction[WHITE] = &ScaleKPsK[WHITE];
+        }
+        else if (!pos.count<PAWN>(WHITE))
+        {
+            assert(pos.count<PAWN>(BLACK) >= 2);
+
+            e->scalingFunction[BLACK] = &ScaleKPsK[BLACK];
+        }
+        else if (pos.count<PAWN>(WHITE) == 1 && pos.count<PAWN>(BLACK) == 1)
+        {
+            // This is a special case because we set scaling functions
+            // for both colors instead of only one.
+            e->scalingFunction[WHITE] = &ScaleKPKP[WHITE];
+            e->scalingFunction[BLACK] = &ScaleKPKP[BLACK];
+        }
+    }
+
+    // Zero or just one pawn makes it difficult to win, even with a small material
+    // advantage. This catches some trivial draws like KK, KBK and KNK and gives a
+    // drawish scale factor for cases such as KRKBP and KmmKm (except for KBBKN).
+    if (!pos.count<PAWN>(WHITE) && npm_w - npm_b <= BishopValueMg)
+        e->factor[WHITE] = uint8_t(npm_w <  RookValueMg   ? SCALE_FACTOR_DRAW :
+                                   npm_b <= BishopValueMg ? 4 : 14);
+
+    if (!pos.count<PAWN>(BLACK) && npm_b - npm_w <= BishopValueMg)
+        e->factor[BLACK] = uint8_t(npm_b <  RookValueMg   ? SCALE_FACTOR_DRAW :
+                                   npm_w <= BishopValueMg ? 4 : 14);
+
+    if (pos.count<PAWN>(WHITE) == 1 && npm_w - npm_b <= BishopValueMg)
+        e->factor[WHITE] = (uint8_t) SCALE_FACTOR_ONEPAWN;
+
+    if (pos.count<PAWN>(BLACK) == 1 && npm_b - npm_w <= BishopValueMg)
+        e->factor[BLACK] = (uint8_t) SCALE_FACTOR_ONEPAWN;
+
+    // Evaluate the material imbalance. We use PIECE_TYPE_NONE as a place holder
+    // for the bishop pair "extended piece", which allows us to be more flexible
+    // in defining bishop pair bonuses.
+    const int PieceCount[COLOR_NB][PIECE_TYPE_NB] = {
+    { pos.count<BISHOP>(WHITE) > 1, pos.count<PAWN>(WHITE), pos.count<KNIGHT>(WHITE),
+      pos.count<BISHOP>(WHITE)    , pos.count<ROOK>(WHITE), pos.count<QUEEN >(WHITE) },
+    { pos.count<BISHOP>(BLACK) > 1, pos.count<PAWN>(BLACK), pos.count<KNIGHT>(BLACK),
+      pos.count<BISHOP>(BLACK)    , pos.count<ROOK>(BLACK), pos.count<QUEEN >(BLACK) } };
+
+    e->value = int16_t((imbalance<WHITE>(PieceCount) - imbalance<BLACK>(PieceCount)) / 16);
+    return e;
   }
 
-  Value npm_w = pos.non_pawn_material(WHITE);
-  Value npm_b = pos.non_pawn_material(BLACK);
+} // namespace
+
+
+/// Material::probe() looks up the current position's material configuration in
+/// the material hash table. It returns a pointer to the Entry if the position
+/// is found. Otherwise the entry is copied from the shared table if it is
+/// there, or a new Entry is computed and stored in both, so we don't have to
+/// recompute all when the same material configuration occurs again.
+
+Entry* probe(const Position& pos) {
+
+  Key key = pos.material_key();
+  Thread* th = pos.this_thread();
+  Entry* e = th->materialTable[key];
+
+  th->materialStats.probes++;
 
-  if (npm_w + npm_b == VALUE_ZERO && pos.pieces(PAWN)) // Only pawns on the board
+  if (e->key == key)
   {
-      if (!pos.count<PAWN>(BLACK))
-      {
-          assert(pos.count<PAWN>(WHITE) >= 2);
-
-          e->scalingFunction[WHITE] = &ScaleKPsK[WHITE];
-      }
-      else if (!pos.count<PAWN>(WHITE))
-      {
-          assert(pos.count<PAWN>(BLACK) >= 2);
-
-          e->scalingFunction[BLACK] = &ScaleKPsK[BLACK];
-      }
-      else if (pos.count<PAWN>(WHITE) == 1 && pos.count<PAWN>(BLACK) == 1)
-      {
-          // This is a special case because we set scaling functions
-          // for both colors instead of only one.
-          e->scalingFunction[WHITE] = &ScaleKPKP[WHITE];
-          e->scalingFunction[BLACK] = &ScaleKPKP[BLACK];
-      }
+      th->materialStats.hits++;
+      return e;
+  }
+
+  if (SharedTable.get(key, *e))
+  {
+      th->materialStats.sharedHits++;
+      return e;
   }
 
-  // Zero or just one pawn makes it difficult to win, even with a small material
-  // advantage. This catches some trivial draws like KK, KBK and KNK and gives a
-  // drawish scale factor for cases such as KRKBP and KmmKm (except for KBBKN).
-  if (!pos.count<PAWN>(WHITE) && npm_w - npm_b <= BishopValueMg)
-      e->factor[WHITE] = uint8_t(npm_w <  RookValueMg   ? SCALE_FACTOR_DRAW :
-                                 npm_b <= BishopValueMg ? 4 : 14);
-
-  if (!pos.count<PAWN>(BLACK) && npm_b - npm_w <= BishopValueMg)
-      e->factor[BLACK] = uint8_t(npm_b <  RookValueMg   ? SCALE_FACTOR_DRAW :
-                                 npm_w <= BishopValueMg ? 4 : 14);
-
-  if (pos.count<PAWN>(WHITE) == 1 && npm_w - npm_b <= BishopValueMg)
-      e->factor[WHITE] = (uint8_t) SCALE_FACTOR_ONEPAWN;
-
-  if (pos.count<PAWN>(BLACK) == 1 && npm_b - npm_w <= BishopValueMg)
-      e->factor[BLACK] = (uint8_t) SCALE_FACTOR_ONEPAWN;
-
-  // Evaluate the material imbalance. We use PIECE_TYPE_NONE as a place holder
-  // for the bishop pair "extended piece", which allows us to be more flexible
-  // in defining bishop pair bonuses.
-  const int PieceCount[COLOR_NB][PIECE_TYPE_NB] = {
-  { pos.count<BISHOP>(WHITE) > 1, pos.count<PAWN>(WHITE), pos.count<KNIGHT>(WHITE),
-    pos.count<BISHOP>(WHITE)    , pos.count<ROOK>(WHITE), pos.count<QUEEN >(WHITE) },
-  { pos.count<BISHOP>(BLACK) > 1, pos.count<PAWN>(BLACK), pos.count<KNIGHT>(BLACK),
-    pos.count<BISHOP>(BLACK)    , pos.count<ROOK>(BLACK), pos.count<QUEEN >(BLACK) } };
-
-  e->value = int16_t((imbalance<WHITE>(PieceCount) - imbalance<BLACK>(PieceCount)) / 16);
+  SharedTable.put(*compute(pos, key, e));
   return e;
 }
 
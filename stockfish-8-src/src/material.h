@@ -66,6 +66,8 @@ struct Entry {
 
 typedef HashTable<Entry, 8192> Table;
 
+extern SharedHashTable<Entry> SharedTable; // Used with "SharedEvalTables"
+
 Entry* probe(const Position& pos);
 
 } // namespace Material
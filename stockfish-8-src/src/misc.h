@@ -23,6 +23,7 @@
 
 #include <cassert>
 #include <chrono>
+#include <cstring>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -54,6 +55,86 @@ private:
 };
 
 
+/// SharedHashTable is a second level behind the per-thread HashTables, shared
+/// by all the threads and sized at run time (empty until resized). It has no
+/// locks: each slot holds a copy of an entry with a check word, the entry's key
+/// xored with all of the entry's 64 bit words. A copy read while another thread
+/// is writing the slot fails the check and is taken for a miss.
+
+template<class Entry>
+class SharedHashTable {
+
+  static_assert(sizeof(Entry) % sizeof(uint64_t) == 0, "Entry must be whole 64 bit words");
+
+  struct Slot {
+    uint64_t check;
+    Entry entry;
+  };
+
+  static uint64_t checksum(const Entry& e) {
+    uint64_t w[sizeof(Entry) / sizeof(uint64_t)], x = 0;
+    std::memcpy(w, &e, sizeof(Entry));
+    for (uint64_t v : w)
+        x ^= v;
+    return x;
+  }
+
+public:
+  // Room for bytes' worth of entries (a power of two, at least minEntries), or
+  // none if bytes is 0
+  void resize(size_t bytes, size_t minEntries) {
+    size_t n = 0;
+    if (bytes)
+        for (n = minEntries; n * 2 * sizeof(Slot) <= bytes; n *= 2) {}
+    table.assign(n, Slot());
+    clear();
+  }
+
+  void clear() {
+    for (Slot& s : table)
+        std::memset(&s, 0, sizeof(Slot)), s.check = ~uint64_t(0); // Matches no key
+  }
+
+  size_t size() const { return table.size(); }
+
+  // Copies the entry for key into e if there is one. Otherwise returns false,
+  // leaving e to be filled in from scratch.
+  bool get(Key key, Entry& e) const {
+    if (table.empty())
+        return false;
+    const Slot& s = table[key & (table.size() - 1)];
+    uint64_t check = s.check;
+    std::memcpy(&e, &s.entry, sizeof(Entry));
+    return e.key == key && (check ^ checksum(e)) == key;
+  }
+
+  void put(const Entry& e) {
+    if (table.empty())
+        return;
+    Slot& s = table[e.key & (table.size() - 1)];
+    s.check = e.key ^ checksum(e);
+    std::memcpy(&s.entry, &e, sizeof(Entry));
+  }
+
+private:
+  std::vector<Slot> table;
+};
+
+
+/// HashStats counts the lookups in a thread's pawn or material table: those
+/// found there, and those found in the shared table behind it. For the eval
+/// cache, which is shared to begin with, only hits are counted.
+
+struct HashStats {
+  void clear() { probes = hits = sharedHits = 0; }
+  HashStats& operator+=(const HashStats& s) {
+    probes += s.probes, hits += s.hits, sharedHits += s.sharedHits;
+    return *this;
+  }
+  uint64_t probes = 0, hits = 0, sharedHits = 0;
+};
+
+
 enum SyncCout { IO_LOCK, IO_UNLOCK };
 std::ostream& operator<<(std::ostream&, SyncCout);
 
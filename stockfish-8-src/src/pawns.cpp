@@ -201,23 +201,41 @@ void init() {
 }
 
 
+SharedHashTable<Entry> SharedTable;
+
+
 /// Pawns::probe() looks up the current position's pawns configuration in
 /// the pawns hash table. It returns a pointer to the Entry if the position
-/// is found. Otherwise a new Entry is computed and stored there, so we don't
-/// have to recompute all when the same pawns configuration occurs again.
+/// is found. Otherwise the entry is copied from the shared table if it is
+/// there, or a new Entry is computed and stored in both, so we don't have to
+/// recompute all when the same pawns configuration occurs again.
 
 Entry* probe(const Position& pos) {
 
   Key key = pos.pawn_key();
-  Entry* e = pos.this_thread()->pawnsTable[key];
+  Thread* th = pos.this_thread();
+  Entry* e = th->pawnsTable[key];
+
+  th->pawnStats.probes++;
 
   if (e->key == key)
+  {
+      th->pawnStats.hits++;
+      return e;
+  }
+
+  if (SharedTable.get(key, *e))
+  {
+      th->pawnStats.sharedHits++;
       return e;
+  }
 
   e->key = key;
   e->score = evaluate<WHITE>(pos, e) - evaluate<BLACK>(pos, e);
   e->asymmetry = popcount(e->semiopenFiles[WHITE] ^ e->semiopenFiles[BLACK]);
   e->openFiles = popcount(e->semiopenFiles[WHITE] & e->semiopenFiles[BLACK]);
+
+  SharedTable.put(*e); // Before any king safety, which each thread works out
   return e;
 }
 
@@ -80,6 +80,8 @@ struct Entry {
 
 typedef HashTable<Entry, 16384> Table;
 
+extern SharedHashTable<Entry> SharedTable; // Used with "SharedEvalTables"
+
 void init();
 Entry* probe(const Position& pos);
 
@@ -21,7 +21,10 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdio>
 #include <cstring>   // For std::memset
+#include <deque>
+#include <iomanip>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -32,6 +35,7 @@
 #include "movepick.h"
 #include "position.h"
 #include "search.h"
+#include "shmchannel.h"
 #include "timeman.h"
 #include "thread.h"
 #include "tt.h"
@@ -48,6 +52,7 @@ namespace Tablebases {
 
   int Cardinality;
   bool RootInTB;
+  bool RootDTZ;    // RootInTB from the DTZ tables, so the root moves are ranked
   bool UseRule50;
   Depth ProbeDepth;
   Value Score;
@@ -56,11 +61,33 @@ namespace Tablebases {
 namespace TB = Tablebases;
 
 using std::string;
-using Eval::evaluate;
 using namespace Search;
 
 namespace {
 
+  // evaluate() looks the position up in the eval cache first, where it may
+  // also find evaluations other threads have made
+  Value evaluate(const Position& pos) {
+
+    if (!Eval::Cache.enabled())
+        return Eval::evaluate(pos);
+
+    Thread* th = pos.this_thread();
+    Value v;
+
+    th->evalStats.probes++;
+
+    if (Eval::Cache.probe(pos.key(), v))
+    {
+        th->evalStats.hits++;
+        return v;
+    }
+
+    v = Eval::evaluate(pos);
+    Eval::Cache.save(pos.key(), v);
+    return v;
+  }
+
   // Different node types, used as a template parameter
   enum NodeType { NonPV, PV };
 
@@ -159,6 +186,31 @@ namespace {
   EasyMoveManager EasyMove;
   Value DrawValue[COLOR_NB];
 
+  // RootSplit is the state of the root split, the alternative to lazy SMP
+  // that the "RootSplit" option selects. In each iteration the main thread
+  // searches the first root move alone, and then all the threads share out
+  // the others. Each thread has a deque of root move indices: it takes from
+  // the front of its own and, once that is empty, steals from the back of the
+  // longest. Results are kept by move index and merged in root move order, so
+  // equal scores resolve the same way. The timing still matters: the alpha a
+  // move is searched with depends on which moves finished before it, and the
+  // threads share the TT, so scores and even the best move can differ from
+  // one run to the next.
+  struct RootSplit {
+    Mutex mutex;
+    ConditionVariable cv;
+    std::vector<std::deque<size_t>> queues; // [thread idx]
+    RootMoves moves;             // The main thread's, updated as they are searched
+    std::vector<Value> values;   // VALUE_NONE until searched
+    std::vector<Value> alphas;   // The alpha each was searched with
+    Depth depth;
+    Value alpha, beta;
+    size_t pending;              // Queued or being searched
+    bool active, finished;
+  };
+
+  RootSplit Split;
+
   template <NodeType NT>
   Value search(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth, bool cutNode);
 
@@ -171,6 +223,9 @@ namespace {
   void update_cm_stats(Stack* ss, Piece pc, Square s, Value bonus);
   void update_stats(const Position& pos, Stack* ss, Move move, Move* quiets, int quietsCnt, Value bonus);
   void check_time();
+  string eval_table_info();
+  Value split_root(MainThread* th, Stack* ss, Value alpha, Value beta, Depth depth);
+  void split_helper(Thread* th, Stack* ss);
 
 } // namespace
 
@@ -208,6 +263,8 @@ void Search::init() {
 void Search::clear() {
 
   TT.clear();
+  Eval::Cache.clear();
+  EasyMove.clear();
 
   for (Thread* th : Threads)
   {
@@ -215,6 +272,10 @@ void Search::clear() {
       th->counterMoves.clear();
       th->fromTo.clear();
       th->counterMoveHistory.clear();
+
+      // So that the time is checked at the same nodes as in a new engine
+      th->callsCnt = 0;
+      th->resetCalls = false;
   }
 
   Threads.main()->previousScore = VALUE_INFINITE;
@@ -264,6 +325,15 @@ void MainThread::search() {
   DrawValue[ us] = VALUE_DRAW - Value(contempt);
   DrawValue[~us] = VALUE_DRAW + Value(contempt);
 
+  // With SyzygyInstantMove a root position in the tablebases is answered from
+  // them at once, unless the GUI is analysing or waiting for "stop". Only the
+  // DTZ tables tell the moves apart: from the WDL ones alone every move that
+  // holds the result is as good, and the search picks among them.
+  bool tbMove =    TB::RootDTZ
+                &&  Options["SyzygyInstantMove"]
+                && !rootMoves.empty()
+                && !Limits.analysis && !Limits.infinite && !Limits.ponder;
+
   if (rootMoves.empty())
   {
       rootMoves.push_back(RootMove(MOVE_NONE));
@@ -271,13 +341,37 @@ void MainThread::search() {
                 << UCI::value(rootPos.checkers() ? -VALUE_MATE : VALUE_DRAW)
                 << sync_endl;
   }
+  else if (tbMove)
+  {
+      rootMoves.assign(1, RootMove(TB::best_move(rootMoves)));
+      rootMoves[0].score = TB::Score;
+
+      sync_cout << UCI::pv(rootPos, ONE_PLY, -VALUE_INFINITE, VALUE_INFINITE) << sync_endl;
+      ShmChannel::publish_pv(rootPos, ONE_PLY, -VALUE_INFINITE, VALUE_INFINITE);
+  }
   else
   {
+      // The root split only searches the one PV line, at full strength
+      Split.active =    Options["RootSplit"]
+                     && Threads.size() > 1
+                     && Options["MultiPV"] == 1
+                     && !Skill(Options["Skill Level"]).enabled();
+      Split.finished = false;
+      Split.queues.assign(Threads.size(), std::deque<size_t>());
+
       for (Thread* th : Threads)
           if (th != this)
               th->start_searching();
 
       Thread::search(); // Let's start searching!
+
+      // Let the helpers waiting for root moves go
+      if (Split.active)
+      {
+          std::unique_lock<Mutex> lk(Split.mutex);
+          Split.finished = true;
+          Split.cv.notify_all();
+      }
   }
 
   // When playing in 'nodes as time' mode, subtract the searched nodes from
@@ -304,9 +398,13 @@ void MainThread::search() {
       if (th != this)
           th->wait_for_search_finished();
 
+  if (Threads.pawn_stats().probes)
+      sync_cout << eval_table_info() << sync_endl;
+
   // Check if there are threads with a better score than main thread
   Thread* bestThread = this;
   if (   !this->easyMovePlayed
+      && !tbMove
       &&  Options["MultiPV"] == 1
       && !Limits.depth
       && !Skill(Options["Skill Level"]).enabled()
@@ -322,18 +420,38 @@ void MainThread::search() {
 
   // Send new PV when needed
   if (bestThread != this)
+  {
       sync_cout << UCI::pv(bestThread->rootPos, bestThread->completedDepth, -VALUE_INFINITE, VALUE_INFINITE) << sync_endl;
+      ShmChannel::publish_pv(bestThread->rootPos, bestThread->completedDepth, -VALUE_INFINITE, VALUE_INFINITE);
+  }
+
+  bool ponder =  bestThread->rootMoves[0].pv.size() > 1
+               || bestThread->rootMoves[0].extract_ponder_from_tt(rootPos);
 
-  myfile.open("result.txt");
+  // Publish before writing the result file: the GUI reads the whole search
+  // (nodes, time) from the channel once it sees the file.
+  ShmChannel::publish_bestmove(rootPos, bestThread->rootMoves[0].pv[0],
+                               ponder ? bestThread->rootMoves[0].pv[1] : MOVE_NONE);
+
+  // An analysis search (hints) has no move to play, so it leaves no result file
+  // for the GUI to pick up as one. It is written whole under another name and
+  // renamed, so the GUI never reads a line half written.
+  if (!Limits.analysis)
+  {
+      std::string resultFile = Options["ResultFile"], tmpFile = resultFile + ".tmp";
 
-  // sync_cout << "bestmove " << UCI::move(bestThread->rootMoves[0].pv[0], rootPos.is_chess960());
-  myfile << "bestmove " << UCI::move(bestThread->rootMoves[0].pv[0], rootPos.is_chess960());
+      myfile.open(tmpFile);
 
-  if (bestThread->rootMoves[0].pv.size() > 1 || bestThread->rootMoves[0].extract_ponder_from_tt(rootPos))
-      // std::cout << " ponder " << UCI::move(bestThread->rootMoves[0].pv[1], rootPos.is_chess960());
-      myfile << " ponder " << UCI::move(bestThread->rootMoves[0].pv[1], rootPos.is_chess960());
+      // sync_cout << "bestmove " << UCI::move(bestThread->rootMoves[0].pv[0], rootPos.is_chess960());
+      myfile << "bestmove " << UCI::move(bestThread->rootMoves[0].pv[0], rootPos.is_chess960());
 
-  myfile.close();
+      if (ponder)
+          // std::cout << " ponder " << UCI::move(bestThread->rootMoves[0].pv[1], rootPos.is_chess960());
+          myfile << " ponder " << UCI::move(bestThread->rootMoves[0].pv[1], rootPos.is_chess960());
+
+      myfile.close();
+      std::rename(tmpFile.c_str(), resultFile.c_str());
+  }
 
   std::cout << sync_endl;
 }
@@ -356,6 +474,14 @@ void Thread::search() {
   beta = VALUE_INFINITE;
   completedDepth = DEPTH_ZERO;
 
+  // With the root split the helpers search the root moves the main thread
+  // hands out, instead of iterations of their own
+  if (!mainThread && Split.active)
+  {
+      split_helper(this, ss);
+      return;
+  }
+
   if (mainThread)
   {
       easyMove = EasyMove.get(rootPos.key());
@@ -414,7 +540,8 @@ void Thread::search() {
           // high/low anymore.
           while (true)
           {
-              bestValue = ::search<PV>(rootPos, ss, alpha, beta, rootDepth, false);
+              bestValue = Split.active ? split_root(mainThread, ss, alpha, beta, rootDepth)
+                                       : ::search<PV>(rootPos, ss, alpha, beta, rootDepth, false);
 
               // Bring the best move to the front. It is critical that sorting
               // is done with a stable algorithm because all the values but the
@@ -472,6 +599,9 @@ void Thread::search() {
 
           if (Signals.stop || PVIdx + 1 == multiPV || Time.elapsed() > 3000)
               sync_cout << UCI::pv(rootPos, rootDepth, alpha, beta) << sync_endl;
+
+          // The shared memory channel is cheap to update, so it gets every line
+          ShmChannel::publish_pv(rootPos, rootDepth, alpha, beta);
       }
 
       if (!Signals.stop)
@@ -579,13 +709,14 @@ namespace {
     bestValue = -VALUE_INFINITE;
     ss->ply = (ss-1)->ply + 1;
 
-    // Check for the available remaining time
+    // Check for the available remaining time. A small node limit (the weak
+    // strength levels) is checked more often, so it isn't overshot by thousands.
     if (thisThread->resetCalls.load(std::memory_order_relaxed))
     {
         thisThread->resetCalls = false;
         thisThread->callsCnt = 0;
     }
-    if (++thisThread->callsCnt > 4096)
+    if (++thisThread->callsCnt > (Limits.nodes ? std::min(4096, int(Limits.nodes / 1024)) : 4096))
     {
         for (Thread* th : Threads)
             th->resetCalls = true;
@@ -870,6 +1001,11 @@ moves_loop: // When in check search starts from here
 
       ss->moveCount = ++moveCount;
 
+      // A root move handed out by the root split is searched as the move number
+      // it has in the main thread's list, so with the same reductions and windows
+      if (rootNode && thisThread->splitMoveNumber)
+          ss->moveCount = moveCount = thisThread->splitMoveNumber;
+
       if (rootNode && thisThread == Threads.main() && Time.elapsed() > 3000)
           sync_cout << "info depth " << depth / ONE_PLY
                     << " currmove " << UCI::move(move, pos.is_chess960())
@@ -1079,7 +1215,7 @@ moves_loop: // When in check search starts from here
               // We record how often the best move has been changed in each
               // iteration. This information is used for time management: When
               // the best move changes frequently, we allocate some more time.
-              if (moveCount > 1 && thisThread == Threads.main())
+              if (moveCount > 1 && thisThread == Threads.main() && !thisThread->splitMoveNumber)
                   ++static_cast<MainThread*>(thisThread)->bestMoveChanges;
           }
           else
@@ -1098,6 +1234,7 @@ moves_loop: // When in check search starts from here
               // If there is an easy move for this position, clear it if unstable
               if (    PvNode
                   &&  thisThread == Threads.main()
+                  && !thisThread->splitMoveNumber
                   &&  EasyMove.get(pos.key())
                   && (move != EasyMove.get(pos.key()) || moveCount > 1))
                   EasyMove.clear();
@@ -1482,7 +1619,13 @@ moves_loop: // When in check search starts from here
   Move Skill::pick_best(size_t multiPV) {
 
     const RootMoves& rootMoves = Threads.main()->rootMoves;
-    static PRNG rng(now()); // PRNG sequence should be non-deterministic
+
+    // PRNG sequence should be non-deterministic, unless a "SkillSeed" is given:
+    // then the pick depends only on it and the position, so it can be replayed.
+    static PRNG timeRng(now());
+    uint64_t seed = uint64_t(int(Options["SkillSeed"]));
+    PRNG seededRng((seed << 32 ^ Threads.main()->rootPos.key()) | 1);
+    PRNG& rng = seed ? seededRng : timeRng;
 
     // RootMoves are already sorted by score in descending order
     Value topScore = rootMoves[0].score;
@@ -1526,6 +1669,8 @@ moves_loop: // When in check search starts from here
         dbg_print();
     }
 
+    ShmChannel::publish_progress();
+
     // An engine may not stop pondering until told so by the GUI
     if (Limits.ponder)
         return;
@@ -1536,6 +1681,204 @@ moves_loop: // When in check search starts from here
             Signals.stop = true;
   }
 
+
+  // eval_table_info() reports how the pawn and material tables did over the
+  // search: the share of lookups found in the thread's own table, and in the
+  // shared one behind it.
+
+  string eval_table_info() {
+
+    HashStats pawns = Threads.pawn_stats(), material = Threads.material_stats();
+    HashStats evals = Threads.eval_stats();
+    std::stringstream ss;
+
+    auto pct = [](uint64_t n, uint64_t total) { return total ? 100.0 * n / total : 0.0; };
+
+    ss << std::fixed << std::setprecision(1)
+       << "info string pawn table hits "     << pct(pawns.hits, pawns.probes)
+       << "% shared "                        << pct(pawns.sharedHits, pawns.probes)
+       << "% material table hits "           << pct(material.hits, material.probes)
+       << "% shared "                        << pct(material.sharedHits, material.probes) << "%";
+
+    if (evals.probes)
+        ss << " eval cache hits " << pct(evals.hits, evals.probes) << "%";
+
+    return ss.str();
+  }
+
+
+  // split_take() gives thread th the next root move of the split to search:
+  // from the front of its own deque or, failing that, from the back of the
+  // longest one. False if there is none left. Called with Split.mutex held.
+
+  bool split_take(Thread* th, size_t& i) {
+
+    std::deque<size_t>& own = Split.queues[th->idx];
+
+    if (own.empty())
+    {
+        auto victim = std::max_element(Split.queues.begin(), Split.queues.end(),
+                                       [](const std::deque<size_t>& a, const std::deque<size_t>& b) {
+                                           return a.size() < b.size(); });
+        if (victim->empty())
+            return false;
+
+        i = victim->back();
+        victim->pop_back();
+        return true;
+    }
+
+    i = own.front();
+    own.pop_front();
+    return true;
+  }
+
+
+  // split_search() searches root move i of the split on thread th, in a root
+  // move list of its own, and records the result. The lock on Split.mutex is
+  // released for the search.
+
+  void split_search(Thread* th, Stack* ss, size_t i, std::unique_lock<Mutex>& lk) {
+
+    RootMoves rm(1, Split.moves[i]);
+    Value alpha = Split.alpha, beta = Split.beta;
+    Depth depth = Split.depth;
+
+    lk.unlock();
+
+    std::swap(th->rootMoves, rm);
+    th->PVIdx = 0;
+    th->rootDepth = depth;
+    th->splitMoveNumber = int(i) + 1;
+
+    Value value = ::search<PV>(th->rootPos, ss, alpha, beta, depth, false);
+
+    th->splitMoveNumber = 0;
+    std::swap(th->rootMoves, rm);
+
+    lk.lock();
+
+    // As at the root, the result of a stopped search can't be trusted
+    if (!Signals.stop)
+    {
+        Split.moves[i] = rm[0];
+        Split.values[i] = value;
+        Split.alphas[i] = alpha;
+
+        // A fail high: the iteration is re-searched, the rest need not be
+        if (value >= beta)
+            for (std::deque<size_t>& q : Split.queues)
+            {
+                Split.pending -= q.size();
+                q.clear();
+            }
+        else
+            Split.alpha = std::max(Split.alpha, value);
+    }
+
+    if (--Split.pending == 0)
+        Split.cv.notify_all();
+  }
+
+
+  // split_root() stands for the root search of an iteration when the root
+  // split is active. The main thread searches the first move on its own. The
+  // others then only have to be refuted against its score, and are shared out
+  // between all the threads, the main one included.
+
+  Value split_root(MainThread* th, Stack* ss, Value alpha, Value beta, Depth depth) {
+
+    RootMoves first(1, th->rootMoves[0]);
+
+    std::swap(th->rootMoves, first);
+    Value bestValue = ::search<PV>(th->rootPos, ss, alpha, beta, depth, false);
+    std::swap(th->rootMoves, first);
+
+    if (Signals.stop)
+        return bestValue;
+
+    th->rootMoves[0] = first[0];
+
+    size_t n = th->rootMoves.size();
+
+    if (bestValue >= beta || n == 1)
+        return bestValue;
+
+    std::unique_lock<Mutex> lk(Split.mutex);
+
+    Split.moves = th->rootMoves;
+    Split.values.assign(n, VALUE_NONE);
+    Split.alphas.assign(n, VALUE_NONE);
+    Split.depth = depth;
+    Split.alpha = std::max(alpha, bestValue);
+    Split.beta = beta;
+    Split.pending = n - 1;
+
+    for (size_t i = 1; i < n; ++i)
+        Split.queues[(i - 1) % Split.queues.size()].push_back(i);
+
+    Split.cv.notify_all();
+
+    size_t i;
+    while (split_take(th, i))
+        split_search(th, ss, i, lk);
+
+    Split.cv.wait(lk, []{ return Split.pending == 0; });
+
+    // Merge in root move order, so that equal scores always resolve the same way.
+    // A value at or below the alpha its move was searched with is only an upper
+    // bound: if that alpha was raised, another move reached it with an exact
+    // score. Such a move is left as a fail low is at the root, with its previous
+    // PV and a score of -VALUE_INFINITE, and its value only counts when every
+    // move failed low.
+    size_t best = 0;
+    Value failLow = -VALUE_INFINITE;
+
+    for (i = 1; i < n; ++i)
+        if (Split.values[i] != VALUE_NONE)
+        {
+            if (Split.values[i] <= Split.alphas[i])
+            {
+                th->rootMoves[i].score = -VALUE_INFINITE;
+                failLow = std::max(failLow, Split.values[i]);
+                continue;
+            }
+
+            th->rootMoves[i] = Split.moves[i];
+
+            if (Split.values[i] > bestValue)
+                bestValue = Split.values[i], best = i;
+        }
+
+    if (best)
+    {
+        ++th->bestMoveChanges;
+        EasyMove.clear();
+    }
+    else
+        bestValue = std::max(bestValue, failLow);
+
+    return bestValue;
+  }
+
+
+  // split_helper() is what a helper thread does during a search with the root
+  // split: it searches the root moves handed out, until the main thread is done.
+
+  void split_helper(Thread* th, Stack* ss) {
+
+    std::unique_lock<Mutex> lk(Split.mutex);
+    size_t i;
+
+    while (true)
+        if (split_take(th, i))
+            split_search(th, ss, i, lk);
+        else if (Split.finished)
+            break;
+        else
+            Split.cv.wait(lk);
+  }
+
 } // namespace
 
 
@@ -1626,7 +1969,7 @@ bool RootMove::extract_ponder_from_tt(Position& pos) {
 
 void Tablebases::filter_root_moves(Position& pos, Search::RootMoves& rootMoves) {
 
-    RootInTB = false;
+    RootInTB = RootDTZ = false;
     UseRule50 = Options["Syzygy50MoveRule"];
     ProbeDepth = Options["SyzygyProbeDepth"] * ONE_PLY;
     Cardinality = Options["SyzygyProbeLimit"];
@@ -1643,7 +1986,7 @@ void Tablebases::filter_root_moves(Position& pos, Search::RootMoves& rootMoves)
 
     // If the current root position is in the tablebases, then RootMoves
     // contains only moves that preserve the draw or the win.
-    RootInTB = root_probe(pos, rootMoves, TB::Score);
+    RootInTB = RootDTZ = root_probe(pos, rootMoves, TB::Score);
 
     if (RootInTB)
         Cardinality = 0; // Do not probe tablebases during the search
@@ -1663,3 +2006,17 @@ void Tablebases::filter_root_moves(Position& pos, Search::RootMoves& rootMoves)
                    : TB::Score < VALUE_DRAW ? -VALUE_MATE + MAX_PLY + 1
                                             :  VALUE_DRAW;
 }
+
+
+/// Tablebases::best_move() picks from the root moves root_probe() has kept the
+/// one that wins quickest or loses slowest. Their scores are the distance to
+/// zeroing after the move, signed as the result, so that is the lowest. Not
+/// for root_probe_wdl(): it keeps every move that holds the result, unranked.
+
+Move Tablebases::best_move(const Search::RootMoves& rootMoves) {
+
+  auto best = std::min_element(rootMoves.begin(), rootMoves.end(),
+                               [](const RootMove& a, const RootMove& b) { return a.score < b.score; });
+
+  return best != rootMoves.end() ? best->pv[0] : MOVE_NONE;
+}
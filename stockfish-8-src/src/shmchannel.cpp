@@ -0,0 +1,331 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2016 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define USE_SHM
+#endif
+
+#include "search.h"
+#include "shmchannel.h"
+#include "thread.h"
+#include "timeman.h"
+#include "tt.h"
+#include "uci.h"
+#include "syzygy/tbprobe.h"
+
+namespace Tablebases {
+
+  extern bool RootInTB;   // Defined in search.cpp
+  extern Value Score;
+}
+
+namespace {
+
+  ShmSegment* channel = nullptr;
+  std::mutex writeMutex;     // Helper threads can also report progress
+  uint32_t searchId = 0;
+  std::atomic<TimePoint> lastProgress(0);  // Written by every thread that reports
+
+  const TimePoint ProgressInterval = 100;
+
+  // GUI square numbering (a8 = 0) from ours (a1 = 0)
+  int gui_square(Square s) { return s ^ 56; }
+
+  uint16_t pack(Move m, bool chess960) {
+
+    if (m == MOVE_NONE || m == MOVE_NULL)
+        return 0;
+
+    Square from = from_sq(m), to = to_sq(m);
+
+    if (type_of(m) == CASTLING && !chess960)
+        to = make_square(to > from ? FILE_G : FILE_C, rank_of(from));
+
+    int promote = type_of(m) == PROMOTION ? promotion_type(m) - PAWN : 0;
+
+    return uint16_t(gui_square(from) | gui_square(to) << 6 | promote << 12);
+  }
+
+  // Get the next slot, fill it in with fill() and publish it
+  template<typename F>
+  void write_record(F fill) {
+
+    std::lock_guard<std::mutex> lk(writeMutex);
+
+    uint32_t n = channel->written;
+    ShmRecord& r = channel->ring[n % SHM_RING_SIZE];
+
+    __atomic_store_n(&r.seq, 0, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    std::memset((char*)&r + sizeof(r.seq), 0, sizeof(ShmRecord) - sizeof(r.seq));
+    r.searchId = searchId;
+    r.timeMs   = uint32_t(Time.elapsed());
+    r.nodes    = Threads.nodes_searched();
+    r.nps      = r.nodes * 1000 / (r.timeMs + 1);
+    fill(r);
+
+    __atomic_store_n(&r.seq, n + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&channel->written, n + 1, __ATOMIC_RELEASE);
+  }
+
+} // namespace
+
+
+namespace ShmChannel {
+
+/// attach() maps the channel the GUI has created, or detaches with "<empty>"
+
+void attach(const std::string& name) {
+
+#ifdef USE_SHM
+  if (channel)
+  {
+      __atomic_store_n(&channel->attached, 0, __ATOMIC_RELEASE);
+      munmap(channel, sizeof(ShmSegment));
+      channel = nullptr;
+  }
+
+  if (name.empty() || name == "<empty>")
+      return;
+
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+
+  if (fd < 0)
+  {
+      sync_cout << "info string Unable to open shared memory " << name << sync_endl;
+      return;
+  }
+
+  void* p = mmap(nullptr, sizeof(ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (p == MAP_FAILED)
+      return;
+
+  ShmSegment* c = (ShmSegment*)p;
+
+  if (   c->magic != SHM_CHANNEL_MAGIC
+      || c->version != SHM_CHANNEL_VERSION
+      || c->size != sizeof(ShmSegment))
+  {
+      sync_cout << "info string Shared memory " << name << " is not a version "
+                << SHM_CHANNEL_VERSION << " channel" << sync_endl;
+      munmap(p, sizeof(ShmSegment));
+      return;
+  }
+
+  channel = c;
+  __atomic_store_n(&channel->attached, 1, __ATOMIC_RELEASE);
+#else
+  (void)name;
+#endif
+}
+
+bool attached() { return channel != nullptr; }
+
+
+/// new_search() is called on "go", so the records of each search can be told apart
+
+void new_search() {
+
+  searchId++;
+  lastProgress = 0;
+}
+
+
+/// publish_pv() writes the same lines UCI::pv() prints
+
+void publish_pv(const Position& pos, Depth depth, Value alpha, Value beta) {
+
+  if (!channel)
+      return;
+
+  const Search::RootMoves& rootMoves = pos.this_thread()->rootMoves;
+  size_t PVIdx = pos.this_thread()->PVIdx;
+  size_t multiPV = std::min((size_t)Options["MultiPV"], rootMoves.size());
+  int hashFull = Time.elapsed() > 1000 ? TT.hashfull() : 0;
+
+  for (size_t i = 0; i < multiPV; ++i)
+  {
+      bool updated = (i <= PVIdx);
+
+      if (depth == ONE_PLY && !updated)
+          continue;
+
+      Depth d = updated ? depth : depth - ONE_PLY;
+      Value v = updated ? rootMoves[i].score : rootMoves[i].previousScore;
+      bool tb = Tablebases::RootInTB && abs(v) < VALUE_MATE - MAX_PLY;
+      v = tb ? Tablebases::Score : v;
+
+      write_record([&](ShmRecord& r) {
+
+          r.type     = SHM_REC_PV;
+          r.multiPV  = uint8_t(i + 1);
+          r.depth    = uint8_t(d / ONE_PLY);
+          r.selDepth = uint8_t(pos.this_thread()->maxPly);
+          r.hashFull = uint16_t(hashFull);
+
+          if (abs(v) < VALUE_MATE - MAX_PLY)
+              r.scoreType = SHM_SCORE_CP, r.score = v * 100 / PawnValueEg;
+          else
+              r.scoreType = SHM_SCORE_MATE, r.score = (v > 0 ? VALUE_MATE - v + 1 : -VALUE_MATE - v) / 2;
+
+          r.bound = uint8_t(  tb || i != PVIdx ? SHM_BOUND_EXACT
+                            : v >= beta        ? SHM_BOUND_LOWER
+                            : v <= alpha       ? SHM_BOUND_UPPER : SHM_BOUND_EXACT);
+
+          for (Move m : rootMoves[i].pv)
+          {
+              if (r.pvLength == SHM_MAX_PV)
+                  break;
+              r.pv[r.pvLength++] = pack(m, pos.is_chess960());
+          }
+      });
+
+      lastProgress = Time.elapsed();
+  }
+}
+
+
+/// publish_progress() is called often from the search; it writes the node
+/// count at most every ProgressInterval ms.
+
+void publish_progress() {
+
+  TimePoint now = Time.elapsed(), last = lastProgress;
+
+  // Only the thread that moves it on reports
+  if (   !channel
+      || now - last < ProgressInterval
+      || !lastProgress.compare_exchange_strong(last, now))
+      return;
+
+  write_record([](ShmRecord& r) { r.type = SHM_REC_PROGRESS; });
+}
+
+void publish_bestmove(const Position& pos, Move best, Move ponder) {
+
+  if (!channel)
+      return;
+
+  write_record([&](ShmRecord& r) {
+
+      r.type = SHM_REC_BESTMOVE;
+      r.pv[r.pvLength++] = pack(best, pos.is_chess960());
+
+      if (ponder != MOVE_NONE)
+          r.pv[r.pvLength++] = pack(ponder, pos.is_chess960());
+  });
+}
+
+
+/// read_position() gets the position posted by the GUI: its FEN and the moves
+/// from it in coordinate notation, for "position shm" to set up like the text
+/// command. Returns false if there is no channel.
+
+bool read_position(std::string& fen, bool& chess960, std::vector<std::string>& moves) {
+
+  if (!channel)
+      return false;
+
+  ShmPosition sp;
+  std::memcpy(&sp, &channel->position, sizeof(sp));
+
+  // Build a FEN from the bitboards (bit 63 is a8, square 0)
+  const char* pieceChar[2] = { "pnbrqk", "PNBRQK" };
+  std::ostringstream ss;
+  int empty = 0;
+
+  for (int s = 0; s < 64; ++s)
+  {
+      uint64_t bit = uint64_t(1) << (63 - s);
+      char c = 0;
+
+      for (int color = 0; color < 2; ++color)
+          for (int pt = 0; pt < 6; ++pt)
+              if (sp.colors[color] & sp.pieces[pt] & bit)
+                  c = pieceChar[color][pt];
+
+      if (c)
+      {
+          if (empty)
+              ss << empty, empty = 0;
+          ss << c;
+      }
+      else
+          empty++;
+
+      if (s % 8 == 7)
+      {
+          if (empty)
+              ss << empty, empty = 0;
+          if (s != 63)
+              ss << '/';
+      }
+  }
+
+  ss << (sp.toMove ? " w " : " b ");
+
+  if (!sp.castleBits)
+      ss << '-';
+  for (int i = 3; i >= 0; --i)
+      if (sp.castleBits & (1 << i))
+          ss << "KQkq"[3 - i];
+
+  if (sp.enPassantCol < 8)
+      ss << ' ' << char('a' + sp.enPassantCol) << (sp.toMove ? '6' : '3');
+  else
+      ss << " -";
+
+  ss << ' ' << sp.halfMoves << ' ' << std::max(1, int(sp.moveNumber));
+
+  fen = ss.str();
+  chess960 = sp.chess960;
+  moves.clear();
+
+  // The moves, unpacked as pack() packs them
+  for (int i = 0; i < std::min(int(sp.moveCount), SHM_MAX_POS_MOVES); ++i)
+  {
+      std::string move = UCI::square(Square(gui_square(Square(sp.moves[i] & 63))))
+                       + UCI::square(Square(gui_square(Square(sp.moves[i] >> 6 & 63))));
+      int promote = sp.moves[i] >> 12 & 7;
+
+      if (promote)
+          move += " nbrq"[std::min(promote, 4)];
+
+      moves.push_back(move);
+  }
+
+  return true;
+}
+
+
+} // namespace ShmChannel
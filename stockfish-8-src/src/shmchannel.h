@@ -0,0 +1,142 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2016 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHMCHANNEL_H_INCLUDED
+#define SHMCHANNEL_H_INCLUDED
+
+/// Shared memory channel between the engine and a GUI (piChess).
+///
+/// The GUI creates a POSIX shared memory object laid out as ShmSegment below
+/// and passes its name in the "ShmChannel" UCI option. The engine maps it and
+/// then, alongside the normal UCI output:
+///
+///  - appends a record to the ring for every PV line, for search progress
+///    (about every 100ms) and for the best move, and
+///  - on "position shm" takes the position from the 'position' area.
+///
+/// This header is plain C so the GUI can include it. Everything is in the
+/// GUI's conventions, so it has nothing to convert: squares are numbered 0 = a8
+/// to 63 = h1, bitboards have a8 in bit 63 and h1 in bit 0, colors are 0 black
+/// and 1 white and pieces 0 pawn to 5 king. A move is packed as
+/// from | to << 6 | promote << 12 (promote 1 knight .. 4 queen, else 0), with
+/// castling given as the king's two square move.
+///
+/// The ring has one writer. Records are numbered from 0; record n is in slot
+/// n % SHM_RING_SIZE and holds seq = n + 1 once complete. The writer zeroes seq,
+/// fills the record, stores seq and then 'written', all with release ordering.
+/// A reader loads 'written' (acquire), copies the records it hasn't seen and
+/// keeps a copy only if seq was n + 1 both before and after copying it.
+
+#include <stdint.h>
+
+#define SHM_CHANNEL_MAGIC    0x4D485350  /* "PSHM" */
+#define SHM_CHANNEL_VERSION  3
+#define SHM_RING_SIZE        256
+#define SHM_MAX_PV           32
+#define SHM_MAX_POS_MOVES    600
+
+typedef enum ShmRecordType
+{
+  SHM_REC_PV,        /* one line of the principal variation(s) */
+  SHM_REC_PROGRESS,  /* nodes, nps and time only */
+  SHM_REC_BESTMOVE   /* pv[0] best move, pv[1] ponder move (if pvLength 2) */
+} ShmRecordType;
+
+typedef enum ShmScoreType
+{
+  SHM_SCORE_CP,      /* score in centipawns */
+  SHM_SCORE_MATE     /* score is moves to mate, negative if being mated */
+} ShmScoreType;
+
+typedef enum ShmBound
+{
+  SHM_BOUND_EXACT,
+  SHM_BOUND_LOWER,
+  SHM_BOUND_UPPER
+} ShmBound;
+
+typedef struct ShmRecord
+{
+  uint32_t seq;
+  uint8_t  type;      /* ShmRecordType */
+  uint8_t  multiPV;   /* line number, from 1 */
+  uint8_t  depth;
+  uint8_t  selDepth;
+  int32_t  score;
+  uint8_t  scoreType; /* ShmScoreType */
+  uint8_t  bound;     /* ShmBound */
+  uint8_t  pvLength;
+  uint8_t  reserved;
+  uint32_t searchId;  /* counts "go" commands, so a reader can tell searches apart */
+  uint64_t nodes;
+  uint64_t nps;
+  uint32_t timeMs;
+  uint16_t hashFull;  /* per mille */
+  uint16_t pv[SHM_MAX_PV];
+} ShmRecord;
+
+typedef struct ShmPosition
+{
+  uint64_t colors[2];      /* board_t.colors */
+  uint64_t pieces[6];      /* board_t.pieces */
+  uint16_t moveNumber;
+  uint16_t halfMoves;
+  uint8_t  toMove;
+  uint8_t  castleBits;     /* KQkq in bits 3..0 */
+  uint8_t  enPassantCol;   /* 0-7 = a-h, 8 = none */
+  uint8_t  chess960;
+  uint16_t moveCount;      /* moves played from the position above */
+  uint16_t moves[SHM_MAX_POS_MOVES];
+} ShmPosition;
+
+typedef struct ShmSegment
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;           /* sizeof(ShmSegment), as the GUI built it */
+  uint32_t attached;       /* set by the engine once it has mapped the channel */
+  uint32_t written;        /* records written so far */
+  uint32_t reserved;
+  ShmPosition position;
+  ShmRecord ring[SHM_RING_SIZE];
+} ShmSegment;
+
+#ifdef __cplusplus
+
+#include <string>
+#include <vector>
+
+#include "position.h"
+
+namespace ShmChannel {
+
+void attach(const std::string& name);
+bool attached();
+void new_search();
+void publish_pv(const Position& pos, Depth depth, Value alpha, Value beta);
+void publish_progress();
+void publish_bestmove(const Position& pos, Move best, Move ponder);
+bool read_position(std::string& fen, bool& chess960, std::vector<std::string>& moves);
+
+}
+
+#endif
+
+#endif // #ifndef SHMCHANNEL_H_INCLUDED
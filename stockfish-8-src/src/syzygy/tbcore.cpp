@@ -5,6 +5,9 @@
   tbcore.c contains engine-independent routines of the tablebase probing code.
   This file should not need too much adaptation to add tablebase probing to
   a particular engine, provided the engine is written in C or C++.
+
+  It compiles as either: tbprobe.cpp includes it for the engine and piChess's
+  syzygy.c for its own probes. Only Tablebases::init() is C++.
 */
 
 #include <stdio.h>
@@ -37,7 +40,8 @@
 
 static LOCK_T TB_mutex;
 
-static bool initialized = false;
+static int initialized = 0;
+static int max_cardinality = 0;
 static int num_paths = 0;
 static char *path_string = NULL;
 static char **paths = NULL;
@@ -223,8 +227,8 @@ static void init_tb(char *str)
     entry->num += (ubyte)pcs[i];
   entry->symmetric = (key == key2);
   entry->has_pawns = (pcs[TB_WPAWN] + pcs[TB_BPAWN] > 0);
-  if (entry->num > Tablebases::MaxCardinality)
-    Tablebases::MaxCardinality = entry->num;
+  if (entry->num > max_cardinality)
+    max_cardinality = entry->num;
 
   if (entry->has_pawns) {
     struct TBEntry_pawn *ptr = (struct TBEntry_pawn *)entry;
@@ -245,7 +249,7 @@ static void init_tb(char *str)
       j = 16;
       for (i = 0; i < 16; i++) {
         if (pcs[i] < j && pcs[i] > 1) j = pcs[i];
-        ptr->enc_type = ubyte(1 + j);
+        ptr->enc_type = (ubyte)(1 + j);
       }
     }
   }
@@ -253,7 +257,7 @@ static void init_tb(char *str)
   if (key2 != key) add_to_hash(entry, key2);
 }
 
-void Tablebases::init(const std::string& path)
+static void init_tablebases(const char *p)
 {
   char str[16];
   int i, j, k, l;
@@ -275,10 +279,9 @@ void Tablebases::init(const std::string& path)
         free_dtz_entry(DTZ_table[i].entry);
   } else {
     init_indices();
-    initialized = true;
+    initialized = 1;
   }
 
-  const char *p = path.c_str();
   if (strlen(p) == 0 || !strcmp(p, "<empty>")) return;
   path_string = (char *)malloc(strlen(p) + 1);
   strcpy(path_string, p);
@@ -301,7 +304,7 @@ void Tablebases::init(const std::string& path)
   LOCK_INIT(TB_mutex);
 
   TBnum_piece = TBnum_pawn = 0;
-  MaxCardinality = 0;
+  max_cardinality = 0;
 
   for (i = 0; i < (1 << TBHASHBITS); i++)
     for (j = 0; j < HSHMAX; j++) {
@@ -367,8 +370,18 @@ void Tablebases::init(const std::string& path)
           init_tb(str);
         }
 
+#ifdef __cplusplus
   printf("info string Found %d tablebases.\n", TBnum_piece + TBnum_pawn);
+#endif
+}
+
+#ifdef __cplusplus
+void Tablebases::init(const std::string& path)
+{
+  init_tablebases(path.c_str());
+  MaxCardinality = max_cardinality;
 }
+#endif
 
 static const signed char offdiag[] = {
   0,-1,-1,-1,-1,-1,-1,-1,
@@ -779,10 +792,10 @@ static uint64 calc_factors_piece(int *factor, int num, int order, ubyte *norm, u
   f = 1;
   for (i = norm[0], k = 0; i < num || k == order; k++) {
     if (k == order) {
-      factor[0] = static_cast<int>(f);
+      factor[0] = (int)(f);
       f *= pivfac[enc_type];
     } else {
-      factor[i] = static_cast<int>(f);
+      factor[i] = (int)(f);
       f *= subfactor(norm[i], n);
       n -= norm[i];
       i += norm[i];
@@ -804,13 +817,13 @@ static uint64 calc_factors_pawn(int *factor, int num, int order, int order2, uby
   f = 1;
   for (k = 0; i < num || k == order || k == order2; k++) {
     if (k == order) {
-      factor[0] = static_cast<int>(f);
+      factor[0] = (int)(f);
       f *= pfactor[norm[0] - 1][file];
     } else if (k == order2) {
-      factor[norm[0]] = static_cast<int>(f);
+      factor[norm[0]] = (int)(f);
       f *= subfactor(norm[norm[0]], 48 - norm[0]);
     } else {
-      factor[i] = static_cast<int>(f);
+      factor[i] = (int)(f);
       f *= subfactor(norm[i], n);
       n -= norm[i];
       i += norm[i];
@@ -835,7 +848,7 @@ static void set_norm_piece(struct TBEntry_piece *ptr, ubyte *norm, ubyte *pieces
     norm[0] = 2;
     break;
   default:
-    norm[0] = ubyte(ptr->enc_type - 1);
+    norm[0] = (ubyte)(ptr->enc_type - 1);
     break;
   }
 
@@ -865,13 +878,13 @@ static void setup_pieces_piece(struct TBEntry_piece *ptr, unsigned char *data, u
   int order;
 
   for (i = 0; i < ptr->num; i++)
-    ptr->pieces[0][i] = ubyte(data[i + 1] & 0x0f);
+    ptr->pieces[0][i] = (ubyte)(data[i + 1] & 0x0f);
   order = data[0] & 0x0f;
   set_norm_piece(ptr, ptr->norm[0], ptr->pieces[0]);
   tb_size[0] = calc_factors_piece(ptr->factor[0], ptr->num, order, ptr->norm[0], ptr->enc_type);
 
   for (i = 0; i < ptr->num; i++)
-    ptr->pieces[1][i] = ubyte(data[i + 1] >> 4);
+    ptr->pieces[1][i] = (ubyte)(data[i + 1] >> 4);
   order = data[0] >> 4;
   set_norm_piece(ptr, ptr->norm[1], ptr->pieces[1]);
   tb_size[1] = calc_factors_piece(ptr->factor[1], ptr->num, order, ptr->norm[1], ptr->enc_type);
@@ -883,7 +896,7 @@ static void setup_pieces_piece_dtz(struct DTZEntry_piece *ptr, unsigned char *da
   int order;
 
   for (i = 0; i < ptr->num; i++)
-    ptr->pieces[i] = ubyte(data[i + 1] & 0x0f);
+    ptr->pieces[i] = (ubyte)(data[i + 1] & 0x0f);
   order = data[0] & 0x0f;
   set_norm_piece((struct TBEntry_piece *)ptr, ptr->norm, ptr->pieces);
   tb_size[0] = calc_factors_piece(ptr->factor, ptr->num, order, ptr->norm, ptr->enc_type);
@@ -898,14 +911,14 @@ static void setup_pieces_pawn(struct TBEntry_pawn *ptr, unsigned char *data, uin
   order = data[0] & 0x0f;
   order2 = ptr->pawns[1] ? (data[1] & 0x0f) : 0x0f;
   for (i = 0; i < ptr->num; i++)
-    ptr->file[f].pieces[0][i] = ubyte(data[i + j] & 0x0f);
+    ptr->file[f].pieces[0][i] = (ubyte)(data[i + j] & 0x0f);
   set_norm_pawn(ptr, ptr->file[f].norm[0], ptr->file[f].pieces[0]);
   tb_size[0] = calc_factors_pawn(ptr->file[f].factor[0], ptr->num, order, order2, ptr->file[f].norm[0], f);
 
   order = data[0] >> 4;
   order2 = ptr->pawns[1] ? (data[1] >> 4) : 0x0f;
   for (i = 0; i < ptr->num; i++)
-    ptr->file[f].pieces[1][i] = ubyte(data[i + j] >> 4);
+    ptr->file[f].pieces[1][i] = (ubyte)(data[i + j] >> 4);
   set_norm_pawn(ptr, ptr->file[f].norm[1], ptr->file[f].pieces[1]);
   tb_size[1] = calc_factors_pawn(ptr->file[f].factor[1], ptr->num, order, order2, ptr->file[f].norm[1], f);
 }
@@ -919,7 +932,7 @@ static void setup_pieces_pawn_dtz(struct DTZEntry_pawn *ptr, unsigned char *data
   order = data[0] & 0x0f;
   order2 = ptr->pawns[1] ? (data[1] & 0x0f) : 0x0f;
   for (i = 0; i < ptr->num; i++)
-    ptr->file[f].pieces[i] = ubyte(data[i + j] & 0x0f);
+    ptr->file[f].pieces[i] = (ubyte)(data[i + j] & 0x0f);
   set_norm_pawn((struct TBEntry_pawn *)ptr, ptr->file[f].norm, ptr->file[f].pieces);
   tb_size[0] = calc_factors_pawn(ptr->file[f].factor, ptr->num, order, order2, ptr->file[f].norm, f);
 }
@@ -936,13 +949,13 @@ static void calc_symlen(struct PairsData *d, int s, char *tmp)
     s1 = ((w[1] & 0xf) << 8) | w[0];
     if (!tmp[s1]) calc_symlen(d, s1, tmp);
     if (!tmp[s2]) calc_symlen(d, s2, tmp);
-    d->symlen[s] = ubyte(d->symlen[s1] + d->symlen[s2] + 1);
+    d->symlen[s] = (ubyte)(d->symlen[s1] + d->symlen[s2] + 1);
   }
   tmp[s] = 1;
 }
 
 ushort ReadUshort(ubyte* d) {
-  return ushort(d[0] | (d[1] << 8));
+  return (ushort)(d[0] | (d[1] << 8));
 }
 
 uint32 ReadUint32(ubyte* d) {
@@ -1163,7 +1176,7 @@ static int init_table_dtz(struct TBEntry *entry)
     if (ptr->flags & 2) {
       int i;
       for (i = 0; i < 4; i++) {
-        ptr->map_idx[i] = static_cast<ushort>(data + 1 - ptr->map);
+        ptr->map_idx[i] = (ushort)(data + 1 - ptr->map);
         data += 1 + data[0];
       }
       data += ((uintptr_t)data) & 0x01;
@@ -1197,7 +1210,7 @@ static int init_table_dtz(struct TBEntry *entry)
       if (ptr->flags[f] & 2) {
         int i;
         for (i = 0; i < 4; i++) {
-          ptr->map_idx[f][i] = static_cast<ushort>(data + 1 - ptr->map);
+          ptr->map_idx[f][i] = (ushort)(data + 1 - ptr->map);
           data += 1 + data[0];
         }
       }
@@ -1224,13 +1237,13 @@ static int init_table_dtz(struct TBEntry *entry)
   return 1;
 }
 
-template<bool LittleEndian>
-static ubyte decompress_pairs(struct PairsData *d, uint64 idx)
+// LittleEndian is a constant at each call, so the compiler folds its tests away
+static inline ubyte decompress_pairs_order(struct PairsData *d, uint64 idx, int LittleEndian)
 {
   if (!d->idxbits)
-    return ubyte(d->min_len);
+    return (ubyte)(d->min_len);
 
-  uint32 mainidx = static_cast<uint32>(idx >> d->idxbits);
+  uint32 mainidx = (uint32)(idx >> d->idxbits);
   int litidx = (idx & ((1ULL << d->idxbits) - 1)) - (1ULL << (d->idxbits - 1));
   uint32 block = *(uint32 *)(d->indextable + 6 * mainidx);
   if (!LittleEndian)
@@ -1238,7 +1251,7 @@ static ubyte decompress_pairs(struct PairsData *d, uint64 idx)
 
   ushort idxOffset = *(ushort *)(d->indextable + 6 * mainidx + 4);
   if (!LittleEndian)
-    idxOffset = ushort((idxOffset << 8) | (idxOffset >> 8));
+    idxOffset = (ushort)((idxOffset << 8) | (idxOffset >> 8));
   litidx += idxOffset;
 
   if (litidx < 0) {
@@ -1270,7 +1283,7 @@ static ubyte decompress_pairs(struct PairsData *d, uint64 idx)
     sym = offset[l];
     if (!LittleEndian)
       sym = ((sym & 0xff) << 8) | (sym >> 8);
-    sym += static_cast<int>((code - base[l]) >> (64 - l));
+    sym += (int)((code - base[l]) >> (64 - l));
     if (litidx < (int)symlen[sym] + 1) break;
     litidx -= (int)symlen[sym] + 1;
     code <<= l;
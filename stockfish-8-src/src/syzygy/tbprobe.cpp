@@ -104,8 +104,8 @@ bool is_little_endian() {
 static ubyte decompress_pairs(struct PairsData *d, uint64 idx)
 {
   static const bool isLittleEndian = is_little_endian();
-  return isLittleEndian ? decompress_pairs<true >(d, idx)
-                        : decompress_pairs<false>(d, idx);
+  return isLittleEndian ? decompress_pairs_order(d, idx, 1)
+                        : decompress_pairs_order(d, idx, 0);
 }
 
 // probe_wdl_table and probe_dtz_table require similar adaptations.
@@ -13,6 +13,7 @@ int probe_dtz(Position& pos, int *success);
 bool root_probe(Position& pos, Search::RootMoves& rootMoves, Value& score);
 bool root_probe_wdl(Position& pos, Search::RootMoves& rootMoves, Value& score);
 void filter_root_moves(Position& pos, Search::RootMoves& rootMoves);
+Move best_move(const Search::RootMoves& rootMoves);
 
 }
 
@@ -0,0 +1,343 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2016 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define USE_MMAP
+#endif
+
+#include "bitboard.h"
+#include "misc.h"
+#include "tables.h"
+
+/// Tables file, in native byte order:
+///
+///   header  "SFIT", uint32 version, uint32 word size in bits (Is64Bit),
+///           uint32 1 if built with pext, uint64 size of the tables, uint64
+///           checksum of them
+///   tables  the blocks from Bitboards::tables() and Bitbases::tables(), back
+///           to back
+
+namespace {
+
+  const char TablesMagic[4] = { 'S', 'F', 'I', 'T' };
+  const uint32_t TablesVersion = 1; // Bump when a table or the way it's built changes
+
+  struct Header {
+    char magic[4];
+    uint32_t version, bits, pext;
+    uint64_t size, checksum;
+  };
+
+  std::string TablesFile;
+
+  std::vector<Tables::Block> blocks() {
+
+    std::vector<Tables::Block> b;
+
+    Bitboards::tables(b);
+    Bitbases::tables(b);
+    return b;
+  }
+
+  size_t total_size(const std::vector<Tables::Block>& blocks) {
+
+    size_t size = 0;
+
+    for (const Tables::Block& b : blocks)
+        size += b.size;
+
+    return size;
+  }
+
+  // checksum() is FNV-1a over 64 bit words, enough to catch a damaged file
+  uint64_t checksum(const char* data, size_t size) {
+
+    uint64_t sum = 0xCBF29CE484222325ULL, w;
+    size_t i = 0;
+
+    for ( ; i + 8 <= size; i += 8)
+    {
+        std::memcpy(&w, data + i, 8);
+        sum = (sum ^ w) * 0x100000001B3ULL;
+    }
+
+    for ( ; i < size; ++i)
+        sum = (sum ^ uint8_t(data[i])) * 0x100000001B3ULL;
+
+    return sum;
+  }
+
+  // problem() says what is wrong with a tables file for this build, if
+  // anything: nullptr if its tables can be loaded.
+  const char* problem(const char* data, size_t size, size_t tablesSize) {
+
+    Header h;
+
+    if (size < sizeof(h))
+        return "too short";
+
+    std::memcpy(&h, data, sizeof(h));
+
+    if (std::memcmp(h.magic, TablesMagic, 4))
+        return "not a tables file";
+
+    if (h.version != TablesVersion)
+        return "another version";
+
+    if (h.bits != (Is64Bit ? 64 : 32) || h.pext != HasPext)
+        return "built for another architecture";
+
+    if (h.size != tablesSize || size != sizeof(h) + tablesSize)
+        return "wrong size";
+
+    if (h.checksum != checksum(data + sizeof(h), tablesSize))
+        return "damaged";
+
+    return nullptr;
+  }
+
+  // read() gets the contents of a file, mapped where it can be. release()
+  // lets go of them again.
+  struct Contents {
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef USE_MMAP
+    void* map = MAP_FAILED;
+#else
+    std::vector<char> buf;
+#endif
+  };
+
+  bool read(const std::string& file, Contents& c) {
+
+#ifdef USE_MMAP
+    int fd = open(file.c_str(), O_RDONLY);
+    struct stat st;
+
+    if (fd < 0)
+        return false;
+
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    c.size = st.st_size;
+    c.map = mmap(nullptr, c.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (c.map == MAP_FAILED)
+        return false;
+
+    c.data = (const char*)c.map;
+#else
+    std::ifstream in(file, std::ios::binary);
+    c.buf.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    if (c.buf.empty())
+        return false;
+
+    c.size = c.buf.size();
+    c.data = c.buf.data();
+#endif
+    return true;
+  }
+
+  void release(Contents& c) {
+
+#ifdef USE_MMAP
+    if (c.map != MAP_FAILED)
+        munmap(c.map, c.size);
+#endif
+    c.data = nullptr;
+  }
+
+  // load() fills in the tables from a file, if it has them for this build
+  bool load(const std::string& file) {
+
+    std::vector<Tables::Block> bs = blocks();
+    Contents c;
+
+    if (!read(file, c))
+        return false;
+
+    bool ok = !problem(c.data, c.size, total_size(bs));
+
+    if (ok)
+    {
+        const char* p = c.data + sizeof(Header);
+
+        for (const Tables::Block& b : bs)
+        {
+            std::memcpy(b.data, p, b.size);
+            p += b.size;
+        }
+
+        Bitboards::link_attacks();
+    }
+
+    release(c);
+    return ok;
+  }
+
+} // namespace
+
+
+/// Tables::init() gets the tables ready at startup: from <exe>.tables if it
+/// has them for this build, else built, in which case the file is written for
+/// the next start (quietly, as the directory may not be writable).
+
+void Tables::init(const std::string& exe) {
+
+  TablesFile = exe + ".tables";
+
+  if (!load(TablesFile))
+  {
+      build();
+      save(TablesFile);
+  }
+}
+
+
+/// Tables::build() builds the tables, as without a tables file
+
+void Tables::build() {
+
+  // The init functions rely on the tables starting out zeroed
+  for (const Block& b : blocks())
+      std::memset(b.data, 0, b.size);
+
+  Bitboards::init();
+  Bitbases::init();
+}
+
+
+/// Tables::save() writes the tables to a file. Like the hash file, it is
+/// written under a temporary name and renamed, as other engines starting at
+/// the same time may be writing it too.
+
+bool Tables::save(const std::string& file) {
+
+  std::vector<Block> bs = blocks();
+  std::vector<char> buf(sizeof(Header) + total_size(bs));
+  Header h;
+  char* p = &buf[sizeof(h)];
+
+  for (const Block& b : bs)
+  {
+      std::memcpy(p, b.data, b.size);
+      p += b.size;
+  }
+
+  std::memcpy(h.magic, TablesMagic, 4);
+  h.version = TablesVersion;
+  h.bits = Is64Bit ? 64 : 32;
+  h.pext = HasPext;
+  h.size = buf.size() - sizeof(h);
+  h.checksum = checksum(&buf[sizeof(h)], h.size);
+  std::memcpy(&buf[0], &h, sizeof(h));
+
+  std::string tmpFile = file + ".tmp";
+
+#ifdef USE_MMAP
+  tmpFile = file + "." + std::to_string(getpid()) + ".tmp";
+#endif
+  std::ofstream out(tmpFile, std::ios::binary);
+
+  out.write(buf.data(), buf.size());
+  out.close();
+
+  if (!out || std::rename(tmpFile.c_str(), file.c_str()) != 0)
+  {
+      std::remove(tmpFile.c_str());
+      return false;
+  }
+
+  return true;
+}
+
+
+/// Tables::check() builds the tables and compares them with the ones in a
+/// file, table by table. True if they are all identical.
+
+bool Tables::check(const std::string& file) {
+
+  std::vector<Block> bs = blocks();
+  Contents c;
+
+  if (!read(file, c))
+  {
+      sync_cout << "Unable to read " << file << sync_endl;
+      return false;
+  }
+
+  const char* why = problem(c.data, c.size, total_size(bs));
+
+  if (why)
+  {
+      sync_cout << "Tables in " << file << " can't be used: " << why << sync_endl;
+      release(c);
+      return false;
+  }
+
+  build();
+
+  const char* p = c.data + sizeof(Header);
+  int differ = 0;
+
+  for (const Block& b : bs)
+  {
+      bool same = !std::memcmp(b.data, p, b.size);
+
+      sync_cout << b.name << std::string(16 - std::min(strlen(b.name), size_t(15)), ' ')
+                << b.size << " bytes " << (same ? "identical" : "DIFFER") << sync_endl;
+
+      differ += !same;
+      p += b.size;
+  }
+
+  release(c);
+
+  if (differ)
+      sync_cout << "Tables in " << file << " differ from the ones built: " << differ << " of " << bs.size() << sync_endl;
+  else
+      sync_cout << "Tables in " << file << " match the ones built" << sync_endl;
+
+  return !differ;
+}
+
+
+/// Tables::file() is the tables file of this executable
+
+const std::string& Tables::file() {
+  return TablesFile;
+}
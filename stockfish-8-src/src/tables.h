@@ -0,0 +1,57 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2016 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TABLES_H_INCLUDED
+#define TABLES_H_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// Tables file: the bitboard tables (magics and sliding attacks included) and
+/// the KPK bitbase, saved once they have been built so that the next start
+/// can map them in instead of building them again. Building them is most of
+/// the engine's startup time, and the GUI starts an engine for every game.
+///
+/// The file is made by "make tables" next to the executable, as <exe>.tables.
+/// An engine that finds it missing or unusable (an older version, or built for
+/// a different word size or with/without pext, which change the layout of the
+/// attack tables) builds the tables as before and writes the file for the next
+/// one. "tables check" rebuilds the tables and compares them with the file.
+
+namespace Tables {
+
+/// A table built at startup, as listed by Bitboards::tables() and
+/// Bitbases::tables() in the order it is stored in the file.
+struct Block {
+  const char* name;
+  void* data;
+  size_t size;
+};
+
+void init(const std::string& exe);
+void build();
+bool save(const std::string& file);
+bool check(const std::string& file);
+const std::string& file();
+
+} // namespace Tables
+
+#endif // #ifndef TABLES_H_INCLUDED
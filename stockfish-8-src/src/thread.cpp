@@ -35,7 +35,7 @@ ThreadPool Threads; // Global object
 Thread::Thread() {
 
   resetCalls = exit = false;
-  maxPly = callsCnt = 0;
+  maxPly = callsCnt = splitMoveNumber = 0;
   tbHits = 0;
   history.clear();
   counterMoves.clear();
@@ -179,6 +179,35 @@ uint64_t ThreadPool::tb_hits() const {
 }
 
 
+/// ThreadPool::pawn_stats(), material_stats() and eval_stats() add up the
+/// threads' pawn table, material table and eval cache lookups for the current
+/// search
+
+HashStats ThreadPool::pawn_stats() const {
+
+  HashStats stats;
+  for (Thread* th : *this)
+      stats += th->pawnStats;
+  return stats;
+}
+
+HashStats ThreadPool::material_stats() const {
+
+  HashStats stats;
+  for (Thread* th : *this)
+      stats += th->materialStats;
+  return stats;
+}
+
+HashStats ThreadPool::eval_stats() const {
+
+  HashStats stats;
+  for (Thread* th : *this)
+      stats += th->evalStats;
+  return stats;
+}
+
+
 /// ThreadPool::start_thinking() wakes up the main thread sleeping in idle_loop()
 /// and starts a new search, then returns immediately.
 
@@ -212,6 +241,9 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states,
   {
       th->maxPly = 0;
       th->tbHits = 0;
+      th->pawnStats.clear();
+      th->materialStats.clear();
+      th->evalStats.clear();
       th->rootDepth = DEPTH_ZERO;
       th->rootMoves = rootMoves;
       th->rootPos.set(pos.fen(), pos.is_chess960(), &setupStates->back(), th);
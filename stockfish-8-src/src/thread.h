@@ -39,7 +39,8 @@
 /// Thread struct keeps together all the thread-related stuff. We also use
 /// per-thread pawn and material hash tables so that once we get a pointer to an
 /// entry its life time is unlimited and we don't have to care about someone
-/// changing the entry under our feet.
+/// changing the entry under our feet. The shared tables behind them (with
+/// "SharedEvalTables") are only ever copied from.
 
 class Thread {
 
@@ -60,8 +61,10 @@ public:
   Pawns::Table pawnsTable;
   Material::Table materialTable;
   Endgames endgames;
+  HashStats pawnStats, materialStats, evalStats;
   size_t idx, PVIdx;
   int maxPly, callsCnt;
+  int splitMoveNumber; // Root split: the root move's number in the main thread's list
   uint64_t tbHits;
 
   Position rootPos;
@@ -101,6 +104,22 @@ struct ThreadPool : public std::vector<Thread*> {
   void read_uci_options();
   uint64_t nodes_searched() const;
   uint64_t tb_hits() const;
+  HashStats pawn_stats() const;
+  HashStats material_stats() const;
+  HashStats eval_stats() const;
+
+  // Hands back the states of the setup moves given to the last search, which
+  // only reads them, so that a position extending it can be played on from them.
+  // The search may still be winding down after a "stop", so it is waited for.
+  bool take_setup_states(StateListPtr& states) {
+    main()->wait_for_search_finished();
+
+    if (!setupStates.get())
+        return false;
+
+    states = std::move(setupStates);
+    return true;
+  }
 
 private:
   StateListPtr setupStates;
@@ -100,6 +100,7 @@ void TimeManagement::init(Search::LimitsType& limits, Color us, int ply) {
       // Convert from millisecs to nodes
       limits.time[us] = (int)availableNodes;
       limits.inc[us] *= npmsec;
+      limits.movetime *= npmsec;
       limits.npmsec = npmsec;
   }
 
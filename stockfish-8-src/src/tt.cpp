@@ -18,11 +18,25 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>   // For std::memset
+#include <fstream>
 #include <iostream>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define USE_MMAP
+#endif
 
 #include "bitboard.h"
 #include "tt.h"
+#include "uci.h"
 
 TranspositionTable TT; // Our global transposition table
 
@@ -40,8 +54,31 @@ void TranspositionTable::resize(size_t mbSize) {
 
   clusterCount = newClusterCount;
 
-  free(mem);
+  free_mem();
+
+#ifdef USE_MMAP
+  // Anonymous pages come zeroed and are only backed by memory once touched, so
+  // the table needs no clearing here. It is aligned to, and advised as, huge
+  // pages: with 4K pages nearly every probe of a large table is a TLB miss.
+  const size_t HugePageSize = 2 * 1024 * 1024;
+  size_t size = clusterCount * sizeof(Cluster);
+
+  memSize = size + HugePageSize;
+  mem = mmap(nullptr, memSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (mem == MAP_FAILED)
+      mem = nullptr, memSize = 0;
+  else
+  {
+      table = (Cluster*)((uintptr_t(mem) + HugePageSize - 1) & ~(HugePageSize - 1));
+#ifdef MADV_HUGEPAGE
+      madvise(table, size, MADV_HUGEPAGE);
+#endif
+  }
+#else
   mem = calloc(clusterCount * sizeof(Cluster) + CacheLineSize - 1, 1);
+  table = (Cluster*)((uintptr_t(mem) + CacheLineSize - 1) & ~(CacheLineSize - 1));
+#endif
 
   if (!mem)
   {
@@ -50,17 +87,55 @@ void TranspositionTable::resize(size_t mbSize) {
       exit(EXIT_FAILURE);
   }
 
-  table = (Cluster*)((uintptr_t(mem) + CacheLineSize - 1) & ~(CacheLineSize - 1));
+  zeroed = true;
+}
+
+
+/// TranspositionTable::free_mem() releases the table's memory, however it was
+/// allocated.
+
+void TranspositionTable::free_mem() {
+
+#ifdef USE_MMAP
+  if (mem)
+      munmap(mem, memSize);
+#else
+  free(mem);
+#endif
+
+  mem = nullptr;
+  memSize = 0;
 }
 
 
 /// TranspositionTable::clear() overwrites the entire transposition table
-/// with zeros. It is called whenever the table is resized, or when the
-/// user asks the program to clear the table (from the UCI interface).
+/// with zeros. It is called on a new game, or when the user asks the program
+/// to clear the table (from the UCI interface). Nothing is done if the table
+/// hasn't been searched since it was allocated or last cleared, otherwise the
+/// work is split over as many threads as the search uses.
 
 void TranspositionTable::clear() {
 
-  std::memset(table, 0, clusterCount * sizeof(Cluster));
+  if (zeroed)
+      return;
+
+  const size_t threadCount = Options["Threads"];
+  std::vector<std::thread> threads;
+
+  for (size_t idx = 0; idx < threadCount; ++idx)
+      threads.emplace_back([this, idx, threadCount]() {
+
+          const size_t stride = clusterCount / threadCount,
+                       start  = stride * idx,
+                       len    = idx != threadCount - 1 ? stride : clusterCount - start;
+
+          std::memset(&table[start], 0, len * sizeof(Cluster));
+      });
+
+  for (std::thread& th : threads)
+      th.join();
+
+  zeroed = true;
 }
 
 
@@ -115,3 +190,226 @@ int TranspositionTable::hashfull() const {
   }
   return cnt;
 }
+
+
+/// Snapshot file, written by save() and read by load(), in native byte order:
+///
+///   header   "SFTT", uint32 version, uint64 cluster count, uint64 entry count
+///   entries  varint distance from the previous entry's position (cluster *
+///            ClusterSize + slot, starting from 0), then the 10 entry bytes
+///            with the generation replaced by the entry's age in searches
+///
+/// The table is mostly full, so the positions take a byte or two each.
+
+namespace {
+
+  const char SnapshotMagic[4] = { 'S', 'F', 'T', 'T' };
+  const uint32_t SnapshotVersion = 1;
+  const size_t SnapshotHeaderSize = 24;
+  const size_t SnapshotMaxEntries = 1 << 20; // Keep the file to about 12MB
+  const int SnapshotMaxAge = 63;             // Searches; anything older isn't saved
+  const size_t SnapshotMaxGrowth = 16;       // See load()
+
+  bool no_file(const std::string& file) { return file.empty() || file == "<empty>"; }
+}
+
+
+/// TranspositionTable::save() writes the deepest entries from recent searches
+/// to a file, so the next engine can start with them. The file is written
+/// under a temporary name and renamed, so it is never seen half written.
+/// Nothing is written unless there has been a search since the table was
+/// loaded or last saved, so idle engines sharing the file leave it alone.
+
+void TranspositionTable::save(const std::string& file) {
+
+  if (no_file(file) || zeroed || !unsaved)
+      return;
+
+  // Pick a depth cut-off that keeps the file within SnapshotMaxEntries
+  size_t histogram[256] = {}, total = 0, kept = 0;
+  int minDepth = -128;
+
+  for (size_t i = 0; i < clusterCount * ClusterSize; ++i)
+  {
+      const TTEntry& e = table[i / ClusterSize].entry[i % ClusterSize];
+
+      if (e.key16 && ((259 + generation8 - e.genBound8) & 0xFC) / 4 <= SnapshotMaxAge)
+          histogram[e.depth8 + 128]++;
+  }
+
+  for (int d = 255; d >= 0; --d)
+  {
+      if (total + histogram[d] > SnapshotMaxEntries)
+          break;
+
+      total += histogram[d];
+      minDepth = d - 128;
+  }
+
+  std::string tmpFile = file + ".tmp";
+
+#ifdef USE_MMAP
+  tmpFile = file + "." + std::to_string(getpid()) + ".tmp"; // Other engines may be saving too
+#endif
+  std::ofstream out(tmpFile, std::ios::binary);
+  std::vector<char> buf;
+
+  buf.resize(SnapshotHeaderSize);
+  memcpy(&buf[0], SnapshotMagic, 4);
+  memcpy(&buf[4], &SnapshotVersion, 4);
+  uint64_t clusters64 = clusterCount, total64 = total; // size_t may be 32 bits
+
+  memcpy(&buf[8], &clusters64, 8);
+  memcpy(&buf[16], &total64, 8);
+
+  uint64_t prev = 0;
+
+  for (size_t i = 0; i < clusterCount * ClusterSize && kept < total; ++i)
+  {
+      TTEntry e = table[i / ClusterSize].entry[i % ClusterSize];
+      int age = ((259 + generation8 - e.genBound8) & 0xFC) / 4;
+
+      if (!e.key16 || age > SnapshotMaxAge || e.depth8 < minDepth)
+          continue;
+
+      for (uint64_t delta = i - prev; ; delta >>= 7)
+      {
+          buf.push_back(char((delta & 0x7F) | (delta > 0x7F ? 0x80 : 0)));
+          if (delta <= 0x7F)
+              break;
+      }
+      prev = i;
+
+      e.genBound8 = uint8_t((age << 2) | e.bound());
+      buf.insert(buf.end(), (char*)&e, (char*)&e + sizeof(TTEntry));
+      kept++;
+  }
+
+  out.write(buf.data(), buf.size());
+  out.close();
+
+  if (!out || std::rename(tmpFile.c_str(), file.c_str()) != 0)
+  {
+      std::remove(tmpFile.c_str());
+      sync_cout << "info string Unable to save hash to " << file << sync_endl;
+  }
+  else
+      unsaved = false;
+}
+
+
+/// TranspositionTable::load() fills the table from a snapshot file. Loaded
+/// entries are aged one search more than when they were saved, so they lose
+/// out to anything the coming search finds at the same depth.
+///
+/// A table smaller than the saved one takes each entry at its position masked
+/// down. A table up to SnapshotMaxGrowth times bigger can't know which of its
+/// clusters an entry belongs in (only the low bits of the key are known), so
+/// the entry is copied to each of them; the copies in the wrong clusters are no
+/// more likely to give a false hit than the entry was in the smaller table.
+
+void TranspositionTable::load(const std::string& file) {
+
+  if (no_file(file) || !table)
+      return;
+
+  const char* data;
+  size_t size;
+
+#ifdef USE_MMAP
+  int fd = open(file.c_str(), O_RDONLY);
+  struct stat st;
+
+  if (fd < 0)
+      return;
+
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < SnapshotHeaderSize)
+  {
+      close(fd);
+      return;
+  }
+
+  size = st.st_size;
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (map == MAP_FAILED)
+      return;
+
+  madvise(map, size, MADV_SEQUENTIAL);
+  data = (const char*)map;
+#else
+  std::ifstream in(file, std::ios::binary);
+  std::vector<char> contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+  if (contents.size() < SnapshotHeaderSize)
+      return;
+
+  size = contents.size();
+  data = contents.data();
+#endif
+
+  uint32_t version;
+  uint64_t savedClusters, count, loaded = 0;
+
+  memcpy(&version, data + 4, 4);
+  memcpy(&savedClusters, data + 8, 8);
+  memcpy(&count, data + 16, 8);
+
+  if (   !memcmp(data, SnapshotMagic, 4)
+      && version == SnapshotVersion
+      && savedClusters && !(savedClusters & (savedClusters - 1))
+      && savedClusters <= SIZE_MAX
+      && clusterCount / savedClusters <= SnapshotMaxGrowth)
+  {
+      const size_t copies = clusterCount > savedClusters ? clusterCount / savedClusters : 1;
+      const size_t mask = std::min(size_t(savedClusters), clusterCount) - 1;
+      const char* p = data + SnapshotHeaderSize;
+      const char* end = data + size;
+      uint64_t pos = 0;
+
+      for ( ; loaded < count; ++loaded)
+      {
+          uint64_t delta = 0;
+          int shift = 0;
+
+          while (p < end && (*p & 0x80) && shift < 63)
+              delta |= uint64_t(*p++ & 0x7F) << shift, shift += 7;
+
+          if (p >= end || end - p < 1 + (ptrdiff_t)sizeof(TTEntry))
+              break;
+
+          delta |= uint64_t(*p++ & 0x7F) << shift;
+          pos += delta;
+
+          TTEntry e;
+          memcpy(&e, p, sizeof(TTEntry));
+          p += sizeof(TTEntry);
+
+          if (pos / ClusterSize >= savedClusters)
+              break;
+
+          e.genBound8 = uint8_t((generation8 - 4 * ((e.genBound8 >> 2) + 1)) & 0xFC) | e.bound();
+
+          for (size_t c = 0; c < copies; ++c)
+          {
+              size_t cluster = (pos / ClusterSize & mask) + c * savedClusters;
+              TTEntry& slot = table[cluster].entry[pos % ClusterSize];
+
+              // When shrinking, several saved clusters land on one; keep the deepest
+              if (!slot.key16 || slot.depth8 < e.depth8)
+                  slot = e;
+          }
+      }
+  }
+
+#ifdef USE_MMAP
+  munmap(map, size);
+#endif
+
+  if (loaded)
+  {
+      zeroed = false;
+      sync_cout << "info string Loaded " << loaded << " hash entries from " << file << sync_endl;
+  }
+}
@@ -21,6 +21,8 @@
 #ifndef TT_H_INCLUDED
 #define TT_H_INCLUDED
 
+#include <string>
+
 #include "misc.h"
 #include "types.h"
 
@@ -96,13 +98,15 @@ class TranspositionTable {
   static_assert(CacheLineSize % sizeof(Cluster) == 0, "Cluster size incorrect");
 
 public:
- ~TranspositionTable() { free(mem); }
-  void new_search() { generation8 += 4; } // Lower 2 bits are used by Bound
+ ~TranspositionTable() { free_mem(); }
+  void new_search() { generation8 += 4; zeroed = false; unsaved = true; } // Lower 2 bits are used by Bound
   uint8_t generation() const { return generation8; }
   TTEntry* probe(const Key key, bool& found) const;
   int hashfull() const;
   void resize(size_t mbSize);
   void clear();
+  void save(const std::string& file);
+  void load(const std::string& file);
 
   // The lowest order bits of the key are used to get the index of the cluster
   TTEntry* first_entry(const Key key) const {
@@ -110,9 +114,14 @@ public:
   }
 
 private:
+  void free_mem();
+
   size_t clusterCount;
   Cluster* table;
   void* mem;
+  size_t memSize;  // Bytes mapped at mem, 0 if it came from calloc()
+  bool zeroed;     // Nothing written since the table was allocated or cleared
+  bool unsaved;    // Searched since the table was last loaded or saved
   uint8_t generation8; // Size must be not bigger than TTEntry::genBound8
 };
 
@@ -18,21 +18,28 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "evaluate.h"
 #include "movegen.h"
 #include "position.h"
 #include "search.h"
+#include "shmchannel.h"
+#include "tables.h"
 #include "thread.h"
 #include "timeman.h"
 #include "uci.h"
+#include "syzygy/tbprobe.h"
 
 using namespace std;
 
 extern void benchmark(const Position& pos, istream& is);
+extern void eval_cache_benchmark(istream& is);
+extern void smp_benchmark(istream& is);
 
 namespace {
 
@@ -44,19 +51,78 @@ namespace {
   // 'draw by repetition' detection.
   StateListPtr States(new std::deque<StateInfo>(1));
 
+  // The position last set up by set_position(): the FEN and the moves played
+  // from it. The GUI sends the whole game before every search, so the next
+  // position usually extends this one by a move or two.
+  string SetupFen;
+  bool SetupChess960;
+  vector<string> SetupMoves;
+
+
+  // set_position() sets up a FEN and the moves from it, up to the first one that
+  // isn't legal. If it extends the position set up last, the moves already
+  // played are kept, with their states, and only the new ones are played on.
+
+  void set_position(Position& pos, const string& fen, bool chess960, vector<string>& moves) {
+
+    size_t played = 0;
+
+    // After "go" the states are the search's; they are taken back last, only
+    // once the position is known to extend them.
+    if (   !SetupFen.empty()
+        && fen == SetupFen
+        && chess960 == SetupChess960
+        && moves.size() >= SetupMoves.size()
+        && std::equal(SetupMoves.begin(), SetupMoves.end(), moves.begin())
+        && (States.get() || Threads.take_setup_states(States)))
+        played = SetupMoves.size();
+    else
+    {
+        States = StateListPtr(new std::deque<StateInfo>(1));
+        pos.set(fen, chess960, &States->back(), Threads.main());
+    }
+
+    for ( ; played < moves.size(); ++played)
+    {
+        Move m = UCI::to_move(pos, moves[played]);
+
+        if (m == MOVE_NONE)
+            break;
+
+        States->push_back(StateInfo());
+        pos.do_move(m, States->back(), pos.gives_check(m));
+    }
+
+    moves.resize(played);
+    SetupFen = fen;
+    SetupChess960 = chess960;
+    SetupMoves.swap(moves);
+  }
+
 
   // position() is called when engine receives the "position" UCI command.
   // The function sets up the position described in the given FEN string ("fen")
   // or the starting position ("startpos") and then makes the moves given in the
-  // following move list ("moves").
+  // following move list ("moves"). "position shm" takes the position posted
+  // in the shared memory channel instead.
 
   void position(Position& pos, istringstream& is) {
 
-    Move m;
     string token, fen;
+    bool chess960 = Options["UCI_Chess960"];
+    vector<string> moves;
 
     is >> token;
 
+    if (token == "shm")
+    {
+        if (!ShmChannel::read_position(fen, chess960, moves))
+            sync_cout << "info string No shared memory channel" << sync_endl;
+        else
+            set_position(pos, fen, chess960, moves);
+        return;
+    }
+
     if (token == "startpos")
     {
         fen = StartFEN;
@@ -68,15 +134,10 @@ namespace {
     else
         return;
 
-    States = StateListPtr(new std::deque<StateInfo>(1));
-    pos.set(fen, Options["UCI_Chess960"], &States->back(), Threads.main());
+    while (is >> token)
+        moves.push_back(token);
 
-    // Parse move list (if any)
-    while (is >> token && (m = UCI::to_move(pos, token)) != MOVE_NONE)
-    {
-        States->push_back(StateInfo());
-        pos.do_move(m, States->back(), pos.gives_check(m));
-    }
+    set_position(pos, fen, chess960, moves);
   }
 
 
@@ -132,9 +193,41 @@ namespace {
         else if (token == "infinite")  limits.infinite = 1;
         else if (token == "ponder")    limits.ponder = 1;
 
+  limits.analysis = Options["UCI_AnalyseMode"];
+
+    ShmChannel::new_search();
     Threads.start_thinking(pos, States, limits);
   }
 
+
+  // tables() is called on "tables save [file]", which builds the startup tables
+  // and writes them to the tables file, or "tables check [file]", which builds
+  // them and compares them with the file.
+
+  void tables(istringstream& is) {
+
+    string token, file;
+
+    is >> token;
+
+    if (!(is >> file))
+        file = Tables::file();
+
+    if (token == "save")
+    {
+        Tables::build();
+
+        if (Tables::save(file))
+            sync_cout << "Tables saved to " << file << sync_endl;
+        else
+            sync_cout << "Unable to save tables to " << file << sync_endl;
+    }
+    else if (token == "check")
+        Tables::check(file);
+    else
+        sync_cout << "Usage: tables save|check [file]" << sync_endl;
+  }
+
 } // namespace
 
 
@@ -185,6 +278,8 @@ void UCI::loop(int argc, char* argv[]) {
 
       else if (token == "ucinewgame")
       {
+          // The GUI may send it before the last search has wound down
+          Threads.main()->wait_for_search_finished();
           Search::clear();
           Time.availableNodes = 0;
       }
@@ -194,8 +289,11 @@ void UCI::loop(int argc, char* argv[]) {
       else if (token == "setoption")  setoption(is);
 
       // Additional custom non-UCI commands, useful for debugging
-      else if (token == "flip")       pos.flip();
-      else if (token == "bench")      benchmark(pos, is);
+      else if (token == "flip")       pos.flip(), SetupFen.clear();
+      else if (token == "bench")      benchmark(pos, is), SetupFen.clear();
+      else if (token == "evalbench")  eval_cache_benchmark(is), SetupFen.clear();
+      else if (token == "smpbench")   smp_benchmark(is), SetupFen.clear();
+      else if (token == "tables")     tables(is);
       else if (token == "d")          sync_cout << pos << sync_endl;
       else if (token == "eval")       sync_cout << Eval::trace(pos) << sync_endl;
       else if (token == "perft")
@@ -208,6 +306,7 @@ void UCI::loop(int argc, char* argv[]) {
              << Options["Threads"] << " " << depth << " current perft";
 
           benchmark(pos, ss);
+          SetupFen.clear();
       }
       else
           sync_cout << "Unknown command: " << cmd << sync_endl;
@@ -274,16 +373,58 @@ string UCI::move(Move m, bool chess960) {
 
 
 /// UCI::to_move() converts a string representing a move in coordinate notation
-/// (g1f3, a7a8q) to the corresponding legal Move, if any.
+/// (g1f3, a7a8q) to the corresponding legal Move, if any. The move is decoded
+/// from its squares and then checked, rather than looked for among the legal
+/// moves: the GUI sends the whole game before every search.
 
 Move UCI::to_move(const Position& pos, string& str) {
 
   if (str.length() == 5) // Junior could send promotion piece in uppercase
       str[4] = char(tolower(str[4]));
 
-  for (const auto& m : MoveList<LEGAL>(pos))
-      if (str == UCI::move(m, pos.is_chess960()))
-          return m;
+  if (   (str.length() != 4 && str.length() != 5)
+      || str[0] < 'a' || str[0] > 'h' || str[1] < '1' || str[1] > '8'
+      || str[2] < 'a' || str[2] > 'h' || str[3] < '1' || str[3] > '8')
+      return MOVE_NONE;
+
+  Square from = make_square(File(str[0] - 'a'), Rank(str[1] - '1'));
+  Square to   = make_square(File(str[2] - 'a'), Rank(str[3] - '1'));
+  Piece pc = pos.piece_on(from);
+  Move m;
+
+  if (str.length() == 5)
+  {
+      size_t promotion = string("nbrq").find(str[4]);
+
+      if (promotion == string::npos)
+          return MOVE_NONE;
+
+      m = make<PROMOTION>(from, to, PieceType(KNIGHT + promotion));
+  }
+  // Castling is the king's two square move, or in Chess960 the king taking
+  // its own rook; either way the move itself goes from king to rook.
+  else if (   type_of(pc) == KING
+           && (pos.is_chess960() ? pos.piece_on(to) == make_piece(pos.side_to_move(), ROOK)
+                                 : distance<File>(from, to) == 2))
+      m = make<CASTLING>(from, pos.is_chess960() ? to
+                             : pos.castling_rook_square(pos.side_to_move() | (to > from ? KING_SIDE : QUEEN_SIDE)));
+  else if (type_of(pc) == PAWN && to == pos.ep_square())
+      m = make<ENPASSANT>(from, to);
+  else
+      m = make_move(from, to);
+
+  if (!pos.pseudo_legal(m) || !pos.legal(m))
+      m = MOVE_NONE;
+
+#ifndef NDEBUG
+  Move found = MOVE_NONE;
+
+  for (const auto& lm : MoveList<LEGAL>(pos))
+      if (str == UCI::move(lm, pos.is_chess960()))
+          found = lm;
+
+  assert(m == found);
+#endif
 
-  return MOVE_NONE;
+  return m;
 }
@@ -22,8 +22,12 @@
 #include <cassert>
 #include <ostream>
 
+#include "evaluate.h"
+#include "material.h"
 #include "misc.h"
+#include "pawns.h"
 #include "search.h"
+#include "shmchannel.h"
 #include "thread.h"
 #include "tt.h"
 #include "uci.h"
@@ -37,10 +41,32 @@ namespace UCI {
 
 /// 'On change' actions, triggered by an option's value change
 void on_clear_hash(const Option&) { Search::clear(); }
-void on_hash_size(const Option& o) { TT.resize(o); }
+
+// The shared pawn and material tables take a sixteenth and a sixty-fourth of
+// Hash, and are at least as big as a thread's own
+void on_eval_tables(const Option&) {
+
+  size_t bytes = Options["SharedEvalTables"] ? size_t(Options["Hash"]) << 20 : 0;
+
+  Pawns::SharedTable.resize(bytes / 16, 16384);
+  Material::SharedTable.resize(bytes / 64, 8192);
+}
+void on_hash_size(const Option& o) { TT.resize(o); TT.load(Options["HashFile"]); on_eval_tables(o); }
+void on_hash_file(const Option& o) { TT.load(o); }
+void on_eval_cache(const Option& o) { Eval::Cache.resize(o); }
+void on_save_hash(const Option&) { TT.save(Options["HashFile"]); }
 void on_logger(const Option& o) { start_logger(o); }
-void on_threads(const Option&) { Threads.read_uci_options(); }
+void on_threads(const Option&) {
+
+  // The GUI may change them between searches (thermal scheduling); never under one
+  Threads.main()->wait_for_search_finished();
+  Threads.read_uci_options();
+
+  // Its entries point to endgame functions of threads that may be gone
+  Material::SharedTable.clear();
+}
 void on_tb_path(const Option& o) { Tablebases::init(o); }
+void on_shm_channel(const Option& o) { ShmChannel::attach(o); }
 
 
 /// Our case insensitive less() function as required by UCI protocol
@@ -60,20 +86,30 @@ void init(OptionsMap& o) {
   o["Debug Log File"]        << Option("", on_logger);
   o["Contempt"]              << Option(0, -100, 100);
   o["Threads"]               << Option(1, 1, 128, on_threads);
+  o["RootSplit"]             << Option(false);
   o["Hash"]                  << Option(16, 1, MaxHashMB, on_hash_size);
   o["Clear Hash"]            << Option(on_clear_hash);
+  o["SharedEvalTables"]      << Option(false, on_eval_tables);
+  o["EvalCache"]             << Option(0, 0, 1024, on_eval_cache);
+  o["HashFile"]              << Option("<empty>", on_hash_file);
+  o["Save Hash"]             << Option(on_save_hash);
+  o["ResultFile"]            << Option("result.txt");
+  o["ShmChannel"]            << Option("<empty>", on_shm_channel);
   o["Ponder"]                << Option(false);
   o["MultiPV"]               << Option(1, 1, 500);
   o["Skill Level"]           << Option(20, 0, 20);
+  o["SkillSeed"]             << Option(0, 0, 2147483647);
   o["Move Overhead"]         << Option(30, 0, 5000);
   o["Minimum Thinking Time"] << Option(20, 0, 5000);
   o["Slow Mover"]            << Option(89, 10, 1000);
   o["nodestime"]             << Option(0, 0, 10000);
   o["UCI_Chess960"]          << Option(false);
+  o["UCI_AnalyseMode"]       << Option(false);
   o["SyzygyPath"]            << Option("<empty>", on_tb_path);
   o["SyzygyProbeDepth"]      << Option(1, 1, 100);
   o["Syzygy50MoveRule"]      << Option(true);
   o["SyzygyProbeLimit"]      << Option(6, 0, 6);
+  o["SyzygyInstantMove"]     << Option(false);
 }
 
 
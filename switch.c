@@ -6,7 +6,7 @@
 #include "gpio.h"
 #include "event.h"
 #include "hsm.h"
-#include "bcm2835.h"
+#include "hal.h"
 #include "options.h"
 #include "hsm.h"
 #include "hsmDefs.h"
@@ -252,7 +252,7 @@ void switchPoll ( void )
    // Buttons
 
    // Has the state at the GPIO expanders changed?
-   if( bcm2835_gpio_lev(BUTTON_SWITCH_INT_PIN) == 0)
+   if( HAL_gpioLevel(BUTTON_SWITCH_INT_PIN) == 0)
    {
       uint8_t command[2];
       uint8_t junk;
@@ -325,6 +325,20 @@ void switchPoll ( void )
    pthread_mutex_unlock(&Switch_dataMutex);
 }
 
+// Apply a reed switch change from an event trace (see replay.c) to the debounced states, as if
+//   switchPoll() had just reported it.  Does not post an event.
+void SW_injectChange( int sq, bool_t state )
+{
+   pthread_mutex_lock(&Switch_dataMutex);
+
+   if(state == FALSE)
+      debouncedState &= ~(0x0000000000000001ULL << sq);
+   else
+      debouncedState |=  (0x0000000000000001ULL << sq);
+
+   pthread_mutex_unlock(&Switch_dataMutex);
+}
+
 bool_t SW_getFlippedState( void )
 {
   return flippedBoard;
@@ -372,7 +386,7 @@ static uint8_t checkRow(uint8_t row, uint8_t intPin, uint8_t portAddress, uint8_
    uint8_t command[2];
 
    // If interrupt pin is not asserted, just return last sample
-   if( bcm2835_gpio_lev(intPin) == 1)
+   if( HAL_gpioLevel(intPin) == 1)
    {
       // No changes... return last value
        retValue = ((uint8_t *)(&lastBitBoard))[8-row];
@@ -28,6 +28,10 @@ void setButtonRepeat(uint8_t delay, uint8_t interval);
 
 void SW_SetFlip( bool_t state );
 
+// Set a square's debounced state directly (event trace replay only).  sq and state as passed
+//   with EV_PIECE_LIFT / EV_PIECE_DROP
+void SW_injectChange( int sq, bool_t state );
+
 bool_t SW_getFlippedState( void );
 
 
@@ -0,0 +1,602 @@
+#include "syzygy.h"
+
+#include "bitboard.h"
+#include "board.h"
+#include "constants.h"
+#include "diag.h"
+#include "moves.h"
+#include "zobrist.h"
+
+// The table files, their decompression and indexing.  Expects calc_key_from_pcs() from here.
+#include "stockfish-8-src/src/syzygy/tbcore.cpp"
+
+static uint64 kvkKey;      // material key of the bare kings, set by SYZYGY_init()
+
+static int wdlToDtz[] = { -1, -101, 0, 101, 1 };
+
+static int probeDtz( board_t *b, int *success );
+
+// Material key of the pieces counted in pcs (1 to 6 white pawns to kings, 9 to 14 black), with
+//   the colors swapped if mirror.  The same keys as materialKey() gives a board.
+static uint64 calc_key_from_pcs( int *pcs, int mirror )
+{
+   int color = mirror ? 8 : 0;
+   uint64 key = 0;
+   int pt, i;
+
+   for(pt=TB_PAWN;pt<=TB_KING;pt++)
+   {
+      for(i=0;i<pcs[color + pt];i++)
+         key ^= Z_PIECESQUARE_KEY(pt - TB_PAWN, WHITE, i);
+
+      for(i=0;i<pcs[(color ^ 8) + pt];i++)
+         key ^= Z_PIECESQUARE_KEY(pt - TB_PAWN, BLACK, i);
+   }
+   return key;
+}
+
+static uint64 materialKey( const board_t *b, int mirror )
+{
+   int pcs[16] = {0};
+   piece_t p;
+
+   for(p=PAWN;p<=KING;p++)
+   {
+      pcs[TB_PAWN + p]     = bitCount(b->colors[WHITE] & b->pieces[p]);
+      pcs[TB_PAWN + p + 8] = bitCount(b->colors[BLACK] & b->pieces[p]);
+   }
+   return calc_key_from_pcs(pcs, mirror);
+}
+
+// The table's file name for the material, e.g. "KQPvKR";  white first unless mirror
+static void tableName( const board_t *b, char *str, int mirror )
+{
+   color_t c = mirror ? BLACK : WHITE;
+   int p, i;
+
+   for(p=KING;p>=PAWN;p--)
+      for(i=bitCount(b->colors[c] & b->pieces[p]);i>0;i--)
+         *str++ = pchr[KING - p];
+
+   *str++ = 'v';
+
+   c = (c == WHITE) ? BLACK : WHITE;
+   for(p=KING;p>=PAWN;p--)
+      for(i=bitCount(b->colors[c] & b->pieces[p]);i>0;i--)
+         *str++ = pchr[KING - p];
+
+   *str = '\0';
+}
+
+static ubyte decompress_pairs( struct PairsData *d, uint64 idx )
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+   return decompress_pairs_order(d, idx, 1);
+#else
+   return decompress_pairs_order(d, idx, 0);
+#endif
+}
+
+// Fill p from p[i] with the squares of the pieces of table code (1 to 6 pawn to king, 8 added
+//   for black), numbered as the tables do (a1 = 0) and flipped by mirror.  Returns the next i.
+static int tableSquares( const board_t *b, int code, int mirror, int *p, int i )
+{
+   BB bb = b->colors[(code & 8) ? BLACK : WHITE] & b->pieces[(code & 7) - TB_PAWN];
+
+   while(bb)
+   {
+      p[i++] = ((63 - getLSBindex(bb)) ^ 56) ^ mirror;
+      clearlsb(bb);
+   }
+   return i;
+}
+
+// Which side of the table the position is on, and how it's flipped to match the table
+static void tableSide( const struct TBEntry *ptr, uint64 key, color_t toMove,
+                       int *bside, int *mirror, int *cmirror )
+{
+   if(!ptr->symmetric)
+   {
+      if(key != ptr->key)
+      {
+         *cmirror = 8;
+         *mirror  = 0x38;
+         *bside   = (toMove == WHITE);
+      }
+      else
+      {
+         *cmirror = *mirror = 0;
+         *bside   = (toMove != WHITE);
+      }
+   }
+   else
+   {
+      *cmirror = (toMove == WHITE) ? 0 : 8;
+      *mirror  = (toMove == WHITE) ? 0 : 0x38;
+      *bside   = 0;
+   }
+}
+
+// The WDL table's entry for the position, as probe_wdl(), with no regard for captures
+static int probeWdlTable( board_t *b, int *success )
+{
+   struct TBEntry *ptr;
+   struct TBHashEntry *ptr2;
+   uint64 idx, key = materialKey(b, 0);
+   int i, f, bside, mirror, cmirror;
+   int p[TBPIECES];
+   ubyte *pc;
+   ubyte res;
+
+   if(key == kvkKey)
+      return 0;
+
+   ptr2 = TB_hash[key >> (64 - TBHASHBITS)];
+   for(i=0;i<HSHMAX && ptr2[i].key != key;i++);
+   if(i == HSHMAX)
+   {
+      *success = 0;
+      return 0;
+   }
+
+   // Each table is mapped the first time it's needed
+   ptr = ptr2[i].ptr;
+   if(!ptr->ready)
+   {
+      char str[16];
+
+      tableName(b, str, ptr->key != key);
+      if(!init_table_wdl(ptr, str))
+      {
+         ptr2[i].key = 0ULL;
+         *success = 0;
+         return 0;
+      }
+      ptr->ready = 1;
+   }
+
+   tableSide(ptr, key, b->toMove, &bside, &mirror, &cmirror);
+
+   if(!ptr->has_pawns)
+   {
+      struct TBEntry_piece *entry = (struct TBEntry_piece *)ptr;
+
+      pc = entry->pieces[bside];
+      for(i=0;i<entry->num;)
+         i = tableSquares(b, pc[i] ^ cmirror, 0, p, i);
+
+      idx = encode_piece(entry, entry->norm[bside], p, entry->factor[bside]);
+      res = decompress_pairs(entry->precomp[bside], idx);
+   }
+   else
+   {
+      struct TBEntry_pawn *entry = (struct TBEntry_pawn *)ptr;
+
+      i = tableSquares(b, entry->file[0].pieces[0][0] ^ cmirror, mirror, p, 0);
+      f = pawn_file(entry, p);
+
+      pc = entry->file[f].pieces[bside];
+      while(i < entry->num)
+         i = tableSquares(b, pc[i] ^ cmirror, mirror, p, i);
+
+      idx = encode_pawn(entry, entry->file[f].norm[bside], p, entry->file[f].factor[bside]);
+      res = decompress_pairs(entry->file[f].precomp[bside], idx);
+   }
+
+   return (int)res - 2;
+}
+
+// The DTZ table's entry for the position, given its WDL.  success -1 if the table is only
+//   stored for the other side to move.
+static int probeDtzTable( board_t *b, int wdl, int *success )
+{
+   struct TBEntry *ptr;
+   uint64 idx, key = materialKey(b, 0);
+   int i, f, res, bside, mirror, cmirror;
+   int p[TBPIECES];
+   ubyte *pc;
+
+   // The most recently used DTZ tables are kept mapped, most recent first
+   if(DTZ_table[0].key1 != key && DTZ_table[0].key2 != key)
+   {
+      for(i=1;i<DTZ_ENTRIES && DTZ_table[i].key1 != key;i++);
+
+      if(i < DTZ_ENTRIES)
+      {
+         struct DTZTableEntry tableEntry = DTZ_table[i];
+
+         for(;i>0;i--)
+            DTZ_table[i] = DTZ_table[i - 1];
+         DTZ_table[0] = tableEntry;
+      }
+      else
+      {
+         struct TBHashEntry *ptr2 = TB_hash[key >> (64 - TBHASHBITS)];
+         char str[16];
+
+         for(i=0;i<HSHMAX && ptr2[i].key != key;i++);
+         if(i == HSHMAX)
+         {
+            *success = 0;
+            return 0;
+         }
+
+         mirror = (ptr2[i].ptr->key != key);
+         tableName(b, str, mirror);
+
+         if(DTZ_table[DTZ_ENTRIES - 1].entry)
+            free_dtz_entry(DTZ_table[DTZ_ENTRIES - 1].entry);
+         for(i=DTZ_ENTRIES-1;i>0;i--)
+            DTZ_table[i] = DTZ_table[i - 1];
+
+         load_dtz_table(str, materialKey(b, mirror), materialKey(b, !mirror));
+      }
+   }
+
+   ptr = DTZ_table[0].entry;
+   if(!ptr)
+   {
+      *success = 0;
+      return 0;
+   }
+
+   tableSide(ptr, key, b->toMove, &bside, &mirror, &cmirror);
+
+   if(!ptr->has_pawns)
+   {
+      struct DTZEntry_piece *entry = (struct DTZEntry_piece *)ptr;
+
+      if((entry->flags & 1) != bside && !entry->symmetric)
+      {
+         *success = -1;
+         return 0;
+      }
+
+      pc = entry->pieces;
+      for(i=0;i<entry->num;)
+         i = tableSquares(b, pc[i] ^ cmirror, 0, p, i);
+
+      idx = encode_piece((struct TBEntry_piece *)entry, entry->norm, p, entry->factor);
+      res = decompress_pairs(entry->precomp, idx);
+
+      if(entry->flags & 2)
+         res = entry->map[entry->map_idx[wdl_to_map[wdl + 2]] + res];
+
+      if(!(entry->flags & pa_flags[wdl + 2]) || (wdl & 1))
+         res *= 2;
+   }
+   else
+   {
+      struct DTZEntry_pawn *entry = (struct DTZEntry_pawn *)ptr;
+
+      i = tableSquares(b, entry->file[0].pieces[0] ^ cmirror, mirror, p, 0);
+      f = pawn_file((struct TBEntry_pawn *)entry, p);
+
+      if((entry->flags[f] & 1) != bside)
+      {
+         *success = -1;
+         return 0;
+      }
+
+      pc = entry->file[f].pieces;
+      while(i < entry->num)
+         i = tableSquares(b, pc[i] ^ cmirror, mirror, p, i);
+
+      idx = encode_pawn((struct TBEntry_pawn *)entry, entry->file[f].norm, p, entry->file[f].factor);
+      res = decompress_pairs(entry->file[f].precomp, idx);
+
+      if(entry->flags[f] & 2)
+         res = entry->map[entry->map_idx[f][wdl_to_map[wdl + 2]] + res];
+
+      if(!(entry->flags[f] & pa_flags[wdl + 2]) || (wdl & 1))
+         res *= 2;
+   }
+
+   return res;
+}
+
+static int legalMoves( board_t *b, move_t *list )
+{
+   int n = findMoves(b, list);
+
+   return (n < 0) ? 0 : n;
+}
+
+static bool_t isPawnMove( const board_t *b, move_t m )
+{
+   return (b->pieces[PAWN] & squareMask[m.from]) ? TRUE : FALSE;
+}
+
+// A pawn moving diagonally to an empty square
+static bool_t isEnPassant( const board_t *b, move_t m )
+{
+   return (isPawnMove(b, m) && (m.from % 8) != (m.to % 8) &&
+           !((b->colors[WHITE] | b->colors[BLACK]) & squareMask[m.to])) ? TRUE : FALSE;
+}
+
+static bool_t isCapture( const board_t *b, move_t m )
+{
+   return (((b->colors[WHITE] | b->colors[BLACK]) & squareMask[m.to]) || isEnPassant(b, m)) ?
+          TRUE : FALSE;
+}
+
+// WDL of the position, searching captures (en passant aside) until the tables have the answer
+static int probeAb( board_t *b, int alpha, int beta, int *success )
+{
+   move_t list[MAX_LIST_SIZE];
+   revMove_t rev;
+   int n, i, v;
+
+   n = legalMoves(b, list);
+   for(i=0;i<n;i++)
+   {
+      if(!isCapture(b, list[i]) || isEnPassant(b, list[i]))
+         continue;
+
+      rev = move(b, list[i]);
+      v = -probeAb(b, -beta, -alpha, success);
+      unmove(b, rev);
+
+      if(*success == 0) return 0;
+      if(v > alpha)
+      {
+         if(v >= beta)
+         {
+            *success = 2;
+            return v;
+         }
+         alpha = v;
+      }
+   }
+
+   v = probeWdlTable(b, success);
+   if(*success == 0) return 0;
+
+   if(alpha >= v)
+   {
+      *success = 1 + (alpha > 0);
+      return alpha;
+   }
+   *success = 1;
+   return v;
+}
+
+// Whether any legal move is something other than an en passant capture
+static bool_t hasNonEpMove( const board_t *b, const move_t *list, int n )
+{
+   int i;
+
+   for(i=0;i<n && isEnPassant(b, list[i]);i++);
+   return (i < n) ? TRUE : FALSE;
+}
+
+// WDL for the side to move:  2 win, 1 a win drawn by the 50-move rule, 0 draw, -1 and -2 likewise
+//   for losses.  success 0 if it isn't in the tables.
+static int probeWdl( board_t *b, int *success )
+{
+   move_t list[MAX_LIST_SIZE];
+   revMove_t rev;
+   int n, i, v, v0, v1 = -3;
+
+   *success = 1;
+   v = probeAb(b, -2, 2, success);
+
+   if(b->enPassantCol == 8)
+      return v;
+   if(*success == 0) return 0;
+
+   // The tables assume no en passant capture is possible
+   n = legalMoves(b, list);
+   for(i=0;i<n;i++)
+   {
+      if(!isEnPassant(b, list[i]))
+         continue;
+
+      rev = move(b, list[i]);
+      v0 = -probeAb(b, -2, 2, success);
+      unmove(b, rev);
+
+      if(*success == 0) return 0;
+      if(v0 > v1) v1 = v0;
+   }
+
+   if(v1 > -3)
+   {
+      if(v1 >= v)
+         v = v1;
+      else if(v == 0 && !hasNonEpMove(b, list, n))
+         v = v1;
+   }
+   return v;
+}
+
+// DTZ as probeDtz(), but as if no en passant capture were possible
+static int probeDtzNoEp( board_t *b, int *success )
+{
+   move_t list[MAX_LIST_SIZE];
+   revMove_t rev;
+   int n = 0, i, v, wdl, dtz, best;
+
+   wdl = probeAb(b, -2, 2, success);
+   if(*success == 0) return 0;
+
+   if(wdl == 0)
+      return 0;
+
+   if(*success == 2)
+      return wdl == 2 ? 1 : 101;
+
+   if(wdl > 0)
+   {
+      // A pawn move that keeps the win resets the count
+      n = legalMoves(b, list);
+      for(i=0;i<n;i++)
+      {
+         if(!isPawnMove(b, list[i]) || isCapture(b, list[i]))
+            continue;
+
+         rev = move(b, list[i]);
+         v = -probeWdl(b, success);
+         unmove(b, rev);
+
+         if(*success == 0) return 0;
+         if(v == wdl)
+            return v == 2 ? 1 : 101;
+      }
+   }
+
+   dtz = 1 + probeDtzTable(b, wdl, success);
+   if(*success >= 0)
+   {
+      if(wdl & 1) dtz += 100;
+      return wdl >= 0 ? dtz : -dtz;
+   }
+
+   // The table is for the other side to move:  look one move ahead
+   if(wdl > 0)
+   {
+      best = 0xffff;
+      for(i=0;i<n;i++)
+      {
+         if(isCapture(b, list[i]) || isPawnMove(b, list[i]))
+            continue;
+
+         rev = move(b, list[i]);
+         v = -probeDtz(b, success);
+         unmove(b, rev);
+
+         if(*success == 0) return 0;
+         if(v > 0 && v + 1 < best)
+            best = v + 1;
+      }
+      return best;
+   }
+
+   best = -1;
+   n = legalMoves(b, list);
+   for(i=0;i<n;i++)
+   {
+      rev = move(b, list[i]);
+      if(b->halfMoves == 0)
+      {
+         if(wdl == -2)
+            v = -1;
+         else
+         {
+            v = probeAb(b, 1, 2, success);
+            v = (v == 2) ? 0 : -101;
+         }
+      }
+      else
+         v = -probeDtz(b, success) - 1;
+      unmove(b, rev);
+
+      if(*success == 0) return 0;
+      if(v < best)
+         best = v;
+   }
+   return best;
+}
+
+// DTZ for the side to move:  plies to the next capture or pawn move, positive winning, negative
+//   losing, 0 drawn;  beyond +/-100 the 50-move rule draws it.  Can be one short.  success 0 if it
+//   isn't in the tables.
+static int probeDtz( board_t *b, int *success )
+{
+   move_t list[MAX_LIST_SIZE];
+   revMove_t rev;
+   int n, i, v, v0, v1 = -3;
+
+   *success = 1;
+   v = probeDtzNoEp(b, success);
+
+   if(b->enPassantCol == 8)
+      return v;
+   if(*success == 0) return 0;
+
+   n = legalMoves(b, list);
+   for(i=0;i<n;i++)
+   {
+      if(!isEnPassant(b, list[i]))
+         continue;
+
+      rev = move(b, list[i]);
+      v0 = -probeAb(b, -2, 2, success);
+      unmove(b, rev);
+
+      if(*success == 0) return 0;
+      if(v0 > v1) v1 = v0;
+   }
+
+   if(v1 > -3)
+   {
+      v1 = wdlToDtz[v1 + 2];
+
+      if(v < -100)
+      {
+         if(v1 >= 0) v = v1;
+      }
+      else if(v < 0)
+      {
+         if(v1 >= 0 || v1 < -100) v = v1;
+      }
+      else if(v > 100)
+      {
+         if(v1 > 0) v = v1;
+      }
+      else if(v > 0)
+      {
+         if(v1 == 1) v = v1;
+      }
+      else if(v1 >= 0 || !hasNonEpMove(b, list, n))
+         v = v1;
+   }
+   return v;
+}
+
+int SYZYGY_init( const char *path )
+{
+   int pcs[16] = {0};
+
+   pcs[TB_KING] = pcs[TB_KING + 8] = 1;
+   kvkKey = calc_key_from_pcs(pcs, 0);
+
+   init_tablebases(path);
+
+   // With no path the core returns before counting
+   if(path[0] == '\0')
+      max_cardinality = 0;
+
+   DPRINT("%d tables of up to %d pieces in %s\n", TBnum_piece + TBnum_pawn, max_cardinality, path);
+   return max_cardinality;
+}
+
+bool_t SYZYGY_probe( const board_t *brd, int *wdl, int *dtz )
+{
+   move_t list[MAX_LIST_SIZE];
+   board_t b = *brd;
+   int success, d;
+
+   if(bitCount(b.colors[WHITE] | b.colors[BLACK]) > max_cardinality || b.castleBits != 0 ||
+      findMoves(&b, list) <= 0)
+      return FALSE;
+
+   d = probeDtz(&b, &success);
+   if(success)
+   {
+      // The tables count from a zeroed 50-move count:  add the half moves already played
+      *dtz = d;
+      if(d > 0)
+         *wdl = (d + b.halfMoves <= 100) ? 2 : 1;
+      else if(d < 0)
+         *wdl = (-d + b.halfMoves <= 100) ? -2 : -1;
+      else
+         *wdl = 0;
+      return TRUE;
+   }
+
+   // No DTZ table for it:  the WDL tables still say who wins
+   *dtz = 0;
+   *wdl = probeWdl(&b, &success);
+   return success ? TRUE : FALSE;
+}
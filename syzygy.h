@@ -0,0 +1,28 @@
+#ifndef SYZYGY_H
+#define SYZYGY_H
+
+// Syzygy tablebase probes
+//
+// piChess's own look up of a board_t in the Syzygy WDL and DTZ tables, so a game is looked up
+//   whether or not an engine is running.  The tables are read (memory mapped) by the same core as
+//   the engine's, Ronald de Man's tbcore, built here as C;  the moves it has to try around the
+//   tables (captures, en passant, zeroing moves) are made with findMoves() and move().
+//
+// Not thread safe:  one thread opens the tables and does all the probes (tb.c's).
+
+#include "types.h"
+
+// Open the tables in path (directories separated by ':'), closing any open before.  Returns the
+//   most pieces a table found has, 0 if none were.
+int    SYZYGY_init( const char *path );
+
+// Look the position up.  FALSE if it isn't in the tables found (too many pieces, castling rights
+//   or no legal moves).  Otherwise, for the side to move:
+//
+//    wdl   2 win, 1 a win the 50-move rule turns into a draw, 0 draw, -1 and -2 the same for losses,
+//          counting the half moves already played toward the 50-move rule
+//    dtz   plies to the next capture or pawn move with best play, signed as wdl (0 if drawn, or if
+//          only the WDL tables were found)
+bool_t SYZYGY_probe( const board_t *b, int *wdl, int *dtz );
+
+#endif
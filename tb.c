@@ -0,0 +1,208 @@
+#include "tb.h"
+
+#include "hsmDefs.h"
+#include "bitboard.h"
+#include "diag.h"
+#include "display.h"
+#include "engine.h"
+#include "event.h"
+#include "hint.h"
+#include "options.h"
+#include "syzygy.h"
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TB_MAX_PROBE_ID  0x7FFF   // what fits in the event data (TB_ID())
+
+// EV_TB_RESULT data:  the probe's id, whether the position was found, and its wdl and dtz as
+//   SYZYGY_probe() gives them (dtz unsigned:  wdl has the sign)
+#define TB_DATA(id, found, wdl, dtz) \
+   ((int)(((id) & 0x7FFF) << 16 | ((found) ? 1 << 15 : 0) | (((wdl) + 2) & 7) << 12 | ((dtz) & 0xFFF)))
+
+#define TB_ID(data)     (((data) >> 16) & 0x7FFF)
+#define TB_FOUND(data)  (((data) >> 15) & 1)
+#define TB_WDL(data)    ((((data) >> 12) & 7) - 2)
+#define TB_DTZ(data)    ((data) & 0xFFF)
+
+extern game_t game;
+extern bool_t computerMovePending;
+
+static uint16_t    probeId     = 0;       // last probe sent, 1 to TB_MAX_PROBE_ID
+static int         probedMoves = -1;      // game.playedMoves it was sent at, -1 once answered
+
+static bool_t      shown       = FALSE;   // a result is on display line 2
+
+static bool_t      adjudicationPending = FALSE;
+static endReason_t pendingReason;
+
+// The position waiting for the probe thread, which opens the tables and makes every lookup
+static pthread_mutex_t probeMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  probeCond  = PTHREAD_COND_INITIALIZER;
+static pthread_t       probeThread;
+static bool_t          probeThreadStarted = FALSE;
+static bool_t          probeWaiting = FALSE;
+static board_t         probeBoard;
+static uint16_t        probeBoardId;
+
+static void *probeTask( void *arg );
+
+void TB_probe( void )
+{
+   adjudicationPending = FALSE;
+   probedMoves = -1;
+
+   if(shown)
+   {
+      displayClearLine(2);
+      shown = FALSE;
+   }
+
+   if(getOption(OPT_TABLEBASES) == TB_OFF ||
+      bitCount(game.brd.colors[WHITE] | game.brd.colors[BLACK]) > TB_MAX_PIECES)
+      return;
+
+   // Numbered whether or not the engine is there to ask, so a replay numbers them the same
+   if(++probeId > TB_MAX_PROBE_ID)
+      probeId = 1;
+
+   probedMoves = game.playedMoves;
+
+   // A replay has the answers in the trace
+   if(TRACE_isReplaying())
+      return;
+
+   pthread_mutex_lock(&probeMutex);
+
+   if(!probeThreadStarted)
+   {
+      pthread_create(&probeThread, NULL, probeTask, NULL);
+      probeThreadStarted = TRUE;
+   }
+
+   // One still waiting is replaced:  its answer would be ignored anyway
+   probeBoard   = game.brd;
+   probeBoardId = probeId;
+   probeWaiting = TRUE;
+   pthread_cond_signal(&probeCond);
+
+   pthread_mutex_unlock(&probeMutex);
+}
+
+void TB_result( event_t ev )
+{
+   int wdl = TB_WDL(ev.data);
+   int dtz = TB_DTZ(ev.data);
+   const char *winner;
+   endReason_t reason;
+   char text[30];
+
+   // An answer for a position since moved on from or taken back
+   if(TB_ID(ev.data) != probeId || game.playedMoves != probedMoves)
+      return;
+
+   probedMoves = -1;
+
+   if(!TB_FOUND(ev.data))
+      return;
+
+   winner = ((wdl > 0) == (game.brd.toMove == WHITE)) ? "White" : "Black";
+
+   if(wdl == 2 || wdl == -2)
+   {
+      // Plies to the next capture or pawn move, not to mate:  all the tables know
+      if(dtz != 0)
+         snprintf(text, sizeof(text), "TB: %c wins, DTZ %d", winner[0], dtz);
+      else
+         snprintf(text, sizeof(text), "TB: %s wins", winner);
+
+      reason = (winner[0] == 'W') ? GAME_END_TB_WHITE_WINS : GAME_END_TB_BLACK_WINS;
+   }
+   else
+   {
+      // A win that takes too long to bring about is a draw under the 50-move rule
+      snprintf(text, sizeof(text), wdl == 0 ? "TB: Draw" : "TB: Draw (50 moves)");
+      reason = GAME_END_TB_DRAW;
+   }
+
+   DPRINT("Tablebases:  %s (wdl %d, dtz %d)\n", text, wdl, dtz);
+
+   // Hints have the line, and show the tablebase scores themselves
+   if(!HINT_enabled())
+   {
+      text[20] = '\0';
+      displayWriteLine(2, text, TRUE);
+      shown = TRUE;
+   }
+
+   if(getOption(OPT_TABLEBASES) != TB_ADJUDICATE)
+      return;
+
+   if(computerMovePending)
+   {
+      adjudicationPending = TRUE;
+      pendingReason = reason;
+   }
+   else
+   {
+      event_t done = {EV_GAME_DONE, reason};
+      putEvent(EVQ_EVENT_MANAGER, &done);
+   }
+}
+
+bool_t TB_adjudication( endReason_t *reason )
+{
+   if(!adjudicationPending)
+      return FALSE;
+
+   adjudicationPending = FALSE;
+   *reason = pendingReason;
+
+   return TRUE;
+}
+
+// Looks each position handed over by TB_probe() up, posting the answer as EV_TB_RESULT.  The
+//   tables are opened the first time:  scanning TB_DIR waits until a game gets down to them.
+static void *probeTask( void *arg )
+{
+   bool_t opened = FALSE;
+   board_t b;
+   uint16_t id;
+
+   pthread_mutex_lock(&probeMutex);
+
+   while(1)
+   {
+      bool_t found = FALSE;
+      int wdl = 0, dtz = 0;
+      event_t ev;
+
+      while(!probeWaiting)
+         pthread_cond_wait(&probeCond, &probeMutex);
+
+      b  = probeBoard;
+      id = probeBoardId;
+      probeWaiting = FALSE;
+
+      pthread_mutex_unlock(&probeMutex);
+
+      if(!opened)
+      {
+         if(SYZYGY_init(TB_DIR) == 0)
+            DLOG(DIAG_WARN, "No tablebases found in %s\n", TB_DIR);
+         opened = TRUE;
+      }
+
+      found = SYZYGY_probe(&b, &wdl, &dtz);
+
+      ev.ev   = EV_TB_RESULT;
+      ev.data = TB_DATA(id, found, wdl, abs(dtz));
+      putEvent(EVQ_EVENT_MANAGER, &ev);
+
+      pthread_mutex_lock(&probeMutex);
+   }
+
+   return NULL;
+}
@@ -0,0 +1,32 @@
+#ifndef TB_H
+#define TB_H
+
+// Endgame tablebases
+//
+// While OPT_TABLEBASES is on, the engine has the Syzygy tables in TB_DIR (engine.h):  it plays a
+//   position that is in them straight from them, without a search.  And after every move of a game
+//   with few enough pieces left, TB_probe() looks the position up.  The answer comes back as an
+//   EV_TB_RESULT event, which TB_result() shows on display line 2 ("TB: W wins, DTZ 23", the plies
+//   to the next capture or pawn move:  the tables hold that, not the distance to mate).  With
+//   OPT_TABLEBASES at TB_ADJUDICATE it also ends a game whose result the tables have decided.
+//
+// The lookup is piChess's own (syzygy.h), made from the board on a thread of its own, so games
+//   between two humans are looked up and adjudicated too.  The answer arrives as event data, so a
+//   trace replays without the tables.
+
+#include "types.h"
+#include "hsm.h"
+
+#define TB_MAX_PIECES  6     // largest tables there are
+
+// Look up the game's current position, if tablebases are on and it has few enough pieces
+void   TB_probe( void );
+
+// EV_TB_RESULT action:  show the answer and adjudicate on it
+void   TB_result( event_t ev );
+
+// Adjudication waits while the computer's move is being made on the board;  this hands it over
+//   once it has been.  TRUE, with the EV_GAME_DONE reason, if the game is to end.
+bool_t TB_adjudication( endReason_t *reason );
+
+#endif
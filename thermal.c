@@ -0,0 +1,56 @@
+#include "thermal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SYS_TEMP_FILE      "/sys/class/thermal/thermal_zone0/temp"
+#define SYS_CUR_FREQ_FILE  "/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq"
+#define SYS_MAX_FREQ_FILE  "/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq"
+
+// Clocks within this many percent of the maximum count as full speed (governors step a little)
+#define THROTTLE_MARGIN_PCT  5
+
+static int32_t readValue( const char *sysFile, const char *standIn );
+
+bool_t THERMAL_read( thermalState_t *s )
+{
+   s->tempMilliC = readValue(SYS_TEMP_FILE,     "temp");
+   s->curFreqKHz = readValue(SYS_CUR_FREQ_FILE, "scaling_cur_freq");
+   s->maxFreqKHz = readValue(SYS_MAX_FREQ_FILE, "cpuinfo_max_freq");
+
+   return (s->tempMilliC >= 0 || s->curFreqKHz >= 0);
+}
+
+bool_t THERMAL_clockThrottled( const thermalState_t *s )
+{
+   if(s->curFreqKHz <= 0 || s->maxFreqKHz <= 0)
+      return FALSE;
+
+   return ((int64_t)s->curFreqKHz * 100 < (int64_t)s->maxFreqKHz * (100 - THROTTLE_MARGIN_PCT));
+}
+
+// A single integer from a sysfs file, or from its stand-in if PICHESS_THERMAL_DIR is set.  -1 if
+//   it can't be read.
+static int32_t readValue( const char *sysFile, const char *standIn )
+{
+   const char *dir = getenv(THERMAL_DIR_ENV);
+   char path[200];
+   long value;
+   FILE *fp;
+
+   if(dir != NULL)
+   {
+      snprintf(path, sizeof(path), "%s/%s", dir, standIn);
+      sysFile = path;
+   }
+
+   if( (fp = fopen(sysFile, "r")) == NULL)
+      return -1;
+
+   if(fscanf(fp, "%ld", &value) != 1 || value < 0)
+      value = -1;
+
+   fclose(fp);
+
+   return (int32_t)value;
+}
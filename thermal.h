@@ -0,0 +1,30 @@
+#ifndef THERMAL_H
+#define THERMAL_H
+
+// CPU temperature and clock
+//
+// Read from sysfs:  the first thermal zone, and cpu0's current and maximum clock.  On a Pi all
+//   the cores share one clock, which the firmware lowers when the SoC gets too hot.
+//
+// Setting PICHESS_THERMAL_DIR in the environment reads them from files in that directory instead
+//   ("temp", "scaling_cur_freq" and "cpuinfo_max_freq", in the same format as sysfs), so
+//   throttling can be tried out on a desk or in the simulator by writing to the files.
+
+#include "types.h"
+
+#define THERMAL_DIR_ENV   "PICHESS_THERMAL_DIR"
+
+typedef struct thermalState_s
+{
+   int32_t tempMilliC;   // SoC temperature, thousandths of a degree C (-1 if unknown)
+   int32_t curFreqKHz;   // current clock (-1 if unknown)
+   int32_t maxFreqKHz;   // clock it runs at when not throttled (-1 if unknown)
+}thermalState_t;
+
+// Read the current state.  FALSE if none of it could be read.
+bool_t THERMAL_read( thermalState_t *s );
+
+// The clock has been lowered below its maximum
+bool_t THERMAL_clockThrottled( const thermalState_t *s );
+
+#endif
@@ -8,6 +8,7 @@
 #include "event.h"
 #include "diag.h"
 #include "switch.h"
+#include "trace.h"
 
 #include <pthread.h>
 #include <semaphore.h>
@@ -108,7 +109,8 @@ static void *timerTask ( void *arg )
    while(1)
    {
       sem_wait(&timerSem);
-      if(errno != EINTR)
+      // While replaying an event trace, switch and timer events come from the trace
+      if(errno != EINTR && !TRACE_isReplaying())
       {
          switchPoll();
          timerTic();
@@ -130,7 +132,7 @@ timerErr_t timerStart( timerRef_t id, uint32_t val, uint32_t rel, uint16_t ev)
 
    if(id > TMR_TOTAL_TIMERS)
    {
-      DPRINT("Invalid timer id %d passed to timerStart\n", (int)id);
+      DLOG(DIAG_WARN, "Invalid timer id %d passed to timerStart\n", (int)id);
       return TMR_ERR_INVALID_ID;
    }
 
@@ -150,7 +152,7 @@ timerErr_t timerKill( timerRef_t id )
 {
    if(id > TMR_TOTAL_TIMERS)
    {
-      DPRINT("Invalid timer id %d passed to timerKill\n", (int)id);
+      DLOG(DIAG_WARN, "Invalid timer id %d passed to timerKill\n", (int)id);
       return TMR_ERR_INVALID_ID;
    }
 
@@ -168,7 +170,7 @@ timerErr_t timerGetVal( timerRef_t id, uint32_t *val)
 
    if(id > TMR_TOTAL_TIMERS)
    {
-      DPRINT("Invalid timer id %d passed to timerGetVal\n", (int)id);
+      DLOG(DIAG_WARN, "Invalid timer id %d passed to timerGetVal\n", (int)id);
       return TMR_ERR_INVALID_ID;
    }
 
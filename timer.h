@@ -23,6 +23,7 @@ typedef enum timerRef_e
    TMR_DIAG_TIMEOUT,
    TMR_COMPUTER_POLL,
    TMR_UI_BOX_CHECK,
+   TMR_HINT_POLL,
 
    TMR_TOTAL_TIMERS
 }timerRef_t;
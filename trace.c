@@ -0,0 +1,328 @@
+#include "trace.h"
+#include "hal.h"
+#include "diag.h"
+#include "options.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// File layout (all values little endian)
+//
+//    header   "PCTR", uint16 version, uint16 reserved
+//    record   uint8 type, uint8 flags, uint16 ev, int32 data, uint64 time     (16 bytes)
+//
+// For the payload record types, data holds the payload length and the payload bytes follow the
+//   record.  A seed record keeps the seed in data.  Record types are only ever added, so a log
+//   still loads in a later version.
+
+#define TRACE_MAGIC       "PCTR"
+#define TRACE_HEADER_LEN  8
+#define TRACE_RECORD_LEN  16
+
+#define TRACE_FLAG_INTERNAL 0x01
+
+// Largest options file, engine line or search we'll accept from a log
+#define TRACE_MAX_PAYLOAD 65536
+
+static FILE           *traceFile = NULL;
+static pthread_mutex_t traceMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t       hsmThread;
+static uint64_t        startTime;
+
+static bool_t          replaying   = FALSE;
+static traceRecord_t  *replayRecs  = NULL;
+static int             replayCount = 0;
+static int             seedCursor  = 0;
+
+static void traceWrite( traceRecType_t type, uint8_t flags, uint16_t ev, int32_t data, char *payload );
+static void putLE( uint8_t *buf, uint64_t val, int len );
+static uint64_t getLE( uint8_t *buf, int len );
+static void traceOptions( void );
+
+traceErr_t TRACE_start( char *file )
+{
+   char oldName[100];
+   uint8_t header[TRACE_HEADER_LEN];
+
+   if(replaying || traceFile != NULL) return TRACE_ERR_NONE;
+
+   // Keep the last session around
+   sprintf(oldName, "%s.1", file);
+   rename(file, oldName);
+
+   if( (traceFile = fopen(file, "wb")) == NULL)
+   {
+      DLOG(DIAG_ERROR, "Unable to open event trace file %s\n", file);
+      return TRACE_ERR_FILE_OPEN;
+   }
+
+   memcpy(header, TRACE_MAGIC, 4);
+   putLE(&header[4], TRACE_VERSION, 2);
+   putLE(&header[6], 0, 2);
+   fwrite(header, 1, TRACE_HEADER_LEN, traceFile);
+
+   hsmThread = pthread_self();
+   startTime = HAL_timeMicros();
+
+   traceOptions();
+
+   DPRINT("Recording events to %s\n", file);
+
+   return TRACE_ERR_NONE;
+}
+
+void TRACE_stop( void )
+{
+   pthread_mutex_lock(&traceMutex);
+
+   if(traceFile != NULL)
+   {
+      fclose(traceFile);
+      traceFile = NULL;
+   }
+
+   pthread_mutex_unlock(&traceMutex);
+}
+
+void TRACE_event( evQueueIndex_t indx, event_t *ev )
+{
+   if(traceFile == NULL) return;
+
+   // Events posted while the state machine is handling another event are its own doing
+   traceWrite(TRACE_REC_EVENT, pthread_equal(pthread_self(), hsmThread) ? TRACE_FLAG_INTERNAL : 0,
+              ev->ev, ev->data, NULL);
+}
+
+void TRACE_engineResult( char *line )
+{
+   if(traceFile == NULL) return;
+
+   traceWrite(TRACE_REC_ENGINE, 0, 0, strlen(line), line);
+}
+
+void TRACE_engineSearch( char *commands )
+{
+   if(traceFile == NULL) return;
+
+   traceWrite(TRACE_REC_SEARCH, 0, 0, strlen(commands), commands);
+}
+
+unsigned int TRACE_seed( unsigned int seed )
+{
+   if(replaying)
+   {
+      while(seedCursor < replayCount)
+      {
+         if(replayRecs[seedCursor++].type == TRACE_REC_SEED)
+            return (unsigned int)replayRecs[seedCursor - 1].ev.data;
+      }
+
+      DPRINT("Event trace has no more seeds recorded\n");
+      return seed;
+   }
+
+   if(traceFile != NULL)
+      traceWrite(TRACE_REC_SEED, 0, 0, (int32_t)seed, NULL);
+
+   return seed;
+}
+
+traceErr_t TRACE_load( char *file, traceRecord_t **recs, int *count )
+{
+   FILE *fp;
+   uint8_t buf[TRACE_RECORD_LEN];
+   traceRecord_t *list = NULL;
+   int n = 0, size = 0;
+   traceErr_t retVal = TRACE_ERR_NONE;
+
+   *recs  = NULL;
+   *count = 0;
+
+   if( (fp = fopen(file, "rb")) == NULL)
+      return TRACE_ERR_FILE_OPEN;
+
+   if( fread(buf, 1, TRACE_HEADER_LEN, fp) != TRACE_HEADER_LEN ||
+       memcmp(buf, TRACE_MAGIC, 4)                                ||
+       getLE(&buf[4], 2) != TRACE_VERSION )
+   {
+      fclose(fp);
+      return TRACE_ERR_BAD_HEADER;
+   }
+
+   // A session that ended with a crash may end with a partial record; just stop there.
+   while( fread(buf, 1, TRACE_RECORD_LEN, fp) == TRACE_RECORD_LEN )
+   {
+      traceRecord_t *r;
+
+      if(n == size)
+      {
+         traceRecord_t *bigger;
+
+         size = (size == 0 ? 1024 : size * 2);
+
+         if( (bigger = realloc(list, size * sizeof(traceRecord_t))) == NULL)
+         {
+            retVal = TRACE_ERR_NO_MEM;
+            break;
+         }
+         list = bigger;
+      }
+
+      r = &list[n];
+      memset(r, 0, sizeof(traceRecord_t));
+
+      r->type     = buf[0];
+      r->internal = (buf[1] & TRACE_FLAG_INTERNAL) ? TRUE : FALSE;
+      r->ev.ev    = getLE(&buf[2], 2);
+      r->ev.data  = (int32_t)getLE(&buf[4], 4);
+      r->time     = getLE(&buf[8], 8);
+
+      if(r->type >= TRACE_REC_TOTAL)
+      {
+         retVal = TRACE_ERR_BAD_RECORD;
+         break;
+      }
+
+      if(r->type == TRACE_REC_OPTIONS || r->type == TRACE_REC_ENGINE || r->type == TRACE_REC_SEARCH)
+      {
+         if(r->ev.data < 0 || r->ev.data > TRACE_MAX_PAYLOAD)
+         {
+            retVal = TRACE_ERR_BAD_RECORD;
+            break;
+         }
+
+         r->len = r->ev.data;
+
+         if( (r->payload = malloc(r->len + 1)) == NULL)
+         {
+            retVal = TRACE_ERR_NO_MEM;
+            break;
+         }
+
+         if(fread(r->payload, 1, r->len, fp) != r->len)
+         {
+            free(r->payload);
+            break;
+         }
+         r->payload[r->len] = 0x00;
+      }
+
+      n++;
+   }
+
+   fclose(fp);
+
+   if(retVal != TRACE_ERR_NONE)
+   {
+      TRACE_free(list, n);
+      return retVal;
+   }
+
+   *recs  = list;
+   *count = n;
+
+   return TRACE_ERR_NONE;
+}
+
+void TRACE_free( traceRecord_t *recs, int count )
+{
+   int i;
+
+   if(recs == NULL) return;
+
+   for(i=0;i<count;i++)
+      free(recs[i].payload);
+
+   free(recs);
+}
+
+void TRACE_setReplay( traceRecord_t *recs, int count )
+{
+   replaying   = TRUE;
+   replayRecs  = recs;
+   replayCount = count;
+   seedCursor  = 0;
+}
+
+bool_t TRACE_isReplaying( void )
+{
+   return replaying;
+}
+
+static void traceWrite( traceRecType_t type, uint8_t flags, uint16_t ev, int32_t data, char *payload )
+{
+   uint8_t buf[TRACE_RECORD_LEN];
+
+   pthread_mutex_lock(&traceMutex);
+
+   if(traceFile != NULL)
+   {
+      buf[0] = type;
+      buf[1] = flags;
+      putLE(&buf[2], ev, 2);
+      putLE(&buf[4], (uint32_t)data, 4);
+      putLE(&buf[8], HAL_timeMicros() - startTime, 8);
+
+      fwrite(buf, 1, TRACE_RECORD_LEN, traceFile);
+
+      if(payload != NULL)
+         fwrite(payload, 1, data, traceFile);
+
+      // Only a couple dozen events a second at most, so push each one out.  That way the log is
+      //   complete up to the point of a crash.
+      fflush(traceFile);
+   }
+
+   pthread_mutex_unlock(&traceMutex);
+}
+
+// Store the options file (just written by loadOptions) so the replay starts from the same settings
+static void traceOptions( void )
+{
+   FILE *fp;
+   char *text;
+   long len;
+
+   if( (fp = fopen(OPTIONS_FILE, "rb")) == NULL)
+      return;
+
+   fseek(fp, 0, SEEK_END);
+   len = ftell(fp);
+   rewind(fp);
+
+   if( len > 0 && len <= TRACE_MAX_PAYLOAD && (text = malloc(len + 1)) != NULL)
+   {
+      if(fread(text, 1, len, fp) == len)
+      {
+         text[len] = 0x00;
+         traceWrite(TRACE_REC_OPTIONS, 0, 0, (int32_t)len, text);
+      }
+      free(text);
+   }
+
+   fclose(fp);
+}
+
+static void putLE( uint8_t *buf, uint64_t val, int len )
+{
+   int i;
+
+   for(i=0;i<len;i++)
+   {
+      buf[i] = val & 0xFF;
+      val >>= 8;
+   }
+}
+
+static uint64_t getLE( uint8_t *buf, int len )
+{
+   uint64_t val = 0;
+   int i;
+
+   for(i=len-1;i>=0;i--)
+      val = (val << 8) | buf[i];
+
+   return val;
+}
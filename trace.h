@@ -0,0 +1,86 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Event trace recorder
+//
+// When the "eventTrace" option is "true", every event passed to putEvent() is written to a compact
+//   binary log (TRACE_FILE in the working directory) along with a microsecond timestamp.  The few
+//   inputs that do not arrive as events are logged too, so the session can be reproduced exactly:
+//
+//    - the options file as it was at start up
+//    - the text the engine left in its result file
+//    - the seed used for random book move selection
+//    - the engine commands that repeat a repeatable search for a move (see sfInterface.h)
+//
+// The previous log is kept as TRACE_FILE ".1" so the session that crashed survives a restart.
+//
+// piChessReplay (replay.c) loads a log and feeds it through a fresh copy of the state machine.
+
+#include "types.h"
+#include "hsm.h"
+#include "event.h"
+
+#define TRACE_FILE    "events.trc"
+#define TRACE_VERSION 1
+
+typedef enum traceRecType_e
+{
+   TRACE_REC_EVENT,       // event passed to putEvent()
+   TRACE_REC_OPTIONS,     // contents of the options file (payload)
+   TRACE_REC_ENGINE,      // line read from the engine result file (payload)
+   TRACE_REC_SEED,        // random seed (in ev.data)
+   TRACE_REC_SEARCH,      // engine commands repeating a search for a move (payload)
+
+   TRACE_REC_TOTAL
+}traceRecType_t;
+
+typedef enum traceErr_e
+{
+   TRACE_ERR_NONE,
+   TRACE_ERR_FILE_OPEN,
+   TRACE_ERR_BAD_HEADER,
+   TRACE_ERR_BAD_RECORD,
+   TRACE_ERR_NO_MEM
+}traceErr_t;
+
+typedef struct traceRecord_s
+{
+   traceRecType_t type;
+   bool_t         internal;  // event posted by the state machine itself (vs. switches, timers, engine)
+   uint64_t       time;      // microseconds since the trace was started
+   event_t        ev;
+   uint32_t       len;       // payload length
+   char          *payload;   // NUL terminated, NULL if none
+}traceRecord_t;
+
+// Recording
+
+// Start recording to file (no effect while replaying).  Must be called from the state machine's thread.
+traceErr_t TRACE_start( char *file );
+void       TRACE_stop( void );
+
+// Called from putEvent() for every event queued
+void       TRACE_event( evQueueIndex_t indx, event_t *ev );
+
+// Log the text read from the engine result file
+void       TRACE_engineResult( char *line );
+
+// Log the engine commands that repeat the search for a move just started
+void       TRACE_engineSearch( char *commands );
+
+// Pass a freshly generated random seed through.  While recording the seed is logged;  while
+//   replaying the recorded seed is returned instead.
+unsigned int TRACE_seed( unsigned int seed );
+
+// Replaying
+
+// Load an entire log into memory.  Caller frees with TRACE_free()
+traceErr_t TRACE_load( char *file, traceRecord_t **recs, int *count );
+void       TRACE_free( traceRecord_t *recs, int count );
+
+// Puts the program in replay mode:  the recorder is disabled, the timer task and engine are not
+//   started and TRACE_seed() hands back the seeds found in recs.
+void       TRACE_setReplay( traceRecord_t *recs, int count );
+bool_t     TRACE_isReplaying( void );
+
+#endif
@@ -121,6 +121,19 @@ typedef struct posHistory_s
 }posHistory_t;
 
 
+/// Longest text one ply adds to a move record:  separator, move number ("123.") and the move
+///   ("exd8=Q+")
+#define MOVE_TEXT_MAX  16
+
+/// Text of the moves of a game, one ply after another separated by spaces.  See moveRecord.h
+typedef struct moveRecord_s
+{
+   int      plies;                                   ///< Plies in the record
+   uint16_t offset[MAX_MOVES_IN_GAME];               ///< Length of the text before each ply
+   uint16_t length;                                  ///< Length of the whole text
+   char     text[MAX_MOVES_IN_GAME * MOVE_TEXT_MAX]; ///< The moves, NUL terminated
+}moveRecord_t;
+
 /// Current state of the game...
 typedef struct game_s
 {
@@ -141,8 +154,8 @@ typedef struct game_s
     /// Position hash value.  Used to enforce the 3-fold and 5-fold repetition rules
     posHistory_t posHistory[MAX_MOVES_IN_GAME];
 
-    char moveRecord[MAX_MOVES_IN_GAME * 5 + 16 + 1]; ///< The coord notation text string of the moves made in this game.  This is passed to the chess engine
-    char SANRecord[MAX_MOVES_IN_GAME * 5]; ///< The SAN notation text string of the moves made in this game.  This is used for recording of game and display of recent moves on display
+    moveRecord_t moveRecord; ///< The coord notation text of the moves made in this game.  This is passed to the chess engine
+    moveRecord_t SANRecord;  ///< The SAN notation text of the moves made in this game.  This is used for recording of game and display of recent moves on display
 
     int playedMoves;  ///< total number of half-moves already made in game
 
@@ -179,6 +192,9 @@ typedef enum endReason_s
    GAME_END_3FOLD_REP,              ///< 3-fold repetition claimed
    GAME_END_5FOLD_REP,              ///< 5-fold repetition occurred
    GAME_END_TIME_EXPIRED,           ///< Time expiration claimed
+   GAME_END_TB_WHITE_WINS,          ///< Adjudicated from the tablebases:  white wins
+   GAME_END_TB_BLACK_WINS,          ///< Adjudicated from the tablebases:  black wins
+   GAME_END_TB_DRAW,                ///< Adjudicated from the tablebases:  drawn
    GAME_END_ABORT,                  ///< Game was aborted before finish
 }endReason_t;
 
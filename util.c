@@ -49,7 +49,7 @@ char *convertSqNumToCoord(int sq)
 
    if(sq>63)
    {
-      DPRINT("ERROR: Invalid square number in convertSqNumToCoord\n");
+      DLOG(DIAG_ERROR, "ERROR: Invalid square number in convertSqNumToCoord\n");
       coord[0] = coord[1] = '?';
    }
    else